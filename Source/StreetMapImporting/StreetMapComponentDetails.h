@@ -25,7 +25,7 @@ public:
 	/** Handles create static mesh asset button clicking */
 	FReply OnCreateStaticMeshAssetClicked();
 
-	void CreateStaticMeshAsset(FString UserPackageName, FName MeshName, TArray<FStreetMapVertex> RawMeshVertices, TArray<uint32> RawMeshIndices);
+	void CreateStaticMeshAsset(FString UserPackageName, FName MeshName, EVertexType VertexType, TArray<FStreetMapVertex> RawMeshVertices, TArray<uint32> RawMeshIndices);
 
 	/** Handles build/rebuild mesh button clicking */
 	FReply OnBuildMeshClicked();
@@ -0,0 +1,303 @@
+// Copyright 2017 Mike Fricker. All Rights Reserved.
+
+#include "StreetMapImporting.h"
+#include "StreetMap.h"
+#include "StreetMapComponent.h"
+#include "Misc/AutomationTest.h"
+#include "Serialization/MemoryWriter.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/ObjectAndNameAsStringProxyArchive.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+/**
+ * A small grid of disconnected roads of every type and both directions, two roads per TMC, with a building next to
+ * every road.  Roads bend slightly halfway, so coarser LODs drop their middle point.
+ */
+static UStreetMap* CreateTestStreetMap(int32 NumRoads, float SpeedLimit)
+{
+	UStreetMap* StreetMap = NewObject<UStreetMap>(GetTransientPackage());
+	TArray<FStreetMapRoad>& Roads = StreetMap->GetRoads();
+	TArray<FStreetMapNode>& Nodes = StreetMap->GetNodes();
+	TArray<FStreetMapBuilding>& Buildings = StreetMap->GetBuildings();
+
+	for (int32 RoadIndex = 0; RoadIndex < NumRoads; ++RoadIndex)
+	{
+		const FVector2D Start((RoadIndex % 8) * 1000.0f, (RoadIndex / 8) * 1000.0f);
+		const FVector2D Middle = Start + FVector2D(400.0f, 50.0f);
+		const FVector2D End = Start + FVector2D(800.0f, 0.0f);
+
+		FStreetMapRoad& Road = Roads.AddDefaulted_GetRef();
+		Road.RoadName = FString::Printf(TEXT("Road %d"), RoadIndex);
+		Road.Link = FStreetMapLink(RoadIndex + 1, RoadIndex % 2 ? TEXT("F") : TEXT("T"));
+		Road.TMC = FName(*FString::Printf(TEXT("TMC%03d"), RoadIndex / 2));
+		Road.SpeedLimit = SpeedLimit;
+		Road.RoadType = (EStreetMapRoadType)(RoadIndex % 3);
+		Road.RoadPoints = { Start, Middle, End };
+		Road.Distance = 2.0f * FVector2D::Distance(Start, Middle);
+		Road.BoundsMin = Start;
+		Road.BoundsMax = FVector2D(End.X, Middle.Y);
+
+		for (int32 PointIndex = 0; PointIndex < Road.RoadPoints.Num(); ++PointIndex)
+		{
+			FStreetMapNode& Node = Nodes.AddDefaulted_GetRef();
+			Node.RoadRefs.Add({ RoadIndex, PointIndex });
+			Road.NodeIndices.Add(Nodes.Num() - 1);
+		}
+
+		FStreetMapBuilding& Building = Buildings.AddDefaulted_GetRef();
+		Building.BuildingName = FString::Printf(TEXT("Building %d"), RoadIndex);
+		Building.BoundsMin = Start + FVector2D(200.0f, 300.0f);
+		Building.BoundsMax = Start + FVector2D(600.0f, 600.0f);
+		Building.BuildingPoints = { Building.BoundsMin, FVector2D(Building.BoundsMax.X, Building.BoundsMin.Y), Building.BoundsMax, FVector2D(Building.BoundsMin.X, Building.BoundsMax.Y) };
+		Building.Height = 10.0f * (RoadIndex % 3);
+		Building.BuildingLevels = RoadIndex % 4;
+	}
+
+	return StreetMap;
+}
+
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FStreetMapRoadAttributeColorTest, "StreetMap.RoadAttributeColors", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FStreetMapRoadAttributeColorTest::RunTest(const FString& Parameters)
+{
+	// Speed ratios on and around the edges of the color bands, the quantized slots must not move a road to another band
+	const float SpeedLimit = 50.0f;
+	const TArray<float> SpeedRatios = { 1.0f, 0.801f, 0.8f, 0.799f, 0.501f, 0.5f, 0.499f, 0.3f, 0.0f };
+	const int32 NumSpeedRatios = SpeedRatios.Num();
+
+	UStreetMap* StreetMap = CreateTestStreetMap(2 * (NumSpeedRatios + 1), SpeedLimit);
+	const TArray<FStreetMapRoad>& Roads = StreetMap->GetRoads();
+
+	UStreetMapComponent* Component = NewObject<UStreetMapComponent>(GetTransientPackage());
+	FStreetMapMeshBuildSettings Settings = Component->GetMeshBuildSettings();
+	Settings.bUseRoadAttributes = true;
+	Settings.ColorMode = EColorMode::Flow;
+	Component->SetMeshBuildSettings(Settings);
+	Component->SetStreetMap(StreetMap);
+	Component->IndexStreetMap();
+
+	// The last TMC has no data and is drawn at its speed limit
+	for (int32 RatioIndex = 0; RatioIndex < NumSpeedRatios; ++RatioIndex)
+	{
+		const FName TMC = Roads[2 * RatioIndex].TMC;
+		const float FlowRatio = SpeedRatios[RatioIndex];
+		const float PredictiveRatio = SpeedRatios[NumSpeedRatios - 1 - RatioIndex];
+		Component->AddOrUpdateFlowData(TMC, FlowRatio * SpeedLimit);
+		Component->AddOrUpdatePredictiveData(TMC, SpeedLimit, PredictiveRatio * SpeedLimit, SpeedLimit, SpeedLimit);
+	}
+
+	Component->InitRoadAttributes();
+
+	for (const EColorMode ColorMode : { EColorMode::Flow, EColorMode::Predictive15 })
+	{
+		Component->SetColorMode(ColorMode);
+
+		for (int32 RoadIndex = 0; RoadIndex < Roads.Num(); ++RoadIndex)
+		{
+			float Speed, RoadSpeedLimit, SpeedRatio;
+			FColor SlotColor;
+			Component->GetSpeedAndColorFromData(&Roads[RoadIndex], Speed, RoadSpeedLimit, SpeedRatio, SlotColor);
+
+			TestEqual(FString::Printf(TEXT("Color of road %d at speed ratio %g in color mode %d"), RoadIndex, SpeedRatio, (int32)ColorMode),
+				Component->ResolveRoadAttributeColor(RoadIndex), SlotColor);
+		}
+	}
+
+	return true;
+}
+
+
+/** The mesh a build generated as bytes, laid out the way the cached mesh is saved */
+static void GetMeshBuildBytes(FStreetMapMeshBuild& Build, TArray<uint8>& OutBytes)
+{
+	FMemoryWriter Writer(OutBytes);
+	for (int32 SectionIndex = 0; SectionIndex < FStreetMapSceneProxy::NumSections; ++SectionIndex)
+	{
+		Writer << Build.Vertices[SectionIndex] << Build.Indices[SectionIndex];
+	}
+	Writer << Build.RoadVertexRanges << Build.MeshBoundingBox;
+
+	int32 NumChunks = Build.MeshChunks.Num();
+	Writer << NumChunks;
+	for (FStreetMapMeshChunk& Chunk : Build.MeshChunks)
+	{
+		Writer << Chunk << Chunk.LOD;
+	}
+}
+
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FStreetMapParallelMeshTest, "StreetMap.ParallelMesh", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FStreetMapParallelMeshTest::RunTest(const FString& Parameters)
+{
+	UStreetMap* StreetMap = CreateTestStreetMap(48, 50.0f);
+
+	UStreetMapComponent* Component = NewObject<UStreetMapComponent>(GetTransientPackage());
+	Component->SetStreetMap(StreetMap);
+
+	// Smooth and straight roads lay their vertices out differently
+	for (const bool bWantSmoothStreets : { true, false })
+	{
+		FStreetMapMeshBuildSettings Settings = Component->GetMeshBuildSettings();
+		Settings.bWantSmoothStreets = bWantSmoothStreets;
+		Component->SetMeshBuildSettings(Settings);
+
+		TArray<uint8> MeshBytes[2];
+		for (int32 BuildIndex = 0; BuildIndex < 2; ++BuildIndex)
+		{
+			FStreetMapMeshBuild Build;
+			Build.bSingleThreaded = BuildIndex == 0;
+			Component->CaptureMeshBuild(Build);
+			Component->GenerateMesh(Build);
+
+			TestTrue(TEXT("Mesh has vertices"), Build.Vertices[EVertexType::VStreet].Num() > 0 && Build.Vertices[EVertexType::VBuilding].Num() > 0);
+			TestEqual(TEXT("Vertex range of every road"), Build.RoadVertexRanges.Num(), StreetMap->GetRoads().Num());
+			GetMeshBuildBytes(Build, MeshBytes[BuildIndex]);
+		}
+
+		TestTrue(FString::Printf(TEXT("Parallel mesh is the serial mesh, smooth streets %d"), bWantSmoothStreets), MeshBytes[0] == MeshBytes[1]);
+	}
+
+	return true;
+}
+
+
+/** The cached mesh of a component as bytes, with the per-road texture coordinates it draws */
+static void GetCachedMeshBytes(const UStreetMapComponent* Component, TArray<uint8>& OutBytes)
+{
+	FMemoryWriter Writer(OutBytes);
+	for (int32 SectionIndex = 0; SectionIndex < FStreetMapSceneProxy::NumSections; ++SectionIndex)
+	{
+		const EVertexType VertexType = (EVertexType)SectionIndex;
+		TArray<FStreetMapVertex> Vertices = Component->GetRawMeshVertices(VertexType);
+		TArray<uint32> Indices = Component->GetRawMeshIndices(VertexType);
+		TArray<FVector2D> TexCoords4, TexCoords5;
+		Component->GetRawMeshRoadTexCoords(VertexType, TexCoords4, TexCoords5);
+		Writer << Vertices << Indices << TexCoords4 << TexCoords5;
+	}
+}
+
+/** Saves a component the way a level does and loads it into a new one */
+static UStreetMapComponent* SaveAndLoadComponent(UStreetMapComponent* Component, TFunctionRef<void()> BeforeLoad)
+{
+	TArray<uint8> Bytes;
+	FMemoryWriter Writer(Bytes, true);
+	FObjectAndNameAsStringProxyArchive SaveArchive(Writer, false);
+	Component->Serialize(SaveArchive);
+
+	BeforeLoad();
+
+	UStreetMapComponent* LoadedComponent = NewObject<UStreetMapComponent>(GetTransientPackage());
+	FMemoryReader Reader(Bytes, true);
+	FObjectAndNameAsStringProxyArchive LoadArchive(Reader, false);
+	LoadedComponent->Serialize(LoadArchive);
+	LoadedComponent->PostLoad();
+
+	return LoadedComponent;
+}
+
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FStreetMapCachedMeshTest, "StreetMap.CachedMesh", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FStreetMapCachedMeshTest::RunTest(const FString& Parameters)
+{
+	UStreetMap* StreetMap = CreateTestStreetMap(48, 50.0f);
+
+	UStreetMapComponent* Component = NewObject<UStreetMapComponent>(GetTransientPackage());
+	Component->SetStreetMap(StreetMap, false, true);
+	if (!TestTrue(TEXT("Mesh was built"), Component->HasValidMesh()))
+	{
+		return false;
+	}
+
+	TArray<uint8> SavedMesh;
+	GetCachedMeshBytes(Component, SavedMesh);
+
+	// Loaded as saved, compressed
+	UStreetMapComponent* LoadedComponent = SaveAndLoadComponent(Component, []() {});
+	TestTrue(TEXT("Street map of the loaded component"), LoadedComponent->GetStreetMap() == StreetMap);
+
+	TArray<uint8> LoadedMesh;
+	GetCachedMeshBytes(LoadedComponent, LoadedMesh);
+	TestTrue(TEXT("Loaded mesh is the saved mesh"), LoadedMesh == SavedMesh);
+
+	// A road moved after the mesh was saved, the mesh build hash no longer matches and the mesh is generated again on load
+	LoadedComponent = SaveAndLoadComponent(Component, [StreetMap]()
+	{
+		StreetMap->GetRoads()[0].RoadPoints[1] += FVector2D(0.0f, 200.0f);
+	});
+
+	UStreetMapComponent* RebuiltComponent = NewObject<UStreetMapComponent>(GetTransientPackage());
+	RebuiltComponent->SetStreetMap(StreetMap, false, true);
+
+	TArray<uint8> RebuiltMesh;
+	GetCachedMeshBytes(RebuiltComponent, RebuiltMesh);
+	GetCachedMeshBytes(LoadedComponent, LoadedMesh);
+	TestFalse(TEXT("Moved road changes the mesh"), RebuiltMesh == SavedMesh);
+	TestTrue(TEXT("Stale mesh is generated again on load"), LoadedMesh == RebuiltMesh);
+
+	return true;
+}
+
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FStreetMapRoadSegmentTest, "StreetMap.RoadSegments", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FStreetMapRoadSegmentTest::RunTest(const FString& Parameters)
+{
+	// A segment along X covers the half of the road right of its centerline when forward, the left half otherwise
+	const FVector ForwardCorners[4] = { FVector(0.0f, 0.0f, 5.0f), FVector(0.0f, 10.0f, 5.0f), FVector(100.0f, 10.0f, 5.0f), FVector(100.0f, 0.0f, 5.0f) };
+	const FVector BackwardCorners[4] = { FVector(0.0f, -10.0f, 5.0f), FVector(0.0f, 0.0f, 5.0f), FVector(100.0f, 0.0f, 5.0f), FVector(100.0f, -10.0f, 5.0f) };
+
+	FVector QuadCorners[4];
+	FStreetMapRoadSegments::GetQuadCorners(QuadCorners);
+
+	for (const bool bForward : { true, false })
+	{
+		const FVector2D Start(0.0f, 0.0f);
+		const FVector2D End(100.0f, 0.0f);
+
+		FVector Corners[4];
+		FStreetMapRoadSegments::ExpandSegment(Start, End, 5.0f, 20.0f, bForward, Corners);
+		const FTransform Transform = FStreetMapRoadSegments::GetInstanceTransform(Start, End, 5.0f, 20.0f, bForward);
+
+		for (int32 Corner = 0; Corner < 4; ++Corner)
+		{
+			const FVector& Expected = bForward ? ForwardCorners[Corner] : BackwardCorners[Corner];
+			TestEqual(FString::Printf(TEXT("Corner %d of the expanded segment, forward %d"), Corner, bForward), Corners[Corner], Expected, KINDA_SMALL_NUMBER);
+			TestEqual(FString::Printf(TEXT("Corner %d of the segment instance, forward %d"), Corner, bForward), Transform.TransformPosition(QuadCorners[Corner]), Expected, 0.001f);
+		}
+	}
+
+	UStreetMap* StreetMap = CreateTestStreetMap(48, 50.0f);
+	int32 NumSegments = 0;
+	for (const FStreetMapRoad& Road : StreetMap->GetRoads())
+	{
+		NumSegments += Road.RoadPoints.Num() - 1;
+	}
+
+	UStreetMapComponent* Component = NewObject<UStreetMapComponent>(GetTransientPackage());
+	Component->SetStreetMap(StreetMap);
+
+	// Straight roads in the mesh are compared with their quads too, segment roads with their instances only
+	for (const bool bDrawRoadsAsSegments : { false, true })
+	{
+		FStreetMapMeshBuildSettings Settings = Component->GetMeshBuildSettings();
+		Settings.bWantSmoothStreets = false;
+		Settings.bDrawRoadsAsSegments = bDrawRoadsAsSegments;
+		Component->SetMeshBuildSettings(Settings);
+		Component->BuildMesh();
+
+		const FStreetMapRoadSegmentStats Stats = Component->ValidateRoadSegments();
+		const FString Mode = bDrawRoadsAsSegments ? TEXT("segments") : TEXT("mesh");
+		TestEqual(FString::Printf(TEXT("Segments drawing roads as %s"), *Mode), Stats.NumSegments, NumSegments);
+		TestEqual(FString::Printf(TEXT("Validated segments drawing roads as %s"), *Mode), Stats.NumValidatedSegments, NumSegments);
+		TestTrue(FString::Printf(TEXT("Corner error drawing roads as %s"), *Mode), Stats.MaxCornerError < 0.01f);
+		TestTrue(FString::Printf(TEXT("Instances are smaller than mesh quads drawing roads as %s"), *Mode), Stats.InstanceBytes < Stats.ExpandedBytes);
+	}
+
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
@@ -0,0 +1,318 @@
+// Copyright 2017 Mike Fricker. All Rights Reserved.
+
+#include "StreetMapImporting.h"
+#include "StreetMapFlowReplayCommandlet.h"
+#include "StreetMap.h"
+#include "StreetMapActor.h"
+#include "StreetMapComponent.h"
+#include "StreetMapFlowFeed.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "HAL/PlatformFilemanager.h"
+#include "RenderingThread.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogStreetMapFlowReplay, Log, All);
+
+
+const TCHAR* UStreetMapFlowReplayCommandlet::CsvHeader = TEXT("Speedup,Frame,Records,IngestLatencyMeanMs,IngestLatencyMaxMs,RecolorMs,UploadBytes,GameThreadUsPerUpdate");
+
+void UStreetMapFlowReplayCommandlet::GenerateSyntheticRecords(const UStreetMap* StreetMap, int32 NumRecords, TArray<FStreetMapFlowUpdate>& OutRecords)
+{
+	TMap<FName, float> SpeedLimits;
+	for (const FStreetMapRoad& Road : StreetMap->GetRoads())
+	{
+		if (!Road.TMC.IsNone() && !SpeedLimits.Contains(Road.TMC))
+		{
+			SpeedLimits.Add(Road.TMC, Road.SpeedLimit > 0 ? (float)Road.SpeedLimit : 100.0f);
+		}
+	}
+
+	TArray<FName> TMCs;
+	SpeedLimits.GenerateKeyArray(TMCs);
+	if (TMCs.Num() == 0) return;
+
+	FRandomStream Random(0x57EE7);
+	OutRecords.Reserve(NumRecords);
+	for (int32 Index = 0; Index < NumRecords; ++Index)
+	{
+		const FName TMC = TMCs[Random.RandHelper(TMCs.Num())];
+		const float SpeedLimit = SpeedLimits[TMC];
+		const float SpeedRatio = Random.FRand() < 0.7f ? Random.FRandRange(0.8f, 1.1f) : Random.FRandRange(0.0f, 0.8f);
+		OutRecords.Add({ TMC, SpeedRatio * SpeedLimit, 0.0 });
+	}
+}
+
+
+UStreetMapFlowReplayCommandlet::UStreetMapFlowReplayCommandlet(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+	IsClient = false;
+	IsEditor = true;
+	IsServer = false;
+	LogToConsole = true;
+}
+
+int32 UStreetMapFlowReplayCommandlet::Main(const FString& Params)
+{
+	FString MapPath;
+	if (!FParse::Value(*Params, TEXT("Map="), MapPath))
+	{
+		UE_LOG(LogStreetMapFlowReplay, Error, TEXT("Missing -Map=<street map asset>"));
+		return 1;
+	}
+
+	UStreetMap* StreetMap = LoadObject<UStreetMap>(nullptr, *MapPath);
+	if (StreetMap == nullptr)
+	{
+		UE_LOG(LogStreetMapFlowReplay, Error, TEXT("Can't load street map %s"), *MapPath);
+		return 1;
+	}
+
+	// The replayed feed goes through a real worker thread, reading a file the replay appends to
+	FStreetMapFlowReplaySettings Settings;
+	Settings.Feed.Source = EStreetMapFeedSource::FileTail;
+	Settings.Feed.bTailFromEnd = false;
+	Settings.Feed.Path = FPaths::ProjectSavedDir() / TEXT("StreetMap") / TEXT("FlowReplayFeed.tmp");
+
+	FString Format;
+	if (FParse::Value(*Params, TEXT("Format="), Format) && Format == TEXT("Binary"))
+	{
+		Settings.Feed.Format = EStreetMapFeedFormat::Binary;
+	}
+
+	TArray<FStreetMapFlowUpdate> Records;
+	FString FlowPath;
+	if (FParse::Value(*Params, TEXT("Flow="), FlowPath))
+	{
+		TArray<uint8> RecordedBytes;
+		if (!FFileHelper::LoadFileToArray(RecordedBytes, *FlowPath))
+		{
+			UE_LOG(LogStreetMapFlowReplay, Error, TEXT("Can't read recorded feed %s"), *FlowPath);
+			return 1;
+		}
+
+		int64 NumRejected = 0;
+		FStreetMapFlowFeed::Decode(Settings.Feed, RecordedBytes.GetData(), RecordedBytes.Num(), Records, NumRejected);
+		UE_LOG(LogStreetMapFlowReplay, Display, TEXT("Loaded %d records from %s, %lld rejected"), Records.Num(), *FlowPath, NumRejected);
+	}
+	else
+	{
+		int32 NumSynthetic = 100000;
+		FParse::Value(*Params, TEXT("Synthetic="), NumSynthetic);
+		GenerateSyntheticRecords(StreetMap, NumSynthetic, Records);
+		UE_LOG(LogStreetMapFlowReplay, Display, TEXT("Generated %d synthetic records"), Records.Num());
+	}
+
+	if (Records.Num() == 0)
+	{
+		UE_LOG(LogStreetMapFlowReplay, Error, TEXT("Nothing to replay"));
+		return 1;
+	}
+
+	FString SpeedupList = TEXT("1,10,100");
+	FString OutPath = FPaths::ProjectSavedDir() / TEXT("StreetMap") / TEXT("FlowReplay.csv");
+	FParse::Value(*Params, TEXT("Rate="), Settings.Rate);
+	FParse::Value(*Params, TEXT("FrameRate="), Settings.FrameRate);
+	FParse::Value(*Params, TEXT("Speedups="), SpeedupList);
+	FParse::Value(*Params, TEXT("Out="), OutPath);
+	Settings.bUseRoadAttributes = FParse::Param(*Params, TEXT("Attributes"));
+
+	TArray<FString> Speedups;
+	SpeedupList.ParseIntoArray(Speedups, TEXT(","));
+	for (const FString& Speedup : Speedups)
+	{
+		Settings.Speedups.Add(FCString::Atof(*Speedup));
+	}
+
+	FString Csv;
+	if (!Replay(StreetMap, Records, Settings, Csv))
+	{
+		return 1;
+	}
+
+	if (!FFileHelper::SaveStringToFile(Csv, *OutPath))
+	{
+		UE_LOG(LogStreetMapFlowReplay, Error, TEXT("Can't write %s"), *OutPath);
+		return 1;
+	}
+
+	UE_LOG(LogStreetMapFlowReplay, Display, TEXT("Wrote %s"), *OutPath);
+	return 0;
+}
+
+bool UStreetMapFlowReplayCommandlet::Replay(UStreetMap* StreetMap, const TArray<FStreetMapFlowUpdate>& Records, const FStreetMapFlowReplaySettings& Settings, FString& OutCsv)
+{
+	const FStreetMapFlowFeedSettings& FeedSettings = Settings.Feed;
+
+	// A world gives the component a scene proxy to upload into, when rendering is allowed
+	UWorld* World = UWorld::CreateWorld(EWorldType::Game, false);
+	FWorldContext& WorldContext = GEngine->CreateNewWorldContext(EWorldType::Game);
+	WorldContext.SetCurrentWorld(World);
+
+	AStreetMapActor* Actor = World->SpawnActor<AStreetMapActor>();
+	UStreetMapComponent* Component = Actor->GetStreetMapComponent();
+
+	FStreetMapMeshBuildSettings MeshBuildSettings = Component->GetMeshBuildSettings();
+	MeshBuildSettings.bUseRoadAttributes = Settings.bUseRoadAttributes;
+	MeshBuildSettings.ColorMode = EColorMode::Flow;
+	Component->SetMeshBuildSettings(MeshBuildSettings);
+	Component->SetStreetMap(StreetMap, true, true);
+
+	// Creates the scene proxy, which also indexes the roads by TMC
+	World->SendAllEndOfFrameUpdates();
+	FlushRenderingCommands();
+
+	if (Component->SceneProxy == nullptr)
+	{
+		UE_LOG(LogStreetMapFlowReplay, Warning, TEXT("No scene proxy, upload bytes won't be measured.  Run with -AllowCommandletRendering to measure them."));
+	}
+
+	OutCsv = FString(CsvHeader) + TEXT("\n");
+
+	const double FrameSeconds = 1.0 / FMath::Max(Settings.FrameRate, 1.0f);
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	PlatformFile.CreateDirectoryTree(*FPaths::GetPath(FeedSettings.Path));
+
+	bool bSuccess = true;
+	for (const float Speedup : Settings.Speedups)
+	{
+		if (Speedup <= 0.0f) continue;
+
+		// Every run starts from the same state, reset outside of the measurements
+		Component->ClearFlowData();
+		Component->EnsureColorSlots();
+		if (Settings.bUseRoadAttributes)
+		{
+			Component->UpdateRoadAttributes();
+		}
+		else
+		{
+			Component->ApplyColorSlot();
+		}
+		World->SendAllEndOfFrameUpdates();
+		FlushRenderingCommands();
+
+		PlatformFile.DeleteFile(*FeedSettings.Path);
+		IFileHandle* FeedWriter = PlatformFile.OpenWrite(*FeedSettings.Path, false, true);
+		if (FeedWriter == nullptr)
+		{
+			UE_LOG(LogStreetMapFlowReplay, Error, TEXT("Can't write %s"), *FeedSettings.Path);
+			bSuccess = false;
+			break;
+		}
+
+		FStreetMapFlowFeed Feed(FeedSettings);
+		Feed.Start();
+
+		const double RecordsPerFrame = Settings.Rate * Speedup * FrameSeconds;
+		double PendingRecords = 0.0;
+		int32 NumWritten = 0;
+		int32 NumApplied = 0;
+		int32 Frame = 0;
+		double LastWriteTime = FPlatformTime::Seconds();
+		double TotalRecolorTime = 0.0;
+		int64 TotalUploadBytes = 0;
+
+		// The feed delivers records in the order they were written, the Nth applied record is the Nth written one
+		TArray<double> WriteTimes;
+		WriteTimes.SetNumUninitialized(Records.Num());
+
+		TArray<uint8> Bytes;
+		TArray<FStreetMapFlowUpdate> Batch;
+
+		while (NumApplied < NumWritten || NumWritten < Records.Num())
+		{
+			const double FrameStart = FPlatformTime::Seconds();
+
+			// Feed side: what the source sends during one frame at the accelerated rate
+			PendingRecords += RecordsPerFrame;
+			const int32 NumToWrite = FMath::Min((int32)PendingRecords, Records.Num() - NumWritten);
+			PendingRecords -= NumToWrite;
+
+			if (NumToWrite > 0)
+			{
+				Bytes.Reset();
+				for (int32 Index = NumWritten; Index < NumWritten + NumToWrite; ++Index)
+				{
+					FStreetMapFlowFeed::Encode(FeedSettings.Format, Records[Index].TMC, Records[Index].Speed, Bytes);
+				}
+
+				const double WriteTime = FPlatformTime::Seconds();
+				FeedWriter->Write(Bytes.GetData(), Bytes.Num());
+				FeedWriter->Flush();
+				for (int32 Index = NumWritten; Index < NumWritten + NumToWrite; ++Index)
+				{
+					WriteTimes[Index] = WriteTime;
+				}
+				NumWritten += NumToWrite;
+				LastWriteTime = WriteTime;
+			}
+
+			// Game side: one swap per frame, like UStreetMapComponent::TickComponent(), then the end of frame updates
+			const FStreetMapRenderCounters Before = Component->GetRenderCounters();
+			const double GameStart = FPlatformTime::Seconds();
+			if (Feed.ConsumeBatch(Batch) && Batch.Num() > 0)
+			{
+				Component->ApplyFlowUpdates(Batch);
+				const double ApplyEnd = FPlatformTime::Seconds();
+
+				World->SendAllEndOfFrameUpdates();
+				const double GameEnd = FPlatformTime::Seconds();
+
+				const FStreetMapRenderCounters After = Component->GetRenderCounters();
+				const int64 UploadBytes = (After.TotalColorUploadBytes - Before.TotalColorUploadBytes) + (After.TotalAttributeUploadBytes - Before.TotalAttributeUploadBytes);
+
+				// From the feed writing a record to its color being handed to the renderer, the file and worker included
+				double LatencySum = 0.0;
+				double LatencyMax = 0.0;
+				const int32 NumDelivered = FMath::Min(Batch.Num(), NumWritten - NumApplied);
+				for (int32 Index = 0; Index < NumDelivered; ++Index)
+				{
+					const double Latency = ApplyEnd - WriteTimes[NumApplied + Index];
+					LatencySum += Latency;
+					LatencyMax = FMath::Max(LatencyMax, Latency);
+				}
+
+				const double RecolorMs = After.LastFlowRecolorMilliseconds;
+				OutCsv += FString::Printf(TEXT("%g,%d,%d,%.3f,%.3f,%.3f,%lld,%.3f\n"),
+					Speedup, Frame, Batch.Num(),
+					LatencySum / FMath::Max(NumDelivered, 1) * 1000.0, LatencyMax * 1000.0,
+					RecolorMs, UploadBytes,
+					(GameEnd - GameStart) * 1000000.0 / Batch.Num());
+
+				NumApplied += Batch.Num();
+				TotalRecolorTime += RecolorMs / 1000.0;
+				TotalUploadBytes += UploadBytes;
+			}
+
+			// Keep the render thread from falling behind, as it would run in parallel with the next frame
+			FlushRenderingCommands();
+			++Frame;
+
+			// Records the worker never delivered, give up rather than spin forever
+			if (NumWritten == Records.Num() && FPlatformTime::Seconds() - LastWriteTime > 5.0)
+			{
+				UE_LOG(LogStreetMapFlowReplay, Warning, TEXT("%d records were not delivered"), NumWritten - NumApplied);
+				break;
+			}
+
+			const double Remaining = FrameSeconds - (FPlatformTime::Seconds() - FrameStart);
+			if (Remaining > 0.0)
+			{
+				FPlatformProcess::Sleep((float)Remaining);
+			}
+		}
+
+		Feed.Shutdown();
+		delete FeedWriter;
+
+		UE_LOG(LogStreetMapFlowReplay, Display, TEXT("%gx: %d records in %d frames, %.2f ms recoloring, %lld bytes uploaded, %lld rejected"),
+			Speedup, NumApplied, Frame, TotalRecolorTime * 1000.0, TotalUploadBytes, Feed.GetNumRejected());
+	}
+
+	World->DestroyWorld(false);
+	GEngine->DestroyWorldContext(World);
+	PlatformFile.DeleteFile(*FeedSettings.Path);
+
+	return bSuccess;
+}
@@ -0,0 +1,72 @@
+// Copyright 2017 Mike Fricker. All Rights Reserved.
+#pragma once
+
+#include "Commandlets/Commandlet.h"
+#include "StreetMapFlowFeed.h"
+#include "StreetMapFlowReplayCommandlet.generated.h"
+
+
+/** How a flow replay feeds its records, see UStreetMapFlowReplayCommandlet */
+struct FStreetMapFlowReplaySettings
+{
+	/** Feed the records go through, read from a file the replay appends to */
+	FStreetMapFlowFeedSettings Feed;
+
+	/** Records per second at 1x */
+	float Rate = 1000.0f;
+
+	/** Simulated game frames per second */
+	float FrameRate = 60.0f;
+
+	/** Rate multipliers, one run each */
+	TArray<float> Speedups;
+
+	/** Colors roads through the road attribute texture instead of vertex colors */
+	bool bUseRoadAttributes = false;
+};
+
+/**
+ * Plays a recorded or synthetic flow feed into a street map component at accelerated rates and writes per frame
+ * timings as CSV: ingest latency from the write of a record to its recolor, recolor time, color upload bytes and game
+ * thread time per update.
+ *
+ * UE4Editor-Cmd.exe Project -run=StreetMapFlowReplay -Map=/Game/Maps/City -Flow=Recorded.ndjson -Speedups=1,10,100
+ *
+ * -Map        Street map asset (required)
+ * -Flow       Recorded feed file, a synthetic feed over the map TMCs is generated when missing
+ * -Format     Binary or NDJSON, format of the recorded file and of the replayed feed (NDJSON)
+ * -Synthetic  Number of synthetic records (100000)
+ * -Rate       Records per second at 1x (1000)
+ * -Speedups   Comma separated rate multipliers, one run each (1,10,100)
+ * -FrameRate  Simulated game frames per second (60)
+ * -Attributes Colors roads through the road attribute texture instead of vertex colors
+ * -Out        CSV file (Saved/StreetMap/FlowReplay.csv)
+ *
+ * Upload bytes are only measured when the component has a scene proxy, run with -AllowCommandletRendering.
+ */
+UCLASS()
+class UStreetMapFlowReplayCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+
+	/** UStreetMapFlowReplayCommandlet constructor */
+	UStreetMapFlowReplayCommandlet(const class FObjectInitializer& ObjectInitializer);
+
+	// UCommandlet overrides
+	virtual int32 Main(const FString& Params) override;
+
+	/** First line of the CSV, one column per value of a replayed frame */
+	static const TCHAR* CsvHeader;
+
+	/** Random speeds over the TMCs of a street map, mostly free flowing like a real network */
+	static void GenerateSyntheticRecords(const class UStreetMap* StreetMap, int32 NumRecords, TArray<struct FStreetMapFlowUpdate>& OutRecords);
+
+	/**
+	* Plays the records into a street map component of a world of its own, once per speedup
+	* @param OutCsv	Receives the header and one line per frame that applied records
+	* @return False if the feed file couldn't be written
+	*/
+	static bool Replay(class UStreetMap* StreetMap, const TArray<struct FStreetMapFlowUpdate>& Records, const FStreetMapFlowReplaySettings& Settings, FString& OutCsv);
+};
@@ -0,0 +1,116 @@
+// Copyright 2017 Mike Fricker. All Rights Reserved.
+
+#include "StreetMapImporting.h"
+#include "StreetMapFlowReplayCommandlet.h"
+#include "StreetMap.h"
+#include "Misc/AutomationTest.h"
+#include "Misc/Paths.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FStreetMapFlowReplayTest, "StreetMap.FlowReplay", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FStreetMapFlowReplayTest::RunTest(const FString& Parameters)
+{
+	// A small grid of disconnected roads, two roads per TMC
+	UStreetMap* StreetMap = NewObject<UStreetMap>(GetTransientPackage());
+	TArray<FStreetMapRoad>& Roads = StreetMap->GetRoads();
+	TArray<FStreetMapNode>& Nodes = StreetMap->GetNodes();
+
+	const int32 NumRoads = 48;
+	for (int32 RoadIndex = 0; RoadIndex < NumRoads; ++RoadIndex)
+	{
+		const FVector2D Start((RoadIndex % 8) * 1000.0f, (RoadIndex / 8) * 1000.0f);
+		const FVector2D End = Start + FVector2D(800.0f, 0.0f);
+
+		FStreetMapRoad& Road = Roads.AddDefaulted_GetRef();
+		Road.RoadName = FString::Printf(TEXT("Road %d"), RoadIndex);
+		Road.Link = FStreetMapLink(RoadIndex + 1, TEXT("T"));
+		Road.TMC = FName(*FString::Printf(TEXT("TMC%03d"), RoadIndex / 2));
+		Road.SpeedLimit = 30 + (RoadIndex % 4) * 20;
+		Road.RoadType = (EStreetMapRoadType)(RoadIndex % 3);
+		Road.RoadPoints = { Start, End };
+		Road.Distance = 800.0f;
+		Road.BoundsMin = Start;
+		Road.BoundsMax = End;
+		Road.bIsOneWay = RoadIndex % 2;
+
+		for (int32 PointIndex = 0; PointIndex < Road.RoadPoints.Num(); ++PointIndex)
+		{
+			FStreetMapNode& Node = Nodes.AddDefaulted_GetRef();
+			Node.RoadRefs.Add({ RoadIndex, PointIndex });
+			Road.NodeIndices.Add(Nodes.Num() - 1);
+		}
+	}
+
+	TArray<FStreetMapFlowUpdate> Records;
+	UStreetMapFlowReplayCommandlet::GenerateSyntheticRecords(StreetMap, 2000, Records);
+	TestEqual(TEXT("Synthetic records"), Records.Num(), 2000);
+
+	FStreetMapFlowReplaySettings Settings;
+	Settings.Feed.Source = EStreetMapFeedSource::FileTail;
+	Settings.Feed.bTailFromEnd = false;
+	Settings.Feed.Path = FPaths::AutomationTransientDir() / TEXT("StreetMapFlowReplayFeed.tmp");
+	Settings.Rate = 20000.0f;
+	Settings.Speedups = { 1.0f, 10.0f };
+
+	FString Csv;
+	if (!TestTrue(TEXT("Replay succeeded"), UStreetMapFlowReplayCommandlet::Replay(StreetMap, Records, Settings, Csv)))
+	{
+		return false;
+	}
+
+	TArray<FString> Lines;
+	Csv.ParseIntoArrayLines(Lines);
+	if (!TestTrue(TEXT("CSV has rows"), Lines.Num() > 1))
+	{
+		return false;
+	}
+
+	TArray<FString> Columns;
+	FString(UStreetMapFlowReplayCommandlet::CsvHeader).ParseIntoArray(Columns, TEXT(","));
+	TestEqual(TEXT("CSV header"), Lines[0], FString(UStreetMapFlowReplayCommandlet::CsvHeader));
+
+	TMap<float, int32> RecordsPerSpeedup;
+	for (int32 LineIndex = 1; LineIndex < Lines.Num(); ++LineIndex)
+	{
+		TArray<FString> Fields;
+		Lines[LineIndex].ParseIntoArray(Fields, TEXT(","), false);
+		if (!TestEqual(FString::Printf(TEXT("Fields on row %d"), LineIndex), Fields.Num(), Columns.Num()))
+		{
+			continue;
+		}
+
+		for (const FString& Field : Fields)
+		{
+			TestTrue(FString::Printf(TEXT("Numeric field '%s' on row %d"), *Field, LineIndex), Field.IsNumeric());
+		}
+
+		const float Speedup = FCString::Atof(*Fields[0]);
+		const int32 NumRecords = FCString::Atoi(*Fields[2]);
+		const float LatencyMean = FCString::Atof(*Fields[3]);
+		const float LatencyMax = FCString::Atof(*Fields[4]);
+		const float RecolorMs = FCString::Atof(*Fields[5]);
+		const float GameThreadUs = FCString::Atof(*Fields[7]);
+
+		TestTrue(TEXT("Speedup was requested"), Settings.Speedups.Contains(Speedup));
+		TestTrue(TEXT("Records per row"), NumRecords > 0);
+		TestTrue(TEXT("Ingest latency is positive"), LatencyMean >= 0.0f);
+		TestTrue(TEXT("Maximum ingest latency is at least the mean"), LatencyMax >= LatencyMean - 0.001f);
+		TestTrue(TEXT("Recolor time is positive"), RecolorMs >= 0.0f);
+
+		// The game thread time covers the recolor and more, spread over the records of the row
+		TestTrue(TEXT("Game thread time covers the recolor"), GameThreadUs * NumRecords >= RecolorMs * 1000.0f - NumRecords * 0.001f - 1.0f);
+
+		RecordsPerSpeedup.FindOrAdd(Speedup) += NumRecords;
+	}
+
+	for (const float Speedup : Settings.Speedups)
+	{
+		TestEqual(FString::Printf(TEXT("Records replayed at %gx"), Speedup), RecordsPerSpeedup.FindRef(Speedup), Records.Num());
+	}
+
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
@@ -18,6 +18,9 @@ public:
 	/** Given a 2D polygon and a point, determines whether the point is inside the polygon.  Supports concave polygons.  If the point is exactly on the polygon boundary, the return value could be either false or true. */
 	static inline bool IsPointInsidePolygon( const TArray<FVector2D>& Polygon, const FVector2D Point );
 
+	/** Simplifies a polyline with the Douglas-Peucker algorithm, then places the indices of the points kept, first and last included, in order into KeptIndices. */
+	static void SimplifyPolyline( const TArray<FVector2D>& Polyline, const float Tolerance, TArray<int32>& KeptIndices );
+
 
 private:
 
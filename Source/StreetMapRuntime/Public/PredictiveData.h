@@ -19,4 +19,13 @@ struct STREETMAPRUNTIME_API FPredictiveData
 
 	UPROPERTY(BlueprintReadOnly, Category = "StreetMap")
 		float S45;
+
+	/** Speed at any time between now and 45 minutes, linearly interpolated between the predicted horizons */
+	float GetSpeedAt(float Minutes) const
+	{
+		const float Horizon = FMath::Clamp(Minutes, 0.0f, 45.0f) / 15.0f;
+		if (Horizon <= 1.0f) return FMath::Lerp(S0, S15, Horizon);
+		if (Horizon <= 2.0f) return FMath::Lerp(S15, S30, Horizon - 1.0f);
+		return FMath::Lerp(S30, S45, Horizon - 2.0f);
+	}
 };
\ No newline at end of file
@@ -37,7 +37,8 @@ enum class EColorMode : uint8
 	Predictive0,
 	Predictive15,
 	Predictive30,
-	Predictive45
+	Predictive45,
+	PredictiveTime
 };
 
 USTRUCT(BlueprintType)
@@ -167,6 +168,57 @@ public:
 	UPROPERTY(Category = Status, EditAnywhere, BlueprintReadWrite)
 		TEnumAsByte<EColorMode> ColorMode;
 
+	/**
+	* If true, road vertices only carry their road index and the material looks up speed ratio, trace and highlight
+	* state in a per-road attribute texture, so recoloring uploads a few bytes per road instead of vertex data.
+	* Requires a material that samples the "RoadAttributes" texture.
+	*/
+	UPROPERTY(Category = StreetMap, EditAnywhere, BlueprintReadWrite, DisplayName = "Per-road attribute colors")
+		uint32 bUseRoadAttributes : 1;
+
+	/** Color of highlighted roads in road attribute mode */
+	UPROPERTY(Category = StreetMap, EditAnywhere, BlueprintReadWrite, meta = (editcondition = "bUseRoadAttributes"))
+		FLinearColor HighlightColor;
+
+	/**
+	* Cells along the longest side of the map the mesh is split into.  Each cell of each section is drawn on its own
+	* and skipped when out of view, 1 draws every section as a whole.
+	*/
+	UPROPERTY(Category = StreetMap, EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "1", UIMin = "1", UIMax = "64"), DisplayName = "Chunk grid resolution")
+		int32 ChunkGridResolution;
+
+	/**
+	* Levels of detail the roads are generated in.  Coarser levels reuse the vertices of the full detail roads and only
+	* keep the road points a Douglas-Peucker simplification keeps, and drop the minor road classes.  Each chunk of the
+	* mesh is drawn at the level matching its size on screen.
+	*/
+	UPROPERTY(Category = StreetMap, EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "1", ClampMax = "4", UIMin = "1", UIMax = "4"), DisplayName = "Road LODs")
+		int32 NumRoadLODs;
+
+	/** Simplification tolerance of LOD 1 in centimeters, doubled at every coarser LOD */
+	UPROPERTY(Category = StreetMap, EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "0", UIMin = "0"), DisplayName = "Road LOD tolerance")
+		float RoadLODTolerance;
+
+	/** Coarsest LOD streets are drawn in */
+	UPROPERTY(Category = StreetMap, EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "0", UIMin = "0", UIMax = "3"), DisplayName = "Coarsest street LOD")
+		int32 MaxStreetLOD;
+
+	/** Coarsest LOD major roads are drawn in, highways are drawn in all of them */
+	UPROPERTY(Category = StreetMap, EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "0", UIMin = "0", UIMax = "3"), DisplayName = "Coarsest major road LOD")
+		int32 MaxMajorRoadLOD;
+
+	/**
+	* If true, roads aren't generated into the mesh.  Every road segment is drawn as one instance of a unit quad
+	* stretched over it, with the road index and color in its per-instance custom data, so a segment costs one
+	* instance instead of four vertices and changing road thickness rewrites instance transforms instead of
+	* regenerating the mesh.  Roads are drawn as straight quads, requires a segment material reading the
+	* PerInstanceCustomData the component writes.  Recoloring is costlier than with vertex colors: the instanced
+	* component of every road section with a recolored road recreates its render state, which uploads all of its
+	* instances again, at most once per frame.
+	*/
+	UPROPERTY(Category = StreetMap, EditAnywhere, BlueprintReadWrite, DisplayName = "Draw roads as instanced segments")
+		uint32 bDrawRoadsAsSegments : 1;
+
 	FStreetMapMeshBuildSettings() :
 		StreetOffsetZ(100.0f),
 		MajorRoadOffsetZ(200.0f),
@@ -188,7 +240,15 @@ public:
 		LowFlowColor(FLinearColor(1.0f, 0.0f, 0.0f)),
 		MedFlowColor(FLinearColor(1.0f, 1.05f, 0.0f)),
 		HighFlowColor(FLinearColor(0.2f, 0.8f, 0.0f)),
-		ColorMode(EColorMode::Default)
+		ColorMode(EColorMode::Default),
+		bUseRoadAttributes(false),
+		HighlightColor(FLinearColor(0.0f, 0.6f, 1.0f)),
+		ChunkGridResolution(8),
+		NumRoadLODs(3),
+		RoadLODTolerance(500.0f),
+		MaxStreetLOD(1),
+		MaxMajorRoadLOD(2),
+		bDrawRoadsAsSegments(false)
 	{
 
 	}
@@ -510,6 +570,10 @@ struct STREETMAPRUNTIME_API FStreetMapTrace
 
 	UPROPERTY(Category = StreetMap, EditAnywhere, BlueprintReadWrite)
 		FLinearColor Color;
+
+	/** Where traces overlap, roads are drawn with the trace of highest priority, then the one shown last */
+	UPROPERTY(Category = StreetMap, EditAnywhere, BlueprintReadWrite)
+		int32 Priority = 0;
 };
 
 inline uint32 GetTypeHash(const FStreetMapLink& Value)
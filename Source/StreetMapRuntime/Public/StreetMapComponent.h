@@ -5,12 +5,26 @@
 #include "Components/MeshComponent.h"
 #include "Interfaces/Interface_CollisionDataProvider.h"
 #include "../StreetMapSceneProxy.h"
+#include "../StreetMapRoadAttributes.h"
+#include "../StreetMapColorSlots.h"
+#include "../StreetMapFlowHistory.h"
+#include "../StreetMapHeatmap.h"
+#include "../StreetMapTraceStacks.h"
+#include "../StreetMapRoadGrid.h"
+#include "../StreetMapRoadSegments.h"
+#include "../StreetMapMeshBuild.h"
+#include "StreetMapFlowFeed.h"
+#include "StreetMapCongestionStats.h"
+#include "StreetMapReplication.h"
+#include "StreetMapTraceAnalytics.h"
 #include "./PredictiveData.h"
 #include "Spatial/GeometrySet3.h"
 #include "Spatial/PointHashGrid2.h"
+#include "Async/Future.h"
 #include "StreetMapComponent.generated.h"
 
 class UBodySetup;
+class UInstancedStaticMeshComponent;
 
 /**
  * Component that represents a section of street map roads and buildings
@@ -24,6 +38,15 @@ private:
 	TMap<FName, float> mFlowData;
 	TMap<FName, FPredictiveData> mPredictiveData;
 	TMap<FGuid, FStreetMapTrace> mTraces;
+
+	// Traces hidden with HideTrace()
+	TSet<FGuid> mHiddenTraces;
+
+	// Visible traces of each road, by priority
+	FStreetMapTraceStacks TraceStacks;
+
+	// Per-road distances and speeds of the trace analytics, kept up to date with the data once built
+	FStreetMapTraceAnalyticsPass TraceAnalytics;
 	
 	// TMC to Road Index map
 	TMap<FName, int> mTMC2RoadIndex;
@@ -48,10 +71,93 @@ private:
 	TPointHashGrid2d<FStreetMapRoad> mMajorRoadGrid2d;
 	TPointHashGrid2d<FStreetMapRoad> mStreetGrid2d;
 
-	const float HighSpeedRatio = 0.8f;
-	const float MedSpeedRatio = 0.5f;
+	// Road indices binned for hover picking, built on first use
+	FStreetMapRoadGrid HoverGrid;
+
+	// Segments of every road when roads are drawn as instanced segments
+	FStreetMapRoadSegments RoadSegments;
+
+	// Road drawn with the hover highlight, and what it looked like before
+	int32 HoveredRoadIndex = INDEX_NONE;
+	TArray<FColor> HoveredRoadColors;
+	bool bHoveredRoadWasHighlighted = false;
+
+	// Colors written into the custom data of each road's segments, and the roads that keep theirs over flow updates
+	TArray<FColor> RoadSegmentColors;
+	TBitArray<> RoadSegmentTraces;
+
+	// Road sections whose segments got new custom data since the last FlushRoadSegmentColors()
+	TArray<int32> DirtyRoadSegmentSections;
+
+	const float HighSpeedRatio = FStreetMapColorSlots::HighSpeedRatio;
+	const float MedSpeedRatio = FStreetMapColorSlots::MedSpeedRatio;
 
 	FStreetMapRoad PrevOppositeRoad;
+
+	// Vertex ranges whose colors changed since the last upload to the scene proxy
+	TArray<FStreetMapVertexRange> DirtyColorRanges;
+
+	// Roads whose speed ratio changed since the last upload of their texture coordinates to the scene proxy
+	TArray<int32> DirtyTexCoordRoads;
+
+	// Cached mesh laid out for the GPU, shared with the scene proxies, null once the vertex arrays were edited in place
+	TSharedPtr<const FStreetMapRenderData, ESPMode::ThreadSafe> RenderData;
+
+	// Vertex colors of each section as the next scene proxy uploads them, indexed by EVertexType
+	FStreetMapColorStreamPtr RenderColors[FStreetMapSceneProxy::NumSections];
+
+	// Texture coordinates of each section as the next scene proxy uploads them, indexed by EVertexType
+	FStreetMapTexCoordStreamPtr RenderTexCoords[FStreetMapSceneProxy::NumSections];
+
+	// Upload statistics
+	FStreetMapRenderCounters RenderCounters;
+
+	// Mesh sections drawn by the scene proxy, bit N for EVertexType N
+	uint32 VisibleSectionMask = 0xF;
+
+	// Per-road state for road attribute coloring, mirrors RoadAttributeTexture
+	FStreetMapRoadAttributes RoadAttributes;
+
+	// Per-road speed ratios of every data driven color mode
+	FStreetMapColorSlots ColorSlots;
+	bool bColorSlotsStale = true;
+
+	// True when data changed since the last predictive time interpolation
+	bool bPredictiveTimeStale = true;
+
+	// Live flow feed and its local stand-in server
+	TUniquePtr<FStreetMapFlowFeed> FlowFeed;
+	TUniquePtr<FStreetMapFeedServer> FeedServer;
+
+	// Records of the last batch swapped in from the flow feed, kept to reuse the allocation
+	TArray<FStreetMapFlowUpdate> FlowFeedUpdates;
+
+	// Quantized flow history of every TMC, empty unless EnableFlowHistory() was called
+	FStreetMapFlowHistory FlowHistory;
+
+	// Speeds of the state RestoreFlowHistory() loads, indexed by the TMC ordinals of the history, kept to reuse the allocation
+	TArray<float> FlowHistorySpeeds;
+
+	// Cleared while a recorded state is restored, so restoring doesn't overwrite the newest sample
+	bool bRecordFlowHistory = true;
+
+	// Congestion statistics, updated as flow data is written
+	FStreetMapCongestionStats CongestionStats;
+
+	// Traffic density grid, empty unless EnableHeatmap() was called
+	FStreetMapHeatmap Heatmap;
+	TArray<int32> RoadHeatmapCells;
+	bool bHeatmapFromFlow = false;
+	float HeatmapUpdateInterval = 0.25f;
+	float TimeSinceHeatmapUpdate = 0.0f;
+
+	// Mesh generated by BuildMeshAsync() and the worker generating it
+	TUniquePtr<FStreetMapMeshBuild> PendingMeshBuild;
+	TFuture<void> MeshBuildTask;
+
+	// TMCs of the last flow feed batch and of the replicated items received since the last recolor
+	TArray<FName> FlowFeedTMCs;
+	TArray<FName> ReplicatedTMCs;
 public:
 
 	/** UStreetMapComponent constructor */
@@ -91,21 +197,35 @@ public:
 		}
 	}
 
-	/** Returns Cached raw mesh triangle indices */
-	TArray< uint32 > GetRawMeshIndices(EVertexType type) const
+	/**
+	* Per-road texture coordinates of the cached raw mesh vertices, which the vertices don't hold
+	* @param OutTexCoords4	Speed ratio of the road and flow direction of each vertex, as drawn in TexCoord4
+	* @param OutTexCoords5	Type of the road and, with road attributes, its index, as drawn in TexCoord5
+	*/
+	void GetRawMeshRoadTexCoords(EVertexType type, TArray<FVector2D>& OutTexCoords4, TArray<FVector2D>& OutTexCoords5) const;
+
+	/** Returns the mesh build settings */
+	const FStreetMapMeshBuildSettings& GetMeshBuildSettings() const
 	{
-		switch (type) {
-		case EVertexType::VBuilding:
-			return BuildingIndices;
-		case EVertexType::VMajorRoad:
-			return MajorRoadIndices;
-		case EVertexType::VHighway:
-			return HighwayIndices;
-		default:
-			return StreetIndices;
+		return MeshBuildSettings;
+	}
+
+	/** Replaces the mesh build settings and wipes the cached mesh, call BuildMesh() to rebuild it.  A pending async build restarts with the new settings. */
+	void SetMeshBuildSettings(const FStreetMapMeshBuildSettings& InMeshBuildSettings)
+	{
+		const bool bWasBuilding = CancelMeshBuild();
+		MeshBuildSettings = InMeshBuildSettings;
+		InvalidateMesh();
+
+		if (bWasBuilding)
+		{
+			BuildMeshAsync();
 		}
 	}
 
+	/** Returns Cached raw mesh triangle indices, full detail only.  The coarser LODs of the roads aren't part of the mesh. */
+	TArray< uint32 > GetRawMeshIndices(EVertexType type) const;
+
 	/**
 	* Returns StreetMap Default Material if a valid one is found in plugin's content folder.
 	* Otherwise , it returns the default surface 3d material.
@@ -171,6 +291,13 @@ public:
 	virtual FPrimitiveSceneProxy* CreateSceneProxy() override;
 	virtual FBoxSphereBounds CalcBounds(const FTransform& LocalToWorld) const override;
 	virtual int32 GetNumMaterials() const override;
+	virtual void OnRegister() override;
+	virtual void OnUnregister() override;
+	virtual void TickComponent(float DeltaTime, enum ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+	virtual void BeginDestroy() override;
+	virtual void Serialize(FArchive& Ar) override;
+	virtual void PostLoad() override;
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
 #if WITH_EDITOR
 	virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
 #endif
@@ -181,10 +308,40 @@ public:
 	/** Rebuilds the graphics and physics mesh representation if we don't have one right now.  Designed to be called on demand. */
 	void BuildMesh();
 
+	/**
+	* Same as BuildMesh(), with the mesh generated on a worker thread from a snapshot of the settings and road colors.
+	* The current mesh keeps rendering until the new one is swapped in on the first tick after the worker is done.
+	* Wiping the mesh cancels the build, and assigning another street map, changing the mesh build settings or the road thickness restarts it.
+	*/
+	UFUNCTION(BlueprintCallable, Category = "StreetMap")
+		void BuildMeshAsync();
+
+	UFUNCTION(BlueprintCallable, Category = "StreetMap")
+		bool IsBuildingMesh() const
+	{
+		return PendingMeshBuild.IsValid();
+	}
+
+	/** Stops the pending async build and waits for its worker, @return True if there was one */
+	bool CancelMeshBuild();
+
+	/** Waits for the pending async build and swaps it in right away */
+	void FlushMeshBuild();
+
+	/** Cancels the pending async build and starts it over from the current settings and street map, @return True if there was one */
+	bool RestartMeshBuild();
+
 	/** Rebuilds road mesh only */
 	void BuildRoadMesh(FColor HighFlowColor, FColor MedFlowColor, FColor LowFlowColor);
 	void BuildRoadMesh(EStreetMapRoadType Type, FColor HighFlowColor, FColor MedFlowColor, FColor LowFlowColor);
 
+	/**
+	* Lays the roads of one mesh section out cell by cell with their coarser LODs, the way GenerateMesh() does, after
+	* BuildRoadMesh() generated them one after the other
+	* @param RoadIndexRanges	Full detail indices of each road in the section index array, indexed like the street map roads
+	*/
+	void ChunkRoadSection(EVertexType VertexType, const TArray<FStreetMapVertexRange>& RoadIndexRanges);
+
 	/** Rebuilds indices for street map */
 	void IndexStreetMap();
 	void IndexVertices(TMap<FStreetMapLink, TArray<int>>& LinkMap, TMap<FName, TArray<int>>& TmcMap, TArray<FStreetMapVertex>& Vertices);
@@ -200,19 +357,356 @@ public:
 	void ColorRoadMeshFromData(TArray<FStreetMapVertex>& Vertices, FLinearColor DefaultColor, bool OverwriteTrace = false, float ZOffset = 0.0f);
 	void ColorRoadMeshFromData(TArray<FStreetMapVertex>& Vertices, FLinearColor DefaultColor, FLinearColor LowFlowColor, FLinearColor MedFlowColor, FLinearColor HighFlowColor, bool OverwriteTrace = false, float ZOffset = 0.0f);
 	
-	/** Same as above but target specific links */
+	/** Same as above but target specific links, roads drawn as segments only change color */
 	void ColorRoadMeshFromData(TArray<FStreetMapLink> Links, FColor DefaultColor, FColor LowFlowColor, FColor MedFlowColor, FColor HighFlowColor, bool OverwriteTrace, float ZOffset);
 	void ColorRoadMeshFromData(TArray<FStreetMapLink> Links, FLinearColor DefaultColor, bool OverwriteTrace, float ZOffset = 0.0f);
 	void ColorRoadMeshFromData(TArray<FStreetMapLink> Links, FLinearColor DefaultColor, FLinearColor LowFlowColor, FLinearColor MedFlowColor, FLinearColor HighFlowColor, bool OverwriteTrace, float ZOffset = 0.0f);
 
+	/** Returns the mesh section roads of the specified type are generated into */
+	static EVertexType GetVertexTypeForRoad(EStreetMapRoadType RoadType);
+
+	/**
+	* Shows or hides a section of the mesh: streets, major roads, highways or buildings.  The scene proxy keeps all
+	* sections and only stops drawing the hidden ones, so nothing is rebuilt or uploaded.
+	*/
+	UFUNCTION(BlueprintCallable, Category = "StreetMap")
+		void SetSectionVisible(EVertexType Section, bool bVisible);
+
+	UFUNCTION(BlueprintCallable, Category = "StreetMap")
+		bool IsSectionVisible(EVertexType Section) const
+	{
+		return (VisibleSectionMask & (1u << Section)) != 0;
+	}
+
+	/** Shows or hides the section roads of a type are drawn in */
+	UFUNCTION(BlueprintCallable, Category = "StreetMap")
+		void SetRoadTypeVisible(EStreetMapRoadType RoadType, bool bVisible);
+
+	/** @return Sections that are drawn, bit N for EVertexType N */
+	uint32 GetVisibleSectionMask() const
+	{
+		return VisibleSectionMask;
+	}
+
+	/** Sets the distance beyond which mesh chunks are not drawn, 0 draws them at any distance */
+	UFUNCTION(BlueprintCallable, Category = "StreetMap")
+		void SetChunkDrawDistance(float Distance);
+
+	UFUNCTION(BlueprintCallable, Category = "StreetMap")
+		float GetChunkDrawDistance() const
+	{
+		return ChunkDrawDistance;
+	}
+
+	float GetLODScreenSize() const
+	{
+		return LODScreenSize;
+	}
+
+	bool ShouldDrawChunksDynamically() const
+	{
+		return bDrawChunksDynamically;
+	}
+
+	/** Flags the colors of a vertex range as changed, so the next FlushColorUpdates() uploads them */
+	void MarkColorRangeDirty(EVertexType VertexType, int32 FirstVertex, int32 NumVertices);
+
+	/** Flags the per-road texture coordinates of a road as changed, so the next FlushColorUpdates() uploads them */
+	void MarkRoadTexCoordsDirty(int32 RoadIndex);
+
+	/** Flags the vertex colors of a road as changed */
+	void MarkRoadColorDirty(int32 RoadIndex);
+
+	/** Flags the vertex colors of all roads with the specified TMC as changed */
+	void MarkTMCColorDirty(FName TMC);
+
+	/** Uploads the dirty vertex color and texture coordinate ranges into the existing scene proxy without recreating it */
+	void FlushColorUpdates();
+
+	/** Returns statistics about the data uploaded to the GPU */
+	UFUNCTION(BlueprintCallable, Category = "StreetMap")
+		FStreetMapRenderCounters GetRenderCounters() const
+	{
+		return RenderCounters;
+	}
+
+	/** Returns the memory held by the cached mesh */
+	UFUNCTION(BlueprintCallable, Category = "StreetMap")
+		FStreetMapMeshMemoryStats GetMeshMemoryStats() const;
+
+	/**
+	* Returns the size of the GPU buffers the scene proxy creates, compared with the same mesh without compact
+	* encodings.  Empty until the mesh is laid out for the GPU, by a mesh build or the first scene proxy.
+	*/
+	UFUNCTION(BlueprintCallable, Category = "StreetMap")
+		FStreetMapGPUMemoryStats GetGPUMemoryStats() const;
+
+	/**
+	* Expands every road segment into its quad on the CPU and measures how far its corners are from the corners of
+	* the segment's instance, and from the road mesh when roads are generated as straight quads.  Also returns the
+	* size of the segments against the size of the same roads as mesh quads.  Works in either road drawing mode.
+	*/
+	UFUNCTION(BlueprintCallable, Category = "StreetMap")
+		FStreetMapRoadSegmentStats ValidateRoadSegments();
+
+	/** Recomputes all color slots if they don't match the current roads or data */
+	void EnsureColorSlots();
+
+	/** Measures the roads of the street map for the congestion statistics and adds the current flow data to them */
+	void RebuildCongestionStats();
+
+	/** Rebuilds the congestion statistics if they weren't built for the roads of the street map yet */
+	void EnsureCongestionStats();
+
+	/** Measures the roads for the trace analytics and copies the current flow and predictive speeds, built on first use */
+	void EnsureTraceAnalytics();
+
+	/** Recomputes the color slots of the roads with the specified TMC after its data changed */
+	void UpdateColorSlots(FName TMC);
+
+	/** Recomputes the color slots of a single road */
+	void UpdateRoadColorSlots(int32 RoadIndex);
+
+	/** Recolors the road vertices from the slot of the current color mode and uploads the color and texture coordinate streams */
+	void ApplyColorSlot();
+
+	/**
+	* Recolors the vertices of a road from a color slot and sets the speed ratio of the road in TexCoord4, skipping trace
+	* vertices, and flags them for upload
+	*/
+	void RecolorRoadFromSlot(int32 RoadIndex, int32 Slot, FColor LowFlowColor, FColor MedFlowColor, FColor HighFlowColor);
+
+	/** Sets the TexCoord4 speed ratio of a road and flags it for upload, roads on a trace keep theirs */
+	void UpdateRoadSpeedRatio(int32 RoadIndex, float SpeedRatio);
+
+	/** @return Flow color of a speed ratio read from a color slot */
+	FColor GetSlotFlowColor(float SpeedRatio, FColor LowFlowColor, FColor MedFlowColor, FColor HighFlowColor) const;
+
+	/**
+	* Colors the roads with predictive speeds interpolated between the 0/15/30/45 minute horizons and switches to
+	* the PredictiveTime color mode.  Only roads whose color changed since the previous call are re-uploaded.
+	*/
+	UFUNCTION(BlueprintCallable, Category = "StreetMap")
+		void SetPredictiveTime(float Minutes);
+
+	/** Rebuilds the per-road attributes from the current flow data, visible traces and highlights and creates their texture */
+	void InitRoadAttributes(const TArray<int32>& HighlightedRoads = TArray<int32>());
+
+	/** Recomputes the speed ratio of every road for the current color mode, O(roads) */
+	void UpdateRoadAttributes();
+
+	/** Uploads the roads whose attributes changed into the attribute texture */
+	void FlushRoadAttributes();
+
+	/** Passes the attribute texture and flow colors to the street map material */
+	void ApplyRoadAttributeMaterialParameters();
+
+	/** Sets the trace state of some roads in road attribute mode */
+	void SetRoadAttributeTrace(const TArray<FStreetMapLink>& Links, bool bOnTrace, FColor TraceColor);
+
+	/**
+	* CPU reference of the road attribute material: resolves the color a road is drawn with from its attributes.
+	* Uses the same quantized values as the texture.
+	*/
+	FColor ResolveRoadAttributeColor(int32 RoadIndex) const;
+
+	/** @return The per-road attribute texture, null unless road attribute mode is enabled */
+	UFUNCTION(BlueprintCallable, Category = "StreetMap")
+		UTexture2D* GetRoadAttributeTexture() const
+	{
+		return RoadAttributeTexture;
+	}
+
+	/** Highlights a road, only visible in road attribute mode */
+	UFUNCTION(BlueprintCallable, Category = "StreetMap")
+		void SetRoadHighlighted(FStreetMapLink Link, bool bHighlighted);
+
+	/** Removes all road highlights */
+	UFUNCTION(BlueprintCallable, Category = "StreetMap")
+		void ClearRoadHighlights();
+
+	/**
+	* Highlights the road closest to a location, e.g. under the cursor, and restores the previously hovered one.
+	* Only those two roads are uploaded: their vertex colors, their segments or their rows of the attribute texture.
+	* @param MaxDistance Roads further away are ignored
+	* @param MaxRoadType Highway only picks highways, MajorRoad skips streets, like GetClosestRoad()
+	* @return True if a road is hovered
+	*/
+	UFUNCTION(BlueprintCallable, Category = "StreetMap")
+		bool HoverRoadAt(FVector Location, FStreetMapLink& OutLink, float MaxDistance = 2500.0f, EStreetMapRoadType MaxRoadType = EStreetMapRoadType::Street);
+
+	/** Highlights a road as hovered, replacing the previous one */
+	UFUNCTION(BlueprintCallable, Category = "StreetMap")
+		void SetHoveredRoad(FStreetMapLink Link);
+
+	UFUNCTION(BlueprintCallable, Category = "StreetMap")
+		void ClearHoveredRoad();
+
+	/** @return Index of the road closest to a location in component space, INDEX_NONE if none is in range */
+	int32 FindRoadAt(FVector2D Location, float MaxDistance, EStreetMapRoadType MaxRoadType);
+
+	/** Moves the hover highlight to a road, INDEX_NONE to remove it */
+	void SetHoveredRoadIndex(int32 RoadIndex);
+
+	/** Drops the hover state without touching any vertex, for when the mesh is rebuilt */
+	void ForgetHoveredRoad();
+
+	/** @return Color of a road according to its attributes (CPU reference of the material) */
+	UFUNCTION(BlueprintCallable, Category = "StreetMap")
+		FLinearColor GetRoadAttributeColor(FStreetMapLink Link) const;
+
+	/**
+	* Starts reading live flow data on a worker thread.  Decoded records are swapped in once per frame and
+	* recolor only the roads they touch.
+	*/
+	UFUNCTION(BlueprintCallable, Category = "StreetMap")
+		bool StartFlowFeed(FStreetMapFlowFeedSettings Settings);
+
+	UFUNCTION(BlueprintCallable, Category = "StreetMap")
+		void StopFlowFeed();
+
+	UFUNCTION(BlueprintCallable, Category = "StreetMap")
+		bool IsFlowFeedRunning() const;
+
+	/** @return The running flow feed, null if there is none */
+	const FStreetMapFlowFeed* GetFlowFeed() const
+	{
+		return FlowFeed.Get();
+	}
+
+	/**
+	* Starts a stand-in feed server streaming random speeds for every TMC of the street map, so a flow feed with the
+	* same settings can be tested without a network.  File and pipe settings append to the path instead of listening.
+	*/
+	UFUNCTION(BlueprintCallable, Category = "StreetMap")
+		bool StartLocalFeedServer(FStreetMapFlowFeedSettings Settings, float UpdatesPerSecond = 1000.0f);
+
+	UFUNCTION(BlueprintCallable, Category = "StreetMap")
+		void StopLocalFeedServer();
+
+	/**
+	* Starts recording the flow data of every TMC, one sample per interval over a sliding window.
+	* Flow changes are recorded as they arrive, with the current UTC time.
+	*/
+	UFUNCTION(BlueprintCallable, Category = "StreetMap")
+		void EnableFlowHistory(float IntervalSeconds = 60.0f, float DurationHours = 24.0f);
+
+	UFUNCTION(BlueprintCallable, Category = "StreetMap")
+		void DisableFlowHistory();
+
+	/**
+	* Replaces the flow data of the recorded TMCs with their state at a time, through the same path as feed updates so
+	* it is replicated and only the changed roads are recolored.  False if the time wasn't recorded.
+	*/
+	UFUNCTION(BlueprintCallable, Category = "StreetMap")
+		bool RestoreFlowHistory(FDateTime Time);
+
+	/** Oldest and newest recorded times, false if nothing was recorded */
+	UFUNCTION(BlueprintCallable, Category = "StreetMap")
+		bool GetFlowHistoryRange(FDateTime& OutOldest, FDateTime& OutNewest) const;
+
+	UFUNCTION(BlueprintCallable, Category = "StreetMap")
+		bool SaveFlowHistory(const FString& Path) const;
+
+	UFUNCTION(BlueprintCallable, Category = "StreetMap")
+		bool LoadFlowHistory(const FString& Path);
+
+	const FStreetMapFlowHistory& GetFlowHistory() const
+	{
+		return FlowHistory;
+	}
+
+	/** Writes flow and predictive data, traces with their visibility and highlighted roads to a compact binary file */
+	UFUNCTION(BlueprintCallable, Category = "StreetMap")
+		bool SaveStateSnapshot(const FString& Path) const;
+
+	/**
+	* Replaces flow and predictive data, traces and highlights with a snapshot of the same street map and recolors
+	* every road once.  False if the file is missing, corrupt or from another street map.
+	*/
+	UFUNCTION(BlueprintCallable, Category = "StreetMap")
+		bool LoadStateSnapshot(const FString& Path);
+
+	/** Recolors every road from the color slots, visible traces and highlights in one upload */
+	void RecolorAllRoads(const TArray<int32>& HighlightedRoads);
+
+	/** Puts a trace on the stacks of its roads, or takes it off */
+	void StackTrace(const FStreetMapTrace& Trace, bool bVisible);
+
+	/** Rebuilds the trace stacks of every road from the visible traces */
+	void RebuildTraceStacks();
+
+	/** Recolors roads from the top of their trace stack, or from their data or road type color without a visible trace */
+	void RecolorTraceRoads(const TArray<FStreetMapLink>& Links, FColor LowFlowColor, FColor MedFlowColor, FColor HighFlowColor);
+
+	/** @return Average speed ratio and congested length of a road type, kept up to date as flow data arrives */
+	UFUNCTION(BlueprintCallable, Category = "StreetMap")
+		FStreetMapRoadTypeCongestion GetRoadTypeCongestion(EStreetMapRoadType RoadType);
+
+	/** @return The TMCs with the lowest speed ratio, worst first */
+	UFUNCTION(BlueprintCallable, Category = "StreetMap")
+		TArray<FStreetMapTMCCongestion> GetWorstTMCs(int32 Count = 10);
+
+	/**
+	* Starts a traffic density grid covering the street map, updated on worker threads and decaying over time.
+	* @param Resolution Cells along the longest side of the map
+	* @param HalfLifeSeconds Time after which a probe only weighs half
+	* @param bAccumulateFlow If true, every flow update adds the congestion (1 - speed ratio) of its roads
+	*/
+	UFUNCTION(BlueprintCallable, Category = "StreetMap")
+		void EnableHeatmap(int32 Resolution = 256, float HalfLifeSeconds = 300.0f, bool bAccumulateFlow = true);
+
+	UFUNCTION(BlueprintCallable, Category = "StreetMap")
+		void DisableHeatmap();
+
+	/** Adds probe points, e.g. vehicle positions, binned on a worker thread */
+	UFUNCTION(BlueprintCallable, Category = "StreetMap")
+		void AddHeatmapProbes(const TArray<FVector2D>& Locations, float Weight = 1.0f);
+
+	/** Adds a value per link at the center of its road, binned on a worker thread */
+	UFUNCTION(BlueprintCallable, Category = "StreetMap")
+		void AddHeatmapLinkValues(const TArray<FStreetMapLink>& Links, const TArray<float>& Values);
+
+	/** @return The density texture, normalized by the densest cell and refreshed a few times per second */
+	UFUNCTION(BlueprintCallable, Category = "StreetMap")
+		UTexture2D* GetHeatmapTexture() const
+	{
+		return HeatmapTexture;
+	}
+
+	/** Applies a batch of flow records and recolors the roads they touch */
+	void ApplyFlowUpdates(const TArray<FStreetMapFlowUpdate>& Updates);
+
+	/** Recolors the roads of TMCs whose data changed, if the current color mode shows that data */
+	void RecolorTMCs(const TArray<FName>& TMCs, bool bFlowChanged, bool bPredictiveChanged);
+
+	/** @return True if flow and predictive data set on this component are replicated to clients */
+	bool IsReplicatingFlow() const;
+
+	/** Builds the TMC ordinals of the replicated flow state on first use */
+	void EnsureReplicatedFlow();
+
+	/** Client: applies the state of a TMC received from the server */
+	void ReceiveReplicatedFlow(const FStreetMapReplicatedFlowItem& Item);
+
+	/** Client: recolors the roads of every TMC received since the last call */
+	void ApplyReplicatedFlow();
+
+	/** @return Bytes and TMC states replicated so far */
+	UFUNCTION(BlueprintCallable, Category = "StreetMap")
+		FStreetMapReplicationCounters GetReplicationCounters() const
+	{
+		return ReplicatedFlow.Counters;
+	}
+
 	/** Color road meshes in vertex array */
 	void ColorRoadMesh(FLinearColor val, TArray<FStreetMapVertex>& Vertices, bool IsTrace = false, float ZOffset = 0.0f);
 
-	/** Color road meshes by Link ID */
+	/** Color road meshes by Link ID, roads drawn as segments only change color and ignore ZOffset */
 	void ColorRoadMesh(FLinearColor val, FStreetMapLink Link, bool IsTrace = false, float ZOffset = 0.0f);
 	void ColorRoadMesh(FLinearColor val, TArray<FStreetMapLink> Links, bool IsTrace = false, float ZOffset = 0.0f);
 
-	/** Color road meshes by TMC */
+	/** Color road meshes by TMC, roads drawn as segments only change color and ignore ZOffset */
 	void ColorRoadMesh(FLinearColor val, FName TMC, bool IsTrace = false, float ZOffset = 0.0f);
 	void ColorRoadMesh(FLinearColor val, TArray<FName> TMCs, bool IsTrace = false, float ZOffset = 0.0f);
 	
@@ -298,6 +792,17 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "StreetMap")
 		bool DeleteTrace(FGuid GUID, FColor LowFlowColor, FColor MedFlowColor, FColor HighFlowColor);
 
+	/** Changes the priority of a trace, only its own roads are recolored */
+	UFUNCTION(BlueprintCallable, Category = "StreetMap")
+		bool SetTracePriority(FGuid GUID, int32 Priority);
+
+	/**
+	* Distance, travel times under the flow and every predictive horizon, and delays versus free flow of every
+	* stored trace, in one parallel pass over dense per-road arrays.
+	*/
+	UFUNCTION(BlueprintCallable, Category = "StreetMap")
+		TArray<FStreetMapTraceAnalytics> ComputeTraceAnalytics();
+
 	UFUNCTION(BlueprintCallable, Category = "StreetMap")
 		bool GetTraceDetails(TArray<FStreetMapLink> Links, float& OutAvgSpeed, float& OutDistance, float& OutTravelTime, float& OutIdealTravelTime);
 
@@ -324,9 +829,112 @@ protected:
 	/** Updating navoctree entry for this component , if need/possible. */
 	void UpdateNavigationIfNeeded();
 
+	/** Returns the cached vertex array of a mesh section */
+	TArray<FStreetMapVertex>& GetVerticesOfType(EVertexType VertexType);
+	const TArray<FStreetMapVertex>& GetVerticesOfType(EVertexType VertexType) const
+	{
+		return const_cast<UStreetMapComponent*>(this)->GetVerticesOfType(VertexType);
+	}
+
+	/** Returns the cached index array of a mesh section */
+	TArray<uint32>& GetIndicesOfType(EVertexType VertexType);
+	const TArray<uint32>& GetIndicesOfType(EVertexType VertexType) const
+	{
+		return const_cast<UStreetMapComponent*>(this)->GetIndicesOfType(VertexType);
+	}
+
+	/** Finds which mesh section a cached vertex array belongs to */
+	bool FindVertexType(const TArray<FStreetMapVertex>& Vertices, EVertexType& OutVertexType) const;
+
 	/** Generates a cached mesh from raw street map data */
 	void GenerateMesh();
 
+	/** Captures the settings and road colors a mesh generation reads on the game thread */
+	void CaptureMeshBuild(FStreetMapMeshBuild& Build);
+
+	/** Generates the mesh of a captured build into the build, safe on any thread */
+	void GenerateMesh(FStreetMapMeshBuild& Build);
+
+	/** Moves a generated mesh into the cached mesh */
+	void ApplyMeshBuild(FStreetMapMeshBuild& Build);
+
+	/** Lays the cached mesh out for the GPU if it isn't already */
+	void EnsureRenderData();
+
+	/**
+	* Forgets the render data after the vertex arrays were edited in place and marks the render state dirty, the next
+	* scene proxy lays the mesh out again
+	*/
+	void InvalidateRenderData();
+
+	/** Copies the colors of the dirty color ranges into the color streams, unsharing the streams still being uploaded */
+	void UpdateRenderColors();
+
+	/** Copies the texture coordinates of the dirty ranges into the texture coordinate streams, like UpdateRenderColors() */
+	void UpdateRenderTexCoords();
+
+	/**
+	* Uploads the dirty texture coordinate ranges into the existing scene proxy, see FlushColorUpdates()
+	* @return Number of bytes uploaded
+	*/
+	int64 FlushTexCoordUpdates();
+
+	/**
+	* Reads or writes the cached mesh arrays as plain binary
+	* @param Version FStreetMapCustomVersion the mesh was saved with
+	*/
+	void SerializeCachedMesh(FArchive& Ar, int32 Version);
+
+	/** @return Hash of everything the cached mesh is generated from: the street map geometry and the build settings */
+	uint32 ComputeMeshBuildHash() const;
+
+	/** Updates road attributes, bounds, collision and render state for a freshly generated cached mesh */
+	void FinishBuildMesh();
+
+	/** Collects the road segments if roads are drawn as segments and they don't match the street map */
+	void EnsureRoadSegments();
+
+	/** Recreates the instanced components drawing the road segments of each road section */
+	void UpdateRoadSegmentInstances();
+
+	/** Destroys the instanced components drawing the road segments */
+	void DestroyRoadSegmentInstances();
+
+	/** Stretches the instances of a road section over their segments at the current thickness */
+	void UpdateRoadSegmentTransforms(EVertexType Section);
+
+	/**
+	* Colors the road segments from their trace or the slot of the current color mode.  Only roads whose color changed
+	* get new custom data, all of them after the instances were recreated.
+	*/
+	void UpdateRoadSegmentColors(FColor LowFlowColor, FColor MedFlowColor, FColor HighFlowColor);
+
+	/**
+	* Colors the segments of a road, the hovered road keeps its highlight until it is no longer hovered
+	* @param bIsTrace Flow updates leave the road alone, like trace vertices
+	* @param bForce Writes the custom data even if the color didn't change
+	*/
+	void SetRoadSegmentColor(int32 RoadIndex, FColor Color, bool bIsTrace, bool bForce = false);
+
+	/** Writes the road index and a color into the custom data of the segments of a road */
+	void WriteRoadSegmentColor(int32 RoadIndex, FColor Color, bool bForce = false);
+
+	/**
+	* Sends the custom data of the road sections that changed to the renderer.  Instanced static meshes only take new
+	* custom data with a new render state, so every instance of a dirty section is uploaded again.  The engine
+	* recreates render states once at the end of the frame, however many flushes dirtied them.
+	*/
+	void FlushRoadSegmentColors();
+
+	/** Colors the segments of every road with a TMC */
+	void ColorRoadSegmentsOfTMC(FName TMC, FColor Color, bool bIsTrace);
+
+	/** Instance transforms of the segments of a road section, in instance order */
+	void GetRoadSegmentTransforms(EVertexType Section, TArray<FTransform>& OutTransforms) const;
+
+	/** Height and thickness the roads of a section are generated with */
+	void GetRoadSectionLayout(EVertexType Section, float& OutZ, float& OutThickness) const;
+
 	/** Adds a 2D line to the raw mesh */
 	void AddThick2DLine(
 		const FVector2D Start, 
@@ -340,12 +948,7 @@ protected:
 		TArray<FStreetMapVertex>* Vertices, 
 		TArray<uint32>* Indices, 
 		EVertexType VertexType, 
-		int64 LinkId = -1, 
-		FString LinkDir = "", 
-		FName TMC = "", 
-		int SpeedLimit = 25, 
-		float SpeedRatio = 1.0f,
-		float RoadTypeFloat = 0.0f
+		const FString& LinkDir = ""
 	);
 
 	/** Adds 3D triangles to the raw mesh */
@@ -373,12 +976,8 @@ protected:
 		, TArray<FStreetMapVertex>* Vertices
 		, TArray<uint32>* Indices
 		, EVertexType VertexType
-		, int64 LinkId = -1
-		, FString LinkDir = ""
-		, FName TMC = ""
-		, int SpeedLimit = 25
-		, float SpeedRatio = 1.0f
-		, float RoadTypeFloat = 0.0f
+		, const float ThresholdConnectStreets
+		, const FString& LinkDir = ""
 	);
 
 	void StartSmoothQuadList(const FVector2D& Prev
@@ -394,12 +993,7 @@ protected:
 		, TArray<FStreetMapVertex>* Vertices
 		, TArray<uint32>* Indices
 		, EVertexType VertexType
-		, int64 LinkId = -1
-		, FString LinkDir = ""
-		, FName TMC = ""
-		, int SpeedLimit = 25
-		, float SpeedRatio = 1.0f
-		, float RoadTypeFloat = 0.0f
+		, const FString& LinkDir = ""
 	);
 	
 	void StartSmoothQuadList(const FVector2D& Start
@@ -414,12 +1008,7 @@ protected:
 		, TArray<FStreetMapVertex>* Vertices
 		, TArray<uint32>* Indices
 		, EVertexType VertexType
-		, int64 LinkId = -1
-		, FString LinkDir = ""
-		, FName TMC = ""
-		, int SpeedLimit = 25
-		, float SpeedRatio = 1.0f
-		, float RoadTypeFloat = 0.0f
+		, const FString& LinkDir = ""
 	);
 
 
@@ -437,12 +1026,7 @@ protected:
 		, TArray<FStreetMapVertex>* Vertices
 		, TArray<uint32>* Indices
 		, EVertexType VertexType
-		, int64 LinkId = -1
-		, FString LinkDir = ""
-		, FName TMC = ""
-		, int SpeedLimit = 25
-		, float SpeedRatio = 1.0f
-		, float RoadTypeFloat = 0.0f
+		, const FString& LinkDir = ""
 	);
 
 	void EndSmoothQuadList(const FVector2D& Mid
@@ -457,12 +1041,7 @@ protected:
 		, TArray<FStreetMapVertex>* Vertices
 		, TArray<uint32>* Indices
 		, EVertexType VertexType
-		, int64 LinkId = -1
-		, FString LinkDir = ""
-		, FName TMC = ""
-		, int SpeedLimit = 25
-		, float SpeedRatio = 1.0f
-		, float RoadTypeFloat = 0.0f
+		, const FString& LinkDir = ""
 	);
 
 	void EndSmoothQuadList(const FVector2D& Mid
@@ -478,19 +1057,15 @@ protected:
 		, TArray<FStreetMapVertex>* Vertices
 		, TArray<uint32>* Indices
 		, EVertexType VertexType
-		, int64 LinkId = -1
-		, FString LinkDir = ""
-		, FName TMC = ""
-		, int SpeedLimit = 25
-		, float SpeedRatio = 1.0f
-		, float RoadTypeFloat = 0.0f
+		, const FString& LinkDir = ""
 	);
 
 private:
 	void findConnectedRoad(const FStreetMapRoad& Road
 		, int32 RoadCheckIndex
 		, const bool Start
-		, FString LinkDir
+		, const FString& LinkDir
+		, const float ThresholdConnectStreets
 		, int32& ChosenRoadIndex
 		, bool& fromBack);
 protected:
@@ -505,6 +1080,50 @@ protected:
 	UPROPERTY(EditAnywhere, Category = "StreetMap")
 		FStreetMapCollisionSettings CollisionSettings;
 
+	/** If true, the cached mesh isn't saved with the level but generated again when the level is loaded */
+	UPROPERTY(EditAnywhere, Category = "StreetMap")
+		bool bRegenerateMeshOnLoad = false;
+
+	/** If true, the cached mesh is saved zlib compressed */
+	UPROPERTY(EditAnywhere, Category = "StreetMap", meta = (editcondition = "!bRegenerateMeshOnLoad"))
+		bool bCompressCachedMesh = true;
+
+	/** Mesh chunks further from the view than this are not drawn, 0 draws them at any distance.  Only applies when drawing chunks dynamically */
+	UPROPERTY(EditAnywhere, Category = "StreetMap", meta = (ClampMin = "0", UIMin = "0"))
+		float ChunkDrawDistance = 0.0f;
+
+	/**
+	* Screen size below which mesh chunks are drawn at road LOD 1, each halving of it switches to the next LOD.
+	* 0 always draws full detail.  Dynamic drawing picks one per chunk, static drawing one for the whole map from its
+	* bounds.
+	*/
+	UPROPERTY(EditAnywhere, Category = "StreetMap", meta = (ClampMin = "0", UIMin = "0", UIMax = "2"))
+		float LODScreenSize = 0.5f;
+
+	/**
+	* If true, the mesh is drawn dynamically every frame, with chunks culled and their LOD picked one by one.
+	* Otherwise it is drawn from cached static draw commands, which is cheaper on the render thread for small maps
+	* but can neither cull chunks nor pick their LOD: the renderer picks one LOD for the whole primitive and draws
+	* every chunk of a visible section.  Static drawing falls back to dynamic drawing for a few frames after colors change.
+	*/
+	UPROPERTY(EditAnywhere, Category = "StreetMap")
+		bool bDrawChunksDynamically = true;
+
+	/**
+	* Mesh every road segment is an instance of when drawing roads as segments, see
+	* FStreetMapMeshBuildSettings::bDrawRoadsAsSegments.  Has to be a 100 unit square in the XY plane centered on its
+	* origin, like the default /Engine/BasicShapes/Plane.
+	*/
+	UPROPERTY(EditAnywhere, Category = "StreetMap")
+		UStaticMesh* RoadSegmentMesh;
+
+	/**
+	* Material of the road segment instances.  PerInstanceCustomData 0 is the road index, 1 to 3 the linear color
+	* of the road.
+	*/
+	UPROPERTY(EditAnywhere, Category = "StreetMap")
+		UMaterialInterface* RoadSegmentMaterial;
+
 	UPROPERTY(EditAnywhere, Category = "Landscape")
 		FStreetMapLandscapeBuildSettings LandscapeSettings;
 
@@ -524,36 +1143,60 @@ protected:
 
 
 	friend class FStreetMapComponentDetails;
+	friend class FStreetMapParallelMeshTest;
 
 protected:
 	//
 	// Cached mesh representation
 	//
 
-	/** Cached raw mesh vertices */
-	UPROPERTY()
-		TArray< struct FStreetMapVertex > StreetVertices;
-	UPROPERTY()
-		TArray< struct FStreetMapVertex > MajorRoadVertices;
-	UPROPERTY()
-		TArray< struct FStreetMapVertex > HighwayVertices;
-	UPROPERTY()
-		TArray< struct FStreetMapVertex > BuildingVertices;
+	/** Cached raw mesh vertices, saved by Serialize() */
+	TArray< struct FStreetMapVertex > StreetVertices;
+	TArray< struct FStreetMapVertex > MajorRoadVertices;
+	TArray< struct FStreetMapVertex > HighwayVertices;
+	TArray< struct FStreetMapVertex > BuildingVertices;
 
 	/** Cached raw mesh triangle indices */
-	UPROPERTY()
-		TArray< uint32 > StreetIndices;
-	UPROPERTY()
-		TArray< uint32 > MajorRoadIndices;
-	UPROPERTY()
-		TArray< uint32 > HighwayIndices;
-	UPROPERTY()
-		TArray< uint32 > BuildingIndices;
+	TArray< uint32 > StreetIndices;
+	TArray< uint32 > MajorRoadIndices;
+	TArray< uint32 > HighwayIndices;
+	TArray< uint32 > BuildingIndices;
+
+	/** Vertex range of each road, indexed like the street map roads */
+	TArray< FStreetMapVertexRange > RoadVertexRanges;
+
+	/** Speed ratio of each road, written to the texture coordinates of its vertices, indexed like the street map roads */
+	TArray< float > RoadSpeedRatios;
+
+	/** Index ranges and bounds of the spatial grid cells of each section, see FStreetMapMeshBuildSettings::ChunkGridResolution */
+	TArray< FStreetMapMeshChunk > MeshChunks;
+
+	/** Build hash saved with the cached mesh, PostLoad() generates the mesh again if it doesn't match */
+	uint32 LoadedMeshBuildHash = 0;
+
+	/** Set by Serialize() when a loaded mesh wasn't saved or can't be used, PostLoad() generates it again */
+	bool bMeshNeedsRebuildOnLoad = false;
 
 	/** Cached bounding box */
 	UPROPERTY()
 		FBoxSphereBounds CachedLocalBounds;
 
+	/** Per-road attributes looked up by the material in road attribute mode */
+	UPROPERTY(Transient)
+		UTexture2D* RoadAttributeTexture;
+
+	/** Traffic density grid to drape over the map */
+	UPROPERTY(Transient)
+		UTexture2D* HeatmapTexture;
+
+	/** Instanced road segments of each road section, indexed by EVertexType */
+	UPROPERTY(Transient, DuplicateTransient)
+		TArray<UInstancedStaticMeshComponent*> RoadSegmentComponents;
+
+	/** Quantized flow and predictive state, replicated from the server to clients */
+	UPROPERTY(Transient, Replicated)
+		FStreetMapReplicatedFlow ReplicatedFlow;
+
 	/** Cached StreetMap DefaultMaterial */
 	UPROPERTY()
 		UMaterialInterface* StreetMapDefaultMaterial;
@@ -0,0 +1,148 @@
+// Copyright 2017 Mike Fricker. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "StreetMap.h"
+#include "StreetMapCongestionStats.generated.h"
+
+/** Congestion of all roads of one type */
+USTRUCT(BlueprintType)
+struct STREETMAPRUNTIME_API FStreetMapRoadTypeCongestion
+{
+	GENERATED_USTRUCT_BODY()
+
+	/** Length weighted average speed ratio of the roads with flow data, 1 if none has data */
+	UPROPERTY(Category = StreetMap, VisibleAnywhere, BlueprintReadOnly)
+		float AverageSpeedRatio = 1.0f;
+
+	/** Length of the roads drawn with the low flow color */
+	UPROPERTY(Category = StreetMap, VisibleAnywhere, BlueprintReadOnly)
+		float CongestedKm = 0.0f;
+
+	/** Length of the roads with flow data */
+	UPROPERTY(Category = StreetMap, VisibleAnywhere, BlueprintReadOnly)
+		float KmWithData = 0.0f;
+
+	/** Length of all roads of this type */
+	UPROPERTY(Category = StreetMap, VisibleAnywhere, BlueprintReadOnly)
+		float TotalKm = 0.0f;
+
+	UPROPERTY(Category = StreetMap, VisibleAnywhere, BlueprintReadOnly)
+		int32 NumRoadsWithData = 0;
+};
+
+/** Congestion of a TMC */
+USTRUCT(BlueprintType)
+struct STREETMAPRUNTIME_API FStreetMapTMCCongestion
+{
+	GENERATED_USTRUCT_BODY()
+
+	UPROPERTY(Category = StreetMap, VisibleAnywhere, BlueprintReadOnly)
+		FName TMC;
+
+	UPROPERTY(Category = StreetMap, VisibleAnywhere, BlueprintReadOnly)
+		float SpeedRatio = 1.0f;
+};
+
+/**
+ * Network congestion statistics kept up to date as flow data is written, so polling them never walks the roads.
+ * Every road remembers what it contributes to the running sums of its road type, an update subtracts the old
+ * contribution and adds the new one.  TMCs with flow data are kept in an indexed min-heap by speed ratio, the
+ * worst ones are read from the top of the heap.
+ */
+class STREETMAPRUNTIME_API FStreetMapCongestionStats
+{
+
+public:
+
+	static const int32 NumRoadTypes = (int32)EStreetMapRoadType::Other + 1;
+
+	FStreetMapCongestionStats();
+
+	/**
+	* Measures the roads and resets them to no data
+	* @param InCongestedSpeedRatio Roads at or below this speed ratio count as congested
+	*/
+	void Init(const TArray<FStreetMapRoad>& Roads, float InCongestedSpeedRatio);
+
+	int32 Num() const
+	{
+		return RoadLengths.Num();
+	}
+
+	/** Forgets the roads, Num() is zero until the next Init() */
+	void Reset();
+
+	/** Updates the contribution of a road, O(1), plus O(log TMCs) for the first road of a TMC */
+	void SetRoadSpeedRatio(int32 RoadIndex, bool bHasData, float SpeedRatio);
+
+	/**
+	* Updates the contribution of every road of a TMC from its flow speed, relative to the speed limit of each road
+	* and capped at 1 like the color slots.  O(roads of the TMC), TMCs not on the roads are ignored.
+	*/
+	void SetTMCSpeed(FName TMC, bool bHasData, float Speed);
+
+	/** Sets every road back to no data */
+	void ClearData();
+
+	/** @return Statistics of a road type, O(1) */
+	FStreetMapRoadTypeCongestion GetRoadTypeCongestion(EStreetMapRoadType RoadType) const;
+
+	/** @return Number of TMCs with flow data */
+	int32 NumTMCsWithData() const
+	{
+		return Heap.Num();
+	}
+
+	/** @return The worst TMCs, lowest speed ratio first.  O(Count log Count), independent of the network size */
+	void GetWorstTMCs(int32 Count, TArray<FStreetMapTMCCongestion>& OutWorst) const;
+
+private:
+
+	struct FRoadTypeSums
+	{
+		double SpeedRatioLength = 0.0;
+		double LengthWithData = 0.0;
+		double CongestedLength = 0.0;
+		double TotalLength = 0.0;
+		int32 NumRoadsWithData = 0;
+	};
+
+	/** Orders TMCs by speed ratio, then by ordinal so equal ratios always come out in the same order */
+	bool IsWorse(int32 OrdinalA, int32 OrdinalB) const
+	{
+		return TMCSpeedRatios[OrdinalA] < TMCSpeedRatios[OrdinalB] || (TMCSpeedRatios[OrdinalA] == TMCSpeedRatios[OrdinalB] && OrdinalA < OrdinalB);
+	}
+
+	void SetTMCSpeedRatio(int32 Ordinal, bool bHasData, float SpeedRatio);
+	void SiftUp(int32 HeapIndex);
+	void SiftDown(int32 HeapIndex);
+	void SwapHeapEntries(int32 HeapIndexA, int32 HeapIndexB);
+
+	float CongestedSpeedRatio;
+
+	FRoadTypeSums Sums[NumRoadTypes];
+
+	/** Per road: length in km, type, speed limit, TMC ordinal and current contribution */
+	TArray<float> RoadLengths;
+	TArray<float> RoadSpeedLimits;
+	TArray<uint8> RoadTypes;
+	TArray<int32> RoadTMCOrdinals;
+	TArray<float> RoadSpeedRatios;
+	TBitArray<> RoadHasData;
+
+	/** Per TMC: name, the road that defines its ratio, its ratio and its position in the heap */
+	TMap<FName, int32> Ordinals;
+	TArray<FName> TMCs;
+	TArray<int32> TMCFirstRoads;
+	TArray<float> TMCSpeedRatios;
+	TArray<int32> TMCHeapIndices;
+
+	/** Roads of each TMC, those of ordinal N are TMCRoads[TMCFirstRoadEntries[N]] up to the first entry of N + 1 */
+	TArray<int32> TMCFirstRoadEntries;
+	TArray<int32> TMCRoads;
+
+	/** TMC ordinals with flow data, worst on top */
+	TArray<int32> Heap;
+};
@@ -0,0 +1,220 @@
+// Copyright 2017 Mike Fricker. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/Runnable.h"
+#include "HAL/ThreadSafeBool.h"
+#include "HAL/ThreadSafeCounter64.h"
+#include "Containers/LockFreeList.h"
+#include "StreetMapFlowFeed.generated.h"
+
+/** Where a live flow feed is read from */
+UENUM(BlueprintType)
+enum class EStreetMapFeedSource : uint8
+{
+	/** A file that keeps growing, read like tail -f */
+	FileTail,
+
+	/** A named pipe (Windows) or FIFO (other platforms) */
+	NamedPipe,
+
+	/** A TCP connection to a feed server on this machine */
+	LocalSocket
+};
+
+/** Encoding of the records of a live flow feed */
+UENUM(BlueprintType)
+enum class EStreetMapFeedFormat : uint8
+{
+	/** Records made of a uint8 TMC length, the TMC characters and a little endian float32 speed */
+	Binary,
+
+	/** One JSON object per line: {"tmc": "...", "speed": ...} */
+	NDJSON
+};
+
+/** Live flow feed settings */
+USTRUCT(BlueprintType)
+struct STREETMAPRUNTIME_API FStreetMapFlowFeedSettings
+{
+	GENERATED_USTRUCT_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "StreetMap")
+		EStreetMapFeedSource Source = EStreetMapFeedSource::LocalSocket;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "StreetMap")
+		EStreetMapFeedFormat Format = EStreetMapFeedFormat::NDJSON;
+
+	/** File or pipe path, unused for sockets */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "StreetMap")
+		FString Path;
+
+	/** Port on localhost, only used for sockets */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "StreetMap")
+		int32 Port = 7411;
+
+	/** If true, a file feed starts at its current end and only reads what gets appended */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "StreetMap")
+		bool bTailFromEnd = true;
+
+	/** Records with a negative or higher speed are rejected as corrupt */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "StreetMap")
+		float MaxSpeed = 250.0f;
+};
+
+/** One decoded flow record */
+struct FStreetMapFlowUpdate
+{
+	FName TMC;
+	float Speed;
+
+	/** FPlatformTime::Seconds() when the record was decoded */
+	double DecodeTime;
+};
+
+/** Reads bytes from a feed source, implemented per EStreetMapFeedSource */
+class IStreetMapFeedSource
+{
+public:
+	virtual ~IStreetMapFeedSource() {}
+
+	virtual bool Open() = 0;
+
+	/** @return Number of bytes read, 0 when nothing is available yet, INDEX_NONE once the source is gone */
+	virtual int32 Read(uint8* Buffer, int32 BufferSize) = 0;
+
+	virtual void Close() = 0;
+};
+
+/**
+ * Reads a live flow feed on a worker thread.  Records are decoded and validated off the game thread and published
+ * in batches.  Two batch buffers ping-pong between the worker and the game thread through an atomic "published"
+ * slot and a lock-free free list, so neither side ever waits for the other.
+ */
+class STREETMAPRUNTIME_API FStreetMapFlowFeed : public FRunnable
+{
+
+public:
+
+	FStreetMapFlowFeed(const FStreetMapFlowFeedSettings& InSettings);
+	virtual ~FStreetMapFlowFeed();
+
+	/** Starts the worker thread */
+	bool Start();
+
+	/** Stops the worker thread and waits for it to exit */
+	void Shutdown();
+
+	bool IsRunning() const
+	{
+		return Thread != nullptr;
+	}
+
+	/**
+	* Takes the batch published since the last call, game thread only.
+	* @param OutUpdates Receives the records, oldest first.  Its previous content is discarded.
+	* @return True if a batch was available
+	*/
+	bool ConsumeBatch(TArray<FStreetMapFlowUpdate>& OutUpdates);
+
+	/**
+	* Decodes as many whole records as possible and appends them to OutUpdates.
+	* @return Number of bytes consumed, the remainder is an incomplete record
+	*/
+	static int32 Decode(const FStreetMapFlowFeedSettings& Settings, const uint8* Data, int32 NumBytes, TArray<FStreetMapFlowUpdate>& OutUpdates, int64& OutNumRejected);
+
+	/** Appends one record in the specified format, used by feed writers */
+	static void Encode(EStreetMapFeedFormat Format, FName TMC, float Speed, TArray<uint8>& OutBytes);
+
+	/** Counters, safe to read from any thread */
+	int64 GetNumBytesRead() const { return NumBytesRead.GetValue(); }
+	int64 GetNumRecords() const { return NumRecords.GetValue(); }
+	int64 GetNumRejected() const { return NumRejected.GetValue(); }
+	int64 GetNumBatches() const { return NumBatches.GetValue(); }
+
+	// FRunnable interface
+	virtual uint32 Run() override;
+	virtual void Stop() override;
+
+private:
+
+	struct FBatch
+	{
+		TArray<FStreetMapFlowUpdate> Updates;
+	};
+
+	/** Hands the pending records to the game thread if a batch buffer is available */
+	void Publish();
+
+	FStreetMapFlowFeedSettings Settings;
+
+	TUniquePtr<IStreetMapFeedSource> Source;
+
+	FRunnableThread* Thread;
+
+	FThreadSafeBool bStopping;
+
+	/** Worker side: undecoded bytes and decoded records not published yet */
+	TArray<uint8> ReadBuffer;
+	TArray<FStreetMapFlowUpdate> Pending;
+
+	FBatch Batches[2];
+
+	/** Batch ready for the game thread, null when it was consumed */
+	TAtomic<FBatch*> PublishedBatch;
+
+	/** Batches nobody uses */
+	TLockFreePointerListUnordered<FBatch, PLATFORM_CACHE_LINE_SIZE> FreeBatches;
+
+	FThreadSafeCounter64 NumBytesRead;
+	FThreadSafeCounter64 NumRecords;
+	FThreadSafeCounter64 NumRejected;
+	FThreadSafeCounter64 NumBatches;
+};
+
+/**
+ * Stand-in for a live flow feed server, so the ingestion path can be tested and benchmarked without a network.
+ * Streams random walk speeds for a list of TMCs at a fixed rate, either to a client of a localhost socket or
+ * appended to a file.
+ */
+class STREETMAPRUNTIME_API FStreetMapFeedServer : public FRunnable
+{
+
+public:
+
+	FStreetMapFeedServer(const FStreetMapFlowFeedSettings& InSettings, const TArray<FName>& InTMCs, float InUpdatesPerSecond);
+	virtual ~FStreetMapFeedServer();
+
+	bool Start();
+	void Shutdown();
+
+	/** Changes the rate, can be called while running */
+	void SetUpdatesPerSecond(float InUpdatesPerSecond);
+
+	int64 GetNumRecordsSent() const { return NumRecordsSent.GetValue(); }
+
+	// FRunnable interface
+	virtual uint32 Run() override;
+	virtual void Stop() override;
+
+private:
+
+	/** Sends or appends bytes, @return False if the client is gone */
+	bool Write(const TArray<uint8>& Bytes);
+
+	FStreetMapFlowFeedSettings Settings;
+	TArray<FName> TMCs;
+	TArray<float> Speeds;
+
+	TAtomic<float> UpdatesPerSecond;
+
+	FRunnableThread* Thread;
+	FThreadSafeBool bStopping;
+
+	class FSocket* ListenSocket;
+	class FSocket* ClientSocket;
+	class IFileHandle* FileHandle;
+
+	FThreadSafeCounter64 NumRecordsSent;
+};
@@ -0,0 +1,151 @@
+// Copyright 2017 Mike Fricker. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/NetSerialization.h"
+#include "StreetMapReplication.generated.h"
+
+class UStreetMapComponent;
+struct FPredictiveData;
+struct FStreetMapReplicatedFlow;
+
+/** Replication traffic of the flow state, counted on both ends */
+USTRUCT(BlueprintType)
+struct STREETMAPRUNTIME_API FStreetMapReplicationCounters
+{
+	GENERATED_USTRUCT_BODY()
+
+	/** Bytes written for all client connections, server only */
+	UPROPERTY(Category = StreetMap, VisibleAnywhere, BlueprintReadOnly)
+		int64 BytesSent = 0;
+
+	/** Bytes read from the server, clients only */
+	UPROPERTY(Category = StreetMap, VisibleAnywhere, BlueprintReadOnly)
+		int64 BytesReceived = 0;
+
+	/** TMC states received, a join resync counts every TMC with data */
+	UPROPERTY(Category = StreetMap, VisibleAnywhere, BlueprintReadOnly)
+		int64 NumTMCsReceived = 0;
+
+	/** Replication updates received */
+	UPROPERTY(Category = StreetMap, VisibleAnywhere, BlueprintReadOnly)
+		int32 NumUpdatesReceived = 0;
+};
+
+/**
+ * Flow and predictive state of one TMC, quantized to 8-bit speed ratios relative to the speed limit of the TMC.
+ * TMCs are identified by their dense ordinal in the street map, which server and clients compute identically.
+ */
+USTRUCT()
+struct STREETMAPRUNTIME_API FStreetMapReplicatedFlowItem : public FFastArraySerializerItem
+{
+	GENERATED_USTRUCT_BODY()
+
+	/** Value of a speed without data */
+	static const uint8 NoData = 255;
+
+	/** Largest quantized speed ratio */
+	static const uint8 FullSpeed = 254;
+
+	UPROPERTY()
+		int32 Ordinal = INDEX_NONE;
+
+	UPROPERTY()
+		uint8 Flow = NoData;
+
+	/** Predictive 0, 15, 30 and 45 minutes, all NoData without predictive data */
+	UPROPERTY()
+		uint8 Predictive[4] = { NoData, NoData, NoData, NoData };
+
+	/** Packs the ordinal and skips missing data, 3 to 9 bytes per TMC */
+	bool NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess);
+
+	void PostReplicatedAdd(const FStreetMapReplicatedFlow& InArraySerializer);
+	void PostReplicatedChange(const FStreetMapReplicatedFlow& InArraySerializer);
+};
+
+template<>
+struct TStructOpsTypeTraits<FStreetMapReplicatedFlowItem> : public TStructOpsTypeTraitsBase2<FStreetMapReplicatedFlowItem>
+{
+	enum
+	{
+		WithNetSerializer = true,
+	};
+};
+
+/**
+ * Replicated flow state of a street map component.  Only TMCs whose quantized state changed are sent, and a client
+ * joining late receives every TMC at once.
+ */
+USTRUCT()
+struct STREETMAPRUNTIME_API FStreetMapReplicatedFlow : public FFastArraySerializer
+{
+	GENERATED_USTRUCT_BODY()
+
+	UPROPERTY()
+		TArray<FStreetMapReplicatedFlowItem> Items;
+
+	/** Component applying received states, not replicated */
+	UPROPERTY(NotReplicated)
+		UStreetMapComponent* Owner = nullptr;
+
+	/** Builds the TMC ordinals from the roads, server and clients get the same ones for the same street map */
+	void Init(const TArray<struct FStreetMapRoad>& Roads);
+
+	bool IsInitialized() const
+	{
+		return TMCs.Num() > 0;
+	}
+
+	int32 GetOrdinal(FName TMC) const
+	{
+		const int32* Ordinal = Ordinals.Find(TMC);
+		return Ordinal ? *Ordinal : INDEX_NONE;
+	}
+
+	FName GetTMC(int32 Ordinal) const
+	{
+		return TMCs.IsValidIndex(Ordinal) ? TMCs[Ordinal] : NAME_None;
+	}
+
+	/** Server: quantizes the state of a TMC and marks it for replication if it changed.  Speed < 0 means no data. */
+	void SetFlow(FName TMC, float Speed);
+	void SetPredictive(FName TMC, const FPredictiveData* Data);
+
+	/** Server: every TMC back to no data */
+	void ClearFlow();
+	void ClearPredictive();
+
+	/** Speed of a quantized ratio, -1 for no data */
+	float Dequantize(int32 Ordinal, uint8 Ratio) const;
+
+	FStreetMapReplicationCounters Counters;
+
+	bool NetDeltaSerialize(FNetDeltaSerializeInfo& DeltaParms);
+
+	void PostReplicatedReceive(const FFastArraySerializer::FPostReplicatedReceiveParameters& Parameters);
+
+private:
+
+	uint8 Quantize(int32 Ordinal, float Speed) const;
+
+	/** Item of a TMC, created on first use */
+	FStreetMapReplicatedFlowItem& FindOrAddItem(int32 Ordinal);
+
+	TMap<FName, int32> Ordinals;
+	TArray<FName> TMCs;
+	TArray<float> SpeedLimits;
+
+	/** Index of each ordinal in Items, INDEX_NONE until the TMC first gets data */
+	TArray<int32> ItemIndices;
+};
+
+template<>
+struct TStructOpsTypeTraits<FStreetMapReplicatedFlow> : public TStructOpsTypeTraitsBase2<FStreetMapReplicatedFlow>
+{
+	enum
+	{
+		WithNetDeltaSerializer = true,
+	};
+};
@@ -0,0 +1,119 @@
+// Copyright 2017 Mike Fricker. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "StreetMap.h"
+#include "StreetMapTraceAnalytics.generated.h"
+
+
+/** Length and travel times of one trace, times in minutes like GetTraceDetails() */
+USTRUCT(BlueprintType)
+struct STREETMAPRUNTIME_API FStreetMapTraceAnalytics
+{
+	GENERATED_USTRUCT_BODY()
+
+	UPROPERTY(Category = StreetMap, VisibleAnywhere, BlueprintReadOnly)
+		FGuid TraceGUID;
+
+	/** Sum of the road distances of the trace links found on the street map */
+	UPROPERTY(Category = StreetMap, VisibleAnywhere, BlueprintReadOnly)
+		float Distance = 0.0f;
+
+	/** Number of trace links found on the street map */
+	UPROPERTY(Category = StreetMap, VisibleAnywhere, BlueprintReadOnly)
+		int32 NumRoads = 0;
+
+	/** Travel time at the speed limits */
+	UPROPERTY(Category = StreetMap, VisibleAnywhere, BlueprintReadOnly)
+		float FreeFlowTime = 0.0f;
+
+	/** Travel times at the current flow and at the predicted 0/15/30/45 minute speeds */
+	UPROPERTY(Category = StreetMap, VisibleAnywhere, BlueprintReadOnly)
+		float FlowTime = 0.0f;
+	UPROPERTY(Category = StreetMap, VisibleAnywhere, BlueprintReadOnly)
+		float S0Time = 0.0f;
+	UPROPERTY(Category = StreetMap, VisibleAnywhere, BlueprintReadOnly)
+		float S15Time = 0.0f;
+	UPROPERTY(Category = StreetMap, VisibleAnywhere, BlueprintReadOnly)
+		float S30Time = 0.0f;
+	UPROPERTY(Category = StreetMap, VisibleAnywhere, BlueprintReadOnly)
+		float S45Time = 0.0f;
+
+	/** Travel times above the free flow time */
+	UPROPERTY(Category = StreetMap, VisibleAnywhere, BlueprintReadOnly)
+		float FlowDelay = 0.0f;
+	UPROPERTY(Category = StreetMap, VisibleAnywhere, BlueprintReadOnly)
+		float S0Delay = 0.0f;
+	UPROPERTY(Category = StreetMap, VisibleAnywhere, BlueprintReadOnly)
+		float S15Delay = 0.0f;
+	UPROPERTY(Category = StreetMap, VisibleAnywhere, BlueprintReadOnly)
+		float S30Delay = 0.0f;
+	UPROPERTY(Category = StreetMap, VisibleAnywhere, BlueprintReadOnly)
+		float S45Delay = 0.0f;
+};
+
+/**
+ * Batch travel time analytics over many traces.  The distance and speed limit of every road are precomputed into
+ * dense arrays, along with one dense array of raw speeds per horizon kept up to date as flow and predictive data
+ * arrive, so a trace link costs one map lookup and a few array reads.  Traces are processed in parallel.
+ * Travel times are the road distance over the speed, like GetTraceDetails(): roads without data for a horizon
+ * travel at their speed limit, stopped roads at MinSpeed.
+ */
+class STREETMAPRUNTIME_API FStreetMapTraceAnalyticsPass
+{
+
+public:
+
+	/** Current flow, then the predicted 0/15/30/45 minute speeds */
+	enum EHorizon
+	{
+		Flow,
+		S0,
+		S15,
+		S30,
+		S45,
+		NumHorizons
+	};
+
+	/** Speed of stopped roads, keeps their travel times finite */
+	static const float MinSpeed;
+
+	/** Precomputes the distance and speed limit of the roads, every horizon starts without data */
+	void Init(const TArray<FStreetMapRoad>& Roads);
+
+	void Reset();
+
+	int32 Num() const
+	{
+		return RoadDistances.Num();
+	}
+
+	/**
+	* Sets the speed of every road of a TMC for one horizon
+	* @param Speed Raw speed, negative when the TMC has no data for this horizon
+	*/
+	void SetTMCSpeed(FName TMC, EHorizon Horizon, float Speed);
+
+	/** Every road of one horizon back to its speed limit */
+	void ClearHorizon(EHorizon Horizon);
+
+	/**
+	* Computes one row per trace, in the order of the traces
+	* @param Link2RoadIndex Road of each link, only read
+	*/
+	void Run(const TArray<const FStreetMapTrace*>& Traces, const TMap<FStreetMapLink, int>& Link2RoadIndex, TArray<FStreetMapTraceAnalytics>& OutRows) const;
+
+private:
+
+	TArray<float> RoadDistances;
+	TArray<float> RoadSpeedLimits;
+
+	/** Speed of every road under each horizon, the speed limit without data */
+	TArray<float> RoadSpeeds[NumHorizons];
+
+	/** Roads of each TMC, the roads of ordinal N are TMCRoads[TMCFirstRoadEntries[N]] to TMCRoads[TMCFirstRoadEntries[N + 1] - 1] */
+	TMap<FName, int32> Ordinals;
+	TArray<int32> TMCFirstRoadEntries;
+	TArray<int32> TMCRoads;
+};
@@ -9,4 +9,8 @@ AStreetMapActor::AStreetMapActor(const FObjectInitializer& ObjectInitializer)
 {
 	StreetMapComponent = CreateDefaultSubobject<UStreetMapComponent>(TEXT("StreetMapComp"));
 	RootComponent = StreetMapComponent;
+
+	// The component replicates flow state, every client needs the whole map
+	bReplicates = true;
+	bAlwaysRelevant = true;
 }
\ No newline at end of file
@@ -0,0 +1,72 @@
+// Copyright 2017 Mike Fricker. All Rights Reserved.
+
+#include "StreetMapColorSlots.h"
+#include "StreetMapRuntime.h"
+
+const float FStreetMapColorSlots::HighSpeedRatio = 0.8f;
+const float FStreetMapColorSlots::MedSpeedRatio = 0.5f;
+
+int32 FStreetMapColorSlots::GetSlot(EColorMode ColorMode)
+{
+	switch (ColorMode) {
+	case EColorMode::Flow:
+		return 0;
+	case EColorMode::Predictive0:
+		return 1;
+	case EColorMode::Predictive15:
+		return 2;
+	case EColorMode::Predictive30:
+		return 3;
+	case EColorMode::Predictive45:
+		return 4;
+	case EColorMode::PredictiveTime:
+		return PredictiveTimeSlot;
+	default:
+		return INDEX_NONE;
+	}
+}
+
+void FStreetMapColorSlots::GetPredictiveTimeWeights(float Minutes, int32& OutFirstSlot, uint32& OutWeight)
+{
+	// Predictive slots are 15 minutes apart, starting with Predictive0
+	const float Horizon = FMath::Clamp(Minutes, 0.0f, 45.0f) / 15.0f;
+	const int32 Segment = FMath::Min(FMath::FloorToInt(Horizon), 2);
+
+	OutFirstSlot = GetSlot(EColorMode::Predictive0) + Segment;
+	OutWeight = (uint32)FMath::RoundToInt((Horizon - Segment) * 256.0f);
+}
+
+void FStreetMapColorSlots::Init(int32 InNumRoads)
+{
+	NumRoads = InNumRoads;
+
+	SpeedRatios.Reset();
+	SpeedRatios.Init(FullSpeed, NumRoads * NumSlots);
+
+	PredictiveTimeRatios.Reset();
+	PredictiveTimeRatios.Init(FullSpeed, NumRoads);
+	PreviousPredictiveTimeRatios.Reset();
+	PreviousPredictiveTimeRatios.Init(FullSpeed, NumRoads);
+}
+
+void FStreetMapColorSlots::InterpolatePredictiveTime(float Minutes)
+{
+	PredictiveTime = Minutes;
+
+	int32 FirstSlot;
+	uint32 Weight;
+	GetPredictiveTimeWeights(Minutes, FirstSlot, Weight);
+
+	Swap(PredictiveTimeRatios, PreviousPredictiveTimeRatios);
+
+	// Plain loop over three contiguous byte arrays, simple enough for the compiler to vectorize
+	const uint8* RESTRICT From = SpeedRatios.GetData() + FirstSlot * NumRoads;
+	const uint8* RESTRICT To = From + NumRoads;
+	uint8* RESTRICT Result = PredictiveTimeRatios.GetData();
+	const uint32 FromWeight = 256 - Weight;
+
+	for (int32 RoadIndex = 0; RoadIndex < NumRoads; ++RoadIndex)
+	{
+		Result[RoadIndex] = (uint8)((From[RoadIndex] * FromWeight + To[RoadIndex] * Weight + 128) >> 8);
+	}
+}
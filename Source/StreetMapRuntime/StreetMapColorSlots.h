@@ -0,0 +1,158 @@
+// Copyright 2017 Mike Fricker. All Rights Reserved.
+#pragma once
+
+#include "CoreMinimal.h"
+#include "StreetMap.h"
+
+/**
+ * Precomputed speed ratio of every road for each data driven color mode (Flow, Predictive0/15/30/45).
+ * Ratios are quantized to one byte and every slot is a dense array indexed by road, so whole-network passes
+ * like the predictive time interpolation run over contiguous memory.
+ * Slots are refreshed when flow or predictive data arrives, a color mode switch only selects a slot.
+ */
+class FStreetMapColorSlots
+{
+
+public:
+
+	/** Number of color modes with a stored slot */
+	static const int32 NumSlots = 5;
+
+	/** Slot of EColorMode::PredictiveTime, interpolated from the predictive slots instead of stored */
+	static const int32 PredictiveTimeSlot = NumSlots;
+
+	/** Quantized ratio of roads without data, same as the free flow ratio */
+	static const uint8 FullSpeed = 255;
+
+	/** Speed ratios above these are drawn with the high and medium flow colors */
+	static const float HighSpeedRatio;
+	static const float MedSpeedRatio;
+
+	/** @return Slot of a color mode, INDEX_NONE for modes that don't depend on data */
+	static int32 GetSlot(EColorMode ColorMode);
+
+	/** @return Largest quantized ratio that is not above a color band edge */
+	static uint8 GetQuantizedThreshold(float SpeedRatio)
+	{
+		return (uint8)FMath::FloorToInt(SpeedRatio * 255.0f);
+	}
+
+	/**
+	* @return Color band edge to compare quantized ratios against, halfway between two quantized values so the
+	* material can't land on the other side of it.  The CPU mirror of the material uses the same edges.
+	*/
+	static float GetQuantizedBandEdge(float SpeedRatio)
+	{
+		return (GetQuantizedThreshold(SpeedRatio) + 0.5f) / 255.0f;
+	}
+
+	/**
+	* Quantizes a speed ratio to a slot value.  Rounding never moves a ratio across a color band edge, so a road
+	* has the same color from its slot as from its raw speed ratio.
+	*/
+	static uint8 Quantize(float SpeedRatio)
+	{
+		SpeedRatio = FMath::Clamp(SpeedRatio, 0.0f, 1.0f);
+		int32 Ratio = FMath::RoundToInt(SpeedRatio * 255.0f);
+
+		for (const float Edge : { HighSpeedRatio, MedSpeedRatio })
+		{
+			const int32 Threshold = GetQuantizedThreshold(Edge);
+			if (SpeedRatio > Edge && Ratio <= Threshold)
+			{
+				Ratio = Threshold + 1;
+			}
+			else if (SpeedRatio <= Edge && Ratio > Threshold)
+			{
+				Ratio = Threshold;
+			}
+		}
+
+		return (uint8)Ratio;
+	}
+
+	/**
+	* Splits a predictive time into the first predictive slot to interpolate from and an 8-bit fractional weight
+	* towards the next slot.  Shared with the attribute material so CPU and GPU pick identical values.
+	*/
+	static void GetPredictiveTimeWeights(float Minutes, int32& OutFirstSlot, uint32& OutWeight);
+
+	/** Fixed point interpolation of two quantized ratios, Weight in [0, 256] */
+	static uint8 Interpolate(uint8 A, uint8 B, uint32 Weight)
+	{
+		return (uint8)((A * (256 - Weight) + B * Weight + 128) >> 8);
+	}
+
+	/** Resets all slots of all roads to full speed */
+	void Init(int32 InNumRoads);
+
+	/** @return Number of roads */
+	int32 Num() const
+	{
+		return NumRoads;
+	}
+
+	void SetSpeedRatio(int32 RoadIndex, int32 Slot, float SpeedRatio)
+	{
+		SpeedRatios[Slot * NumRoads + RoadIndex] = Quantize(SpeedRatio);
+	}
+
+	/** @return Speed ratio of a road in a slot, 1 for INDEX_NONE */
+	float GetSpeedRatio(int32 RoadIndex, int32 Slot) const
+	{
+		if (Slot == INDEX_NONE) return 1.0f;
+		if (Slot == PredictiveTimeSlot) return PredictiveTimeRatios[RoadIndex] / 255.0f;
+
+		return SpeedRatios[Slot * NumRoads + RoadIndex] / 255.0f;
+	}
+
+	/** @return Quantized ratios of every road in a stored slot, indexed by road */
+	const uint8* GetSlotRatios(int32 Slot) const
+	{
+		return SpeedRatios.GetData() + Slot * NumRoads;
+	}
+
+	/** Copies the NumSlots quantized ratios of a road */
+	void GetRoadSlots(int32 RoadIndex, uint8* OutSlots) const
+	{
+		for (int32 Slot = 0; Slot < NumSlots; ++Slot)
+		{
+			OutSlots[Slot] = SpeedRatios[Slot * NumRoads + RoadIndex];
+		}
+	}
+
+	/** @return Minutes of the last predictive time interpolation */
+	float GetPredictiveTime() const
+	{
+		return PredictiveTime;
+	}
+
+	/**
+	* Interpolates the predictive slots of every road at the specified time, in one pass over the dense slot arrays.
+	* The ratios of the previous interpolation are kept, so the caller can find the roads that changed.
+	*/
+	void InterpolatePredictiveTime(float Minutes);
+
+	/** @return Quantized ratios of the last two predictive time interpolations, indexed by road */
+	const TArray<uint8>& GetPredictiveTimeRatios() const
+	{
+		return PredictiveTimeRatios;
+	}
+	const TArray<uint8>& GetPreviousPredictiveTimeRatios() const
+	{
+		return PreviousPredictiveTimeRatios;
+	}
+
+private:
+
+	/** NumSlots dense arrays of NumRoads quantized ratios, slot after slot */
+	TArray<uint8> SpeedRatios;
+
+	/** Interpolated ratios of the current and previous predictive time */
+	TArray<uint8> PredictiveTimeRatios;
+	TArray<uint8> PreviousPredictiveTimeRatios;
+
+	float PredictiveTime = 0.0f;
+
+	int32 NumRoads = 0;
+};
@@ -8,7 +8,17 @@
 #include "Engine/Polys.h"
 #include "GenericPlatform/GenericPlatformMath.h"
 #include "PolygonTools.h"
+#include "StreetMapStateSnapshot.h"
+#include "StreetMapCustomVersion.h"
+#include "Engine/Texture2D.h"
+#include "Components/InstancedStaticMeshComponent.h"
+#include "Materials/MaterialInstanceDynamic.h"
 #include "Async.h"
+#include "Async/ParallelFor.h"
+#include "Net/UnrealNetwork.h"
+#include "Misc/Compression.h"
+#include "Serialization/MemoryWriter.h"
+#include "Serialization/MemoryReader.h"
 #include "RayTypes.h"
 #include <algorithm>
 
@@ -35,10 +45,18 @@ UStreetMapComponent::UStreetMapComponent(const FObjectInitializer& ObjectInitial
 	// Because we don't have collision data yet!
 	SetCollisionProfileName(UCollisionProfile::NoCollision_ProfileName);
 
-	// We don't currently need to be ticked.  This can be overridden in a derived class though.
-	PrimaryComponentTick.bCanEverTick = false;
+	// We only tick while a live flow feed is running
+	PrimaryComponentTick.bCanEverTick = true;
+	PrimaryComponentTick.bStartWithTickEnabled = false;
+
+	// Async mesh builds are swapped in by the tick, in the editor as well
+	bTickInEditor = true;
 	this->bAutoActivate = false;	// NOTE: Components instantiated through C++ are not automatically active, so they'll only tick once and then go to sleep!
 
+	// Flow state set on the server shows up on every client
+	SetIsReplicatedByDefault(true);
+	ReplicatedFlow.Owner = this;
+
 	// We don't currently need InitializeComponent() to be called on us.  This can be overridden in a
 	// derived class though.
 	bWantsInitializeComponent = false;
@@ -55,6 +73,10 @@ UStreetMapComponent::UStreetMapComponent(const FObjectInitializer& ObjectInitial
 	static ConstructorHelpers::FObjectFinder<UMaterialInterface> DefaultMaterialAsset(TEXT("/StreetMap/StreetMapDefaultInstanceMaterial"));
 	StreetMapDefaultMaterial = DefaultMaterialAsset.Object;
 
+	static ConstructorHelpers::FObjectFinder<UStaticMesh> RoadSegmentMeshAsset(TEXT("/Engine/BasicShapes/Plane"));
+	RoadSegmentMesh = RoadSegmentMeshAsset.Object;
+	RoadSegmentMaterial = nullptr;
+
 	HighwayTolerance = 50000.0f;
 	MajorRoadTolerance = 10000.0f;
 	StreetTolerance = 2500.0f;
@@ -182,6 +204,11 @@ void UStreetMapComponent::IndexStreetMap()
 		IndexVertices(mHighwayLink2Vertices, mHighwayTmcs2Vertices, HighwayVertices);
 		IndexVertices(mMajorLink2Vertices, mMajorTmcs2Vertices, MajorRoadVertices);
 		IndexVertices(mStreetLink2Vertices, mStreetTmcs2Vertices, StreetVertices);
+
+		// Traces added before the roads were indexed aren't on any stack yet
+		if (TraceStacks.NumRoads() == 0 && mTraces.Num() > mHiddenTraces.Num()) {
+			RebuildTraceStacks();
+		}
 	}
 }
 
@@ -194,28 +221,29 @@ void UStreetMapComponent::IndexVertices(
 	LinkMap.Reset();
 	TmcMap.Reset();
 
-	int NumVertices = Vertices.Num();
+	EVertexType VertexType;
+	if (StreetMap == nullptr || !FindVertexType(Vertices, VertexType)) return;
 
-	for (int i = 0; i < NumVertices; i++) {
-		auto* Vertex = &Vertices[i];
-		const bool IsForward = Vertex->LinkDir.Compare(TEXT("T"), ESearchCase::IgnoreCase) == 0;
+	// Vertices don't know their road, the vertex ranges do.  Meshes cached without them are indexed once rebuilt.
+	const auto& Roads = StreetMap->GetRoads();
+	if (RoadVertexRanges.Num() != Roads.Num()) return;
 
-		auto Link = FStreetMapLink(Vertex->LinkId, Vertex->LinkDir);
-		if (LinkMap.Contains(Link)) {
-			LinkMap[Link].Add(i);
-		}
-		else {
-			auto VertexIndices = TArray<int>({ i });
-			LinkMap.Add(Link, VertexIndices);
+	for (int32 RoadIndex = 0; RoadIndex < Roads.Num(); ++RoadIndex) {
+		const FStreetMapVertexRange& Range = RoadVertexRanges[RoadIndex];
+		if (Range.VertexType != VertexType || Range.NumVertices == 0) continue;
+
+		const FStreetMapRoad& Road = Roads[RoadIndex];
+		const int32 LastVertex = FMath::Min(Range.FirstVertex + Range.NumVertices, Vertices.Num());
+
+		TArray<int>& LinkVertices = LinkMap.FindOrAdd(Road.Link);
+		for (int32 VertexIndex = Range.FirstVertex; VertexIndex < LastVertex; ++VertexIndex) {
+			LinkVertices.Add(VertexIndex);
 		}
 
-		if (Vertex->TMC != "None") {
-			if (TmcMap.Contains(Vertex->TMC)) {
-				TmcMap[Vertex->TMC].Add(i);
-			}
-			else {
-				auto VertexIndices = TArray<int>({ i });
-				TmcMap.Add(Vertex->TMC, VertexIndices);
+		if (Road.TMC != "None") {
+			TArray<int>& TmcVertices = TmcMap.FindOrAdd(Road.TMC);
+			for (int32 VertexIndex = Range.FirstVertex; VertexIndex < LastVertex; ++VertexIndex) {
+				TmcVertices.Add(VertexIndex);
 			}
 		}
 	}
@@ -227,19 +255,304 @@ FPrimitiveSceneProxy* UStreetMapComponent::CreateSceneProxy()
 
 	if (HasValidMesh())
 	{
+		// Only meshes edited in place since they were generated or loaded are laid out here
+		EnsureRenderData();
+
+		// Any pending color changes are part of the new proxy already
+		UpdateRenderColors();
+		UpdateRenderTexCoords();
+		DirtyColorRanges.Reset();
+		DirtyTexCoordRoads.Reset();
+
 		StreetMapSceneProxy = new FStreetMapSceneProxy(this);
-		StreetMapSceneProxy->Init(this, EVertexType::VBuilding, BuildingVertices, BuildingIndices);
-		StreetMapSceneProxy->Init(this, EVertexType::VStreet, StreetVertices, StreetIndices);
-		StreetMapSceneProxy->Init(this, EVertexType::VMajorRoad, MajorRoadVertices, MajorRoadIndices);
-		StreetMapSceneProxy->Init(this, EVertexType::VHighway, HighwayVertices, HighwayIndices);
+		StreetMapSceneProxy->Init(this, RenderData.ToSharedRef(), RenderTexCoords, RenderColors);
 
 		IndexStreetMap();
+
+		RenderCounters.NumProxyRebuilds++;
+		RenderCounters.LastProxyUploadBytes = StreetMapSceneProxy->GetUploadSizeBytes();
 	}
 
 	return StreetMapSceneProxy;
 }
 
 
+void UStreetMapComponent::OnRegister()
+{
+	Super::OnRegister();
+
+	if (MeshBuildSettings.bUseRoadAttributes && RoadAttributeTexture == nullptr)
+	{
+		InitRoadAttributes();
+	}
+
+	// A cached mesh was loaded without its segments
+	if (MeshBuildSettings.bDrawRoadsAsSegments)
+	{
+		EnsureRoadSegments();
+		UpdateRoadSegmentInstances();
+	}
+}
+
+
+void UStreetMapComponent::OnUnregister()
+{
+	DestroyRoadSegmentInstances();
+
+	Super::OnUnregister();
+}
+
+
+void UStreetMapComponent::TickComponent(float DeltaTime, enum ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	if (PendingMeshBuild.IsValid() && PendingMeshBuild->bDone)
+	{
+		FlushMeshBuild();
+	}
+
+	// Swap in whatever the feed decoded since the last frame
+	if (FlowFeed.IsValid() && FlowFeed->ConsumeBatch(FlowFeedUpdates))
+	{
+		ApplyFlowUpdates(FlowFeedUpdates);
+	}
+
+	if (Heatmap.IsInitialized())
+	{
+		Heatmap.Decay(DeltaTime);
+
+		TimeSinceHeatmapUpdate += DeltaTime;
+		if (TimeSinceHeatmapUpdate >= HeatmapUpdateInterval)
+		{
+			TimeSinceHeatmapUpdate = 0.0f;
+			Heatmap.Flush(HeatmapTexture);
+		}
+	}
+}
+
+
+void UStreetMapComponent::BeginDestroy()
+{
+	CancelMeshBuild();
+	StopFlowFeed();
+	StopLocalFeedServer();
+	Heatmap.Reset();
+
+	Super::BeginDestroy();
+}
+
+
+void UStreetMapComponent::Serialize(FArchive& Ar)
+{
+	Super::Serialize(Ar);
+
+	Ar.UsingCustomVersion(FStreetMapCustomVersion::GUID);
+
+	if (Ar.IsLoading() && Ar.GetLinker() != nullptr && Ar.CustomVer(FStreetMapCustomVersion::GUID) < FStreetMapCustomVersion::BulkCachedMesh)
+	{
+		// The cached mesh was saved as tagged properties that no longer exist
+		bMeshNeedsRebuildOnLoad = true;
+		return;
+	}
+
+	// The cached mesh holds no object references
+	if (Ar.IsObjectReferenceCollector() || Ar.IsCountingMemory())
+	{
+		return;
+	}
+
+	// Duplication and undo always keep the mesh and skip compression, they read it back right away
+	const bool bPersistent = Ar.IsPersistent() && !Ar.IsTransacting();
+
+	uint32 BuildHash = 0;
+	bool bHadMesh = false;
+	bool bMeshSaved = false;
+	bool bCompressed = false;
+	int32 UncompressedSize = 0;
+	TArray<uint8> Payload;
+
+	if (Ar.IsSaving())
+	{
+		bHadMesh = HasValidMesh();
+		bMeshSaved = !bPersistent || !bRegenerateMeshOnLoad;
+		if (bPersistent)
+		{
+			BuildHash = ComputeMeshBuildHash();
+		}
+
+		if (bMeshSaved)
+		{
+			FMemoryWriter Writer(Payload, Ar.IsPersistent());
+			SerializeCachedMesh(Writer, FStreetMapCustomVersion::LatestVersion);
+			UncompressedSize = Payload.Num();
+
+			if (bPersistent && bCompressCachedMesh && UncompressedSize > 0)
+			{
+				int32 CompressedSize = FCompression::CompressMemoryBound(NAME_Zlib, UncompressedSize);
+				TArray<uint8> Compressed;
+				Compressed.SetNumUninitialized(CompressedSize);
+				if (FCompression::CompressMemory(NAME_Zlib, Compressed.GetData(), CompressedSize, Payload.GetData(), UncompressedSize))
+				{
+					Compressed.SetNum(CompressedSize, false);
+					Payload = MoveTemp(Compressed);
+					bCompressed = true;
+				}
+			}
+		}
+	}
+
+	Ar << BuildHash << bHadMesh << bMeshSaved << bCompressed << UncompressedSize;
+	Payload.BulkSerialize(Ar);
+
+	if (Ar.IsLoading())
+	{
+		LoadedMeshBuildHash = BuildHash;
+		bMeshNeedsRebuildOnLoad = bHadMesh && !bMeshSaved;
+
+		if (bMeshSaved)
+		{
+			TArray<uint8> Body;
+			if (bCompressed)
+			{
+				Body.SetNumUninitialized(FMath::Max(UncompressedSize, 0));
+				if (!FCompression::UncompressMemory(NAME_Zlib, Body.GetData(), Body.Num(), Payload.GetData(), Payload.Num()))
+				{
+					Body.Reset();
+				}
+			}
+			else
+			{
+				Body = MoveTemp(Payload);
+			}
+
+			// Only packages carry older versions, everything else was written by this code
+			const int32 MeshVersion = Ar.GetLinker() != nullptr ? Ar.CustomVer(FStreetMapCustomVersion::GUID) : (int32)FStreetMapCustomVersion::LatestVersion;
+
+			FMemoryReader Reader(Body, Ar.IsPersistent());
+
+			// Vertices saved before the per-road texture coordinates moved off them can't be read, the mesh is generated again
+			const bool bReadable = MeshVersion >= FStreetMapCustomVersion::PackedVertices;
+			if (bReadable)
+			{
+				SerializeCachedMesh(Reader, MeshVersion);
+			}
+
+			// Laid out by the first scene proxy
+			RenderData.Reset();
+			if (!bReadable || Reader.IsError() || Body.Num() == 0)
+			{
+				FStreetMapMeshBuild Empty;
+				ApplyMeshBuild(Empty);
+				bMeshNeedsRebuildOnLoad = bHadMesh;
+			}
+		}
+		else
+		{
+			FStreetMapMeshBuild Empty;
+			ApplyMeshBuild(Empty);
+		}
+	}
+}
+
+
+void UStreetMapComponent::SerializeCachedMesh(FArchive& Ar, int32 Version)
+{
+	for (int32 SectionIndex = 0; SectionIndex < FStreetMapSceneProxy::NumSections; ++SectionIndex)
+	{
+		Ar << GetVerticesOfType((EVertexType)SectionIndex);
+		GetIndicesOfType((EVertexType)SectionIndex).BulkSerialize(Ar);
+	}
+	Ar << RoadVertexRanges;
+
+	// Meshes saved without chunks are drawn section by section
+	if (Version < FStreetMapCustomVersion::SpatialMeshChunks)
+	{
+		MeshChunks.Reset();
+		return;
+	}
+
+	int32 NumChunks = MeshChunks.Num();
+	Ar << NumChunks;
+	if (Ar.IsLoading())
+	{
+		MeshChunks.SetNum(FMath::Max(NumChunks, 0));
+	}
+	for (FStreetMapMeshChunk& Chunk : MeshChunks)
+	{
+		Ar << Chunk;
+
+		// Chunks saved before LODs are all full detail
+		if (Version >= FStreetMapCustomVersion::RoadLODs)
+		{
+			Ar << Chunk.LOD;
+		}
+	}
+
+	Ar << RoadSpeedRatios;
+}
+
+
+void UStreetMapComponent::PostLoad()
+{
+	Super::PostLoad();
+
+	if (StreetMap == nullptr)
+	{
+		bMeshNeedsRebuildOnLoad = false;
+		return;
+	}
+
+	// The roads have to be loaded before hashing or generating anything from them
+	StreetMap->ConditionalPostLoad();
+
+	// A mesh saved before the street map was reimported or the settings changed is stale
+	if (bMeshNeedsRebuildOnLoad || (LoadedMeshBuildHash != 0 && LoadedMeshBuildHash != ComputeMeshBuildHash()))
+	{
+		GenerateMesh();
+	}
+	bMeshNeedsRebuildOnLoad = false;
+}
+
+
+uint32 UStreetMapComponent::ComputeMeshBuildHash() const
+{
+	TArray<uint8> SettingsBytes;
+	FMemoryWriter Writer(SettingsBytes);
+	FStreetMapMeshBuildSettings::StaticStruct()->SerializeBin(Writer, const_cast<FStreetMapMeshBuildSettings*>(&MeshBuildSettings));
+	uint32 Hash = FCrc::MemCrc32(SettingsBytes.GetData(), SettingsBytes.Num());
+
+	if (StreetMap != nullptr)
+	{
+		for (const FStreetMapRoad& Road : StreetMap->GetRoads())
+		{
+			const uint8 RoadType = Road.RoadType;
+			Hash = FCrc::MemCrc32(&RoadType, sizeof(RoadType), Hash);
+			Hash = FCrc::StrCrc32(*Road.Link.LinkDir, Hash);
+			Hash = FCrc::MemCrc32(Road.RoadPoints.GetData(), Road.RoadPoints.Num() * sizeof(FVector2D), Hash);
+			Hash = FCrc::MemCrc32(Road.NodeIndices.GetData(), Road.NodeIndices.Num() * sizeof(int32), Hash);
+		}
+
+		for (const FStreetMapBuilding& Building : StreetMap->GetBuildings())
+		{
+			Hash = FCrc::MemCrc32(&Building.Height, sizeof(Building.Height), Hash);
+			Hash = FCrc::MemCrc32(&Building.BuildingLevels, sizeof(Building.BuildingLevels), Hash);
+			Hash = FCrc::MemCrc32(Building.BuildingPoints.GetData(), Building.BuildingPoints.Num() * sizeof(FVector2D), Hash);
+		}
+	}
+
+	return Hash;
+}
+
+
+void UStreetMapComponent::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	DOREPLIFETIME(UStreetMapComponent, ReplicatedFlow);
+}
+
+
 int32 UStreetMapComponent::GetNumMaterials() const
 {
 	// NOTE: This is a bit of a weird thing about Unreal that we need to deal with when defining a component that
@@ -253,13 +566,22 @@ void UStreetMapComponent::SetStreetMap(class UStreetMap* NewStreetMap, bool bCle
 {
 	if (StreetMap != NewStreetMap)
 	{
+		// The worker reads the roads of the current street map, a pending build starts over on the new one
+		const bool bWasBuilding = CancelMeshBuild();
+
 		StreetMap = NewStreetMap;
+		HoverGrid.Reset();
+		ForgetHoveredRoad();
+		RebuildCongestionStats();
+		TraceAnalytics.Reset();
 
 		if (bClearPreviousMeshIfAny)
 			InvalidateMesh();
 
 		if (bRebuildMesh)
 			BuildMesh();
+		else if (bWasBuilding)
+			BuildMeshAsync();
 	}
 }
 
@@ -388,66 +710,171 @@ class UBodySetup* UStreetMapComponent::GetBodySetup()
 
 void UStreetMapComponent::GenerateMesh()
 {
+	FStreetMapMeshBuild Build;
+	CaptureMeshBuild(Build);
+	GenerateMesh(Build);
+	ApplyMeshBuild(Build);
+}
+
+void UStreetMapComponent::CaptureMeshBuild(FStreetMapMeshBuild& Build)
+{
+	Build.Settings = MeshBuildSettings;
+
+	if (StreetMap == nullptr) return;
+
+	const auto& Roads = StreetMap->GetRoads();
+	Build.RoadColors.SetNumZeroed(Roads.Num());
+	Build.RoadSpeedRatios.SetNumZeroed(Roads.Num());
+	Build.RoadHasData.SetNumZeroed(Roads.Num());
+
+	ParallelFor(Roads.Num(), [&](int32 RoadIndex)
+	{
+		float Speed, SpeedLimit;
+		Build.RoadHasData[RoadIndex] = GetSpeedAndColorFromData(&Roads[RoadIndex], Speed, SpeedLimit, Build.RoadSpeedRatios[RoadIndex], Build.RoadColors[RoadIndex]);
+	});
+}
+
+/**
+ * Indices drawing a road through the road points a Douglas-Peucker simplification keeps.  Smooth roads have a left
+ * and a right vertex per road point and other roads four vertices per segment, so the vertices at both ends of every
+ * simplified segment already exist.  Roads laid out otherwise keep their full detail indices.
+ */
+static void BuildRoadLODIndices(const TArray<FVector2D>& RoadPoints, float Tolerance, bool bSmooth, int32 NumVertices, const TArray<uint32>& Indices, TArray<int32>& TempKeptPoints, TArray<uint32>& OutIndices)
+{
+	const int32 NumPoints = RoadPoints.Num();
+	if (NumPoints < 2 || NumVertices != (bSmooth ? 2 * NumPoints : 4 * (NumPoints - 1)))
+	{
+		OutIndices = Indices;
+		return;
+	}
+
+	FPolygonTools::SimplifyPolyline(RoadPoints, Tolerance, TempKeptPoints);
+
+	OutIndices.Reset(6 * (TempKeptPoints.Num() - 1));
+	for (int32 Kept = 0; Kept + 1 < TempKeptPoints.Num(); ++Kept)
+	{
+		const uint32 StartPoint = TempKeptPoints[Kept];
+		const uint32 EndPoint = TempKeptPoints[Kept + 1];
+
+		// Same winding as the full detail quads
+		const uint32 StartLeft = bSmooth ? 2 * StartPoint : 4 * StartPoint;
+		const uint32 StartRight = StartLeft + 1;
+		const uint32 EndLeft = bSmooth ? 2 * EndPoint : 4 * (EndPoint - 1) + 3;
+		const uint32 EndRight = bSmooth ? 2 * EndPoint + 1 : 4 * (EndPoint - 1) + 2;
+
+		OutIndices.Add(StartLeft);
+		OutIndices.Add(StartRight);
+		OutIndices.Add(EndRight);
+
+		OutIndices.Add(StartLeft);
+		OutIndices.Add(EndRight);
+		OutIndices.Add(EndLeft);
+	}
+}
+
+/** Writes the speed ratio, type and index of every road into the texture coordinates of its vertices, laid out by BuildSection() */
+static void SetAllRoadTexCoords(const FStreetMapRenderData& RenderData, const TArray<FStreetMapRoad>& Roads, const TArray<FStreetMapVertexRange>& RoadVertexRanges, const TArray<float>& RoadSpeedRatios, const TArray<FStreetMapVertex>* const* SectionVertices, const FStreetMapTexCoordStreamPtr* SectionTexCoords)
+{
+	const int32 NumRoads = FMath::Min3(Roads.Num(), RoadVertexRanges.Num(), RoadSpeedRatios.Num());
+	ParallelFor(NumRoads, [&](int32 RoadIndex)
+	{
+		const FStreetMapVertexRange& Range = RoadVertexRanges[RoadIndex];
+		const FStreetMapTexCoordStreamPtr& TexCoords = SectionTexCoords[Range.VertexType];
+		if (Range.NumVertices == 0 || !TexCoords.IsValid()) return;
+
+		RenderData.SetRoadTexCoords(*TexCoords, *SectionVertices[Range.VertexType], Range, RoadSpeedRatios[RoadIndex], (float)Roads[RoadIndex].RoadType, RoadIndex);
+	});
+}
+
+void UStreetMapComponent::GenerateMesh(FStreetMapMeshBuild& Build)
+{
+	const FStreetMapMeshBuildSettings& Settings = Build.Settings;
+
 	/////////////////////////////////////////////////////////
 	// Visual tweakables for generated Street Map mesh
 	//
-	const float StreetOffsetZ = MeshBuildSettings.StreetOffsetZ;
-	const float MajorRoadOffsetZ = MeshBuildSettings.MajorRoadOffsetZ;
-	const float HighwayOffsetZ = MeshBuildSettings.HighwayOffsetZ;
+	const float StreetOffsetZ = Settings.StreetOffsetZ;
+	const float MajorRoadOffsetZ = Settings.MajorRoadOffsetZ;
+	const float HighwayOffsetZ = Settings.HighwayOffsetZ;
 
-	const bool bWantSmoothStreets = MeshBuildSettings.bWantSmoothStreets;
-	const bool bWantConnectStreets = MeshBuildSettings.bWantConnectStreets;
-	const bool bWant3DBuildings = MeshBuildSettings.bWant3DBuildings;
+	const bool bWantSmoothStreets = Settings.bWantSmoothStreets;
+	const bool bWantConnectStreets = Settings.bWantConnectStreets;
+	const bool bWant3DBuildings = Settings.bWant3DBuildings;
 
-	const float BuildingLevelFloorFactor = MeshBuildSettings.BuildingLevelFloorFactor;
-	const bool bWantLitBuildings = MeshBuildSettings.bWantLitBuildings;
+	const float BuildingLevelFloorFactor = Settings.BuildingLevelFloorFactor;
+	const bool bWantLitBuildings = Settings.bWantLitBuildings;
 	const bool bWantBuildingBorderOnGround = !bWant3DBuildings;
 
-	const float StreetThickness = MeshBuildSettings.StreetThickness;
-	const FColor StreetColor = MeshBuildSettings.StreetColor.ToFColor(false);
+	const float StreetThickness = Settings.StreetThickness;
+	const FColor StreetColor = Settings.StreetColor.ToFColor(false);
 
-	const float MajorRoadThickness = MeshBuildSettings.MajorRoadThickness;
-	const FColor MajorRoadColor = MeshBuildSettings.MajorRoadColor.ToFColor(false);
+	const float MajorRoadThickness = Settings.MajorRoadThickness;
+	const FColor MajorRoadColor = Settings.MajorRoadColor.ToFColor(false);
 
-	const float HighwayThickness = MeshBuildSettings.HighwayThickness;
-	const FColor HighwayColor = MeshBuildSettings.HighwayColor.ToFColor(false);
+	const float HighwayThickness = Settings.HighwayThickness;
+	const FColor HighwayColor = Settings.HighwayColor.ToFColor(false);
 
-	const float BuildingBorderThickness = MeshBuildSettings.BuildingBorderThickness;
-	FLinearColor BuildingBorderLinearColor = MeshBuildSettings.BuildingBorderLinearColor;
-	const float BuildingBorderZ = MeshBuildSettings.BuildingBorderZ;
+	const float BuildingBorderThickness = Settings.BuildingBorderThickness;
+	FLinearColor BuildingBorderLinearColor = Settings.BuildingBorderLinearColor;
+	const float BuildingBorderZ = Settings.BuildingBorderZ;
 	const FColor BuildingBorderColor(BuildingBorderLinearColor.ToFColor(false));
 	const FColor BuildingFillColor(FLinearColor(BuildingBorderLinearColor * 0.33f).CopyWithNewOpacity(1.0f).ToFColor(false));
 
-	const FColor LowFlowColor = MeshBuildSettings.LowFlowColor.ToFColor(false);
-	const FColor MedFlowColor = MeshBuildSettings.MedFlowColor.ToFColor(false);
-	const FColor HighFlowColor = MeshBuildSettings.HighFlowColor.ToFColor(false);
-	const EColorMode ColorMode = MeshBuildSettings.ColorMode;
+	const FColor LowFlowColor = Settings.LowFlowColor.ToFColor(false);
+	const FColor MedFlowColor = Settings.MedFlowColor.ToFColor(false);
+	const FColor HighFlowColor = Settings.HighFlowColor.ToFColor(false);
+	const EColorMode ColorMode = Settings.ColorMode;
 	/////////////////////////////////////////////////////////
 
-	CachedLocalBounds = FBox(ForceInitToZero);
-
-	BuildingVertices.Reset();
-	BuildingIndices.Reset();
-	StreetVertices.Reset();
-	StreetIndices.Reset();
-	MajorRoadVertices.Reset();
-	MajorRoadIndices.Reset();
-	HighwayVertices.Reset();
-	HighwayIndices.Reset();
-
 	const float MaxThickness = std::max(std::max(StreetThickness, MajorRoadThickness), HighwayThickness);
 
 	if (StreetMap != nullptr)
 	{
-		FBox MeshBoundingBox;
-		MeshBoundingBox.Init();
-
 		auto& Roads = StreetMap->GetRoads();
-		const auto& Nodes = StreetMap->GetNodes();
+		Build.RoadVertexRanges.SetNum(Roads.Num());
 		const auto& Buildings = StreetMap->GetBuildings();
 
-		for (auto& Road : Roads)
+		// Roads and buildings are generated in parallel, each into arrays of its own with indices starting at its
+		// first vertex.  Prefix sums over their sizes then place them in the section arrays grouped by the grid cell
+		// their center falls in, in road and building order within a cell, so each cell of each section becomes one
+		// contiguous chunk and every road keeps a contiguous vertex range.
+		struct FMeshPiece
+		{
+			TArray<FStreetMapVertex> Vertices;
+			TArray<uint32> Indices;
+			TArray<uint32> LODIndices[FStreetMapSceneProxy::MaxLODs - 1];
+			FBox MeshBoundingBox = FBox(ForceInit);
+			EVertexType VertexType = EVertexType::VBuilding;
+			int32 Cell = 0;
+			int32 FirstVertex = 0;
+			int32 FirstIndex[FStreetMapSceneProxy::MaxLODs] = { 0 };
+
+			TArray<uint32>& GetIndices(int32 LOD)
+			{
+				return LOD == 0 ? Indices : LODIndices[LOD - 1];
+			}
+		};
+
+		const int32 NumLODs = FMath::Clamp(Settings.NumRoadLODs, 1, (int32)FStreetMapSceneProxy::MaxLODs);
+
+		TArray<FMeshPiece> Pieces;
+		Pieces.SetNum(Roads.Num() + Buildings.Num());
+
+		if (Settings.bDrawRoadsAsSegments)
+		{
+			Build.RoadSegments.Init(Roads);
+		}
+
+		ParallelFor(Roads.Num(), [&](int32 RoadIndex)
 		{
+			// Roads drawn as instanced segments aren't part of the mesh
+			if (Build.bCancelled || Settings.bDrawRoadsAsSegments) return;
+
+			FMeshPiece& Piece = Pieces[RoadIndex];
+			Piece.VertexType = EVertexType::VStreet;
+			FBox& MeshBoundingBox = Piece.MeshBoundingBox;
+
+			auto& Road = Roads[RoadIndex];
 			float RoadThickness = HighwayThickness;
 			EVertexType VertexType = EVertexType::VHighway;
 			float RoadZ = HighwayOffsetZ;
@@ -458,9 +885,8 @@ void UStreetMapComponent::GenerateMesh()
 			const FName TMC = Road.TMC;
 			const FStreetMapLink Link = Road.Link;
 
-			FColor RoadColor;
-			float Speed, SpeedLimit, SpeedRatio;
-			bool bUseDefaultColor = !GetSpeedAndColorFromData(&Road, Speed, SpeedLimit, SpeedRatio, RoadColor);
+			FColor RoadColor = Build.RoadColors[RoadIndex];
+			bool bUseDefaultColor = !Build.RoadHasData[RoadIndex];
 
 			switch (Road.RoadType)
 			{
@@ -471,8 +897,8 @@ void UStreetMapComponent::GenerateMesh()
 				}
 				RoadZ = HighwayOffsetZ;
 				VertexType = EVertexType::VHighway;
-				Vertices = &HighwayVertices;
-				Indices = &HighwayIndices;
+				Vertices = &Piece.Vertices;
+				Indices = &Piece.Indices;
 				break;
 
 			case EStreetMapRoadType::MajorRoad:
@@ -482,8 +908,8 @@ void UStreetMapComponent::GenerateMesh()
 				}
 				RoadZ = MajorRoadOffsetZ;
 				VertexType = EVertexType::VMajorRoad;
-				Vertices = &MajorRoadVertices;
-				Indices = &MajorRoadIndices;
+				Vertices = &Piece.Vertices;
+				Indices = &Piece.Indices;
 				break;
 
 			case EStreetMapRoadType::Street:
@@ -495,8 +921,8 @@ void UStreetMapComponent::GenerateMesh()
 				}
 				RoadZ = StreetOffsetZ;
 				VertexType = EVertexType::VStreet;
-				Vertices = &StreetVertices;
-				Indices = &StreetIndices;
+				Vertices = &Piece.Vertices;
+				Indices = &Piece.Indices;
 				break;
 
 			default:
@@ -524,12 +950,8 @@ void UStreetMapComponent::GenerateMesh()
 							Vertices,
 							Indices,
 							VertexType,
-							Road.Link.LinkId,
-							Road.Link.LinkDir,
-							Road.TMC,
-							Road.SpeedLimit,
-							SpeedRatio,
-							static_cast<float>(Road.RoadType)
+							Settings.fThresholdConnectStreets,
+							Road.Link.LinkDir
 						);
 					}
 					else
@@ -546,12 +968,7 @@ void UStreetMapComponent::GenerateMesh()
 							Vertices,
 							Indices,
 							VertexType,
-							Road.Link.LinkId,
-							Road.Link.LinkDir,
-							Road.TMC,
-							Road.SpeedLimit,
-							SpeedRatio,
-							static_cast<float>(Road.RoadType)
+							Road.Link.LinkDir
 						);
 					}
 					int32 PointIndex = 0;
@@ -573,12 +990,7 @@ void UStreetMapComponent::GenerateMesh()
 							Vertices,
 							Indices,
 							VertexType,
-							Road.Link.LinkId,
-							Road.Link.LinkDir,
-							Road.TMC,
-							Road.SpeedLimit,
-							SpeedRatio,
-							static_cast<float>(Road.RoadType)
+							Road.Link.LinkDir
 						);
 					}
 					if (bWantConnectStreets)
@@ -595,12 +1007,8 @@ void UStreetMapComponent::GenerateMesh()
 							Vertices,
 							Indices,
 							VertexType,
-							Road.Link.LinkId,
-							Road.Link.LinkDir,
-							Road.TMC,
-							Road.SpeedLimit,
-							SpeedRatio,
-							static_cast<float>(Road.RoadType)
+							Settings.fThresholdConnectStreets,
+							Road.Link.LinkDir
 						);
 					}
 					else
@@ -617,12 +1025,7 @@ void UStreetMapComponent::GenerateMesh()
 							Vertices,
 							Indices,
 							VertexType,
-							Road.Link.LinkId,
-							Road.Link.LinkDir,
-							Road.TMC,
-							Road.SpeedLimit,
-							SpeedRatio,
-							static_cast<float>(Road.RoadType)
+							Road.Link.LinkDir
 						);
 					}
 				}
@@ -642,23 +1045,37 @@ void UStreetMapComponent::GenerateMesh()
 							Vertices,
 							Indices,
 							VertexType,
-							Road.Link.LinkId,
-							Road.Link.LinkDir,
-							Road.TMC,
-							Road.SpeedLimit,
-							SpeedRatio,
-							static_cast<float>(Road.RoadType)
+							Road.Link.LinkDir
 						);
 					}
 				}
+
+				Piece.VertexType = VertexType;
+
+				// Coarser LODs draw the same vertices through fewer road points, minor road classes are dropped
+				const int32 MaxRoadLOD = VertexType == EVertexType::VStreet ? Settings.MaxStreetLOD : (VertexType == EVertexType::VMajorRoad ? Settings.MaxMajorRoadLOD : NumLODs - 1);
+				TArray<int32> KeptPoints;
+				for (int32 LOD = 1; LOD <= FMath::Min(MaxRoadLOD, NumLODs - 1); ++LOD)
+				{
+					const float Tolerance = Settings.RoadLODTolerance * (1 << (LOD - 1));
+					BuildRoadLODIndices(Road.RoadPoints, Tolerance, newWay, Piece.Vertices.Num(), Piece.Indices, KeptPoints, Piece.LODIndices[LOD - 1]);
+				}
 			}
-		}
+		}, Build.bSingleThreaded);
 
-		TArray< int32 > TempIndices;
-		TArray< int32 > TriangulatedVertexIndices;
-		TArray< FVector > TempPoints;
-		for (int32 BuildingIndex = 0; BuildingIndex < Buildings.Num(); ++BuildingIndex)
+		ParallelFor(Buildings.Num(), [&](int32 BuildingIndex)
 		{
+			if (Build.bCancelled) return;
+
+			FMeshPiece& Piece = Pieces[Roads.Num() + BuildingIndex];
+			FBox& MeshBoundingBox = Piece.MeshBoundingBox;
+			TArray<FStreetMapVertex>& Vertices = Piece.Vertices;
+			TArray<uint32>& Indices = Piece.Indices;
+
+			TArray< int32 > TempIndices;
+			TArray< int32 > TriangulatedVertexIndices;
+			TArray< FVector > TempPoints;
+
 			const auto& Building = Buildings[BuildingIndex];
 
 			// Building mesh (or filled area, if the building has no height)
@@ -672,11 +1089,11 @@ void UStreetMapComponent::GenerateMesh()
 				// @todo: Performance: We could preprocess the building shapes so that the points always wind
 				//        in a consistent direction, so we can skip determining the winding above.
 
-				const int32 FirstTopVertexIndex = this->BuildingVertices.Num();
+				const int32 FirstTopVertexIndex = Vertices.Num();
 
 				// calculate fill Z for buildings
 				// either use the defined height or extrapolate from building level count
-				float BuildingFillZ = MeshBuildSettings.BuildDefaultZ;
+				float BuildingFillZ = Settings.BuildDefaultZ;
 				if (bWant3DBuildings) {
 					if (Building.Height > 0) {
 						BuildingFillZ = Building.Height;
@@ -693,10 +1110,10 @@ void UStreetMapComponent::GenerateMesh()
 					{
 						TempPoints[PointIndex] = FVector(Building.BuildingPoints[(Building.BuildingPoints.Num() - PointIndex) - 1], BuildingFillZ);
 					}
-					AddTriangles(TempPoints, TriangulatedVertexIndices, FVector::ForwardVector, FVector::UpVector, BuildingFillColor, MeshBoundingBox, BuildingVertices, BuildingIndices);
+					AddTriangles(TempPoints, TriangulatedVertexIndices, FVector::ForwardVector, FVector::UpVector, BuildingFillColor, MeshBoundingBox, Vertices, Indices);
 				}
 
-				if (bWant3DBuildings && (Building.Height > KINDA_SMALL_NUMBER || Building.BuildingLevels > 0 || MeshBuildSettings.BuildDefaultZ > 0.0))
+				if (bWant3DBuildings && (Building.Height > KINDA_SMALL_NUMBER || Building.BuildingLevels > 0 || Settings.BuildDefaultZ > 0.0))
 				{
 					// NOTE: Lit buildings can't share vertices beyond quads (all quads have their own face normals), so this uses a lot more geometry!
 					if (bWantLitBuildings)
@@ -734,26 +1151,24 @@ void UStreetMapComponent::GenerateMesh()
 							const FVector FaceNormal = FVector::CrossProduct((TempPoints[0] - TempPoints[2]).GetSafeNormal(), (TempPoints[0] - TempPoints[1]).GetSafeNormal());
 							const FVector ForwardVector = FVector::UpVector;
 							const FVector UpVector = FaceNormal;
-							AddTriangles(TempPoints, TempIndices, ForwardVector, UpVector, BuildingFillColor, MeshBoundingBox, BuildingVertices, BuildingIndices);
+							AddTriangles(TempPoints, TempIndices, ForwardVector, UpVector, BuildingFillColor, MeshBoundingBox, Vertices, Indices);
 						}
 					}
 					else
 					{
 						// Create vertices for the bottom
-						const int32 FirstBottomVertexIndex = this->BuildingVertices.Num();
+						const int32 FirstBottomVertexIndex = Vertices.Num();
 						for (int32 PointIndex = 0; PointIndex < Building.BuildingPoints.Num(); ++PointIndex)
 						{
 							const FVector2D Point = Building.BuildingPoints[PointIndex];
 
-							FStreetMapVertex& NewVertex = *new(this->BuildingVertices)FStreetMapVertex();
+							FStreetMapVertex& NewVertex = *new(Vertices)FStreetMapVertex();
 							NewVertex.Position = FVector(Point, 0.0f);
 							NewVertex.TextureCoordinate = FVector2D(0.0f, 0.0f);	// NOTE: We're not using texture coordinates for anything yet
 							NewVertex.TextureCoordinate2 = FVector2D(0.0f, 0.0f);
 							NewVertex.TextureCoordinate3 = FVector2D(0.0f, 1.0f); // Thicknesses
-							NewVertex.TextureCoordinate4 = FVector2D(0.0f, 0.0f);
-							NewVertex.TextureCoordinate5 = FVector2D(0.0f, 0.0f);
-							NewVertex.TangentX = FVector::ForwardVector;	 // NOTE: Tangents aren't important for these unlit buildings
-							NewVertex.TangentZ = FVector::UpVector;
+							NewVertex.Direction = 0;
+							NewVertex.SetTangents(FVector::ForwardVector, FVector::UpVector);	 // NOTE: Tangents aren't important for these unlit buildings
 							NewVertex.Color = BuildingFillColor;
 
 							MeshBoundingBox += NewVertex.Position;
@@ -769,13 +1184,13 @@ void UStreetMapComponent::GenerateMesh()
 							const int32 TopRightVertexIndex = FirstTopVertexIndex + RightPointIndex;
 							const int32 TopLeftVertexIndex = FirstTopVertexIndex + LeftPointIndex;
 
-							this->BuildingIndices.Add(BottomLeftVertexIndex);
-							this->BuildingIndices.Add(TopLeftVertexIndex);
-							this->BuildingIndices.Add(BottomRightVertexIndex);
+							Indices.Add(BottomLeftVertexIndex);
+							Indices.Add(TopLeftVertexIndex);
+							Indices.Add(BottomRightVertexIndex);
 
-							this->BuildingIndices.Add(BottomRightVertexIndex);
-							this->BuildingIndices.Add(TopLeftVertexIndex);
-							this->BuildingIndices.Add(TopRightVertexIndex);
+							Indices.Add(BottomRightVertexIndex);
+							Indices.Add(TopLeftVertexIndex);
+							Indices.Add(TopRightVertexIndex);
 						}
 					}
 				}
@@ -800,20 +1215,296 @@ void UStreetMapComponent::GenerateMesh()
 						BuildingBorderColor,
 						BuildingBorderColor,
 						MeshBoundingBox,
-						&BuildingVertices,
-						&BuildingIndices,
+						&Vertices,
+						&Indices,
 						EVertexType::VBuilding
 					);
 				}
 			}
+		}, Build.bSingleThreaded);
+
+		if (Build.bCancelled) return;
+
+		FBox MeshBoundingBox;
+		MeshBoundingBox.Init();
+		for (const FMeshPiece& Piece : Pieces)
+		{
+			MeshBoundingBox += Piece.MeshBoundingBox;
 		}
 
-		CachedLocalBounds = MeshBoundingBox;
-	}
-}
+		// Square cells over the mesh bounds, ChunkGridResolution of them along the longest side
+		int32 NumCells = 1;
+		if (MeshBoundingBox.IsValid)
+		{
+			const FVector2D GridOrigin(MeshBoundingBox.Min);
+			const FVector2D GridSize(MeshBoundingBox.GetSize());
+			const float CellSize = FMath::Max(FMath::Max(GridSize.X, GridSize.Y) / FMath::Max(Settings.ChunkGridResolution, 1), 1.0f);
+			const int32 GridWidth = FMath::Max(FMath::CeilToInt(GridSize.X / CellSize), 1);
+			const int32 GridHeight = FMath::Max(FMath::CeilToInt(GridSize.Y / CellSize), 1);
+			NumCells = GridWidth * GridHeight;
+
+			for (FMeshPiece& Piece : Pieces)
+			{
+				if (!Piece.MeshBoundingBox.IsValid) continue;
 
-void UStreetMapComponent::BuildRoadMesh(FColor HighFlowColor, FColor MedFlowColor, FColor LowFlowColor) {
-	/////////////////////////////////////////////////////////
+				const FVector2D Center(Piece.MeshBoundingBox.GetCenter());
+				const int32 X = FMath::Clamp(FMath::FloorToInt((Center.X - GridOrigin.X) / CellSize), 0, GridWidth - 1);
+				const int32 Y = FMath::Clamp(FMath::FloorToInt((Center.Y - GridOrigin.Y) / CellSize), 0, GridHeight - 1);
+				Piece.Cell = Y * GridWidth + X;
+			}
+		}
+
+		TArray<int32> PieceOrder;
+		PieceOrder.SetNumUninitialized(Pieces.Num());
+		for (int32 PieceIndex = 0; PieceIndex < Pieces.Num(); ++PieceIndex)
+		{
+			PieceOrder[PieceIndex] = PieceIndex;
+		}
+		PieceOrder.StableSort([&Pieces](int32 A, int32 B)
+		{
+			return Pieces[A].VertexType != Pieces[B].VertexType ? Pieces[A].VertexType < Pieces[B].VertexType : Pieces[A].Cell < Pieces[B].Cell;
+		});
+
+		// Each piece goes after the previous ones of its section, and so do the bounds of its cell
+		int32 NumVertices[FStreetMapSceneProxy::NumSections] = { 0 };
+		TArray<FBox> CellBounds[FStreetMapSceneProxy::NumSections];
+		for (int32 SectionIndex = 0; SectionIndex < FStreetMapSceneProxy::NumSections; ++SectionIndex)
+		{
+			CellBounds[SectionIndex].Init(FBox(ForceInit), NumCells);
+		}
+		for (int32 PieceIndex : PieceOrder)
+		{
+			FMeshPiece& Piece = Pieces[PieceIndex];
+			Piece.FirstVertex = NumVertices[Piece.VertexType];
+			NumVertices[Piece.VertexType] += Piece.Vertices.Num();
+			CellBounds[Piece.VertexType][Piece.Cell] += Piece.MeshBoundingBox;
+		}
+
+		// Indices are laid out LOD after LOD, a new chunk starts with every cell
+		int32 NumIndices[FStreetMapSceneProxy::NumSections] = { 0 };
+		for (int32 LOD = 0; LOD < NumLODs; ++LOD)
+		{
+			int32 ChunkCell = INDEX_NONE;
+			for (int32 PieceIndex : PieceOrder)
+			{
+				FMeshPiece& Piece = Pieces[PieceIndex];
+				const int32 NumPieceIndices = Piece.GetIndices(LOD).Num();
+				Piece.FirstIndex[LOD] = NumIndices[Piece.VertexType];
+				NumIndices[Piece.VertexType] += NumPieceIndices;
+
+				if (NumPieceIndices == 0) continue;
+
+				if (Build.MeshChunks.Num() == 0 || Build.MeshChunks.Last().VertexType != Piece.VertexType || Build.MeshChunks.Last().LOD != LOD || ChunkCell != Piece.Cell)
+				{
+					FStreetMapMeshChunk& NewChunk = Build.MeshChunks.AddDefaulted_GetRef();
+					NewChunk.VertexType = Piece.VertexType;
+					NewChunk.FirstIndex = Piece.FirstIndex[LOD];
+					NewChunk.Bounds = CellBounds[Piece.VertexType][Piece.Cell];
+					NewChunk.LOD = LOD;
+					ChunkCell = Piece.Cell;
+				}
+
+				FStreetMapMeshChunk& Chunk = Build.MeshChunks.Last();
+				Chunk.NumIndices = Piece.FirstIndex[LOD] + NumPieceIndices - Chunk.FirstIndex;
+			}
+		}
+
+		// Buildings have no coarser geometry, their full detail chunks are drawn at every LOD
+		const int32 NumFullDetailChunks = Build.MeshChunks.Num();
+		for (int32 LOD = 1; LOD < NumLODs; ++LOD)
+		{
+			for (int32 ChunkIndex = 0; ChunkIndex < NumFullDetailChunks; ++ChunkIndex)
+			{
+				if (Build.MeshChunks[ChunkIndex].LOD == 0 && Build.MeshChunks[ChunkIndex].VertexType == EVertexType::VBuilding)
+				{
+					FStreetMapMeshChunk BuildingChunk = Build.MeshChunks[ChunkIndex];
+					BuildingChunk.LOD = LOD;
+					Build.MeshChunks.Add(BuildingChunk);
+				}
+			}
+		}
+
+		for (int32 SectionIndex = 0; SectionIndex < FStreetMapSceneProxy::NumSections; ++SectionIndex)
+		{
+			Build.Vertices[SectionIndex].SetNum(NumVertices[SectionIndex]);
+			Build.Indices[SectionIndex].SetNumUninitialized(NumIndices[SectionIndex]);
+		}
+
+		ParallelFor(Pieces.Num(), [&](int32 PieceIndex)
+		{
+			FMeshPiece& Piece = Pieces[PieceIndex];
+			TArray<FStreetMapVertex>& Vertices = Build.Vertices[Piece.VertexType];
+			TArray<uint32>& Indices = Build.Indices[Piece.VertexType];
+
+			for (int32 VertexIndex = 0; VertexIndex < Piece.Vertices.Num(); ++VertexIndex)
+			{
+				Vertices[Piece.FirstVertex + VertexIndex] = MoveTemp(Piece.Vertices[VertexIndex]);
+			}
+			for (int32 LOD = 0; LOD < NumLODs; ++LOD)
+			{
+				TArray<uint32>& PieceIndices = Piece.GetIndices(LOD);
+				for (int32 Index = 0; Index < PieceIndices.Num(); ++Index)
+				{
+					Indices[Piece.FirstIndex[LOD] + Index] = Piece.FirstVertex + PieceIndices[Index];
+				}
+				PieceIndices.Empty();
+			}
+
+			if (PieceIndex < Roads.Num())
+			{
+				Build.RoadVertexRanges[PieceIndex] = FStreetMapVertexRange(Piece.VertexType, Piece.FirstVertex, Piece.Vertices.Num());
+			}
+
+			Piece.Vertices.Empty();
+		}, Build.bSingleThreaded);
+
+		Build.MeshBoundingBox = MeshBoundingBox;
+	}
+
+	if (Build.bCancelled) return;
+
+	// Laid out for the GPU right away, so scene proxies created from this mesh only take a reference to it
+	TSharedRef<FStreetMapRenderData, ESPMode::ThreadSafe> RenderData = MakeShared<FStreetMapRenderData, ESPMode::ThreadSafe>();
+	RenderData->bFullPrecisionUVs = Settings.bUseRoadAttributes;
+	for (int32 SectionIndex = 0; SectionIndex < FStreetMapSceneProxy::NumSections; ++SectionIndex)
+	{
+		RenderData->BuildSection((EVertexType)SectionIndex, Build.Vertices[SectionIndex], Build.Indices[SectionIndex], Build.MeshChunks, Build.RenderTexCoords[SectionIndex], Build.RenderColors[SectionIndex]);
+	}
+	if (StreetMap != nullptr)
+	{
+		const TArray<FStreetMapVertex>* SectionVertices[FStreetMapSceneProxy::NumSections];
+		for (int32 SectionIndex = 0; SectionIndex < FStreetMapSceneProxy::NumSections; ++SectionIndex)
+		{
+			SectionVertices[SectionIndex] = &Build.Vertices[SectionIndex];
+		}
+		SetAllRoadTexCoords(*RenderData, StreetMap->GetRoads(), Build.RoadVertexRanges, Build.RoadSpeedRatios, SectionVertices, Build.RenderTexCoords);
+	}
+	Build.RenderData = RenderData;
+}
+
+void UStreetMapComponent::ApplyMeshBuild(FStreetMapMeshBuild& Build)
+{
+	for (int32 SectionIndex = 0; SectionIndex < FStreetMapSceneProxy::NumSections; ++SectionIndex)
+	{
+		GetVerticesOfType((EVertexType)SectionIndex) = MoveTemp(Build.Vertices[SectionIndex]);
+		GetIndicesOfType((EVertexType)SectionIndex) = MoveTemp(Build.Indices[SectionIndex]);
+	}
+	RoadVertexRanges = MoveTemp(Build.RoadVertexRanges);
+	RoadSpeedRatios = MoveTemp(Build.RoadSpeedRatios);
+	MeshChunks = MoveTemp(Build.MeshChunks);
+	RoadSegments = MoveTemp(Build.RoadSegments);
+	RenderData = MoveTemp(Build.RenderData);
+	for (int32 SectionIndex = 0; SectionIndex < FStreetMapSceneProxy::NumSections; ++SectionIndex)
+	{
+		RenderTexCoords[SectionIndex] = MoveTemp(Build.RenderTexCoords[SectionIndex]);
+		RenderColors[SectionIndex] = MoveTemp(Build.RenderColors[SectionIndex]);
+	}
+	ForgetHoveredRoad();
+
+	CachedLocalBounds = Build.MeshBoundingBox;
+}
+
+void UStreetMapComponent::EnsureRenderData()
+{
+	if (RenderData.IsValid()) return;
+
+	TSharedRef<FStreetMapRenderData, ESPMode::ThreadSafe> NewRenderData = MakeShared<FStreetMapRenderData, ESPMode::ThreadSafe>();
+	NewRenderData->bFullPrecisionUVs = MeshBuildSettings.bUseRoadAttributes;
+	const TArray<FStreetMapVertex>* SectionVertices[FStreetMapSceneProxy::NumSections];
+	for (int32 SectionIndex = 0; SectionIndex < FStreetMapSceneProxy::NumSections; ++SectionIndex)
+	{
+		const EVertexType VertexType = (EVertexType)SectionIndex;
+		NewRenderData->BuildSection(VertexType, GetVerticesOfType(VertexType), GetIndicesOfType(VertexType), MeshChunks, RenderTexCoords[SectionIndex], RenderColors[SectionIndex]);
+		SectionVertices[SectionIndex] = &GetVerticesOfType(VertexType);
+	}
+	if (StreetMap != nullptr)
+	{
+		SetAllRoadTexCoords(*NewRenderData, StreetMap->GetRoads(), RoadVertexRanges, RoadSpeedRatios, SectionVertices, RenderTexCoords);
+	}
+	RenderData = NewRenderData;
+
+	// The new streams hold the current colors and texture coordinates already
+	DirtyColorRanges.Reset();
+	DirtyTexCoordRoads.Reset();
+}
+
+void UStreetMapComponent::InvalidateRenderData()
+{
+	RenderData.Reset();
+	for (FStreetMapColorStreamPtr& Colors : RenderColors)
+	{
+		Colors.Reset();
+	}
+	for (FStreetMapTexCoordStreamPtr& TexCoords : RenderTexCoords)
+	{
+		TexCoords.Reset();
+	}
+
+	// Mark our render state dirty so that CreateSceneProxy can refresh it on demand
+	MarkRenderStateDirty();
+}
+
+void UStreetMapComponent::UpdateRenderColors()
+{
+	for (const FStreetMapVertexRange& Range : DirtyColorRanges)
+	{
+		FStreetMapColorStreamPtr& Colors = RenderColors[Range.VertexType];
+		const TArray<FStreetMapVertex>& Vertices = GetVerticesOfType(Range.VertexType);
+		if (!Colors.IsValid() || Colors->Num() != Vertices.Num()) continue;
+
+		// A proxy keeps the colors it was created with to fill its buffer again, so the first write after creating one copies them
+		if (!Colors.IsUnique())
+		{
+			Colors = MakeShared<TArray<FColor>, ESPMode::ThreadSafe>(*Colors);
+		}
+
+		const int32 First = FMath::Clamp(Range.FirstVertex, 0, Vertices.Num());
+		const int32 Last = FMath::Clamp(Range.FirstVertex + Range.NumVertices, 0, Vertices.Num());
+		for (int32 VertexIndex = First; VertexIndex < Last; ++VertexIndex)
+		{
+			(*Colors)[VertexIndex] = Vertices[VertexIndex].Color;
+		}
+	}
+}
+
+void UStreetMapComponent::UpdateRenderTexCoords()
+{
+	if (!RenderData.IsValid() || StreetMap == nullptr) return;
+
+	// Only the speed ratios of the roads change after the build
+	const auto& Roads = StreetMap->GetRoads();
+	for (const int32 RoadIndex : DirtyTexCoordRoads)
+	{
+		if (!RoadVertexRanges.IsValidIndex(RoadIndex) || !RoadSpeedRatios.IsValidIndex(RoadIndex) || !Roads.IsValidIndex(RoadIndex)) continue;
+
+		const FStreetMapVertexRange& Range = RoadVertexRanges[RoadIndex];
+		FStreetMapTexCoordStreamPtr& TexCoords = RenderTexCoords[Range.VertexType];
+		const TArray<FStreetMapVertex>& Vertices = GetVerticesOfType(Range.VertexType);
+		if (!TexCoords.IsValid() || TexCoords->Num() != Vertices.Num() * (int32)RenderData->GetTexCoordStride()) continue;
+
+		// A proxy keeps the texture coordinates it was created with to fill its buffer again, like the colors
+		if (!TexCoords.IsUnique())
+		{
+			TexCoords = MakeShared<TArray<uint8>, ESPMode::ThreadSafe>(*TexCoords);
+		}
+
+		RenderData->SetRoadTexCoords(*TexCoords, Vertices, Range, RoadSpeedRatios[RoadIndex], (float)Roads[RoadIndex].RoadType, RoadIndex);
+	}
+}
+
+void UStreetMapComponent::BuildRoadMesh(FColor HighFlowColor, FColor MedFlowColor, FColor LowFlowColor) {
+	// Roads are rebuilt on top of the mesh being generated, not under it
+	FlushMeshBuild();
+
+	// Roads drawn as instanced segments have no mesh to rebuild, only colors
+	if (MeshBuildSettings.bDrawRoadsAsSegments)
+	{
+		EnsureColorSlots();
+		UpdateRoadSegmentColors(LowFlowColor, MedFlowColor, HighFlowColor);
+		return;
+	}
+
+	/////////////////////////////////////////////////////////
 	// Visual tweakables for generated Street Map mesh
 	//
 	const float StreetOffsetZ = MeshBuildSettings.StreetOffsetZ;
@@ -842,6 +1533,12 @@ void UStreetMapComponent::BuildRoadMesh(FColor HighFlowColor, FColor MedFlowColo
 	MajorRoadIndices.Reset();
 	HighwayVertices.Reset();
 	HighwayIndices.Reset();
+	RoadVertexRanges.Reset();
+	RoadSpeedRatios.Reset();
+	ForgetHoveredRoad();
+
+	// Roads are generated one after the other here, ChunkRoadSection() lays them out cell by cell again
+	MeshChunks.RemoveAll([](const FStreetMapMeshChunk& Chunk) { return Chunk.VertexType != EVertexType::VBuilding; });
 
 	const float MaxThickness = std::max(std::max(StreetThickness, MajorRoadThickness), HighwayThickness);
 
@@ -851,9 +1548,15 @@ void UStreetMapComponent::BuildRoadMesh(FColor HighFlowColor, FColor MedFlowColo
 		MeshBoundingBox.Init();
 
 		auto& Roads = StreetMap->GetRoads();
+		RoadVertexRanges.SetNum(Roads.Num());
+		RoadSpeedRatios.SetNumZeroed(Roads.Num());
 
-		for (auto& Road : Roads)
+		TArray<FStreetMapVertexRange> RoadIndexRanges;
+		RoadIndexRanges.SetNum(Roads.Num());
+
+		for (int32 RoadIndex = 0; RoadIndex < Roads.Num(); ++RoadIndex)
 		{
+			auto& Road = Roads[RoadIndex];
 			float RoadThickness = HighwayThickness;
 			EVertexType VertexType = EVertexType::VHighway;
 			float RoadZ = HighwayOffsetZ;
@@ -922,6 +1625,9 @@ void UStreetMapComponent::BuildRoadMesh(FColor HighFlowColor, FColor MedFlowColo
 
 			if (Vertices && Indices)
 			{
+				const int32 FirstVertex = Vertices->Num();
+				const int32 FirstIndex = Indices->Num();
+
 				auto newWay = bWantSmoothStreets && Road.RoadPoints.Num() >= 2;
 				float VAccumulation = 0.f;
 				if (newWay)
@@ -940,12 +1646,8 @@ void UStreetMapComponent::BuildRoadMesh(FColor HighFlowColor, FColor MedFlowColo
 							Vertices,
 							Indices,
 							VertexType,
-							Road.Link.LinkId,
-							Road.Link.LinkDir,
-							Road.TMC,
-							Road.SpeedLimit,
-							SpeedRatio,
-							static_cast<float>(Road.RoadType)
+							MeshBuildSettings.fThresholdConnectStreets,
+							Road.Link.LinkDir
 						);
 					}
 					else
@@ -962,12 +1664,7 @@ void UStreetMapComponent::BuildRoadMesh(FColor HighFlowColor, FColor MedFlowColo
 							Vertices,
 							Indices,
 							VertexType,
-							Road.Link.LinkId,
-							Road.Link.LinkDir,
-							Road.TMC,
-							Road.SpeedLimit,
-							SpeedRatio,
-							static_cast<float>(Road.RoadType)
+							Road.Link.LinkDir
 						);
 					}
 					int32 PointIndex = 0;
@@ -989,12 +1686,7 @@ void UStreetMapComponent::BuildRoadMesh(FColor HighFlowColor, FColor MedFlowColo
 							Vertices,
 							Indices,
 							VertexType,
-							Road.Link.LinkId,
-							Road.Link.LinkDir,
-							Road.TMC,
-							Road.SpeedLimit,
-							SpeedRatio,
-							static_cast<float>(Road.RoadType)
+							Road.Link.LinkDir
 						);
 					}
 					if (bWantConnectStreets)
@@ -1011,12 +1703,8 @@ void UStreetMapComponent::BuildRoadMesh(FColor HighFlowColor, FColor MedFlowColo
 							Vertices,
 							Indices,
 							VertexType,
-							Road.Link.LinkId,
-							Road.Link.LinkDir,
-							Road.TMC,
-							Road.SpeedLimit,
-							SpeedRatio,
-							static_cast<float>(Road.RoadType)
+							MeshBuildSettings.fThresholdConnectStreets,
+							Road.Link.LinkDir
 						);
 					}
 					else
@@ -1033,12 +1721,7 @@ void UStreetMapComponent::BuildRoadMesh(FColor HighFlowColor, FColor MedFlowColo
 							Vertices,
 							Indices,
 							VertexType,
-							Road.Link.LinkId,
-							Road.Link.LinkDir,
-							Road.TMC,
-							Road.SpeedLimit,
-							SpeedRatio,
-							static_cast<float>(Road.RoadType)
+							Road.Link.LinkDir
 						);
 					}
 				}
@@ -1058,18 +1741,26 @@ void UStreetMapComponent::BuildRoadMesh(FColor HighFlowColor, FColor MedFlowColo
 							Vertices,
 							Indices,
 							VertexType,
-							Road.Link.LinkId,
-							Road.Link.LinkDir,
-							Road.TMC,
-							Road.SpeedLimit,
-							SpeedRatio,
-							static_cast<float>(Road.RoadType)
+							Road.Link.LinkDir
 						);
 					}
 				}
+
+				RoadVertexRanges[RoadIndex] = FStreetMapVertexRange(VertexType, FirstVertex, Vertices->Num() - FirstVertex);
+				RoadIndexRanges[RoadIndex] = FStreetMapVertexRange(VertexType, FirstIndex, Indices->Num() - FirstIndex);
+				RoadSpeedRatios[RoadIndex] = SpeedRatio;
 			}
 		}
 
+		ChunkRoadSection(EVertexType::VStreet, RoadIndexRanges);
+		ChunkRoadSection(EVertexType::VMajorRoad, RoadIndexRanges);
+		ChunkRoadSection(EVertexType::VHighway, RoadIndexRanges);
+
+		// Buildings weren't rebuilt, their chunks still bound them
+		for (const FStreetMapMeshChunk& Chunk : MeshChunks)
+		{
+			MeshBoundingBox += Chunk.Bounds;
+		}
 		CachedLocalBounds = MeshBoundingBox;
 
 		if (HasValidMesh())
@@ -1084,8 +1775,8 @@ void UStreetMapComponent::BuildRoadMesh(FColor HighFlowColor, FColor MedFlowColo
 
 		GenerateCollision();
 
-		// Mark our render state dirty so that CreateSceneProxy can refresh it on demand
-		MarkRenderStateDirty();
+		// The vertex arrays were edited in place, CreateSceneProxy lays them out again
+		InvalidateRenderData();
 
 		AssignDefaultMaterialIfNeeded();
 
@@ -1095,6 +1786,16 @@ void UStreetMapComponent::BuildRoadMesh(FColor HighFlowColor, FColor MedFlowColo
 
 void UStreetMapComponent::BuildRoadMesh(EStreetMapRoadType RoadType, FColor HighFlowColor, FColor MedFlowColor, FColor LowFlowColor)
 {
+	FlushMeshBuild();
+
+	// Roads drawn as instanced segments have no mesh to rebuild, only colors
+	if (MeshBuildSettings.bDrawRoadsAsSegments)
+	{
+		EnsureColorSlots();
+		UpdateRoadSegmentColors(LowFlowColor, MedFlowColor, HighFlowColor);
+		return;
+	}
+
 	/////////////////////////////////////////////////////////
 	// Visual tweakables for generated Street Map mesh
 	//
@@ -1118,18 +1819,14 @@ void UStreetMapComponent::BuildRoadMesh(EStreetMapRoadType RoadType, FColor High
 	const float MaxThickness = std::max(std::max(StreetThickness, MajorRoadThickness), HighwayThickness);
 
 	CachedLocalBounds = FBox(ForceInitToZero);
+	ForgetHoveredRoad();
 
-	switch (RoadType) {
-	case EStreetMapRoadType::Highway:
-		HighwayIndices.Reset();
-		break;
-	case EStreetMapRoadType::MajorRoad:
-		MajorRoadIndices.Reset();
-		break;
-	case EStreetMapRoadType::Street:
-		StreetIndices.Reset();
-		break;
-	}
+	const EVertexType RebuiltVertexType = GetVertexTypeForRoad(RoadType);
+	MeshChunks.RemoveAll([RebuiltVertexType](const FStreetMapMeshChunk& Chunk) { return Chunk.VertexType == RebuiltVertexType; });
+
+	// Every road of the section is generated again, so none of its old vertices are left behind
+	GetVerticesOfType(RebuiltVertexType).Reset();
+	GetIndicesOfType(RebuiltVertexType).Reset();
 
 	if (StreetMap != nullptr)
 	{
@@ -1137,10 +1834,16 @@ void UStreetMapComponent::BuildRoadMesh(EStreetMapRoadType RoadType, FColor High
 		MeshBoundingBox.Init();
 
 		auto& Roads = StreetMap->GetRoads();
+		RoadVertexRanges.SetNum(Roads.Num());
+		RoadSpeedRatios.SetNumZeroed(Roads.Num());
 
-		for (auto& Road : Roads)
+		TArray<FStreetMapVertexRange> RoadIndexRanges;
+		RoadIndexRanges.SetNum(Roads.Num());
+
+		for (int32 RoadIndex = 0; RoadIndex < Roads.Num(); ++RoadIndex)
 		{
-			if (Road.RoadType == RoadType) {
+			auto& Road = Roads[RoadIndex];
+			if (GetVertexTypeForRoad(Road.RoadType) == RebuiltVertexType) {
 				float RoadThickness = HighwayThickness;
 				FColor RoadColor = HighFlowColor;
 				float RoadZ = HighwayOffsetZ;
@@ -1208,6 +1911,9 @@ void UStreetMapComponent::BuildRoadMesh(EStreetMapRoadType RoadType, FColor High
 
 				if (Vertices && Indices)
 				{
+					const int32 FirstVertex = Vertices->Num();
+					const int32 FirstIndex = Indices->Num();
+
 					auto newWay = bWantSmoothStreets && Road.RoadPoints.Num() >= 2;
 					float VAccumulation = 0.f;
 					if (newWay)
@@ -1226,12 +1932,8 @@ void UStreetMapComponent::BuildRoadMesh(EStreetMapRoadType RoadType, FColor High
 								Vertices,
 								Indices,
 								VertexType,
-								Road.Link.LinkId,
-								Road.Link.LinkDir,
-								Road.TMC,
-								Road.SpeedLimit,
-								SpeedRatio,
-								static_cast<float>(Road.RoadType)
+								MeshBuildSettings.fThresholdConnectStreets,
+								Road.Link.LinkDir
 							);
 						}
 						else
@@ -1248,12 +1950,7 @@ void UStreetMapComponent::BuildRoadMesh(EStreetMapRoadType RoadType, FColor High
 								Vertices,
 								Indices,
 								VertexType,
-								Road.Link.LinkId,
-								Road.Link.LinkDir,
-								Road.TMC,
-								Road.SpeedLimit,
-								SpeedRatio,
-								static_cast<float>(Road.RoadType)
+								Road.Link.LinkDir
 							);
 						}
 						int32 PointIndex = 0;
@@ -1275,12 +1972,7 @@ void UStreetMapComponent::BuildRoadMesh(EStreetMapRoadType RoadType, FColor High
 								Vertices,
 								Indices,
 								VertexType,
-								Road.Link.LinkId,
-								Road.Link.LinkDir,
-								Road.TMC,
-								Road.SpeedLimit,
-								SpeedRatio,
-								static_cast<float>(Road.RoadType)
+								Road.Link.LinkDir
 							);
 						}
 						if (bWantConnectStreets)
@@ -1297,12 +1989,8 @@ void UStreetMapComponent::BuildRoadMesh(EStreetMapRoadType RoadType, FColor High
 								Vertices,
 								Indices,
 								VertexType,
-								Road.Link.LinkId,
-								Road.Link.LinkDir,
-								Road.TMC,
-								Road.SpeedLimit,
-								SpeedRatio,
-								static_cast<float>(Road.RoadType)
+								MeshBuildSettings.fThresholdConnectStreets,
+								Road.Link.LinkDir
 							);
 						}
 						else
@@ -1319,12 +2007,7 @@ void UStreetMapComponent::BuildRoadMesh(EStreetMapRoadType RoadType, FColor High
 								Vertices,
 								Indices,
 								VertexType,
-								Road.Link.LinkId,
-								Road.Link.LinkDir,
-								Road.TMC,
-								Road.SpeedLimit,
-								SpeedRatio,
-								static_cast<float>(Road.RoadType)
+								Road.Link.LinkDir
 							);
 						}
 					}
@@ -1344,19 +2027,25 @@ void UStreetMapComponent::BuildRoadMesh(EStreetMapRoadType RoadType, FColor High
 								Vertices,
 								Indices,
 								VertexType,
-								Road.Link.LinkId,
-								Road.Link.LinkDir,
-								Road.TMC,
-								Road.SpeedLimit,
-								SpeedRatio,
-								static_cast<float>(Road.RoadType)
+								Road.Link.LinkDir
 							);
 						}
 					}
+
+					RoadVertexRanges[RoadIndex] = FStreetMapVertexRange(VertexType, FirstVertex, Vertices->Num() - FirstVertex);
+					RoadIndexRanges[RoadIndex] = FStreetMapVertexRange(VertexType, FirstIndex, Indices->Num() - FirstIndex);
+					RoadSpeedRatios[RoadIndex] = SpeedRatio;
 				}
 			}
 		}
 
+		ChunkRoadSection(RebuiltVertexType, RoadIndexRanges);
+
+		// The other sections weren't rebuilt, their chunks still bound them
+		for (const FStreetMapMeshChunk& Chunk : MeshChunks)
+		{
+			MeshBoundingBox += Chunk.Bounds;
+		}
 		CachedLocalBounds = MeshBoundingBox;
 
 		if (HasValidMesh())
@@ -1371,8 +2060,8 @@ void UStreetMapComponent::BuildRoadMesh(EStreetMapRoadType RoadType, FColor High
 
 		GenerateCollision();
 
-		// Mark our render state dirty so that CreateSceneProxy can refresh it on demand
-		MarkRenderStateDirty();
+		// The vertex arrays were edited in place, CreateSceneProxy lays them out again
+		InvalidateRenderData();
 
 		AssignDefaultMaterialIfNeeded();
 
@@ -1380,6 +2069,138 @@ void UStreetMapComponent::BuildRoadMesh(EStreetMapRoadType RoadType, FColor High
 	}
 }
 
+void UStreetMapComponent::ChunkRoadSection(EVertexType VertexType, const TArray<FStreetMapVertexRange>& RoadIndexRanges)
+{
+	MeshChunks.RemoveAll([VertexType](const FStreetMapMeshChunk& Chunk) { return Chunk.VertexType == VertexType; });
+
+	if (StreetMap == nullptr) return;
+
+	const auto& Roads = StreetMap->GetRoads();
+	TArray<FStreetMapVertex>& Vertices = GetVerticesOfType(VertexType);
+	TArray<uint32>& Indices = GetIndicesOfType(VertexType);
+
+	// Bounds of every road of the section, roads without triangles keep no vertices
+	TArray<int32> SectionRoads;
+	TArray<FBox> RoadBounds;
+	RoadBounds.Init(FBox(ForceInit), Roads.Num());
+	FBox SectionBounds(ForceInit);
+	TArray<FStreetMapVertexRange> NewRoadVertexRanges = RoadVertexRanges;
+	for (int32 RoadIndex = 0; RoadIndex < FMath::Min3(Roads.Num(), RoadVertexRanges.Num(), RoadIndexRanges.Num()); ++RoadIndex)
+	{
+		const FStreetMapVertexRange& Range = RoadVertexRanges[RoadIndex];
+		if (Range.VertexType != VertexType) continue;
+
+		NewRoadVertexRanges[RoadIndex] = FStreetMapVertexRange(VertexType, 0, 0);
+		if (Range.NumVertices == 0 || RoadIndexRanges[RoadIndex].NumVertices == 0) continue;
+
+		for (int32 VertexIndex = Range.FirstVertex; VertexIndex < Range.FirstVertex + Range.NumVertices; ++VertexIndex)
+		{
+			RoadBounds[RoadIndex] += Vertices[VertexIndex].Position;
+		}
+		SectionBounds += RoadBounds[RoadIndex];
+		SectionRoads.Add(RoadIndex);
+	}
+
+	if (SectionRoads.Num() == 0)
+	{
+		Vertices.Reset();
+		Indices.Reset();
+		RoadVertexRanges = MoveTemp(NewRoadVertexRanges);
+		return;
+	}
+
+	// Square cells over the section bounds, ChunkGridResolution of them along the longest side
+	const FVector2D GridOrigin(SectionBounds.Min);
+	const FVector2D GridSize(SectionBounds.GetSize());
+	const float CellSize = FMath::Max(FMath::Max(GridSize.X, GridSize.Y) / FMath::Max(MeshBuildSettings.ChunkGridResolution, 1), 1.0f);
+	const int32 GridWidth = FMath::Max(FMath::CeilToInt(GridSize.X / CellSize), 1);
+	const int32 GridHeight = FMath::Max(FMath::CeilToInt(GridSize.Y / CellSize), 1);
+
+	TArray<int32> RoadCells;
+	RoadCells.SetNumZeroed(Roads.Num());
+	TArray<FBox> CellBounds;
+	CellBounds.Init(FBox(ForceInit), GridWidth * GridHeight);
+	for (int32 RoadIndex : SectionRoads)
+	{
+		const FVector2D Center(RoadBounds[RoadIndex].GetCenter());
+		const int32 X = FMath::Clamp(FMath::FloorToInt((Center.X - GridOrigin.X) / CellSize), 0, GridWidth - 1);
+		const int32 Y = FMath::Clamp(FMath::FloorToInt((Center.Y - GridOrigin.Y) / CellSize), 0, GridHeight - 1);
+		RoadCells[RoadIndex] = Y * GridWidth + X;
+		CellBounds[RoadCells[RoadIndex]] += RoadBounds[RoadIndex];
+	}
+	SectionRoads.StableSort([&RoadCells](int32 A, int32 B) { return RoadCells[A] < RoadCells[B]; });
+
+	// Coarser LODs draw the same vertices through fewer road points, minor road classes are dropped
+	const int32 NumLODs = FMath::Clamp(MeshBuildSettings.NumRoadLODs, 1, (int32)FStreetMapSceneProxy::MaxLODs);
+	const int32 MaxRoadLOD = FMath::Min(VertexType == EVertexType::VStreet ? MeshBuildSettings.MaxStreetLOD : (VertexType == EVertexType::VMajorRoad ? MeshBuildSettings.MaxMajorRoadLOD : NumLODs - 1), NumLODs - 1);
+
+	TArray<FStreetMapVertex> NewVertices;
+	NewVertices.Reserve(Vertices.Num());
+	TArray<uint32> NewIndices;
+	NewIndices.Reserve(Indices.Num());
+	for (int32 RoadIndex : SectionRoads)
+	{
+		const FStreetMapVertexRange& Range = RoadVertexRanges[RoadIndex];
+		NewRoadVertexRanges[RoadIndex] = FStreetMapVertexRange(VertexType, NewVertices.Num(), Range.NumVertices);
+		NewVertices.Append(Vertices.GetData() + Range.FirstVertex, Range.NumVertices);
+	}
+
+	// Indices are laid out LOD after LOD, a new chunk starts with every cell
+	TArray<uint32> RoadIndices;
+	TArray<uint32> LODIndices;
+	TArray<int32> KeptPoints;
+	for (int32 LOD = 0; LOD <= MaxRoadLOD; ++LOD)
+	{
+		int32 ChunkCell = INDEX_NONE;
+		for (int32 RoadIndex : SectionRoads)
+		{
+			const FStreetMapVertexRange& Range = RoadVertexRanges[RoadIndex];
+			const FStreetMapVertexRange& IndexRange = RoadIndexRanges[RoadIndex];
+
+			// Road indices relative to the first vertex of the road, the way GenerateMesh() builds its pieces
+			RoadIndices.Reset();
+			for (int32 Index = IndexRange.FirstVertex; Index < IndexRange.FirstVertex + IndexRange.NumVertices; ++Index)
+			{
+				RoadIndices.Add(Indices[Index] - Range.FirstVertex);
+			}
+
+			const TArray<uint32>* RoadLODIndices = &RoadIndices;
+			if (LOD > 0)
+			{
+				const auto& Road = Roads[RoadIndex];
+				const bool bSmooth = MeshBuildSettings.bWantSmoothStreets && Road.RoadPoints.Num() >= 2;
+				const float Tolerance = MeshBuildSettings.RoadLODTolerance * (1 << (LOD - 1));
+				BuildRoadLODIndices(Road.RoadPoints, Tolerance, bSmooth, Range.NumVertices, RoadIndices, KeptPoints, LODIndices);
+				RoadLODIndices = &LODIndices;
+			}
+			if (RoadLODIndices->Num() == 0) continue;
+
+			if (MeshChunks.Num() == 0 || MeshChunks.Last().VertexType != VertexType || MeshChunks.Last().LOD != LOD || ChunkCell != RoadCells[RoadIndex])
+			{
+				FStreetMapMeshChunk& NewChunk = MeshChunks.AddDefaulted_GetRef();
+				NewChunk.VertexType = VertexType;
+				NewChunk.FirstIndex = NewIndices.Num();
+				NewChunk.Bounds = CellBounds[RoadCells[RoadIndex]];
+				NewChunk.LOD = LOD;
+				ChunkCell = RoadCells[RoadIndex];
+			}
+
+			const uint32 FirstVertex = NewRoadVertexRanges[RoadIndex].FirstVertex;
+			for (uint32 Index : *RoadLODIndices)
+			{
+				NewIndices.Add(FirstVertex + Index);
+			}
+
+			FStreetMapMeshChunk& Chunk = MeshChunks.Last();
+			Chunk.NumIndices = NewIndices.Num() - Chunk.FirstIndex;
+		}
+	}
+
+	Vertices = MoveTemp(NewVertices);
+	Indices = MoveTemp(NewIndices);
+	RoadVertexRanges = MoveTemp(NewRoadVertexRanges);
+}
+
 TArray<FVector> UStreetMapComponent::GetRoadVertices(const FStreetMapRoad& Road) {
 	TArray<FVector> Vertices;
 	TArray<FStreetMapVertex>* StreetMapVertices;
@@ -1526,6 +2347,12 @@ bool UStreetMapComponent::GetSpeedAndColorFromData(const FStreetMapRoad* Road, f
 			bFound = true;
 		}
 		break;
+	case EColorMode::PredictiveTime:
+		if (mPredictiveData.Contains(TMC)) {
+			Speed = mPredictiveData[TMC].GetSpeedAt(ColorSlots.GetPredictiveTime());
+			bFound = true;
+		}
+		break;
 	}
 
 	SpeedRatio = FGenericPlatformMath::Min(Speed / Road->SpeedLimit, 1.0f);
@@ -1568,69 +2395,1878 @@ bool UStreetMapComponent::GetSpeedAndColorFromData(FName TMC, float SpeedLimit,
 	return GetSpeedAndColorFromData(TMC, SpeedLimit, Speed, SpeedRatio, Color, HighFlowColor, MedFlowColor, LowFlowColor);
 }
 
-void UStreetMapComponent::ColorRoadMesh(FLinearColor val, TArray<FStreetMapVertex>& Vertices, bool IsTrace, float ZOffset)
+EVertexType UStreetMapComponent::GetVertexTypeForRoad(EStreetMapRoadType RoadType)
 {
-	int NumVertices = Vertices.Num();
-
-	for (int i = 0; i < NumVertices; i++) {
-		Vertices[i].Color = val.ToFColor(false);
-		Vertices[i].IsTrace = IsTrace;
-		if (ZOffset != 0.0f) {
-			Vertices[i].Position.Z = ZOffset;
-		}
+	switch (RoadType) {
+	case EStreetMapRoadType::Highway:
+		return EVertexType::VHighway;
+	case EStreetMapRoadType::MajorRoad:
+		return EVertexType::VMajorRoad;
+	default:
+		return EVertexType::VStreet;
 	}
+}
 
-	// Mark our render state dirty so that CreateSceneProxy can refresh it on demand
-	MarkRenderStateDirty();
+TArray<FStreetMapVertex>& UStreetMapComponent::GetVerticesOfType(EVertexType VertexType)
+{
+	switch (VertexType) {
+	case EVertexType::VHighway:
+		return HighwayVertices;
+	case EVertexType::VMajorRoad:
+		return MajorRoadVertices;
+	case EVertexType::VBuilding:
+		return BuildingVertices;
+	default:
+		return StreetVertices;
+	}
+}
 
-	Modify();
+TArray<uint32>& UStreetMapComponent::GetIndicesOfType(EVertexType VertexType)
+{
+	switch (VertexType) {
+	case EVertexType::VHighway:
+		return HighwayIndices;
+	case EVertexType::VMajorRoad:
+		return MajorRoadIndices;
+	case EVertexType::VBuilding:
+		return BuildingIndices;
+	default:
+		return StreetIndices;
+	}
 }
 
-void UStreetMapComponent::ColorRoadMesh(FLinearColor val, FStreetMapLink Link, bool IsTrace, float ZOffset)
+bool UStreetMapComponent::FindVertexType(const TArray<FStreetMapVertex>& Vertices, EVertexType& OutVertexType) const
 {
-	auto& Roads = StreetMap->GetRoads();
+	if (&Vertices == &HighwayVertices) OutVertexType = EVertexType::VHighway;
+	else if (&Vertices == &MajorRoadVertices) OutVertexType = EVertexType::VMajorRoad;
+	else if (&Vertices == &StreetVertices) OutVertexType = EVertexType::VStreet;
+	else if (&Vertices == &BuildingVertices) OutVertexType = EVertexType::VBuilding;
+	else return false;
 
-	if (!mLink2RoadIndex.Contains(Link)) return;
+	return true;
+}
 
-	int RoadIndex = mLink2RoadIndex[Link];
-	auto Road = Roads[RoadIndex];
-	TMap<FStreetMapLink, TArray<int>>* LinkMap;
-	TArray<FStreetMapVertex>* Vertices;
+void UStreetMapComponent::SetSectionVisible(EVertexType Section, bool bVisible)
+{
+	const uint32 NewMask = bVisible ? (VisibleSectionMask | (1u << Section)) : (VisibleSectionMask & ~(1u << Section));
+	if (NewMask == VisibleSectionMask) return;
 
-	switch (Road.RoadType) {
-	case EStreetMapRoadType::Highway:
-		LinkMap = &mHighwayLink2Vertices;
-		Vertices = &HighwayVertices;
-		break;
-	case EStreetMapRoadType::MajorRoad:
-		LinkMap = &mMajorLink2Vertices;
-		Vertices = &MajorRoadVertices;
-		break;
-	default:
-		LinkMap = &mStreetLink2Vertices;
-		Vertices = &StreetVertices;
-		break;
-	}
+	VisibleSectionMask = NewMask;
 
-	for (int VertexIndex : (*LinkMap)[Link]) {
-		(*Vertices)[VertexIndex].Color = val.ToFColor(false);
-		(*Vertices)[VertexIndex].IsTrace = IsTrace;
-		if (ZOffset != 0.0f) {
-			(*Vertices)[VertexIndex].Position.Z = ZOffset;
-		}
+	if (RoadSegmentComponents.IsValidIndex(Section) && RoadSegmentComponents[Section] != nullptr)
+	{
+		RoadSegmentComponents[Section]->SetVisibility(bVisible);
 	}
 
-	// Mark our render state dirty so that CreateSceneProxy can refresh it on demand
-	MarkRenderStateDirty();
+	// A proxy created later reads the mask itself
+	FStreetMapSceneProxy* StreetMapSceneProxy = static_cast<FStreetMapSceneProxy*>(SceneProxy);
+	if (StreetMapSceneProxy == nullptr || IsRenderStateDirty()) return;
 
-	//Modify();
+	ENQUEUE_RENDER_COMMAND(StreetMapSectionVisibility)(
+		[StreetMapSceneProxy, NewMask](FRHICommandListImmediate& RHICmdList)
+		{
+			StreetMapSceneProxy->SetVisibleSections_RenderThread(NewMask);
+		});
 }
 
-void UStreetMapComponent::ColorRoadMesh(FLinearColor val, TArray<FStreetMapLink> Links, bool IsTrace, float ZOffset)
+void UStreetMapComponent::SetChunkDrawDistance(float Distance)
 {
-	auto& Roads = StreetMap->GetRoads();
+	Distance = FMath::Max(Distance, 0.0f);
+	if (Distance == ChunkDrawDistance) return;
 
-	for (auto& Link : Links) {
+	ChunkDrawDistance = Distance;
+
+	// A proxy created later reads the distance itself
+	FStreetMapSceneProxy* StreetMapSceneProxy = static_cast<FStreetMapSceneProxy*>(SceneProxy);
+	if (StreetMapSceneProxy == nullptr || IsRenderStateDirty()) return;
+
+	ENQUEUE_RENDER_COMMAND(StreetMapChunkDrawDistance)(
+		[StreetMapSceneProxy, Distance](FRHICommandListImmediate& RHICmdList)
+		{
+			StreetMapSceneProxy->SetChunkDrawDistance_RenderThread(Distance);
+		});
+}
+
+FStreetMapMeshMemoryStats UStreetMapComponent::GetMeshMemoryStats() const
+{
+	const TArray<FStreetMapVertex>* SectionVertices[] = { &StreetVertices, &MajorRoadVertices, &HighwayVertices, &BuildingVertices };
+	const TArray<uint32>* SectionIndices[] = { &StreetIndices, &MajorRoadIndices, &HighwayIndices, &BuildingIndices };
+
+	FStreetMapMeshMemoryStats Stats;
+	for (int32 SectionIndex = 0; SectionIndex < FStreetMapSceneProxy::NumSections; ++SectionIndex)
+	{
+		Stats.NumVertices += SectionVertices[SectionIndex]->Num();
+		Stats.NumIndices += SectionIndices[SectionIndex]->Num();
+		Stats.VertexBytes += SectionVertices[SectionIndex]->GetAllocatedSize();
+		Stats.IndexBytes += SectionIndices[SectionIndex]->GetAllocatedSize();
+	}
+	Stats.RoadRangeBytes = RoadVertexRanges.GetAllocatedSize();
+	if (RenderData.IsValid())
+	{
+		Stats.RenderDataBytes = RenderData->GetAllocatedSize();
+	}
+	for (const FStreetMapColorStreamPtr& Colors : RenderColors)
+	{
+		Stats.RenderDataBytes += Colors.IsValid() ? Colors->GetAllocatedSize() : 0;
+	}
+	for (const FStreetMapTexCoordStreamPtr& TexCoords : RenderTexCoords)
+	{
+		Stats.RenderDataBytes += TexCoords.IsValid() ? TexCoords->GetAllocatedSize() : 0;
+	}
+	Stats.RoadSpeedRatioBytes = RoadSpeedRatios.GetAllocatedSize();
+	Stats.BytesPerVertex = sizeof(FStreetMapVertex);
+
+	return Stats;
+}
+
+TArray<uint32> UStreetMapComponent::GetRawMeshIndices(EVertexType type) const
+{
+	const TArray<uint32>& Indices = GetIndicesOfType(type);
+
+	// Indices are laid out LOD after LOD, the full detail chunks come first
+	int32 NumFullDetailIndices = 0;
+	bool bHasChunks = false;
+	for (const FStreetMapMeshChunk& Chunk : MeshChunks)
+	{
+		if (Chunk.VertexType != type) continue;
+
+		bHasChunks = true;
+		if (Chunk.LOD == 0)
+		{
+			NumFullDetailIndices = FMath::Max(NumFullDetailIndices, Chunk.FirstIndex + Chunk.NumIndices);
+		}
+	}
+	if (!bHasChunks)
+	{
+		return Indices;
+	}
+
+	return TArray<uint32>(Indices.GetData(), FMath::Min(NumFullDetailIndices, Indices.Num()));
+}
+
+void UStreetMapComponent::GetRawMeshRoadTexCoords(EVertexType type, TArray<FVector2D>& OutTexCoords4, TArray<FVector2D>& OutTexCoords5) const
+{
+	const TArray<FStreetMapVertex>& Vertices = GetVerticesOfType(type);
+	OutTexCoords4.SetNumUninitialized(Vertices.Num());
+	OutTexCoords5.SetNumZeroed(Vertices.Num());
+	for (int32 VertexIndex = 0; VertexIndex < Vertices.Num(); ++VertexIndex)
+	{
+		OutTexCoords4[VertexIndex] = FVector2D(0.0f, Vertices[VertexIndex].Direction);
+	}
+
+	if (StreetMap == nullptr) return;
+
+	const auto& Roads = StreetMap->GetRoads();
+	const int32 NumRoads = FMath::Min3(Roads.Num(), RoadVertexRanges.Num(), RoadSpeedRatios.Num());
+	for (int32 RoadIndex = 0; RoadIndex < NumRoads; ++RoadIndex)
+	{
+		const FStreetMapVertexRange& Range = RoadVertexRanges[RoadIndex];
+		if (Range.VertexType != type) continue;
+
+		const FVector2D RoadUV((float)Roads[RoadIndex].RoadType, MeshBuildSettings.bUseRoadAttributes ? (float)RoadIndex : 0.0f);
+		const int32 LastVertex = FMath::Min(Range.FirstVertex + Range.NumVertices, Vertices.Num());
+		for (int32 VertexIndex = Range.FirstVertex; VertexIndex < LastVertex; ++VertexIndex)
+		{
+			OutTexCoords4[VertexIndex].X = RoadSpeedRatios[RoadIndex] * 100;
+			OutTexCoords5[VertexIndex] = RoadUV;
+		}
+	}
+}
+
+FStreetMapGPUMemoryStats UStreetMapComponent::GetGPUMemoryStats() const
+{
+	FStreetMapGPUMemoryStats Stats;
+	if (RenderData.IsValid())
+	{
+		RenderData->GetGPUMemoryStats(Stats);
+	}
+	return Stats;
+}
+
+FStreetMapRoadSegmentStats UStreetMapComponent::ValidateRoadSegments()
+{
+	FStreetMapRoadSegmentStats Stats;
+	if (StreetMap == nullptr) return Stats;
+
+	const auto& Roads = StreetMap->GetRoads();
+
+	// Roads drawn as mesh quads have no segments of their own, they are collected just for the comparison
+	FStreetMapRoadSegments CollectedSegments;
+	const FStreetMapRoadSegments* Segments = &RoadSegments;
+	if (RoadSegments.NumRoads() != Roads.Num())
+	{
+		CollectedSegments.Init(Roads);
+		Segments = &CollectedSegments;
+	}
+
+	Stats.NumSegments = Segments->Num();
+	Stats.SegmentBytes = Segments->GetAllocatedSize();
+
+	// Instance origin, three half precision transform rows and the lightmap bias of the instance stream, plus the custom data
+	static const int64 BytesPerInstance = sizeof(FVector4) + 3 * 4 * sizeof(FFloat16) + 4 * sizeof(int16) + FStreetMapRoadSegments::NumCustomDataFloats * sizeof(float);
+	Stats.InstanceBytes = Stats.NumSegments * BytesPerInstance;
+
+	// Every stream the scene proxy uploads for a vertex, four vertices and two triangles per segment
+	const int64 TexCoordBytes = MeshBuildSettings.bUseRoadAttributes ? sizeof(FVector2D) : sizeof(FVector2DHalf);
+	const int64 BytesPerVertex = sizeof(FVector) + 2 * sizeof(FPackedNormal) + FStreetMapRenderData::NumTexCoords * TexCoordBytes + sizeof(FColor);
+	Stats.ExpandedBytes = Stats.NumSegments * (4 * BytesPerVertex + 6 * sizeof(uint16));
+
+	FVector QuadCorners[4];
+	FStreetMapRoadSegments::GetQuadCorners(QuadCorners);
+
+	for (int32 RoadIndex = 0; RoadIndex < Roads.Num(); ++RoadIndex)
+	{
+		const EVertexType Section = Segments->GetSection(RoadIndex);
+		const bool bForward = Segments->IsForward(RoadIndex);
+		float Z, Thickness;
+		GetRoadSectionLayout(Section, Z, Thickness);
+
+		const int32 FirstSegment = Segments->GetFirstSegment(RoadIndex);
+		const int32 NumRoadSegments = Segments->GetFirstSegment(RoadIndex + 1) - FirstSegment;
+
+		// Only straight quad roads have four vertices of their own per segment, smooth roads share them
+		const FStreetMapVertexRange* Range = RoadVertexRanges.IsValidIndex(RoadIndex) ? &RoadVertexRanges[RoadIndex] : nullptr;
+		const TArray<FStreetMapVertex>* Vertices = nullptr;
+		if (!MeshBuildSettings.bWantSmoothStreets && Range != nullptr && Range->NumVertices == NumRoadSegments * 4 && NumRoadSegments > 0)
+		{
+			Vertices = &GetVerticesOfType(Range->VertexType);
+			if (Range->FirstVertex + Range->NumVertices > Vertices->Num())
+			{
+				Vertices = nullptr;
+			}
+		}
+
+		for (int32 Offset = 0; Offset < NumRoadSegments; ++Offset)
+		{
+			const FStreetMapRoadSegment& Segment = Segments->GetSegment(FirstSegment + Offset);
+
+			FVector Corners[4];
+			FStreetMapRoadSegments::ExpandSegment(Segment.Start, Segment.End, Z, Thickness, bForward, Corners);
+			const FTransform Transform = FStreetMapRoadSegments::GetInstanceTransform(Segment.Start, Segment.End, Z, Thickness, bForward);
+
+			for (int32 Corner = 0; Corner < 4; ++Corner)
+			{
+				Stats.MaxCornerError = FMath::Max(Stats.MaxCornerError, FVector::Dist(Corners[Corner], Transform.TransformPosition(QuadCorners[Corner])));
+
+				// Traces raise the vertices of their roads, only the ground plane is compared
+				if (Vertices != nullptr)
+				{
+					const FVector& Position = (*Vertices)[Range->FirstVertex + Offset * 4 + Corner].Position;
+					Stats.MaxCornerError = FMath::Max(Stats.MaxCornerError, FVector::Dist2D(Corners[Corner], Position));
+				}
+			}
+			++Stats.NumValidatedSegments;
+		}
+	}
+
+	return Stats;
+}
+
+void UStreetMapComponent::EnsureRoadSegments()
+{
+	if (StreetMap == nullptr || !MeshBuildSettings.bDrawRoadsAsSegments)
+	{
+		RoadSegments.Reset();
+		return;
+	}
+
+	if (RoadSegments.NumRoads() != StreetMap->GetRoads().Num())
+	{
+		RoadSegments.Init(StreetMap->GetRoads());
+	}
+}
+
+void UStreetMapComponent::UpdateRoadSegmentInstances()
+{
+	DestroyRoadSegmentInstances();
+
+	UWorld* World = GetWorld();
+	if (!MeshBuildSettings.bDrawRoadsAsSegments || RoadSegments.Num() == 0 || RoadSegmentMesh == nullptr || World == nullptr || !IsRegistered()) return;
+
+	RoadSegmentComponents.SetNumZeroed(EVertexType::VBuilding);
+	for (int32 SectionIndex = 0; SectionIndex < EVertexType::VBuilding; ++SectionIndex)
+	{
+		const EVertexType Section = (EVertexType)SectionIndex;
+		if (RoadSegments.GetNumInstances(Section) == 0) continue;
+
+		UInstancedStaticMeshComponent* Instances = NewObject<UInstancedStaticMeshComponent>(this, NAME_None, RF_Transient | RF_DuplicateTransient);
+		Instances->SetStaticMesh(RoadSegmentMesh);
+		if (RoadSegmentMaterial != nullptr)
+		{
+			Instances->SetMaterial(0, RoadSegmentMaterial);
+		}
+		Instances->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+		Instances->SetCanEverAffectNavigation(false);
+		Instances->CastShadow = CastShadow;
+		Instances->NumCustomDataFloats = FStreetMapRoadSegments::NumCustomDataFloats;
+		Instances->SetVisibility(IsSectionVisible(Section));
+		Instances->SetupAttachment(this);
+		Instances->RegisterComponentWithWorld(World);
+
+		TArray<FTransform> Transforms;
+		GetRoadSegmentTransforms(Section, Transforms);
+		Instances->AddInstances(Transforms, false);
+
+		RoadSegmentComponents[SectionIndex] = Instances;
+	}
+
+	EnsureColorSlots();
+	UpdateRoadSegmentColors(MeshBuildSettings.LowFlowColor.ToFColor(false), MeshBuildSettings.MedFlowColor.ToFColor(false), MeshBuildSettings.HighFlowColor.ToFColor(false));
+}
+
+void UStreetMapComponent::DestroyRoadSegmentInstances()
+{
+	for (UInstancedStaticMeshComponent* Instances : RoadSegmentComponents)
+	{
+		if (Instances != nullptr)
+		{
+			Instances->DestroyComponent();
+		}
+	}
+	RoadSegmentComponents.Empty();
+
+	// The next instances start without custom data
+	RoadSegmentColors.Empty();
+	RoadSegmentTraces.Empty();
+	DirtyRoadSegmentSections.Empty();
+}
+
+void UStreetMapComponent::UpdateRoadSegmentTransforms(EVertexType Section)
+{
+	if (!RoadSegmentComponents.IsValidIndex(Section) || RoadSegmentComponents[Section] == nullptr) return;
+
+	TArray<FTransform> Transforms;
+	GetRoadSegmentTransforms(Section, Transforms);
+	RoadSegmentComponents[Section]->BatchUpdateInstancesTransforms(0, Transforms, false, true, true);
+}
+
+void UStreetMapComponent::UpdateRoadSegmentColors(FColor LowFlowColor, FColor MedFlowColor, FColor HighFlowColor)
+{
+	if (RoadSegmentComponents.Num() == 0 || ColorSlots.Num() != RoadSegments.NumRoads()) return;
+
+	// Recreated instances have no custom data yet, every road is written once
+	const bool bWriteAll = RoadSegmentColors.Num() != RoadSegments.NumRoads();
+	if (bWriteAll)
+	{
+		RoadSegmentColors.Init(FColor::Transparent, RoadSegments.NumRoads());
+		RoadSegmentTraces.Init(false, RoadSegments.NumRoads());
+	}
+
+	const int32 Slot = FStreetMapColorSlots::GetSlot(MeshBuildSettings.ColorMode);
+
+	for (int32 RoadIndex = 0; RoadIndex < RoadSegments.NumRoads(); ++RoadIndex)
+	{
+		if (const FStreetMapTraceStacks::FEntry* Top = TraceStacks.GetTop(RoadIndex))
+		{
+			SetRoadSegmentColor(RoadIndex, Top->Color, true, bWriteAll);
+		}
+		else if (bWriteAll || !RoadSegmentTraces[RoadIndex])
+		{
+			const float SpeedRatio = ColorSlots.GetSpeedRatio(RoadIndex, Slot);
+			SetRoadSegmentColor(RoadIndex, GetSlotFlowColor(SpeedRatio, LowFlowColor, MedFlowColor, HighFlowColor), false, bWriteAll);
+		}
+	}
+
+	FlushRoadSegmentColors();
+}
+
+void UStreetMapComponent::SetRoadSegmentColor(int32 RoadIndex, FColor Color, bool bIsTrace, bool bForce)
+{
+	if (!RoadSegmentColors.IsValidIndex(RoadIndex)) return;
+
+	RoadSegmentTraces[RoadIndex] = bIsTrace;
+
+	// The hovered road keeps its highlight, the new color shows once it is no longer hovered
+	if (RoadIndex == HoveredRoadIndex && HoveredRoadColors.Num() == 1)
+	{
+		HoveredRoadColors[0] = Color;
+		Color = MeshBuildSettings.HighlightColor.ToFColor(false);
+	}
+
+	WriteRoadSegmentColor(RoadIndex, Color, bForce);
+}
+
+void UStreetMapComponent::WriteRoadSegmentColor(int32 RoadIndex, FColor Color, bool bForce)
+{
+	if (!RoadSegmentColors.IsValidIndex(RoadIndex) || (RoadSegmentColors[RoadIndex] == Color && !bForce)) return;
+
+	RoadSegmentColors[RoadIndex] = Color;
+
+	const int32 Section = RoadSegments.GetSection(RoadIndex);
+	UInstancedStaticMeshComponent* Instances = RoadSegmentComponents.IsValidIndex(Section) ? RoadSegmentComponents[Section] : nullptr;
+	if (Instances == nullptr) return;
+
+	// Custom data is read as is, like the vertex colors
+	const FLinearColor RoadColor = Color.ReinterpretAsLinear();
+
+	TArray<float> CustomData;
+	CustomData.SetNumZeroed(FStreetMapRoadSegments::NumCustomDataFloats);
+	CustomData[0] = RoadIndex;
+	CustomData[1] = RoadColor.R;
+	CustomData[2] = RoadColor.G;
+	CustomData[3] = RoadColor.B;
+
+	const int32 FirstInstance = RoadSegments.GetFirstInstance(RoadIndex);
+	const int32 NumRoadSegments = RoadSegments.GetFirstSegment(RoadIndex + 1) - RoadSegments.GetFirstSegment(RoadIndex);
+	for (int32 InstanceIndex = FirstInstance; InstanceIndex < FirstInstance + NumRoadSegments; ++InstanceIndex)
+	{
+		Instances->SetCustomData(InstanceIndex, CustomData, false);
+	}
+
+	DirtyRoadSegmentSections.AddUnique(Section);
+}
+
+void UStreetMapComponent::FlushRoadSegmentColors()
+{
+	// Instanced static meshes only pick up new custom data with a new render state, which uploads the whole section
+	for (int32 Section : DirtyRoadSegmentSections)
+	{
+		if (RoadSegmentComponents.IsValidIndex(Section) && RoadSegmentComponents[Section] != nullptr)
+		{
+			RoadSegmentComponents[Section]->MarkRenderStateDirty();
+		}
+	}
+
+	DirtyRoadSegmentSections.Reset();
+}
+
+void UStreetMapComponent::ColorRoadSegmentsOfTMC(FName TMC, FColor Color, bool bIsTrace)
+{
+	const TArray<FStreetMapLink>* Links = mTMC2Links.Find(TMC);
+	if (Links == nullptr) return;
+
+	for (auto& Link : *Links) {
+		if (const int* RoadIndex = mLink2RoadIndex.Find(Link)) {
+			SetRoadSegmentColor(*RoadIndex, Color, bIsTrace);
+		}
+	}
+}
+
+void UStreetMapComponent::GetRoadSegmentTransforms(EVertexType Section, TArray<FTransform>& OutTransforms) const
+{
+	float Z, Thickness;
+	GetRoadSectionLayout(Section, Z, Thickness);
+
+	OutTransforms.SetNumUninitialized(RoadSegments.GetNumInstances(Section));
+	ParallelFor(RoadSegments.NumRoads(), [&](int32 RoadIndex)
+	{
+		if (RoadSegments.GetSection(RoadIndex) != Section) return;
+
+		const bool bForward = RoadSegments.IsForward(RoadIndex);
+		const int32 FirstSegment = RoadSegments.GetFirstSegment(RoadIndex);
+		const int32 FirstInstance = RoadSegments.GetFirstInstance(RoadIndex);
+		for (int32 SegmentIndex = FirstSegment; SegmentIndex < RoadSegments.GetFirstSegment(RoadIndex + 1); ++SegmentIndex)
+		{
+			const FStreetMapRoadSegment& Segment = RoadSegments.GetSegment(SegmentIndex);
+			OutTransforms[FirstInstance + SegmentIndex - FirstSegment] = FStreetMapRoadSegments::GetInstanceTransform(Segment.Start, Segment.End, Z, Thickness, bForward);
+		}
+	});
+}
+
+void UStreetMapComponent::GetRoadSectionLayout(EVertexType Section, float& OutZ, float& OutThickness) const
+{
+	switch (Section) {
+	case EVertexType::VHighway:
+		OutZ = MeshBuildSettings.HighwayOffsetZ;
+		OutThickness = MeshBuildSettings.HighwayThickness;
+		break;
+	case EVertexType::VMajorRoad:
+		OutZ = MeshBuildSettings.MajorRoadOffsetZ;
+		OutThickness = MeshBuildSettings.MajorRoadThickness;
+		break;
+	default:
+		OutZ = MeshBuildSettings.StreetOffsetZ;
+		OutThickness = MeshBuildSettings.StreetThickness;
+		break;
+	}
+}
+
+void UStreetMapComponent::SetRoadTypeVisible(EStreetMapRoadType RoadType, bool bVisible)
+{
+	SetSectionVisible(GetVertexTypeForRoad(RoadType), bVisible);
+}
+
+void UStreetMapComponent::MarkColorRangeDirty(EVertexType VertexType, int32 FirstVertex, int32 NumVertices)
+{
+	if (NumVertices > 0)
+	{
+		DirtyColorRanges.Add(FStreetMapVertexRange(VertexType, FirstVertex, NumVertices));
+	}
+}
+
+void UStreetMapComponent::MarkRoadTexCoordsDirty(int32 RoadIndex)
+{
+	if (RoadVertexRanges.IsValidIndex(RoadIndex) && RoadVertexRanges[RoadIndex].NumVertices > 0)
+	{
+		DirtyTexCoordRoads.Add(RoadIndex);
+	}
+}
+
+void UStreetMapComponent::MarkRoadColorDirty(int32 RoadIndex)
+{
+	if (StreetMap == nullptr) return;
+
+	auto& Roads = StreetMap->GetRoads();
+	if (!Roads.IsValidIndex(RoadIndex)) return;
+
+	if (RoadVertexRanges.Num() == Roads.Num())
+	{
+		const FStreetMapVertexRange& Range = RoadVertexRanges[RoadIndex];
+		MarkColorRangeDirty(Range.VertexType, Range.FirstVertex, Range.NumVertices);
+	}
+	else
+	{
+		// Mesh was cached without vertex ranges, upload the whole section
+		const EVertexType VertexType = GetVertexTypeForRoad(Roads[RoadIndex].RoadType);
+		MarkColorRangeDirty(VertexType, 0, GetVerticesOfType(VertexType).Num());
+	}
+}
+
+void UStreetMapComponent::MarkTMCColorDirty(FName TMC)
+{
+	if (mTMC2Links.Contains(TMC)) {
+		for (auto& Link : mTMC2Links[TMC]) {
+			if (mLink2RoadIndex.Contains(Link)) {
+				MarkRoadColorDirty(mLink2RoadIndex[Link]);
+			}
+		}
+	}
+	else if (mTMC2RoadIndex.Contains(TMC)) {
+		MarkRoadColorDirty(mTMC2RoadIndex[TMC]);
+	}
+}
+
+/** Sorts vertex ranges by section, then by first vertex, for CoalesceVertexRanges() */
+static void SortVertexRanges(TArray<FStreetMapVertexRange>& Ranges)
+{
+	Ranges.Sort([](const FStreetMapVertexRange& A, const FStreetMapVertexRange& B) {
+		if (A.VertexType != B.VertexType) return A.VertexType.GetValue() < B.VertexType.GetValue();
+		return A.FirstVertex < B.FirstVertex;
+	});
+}
+
+/**
+ * Merges the overlapping and adjacent sorted ranges of one section, starting at RangeIndex, and clamps them to the
+ * vertices of the section.  RangeIndex is left at the first range of the next section.
+ * @return Number of vertices in the merged ranges
+ */
+static int32 CoalesceVertexRanges(const TArray<FStreetMapVertexRange>& SortedRanges, int32& RangeIndex, int32 NumSectionVertices, TArray<FStreetMapVertexRange>& OutRanges)
+{
+	const EVertexType VertexType = SortedRanges[RangeIndex].VertexType;
+
+	int32 NumVertices = 0;
+	for (; RangeIndex < SortedRanges.Num() && SortedRanges[RangeIndex].VertexType == VertexType; ++RangeIndex)
+	{
+		const FStreetMapVertexRange& Range = SortedRanges[RangeIndex];
+		const int32 First = FMath::Clamp(Range.FirstVertex, 0, NumSectionVertices);
+		const int32 Last = FMath::Clamp(Range.FirstVertex + Range.NumVertices, 0, NumSectionVertices);
+		if (Last <= First) continue;
+
+		if (OutRanges.Num() > 0 && First <= OutRanges.Last().FirstVertex + OutRanges.Last().NumVertices)
+		{
+			FStreetMapVertexRange& Previous = OutRanges.Last();
+			const int32 PreviousLast = Previous.FirstVertex + Previous.NumVertices;
+			if (Last > PreviousLast)
+			{
+				Previous.NumVertices += Last - PreviousLast;
+				NumVertices += Last - PreviousLast;
+			}
+		}
+		else
+		{
+			OutRanges.Add(FStreetMapVertexRange(VertexType, First, Last - First));
+			NumVertices += Last - First;
+		}
+	}
+	return NumVertices;
+}
+
+void UStreetMapComponent::FlushColorUpdates()
+{
+	// Roads drawn as segments are recolored through their instances instead
+	FlushRoadSegmentColors();
+
+	const int64 TexCoordUploadBytes = FlushTexCoordUpdates();
+	if (DirtyColorRanges.Num() == 0)
+	{
+		if (TexCoordUploadBytes > 0)
+		{
+			RenderCounters.NumColorUpdates++;
+			RenderCounters.LastColorUploadBytes = TexCoordUploadBytes;
+			RenderCounters.TotalColorUploadBytes += TexCoordUploadBytes;
+		}
+		return;
+	}
+
+	// Keeps the color streams the next proxy is created from up to date
+	UpdateRenderColors();
+
+	FStreetMapSceneProxy* StreetMapSceneProxy = static_cast<FStreetMapSceneProxy*>(SceneProxy);
+	if (StreetMapSceneProxy == nullptr || IsRenderStateDirty())
+	{
+		DirtyColorRanges.Reset();
+		return;
+	}
+
+	SortVertexRanges(DirtyColorRanges);
+
+	int64 UploadBytes = TexCoordUploadBytes;
+	int32 RangeIndex = 0;
+	while (RangeIndex < DirtyColorRanges.Num())
+	{
+		const EVertexType VertexType = DirtyColorRanges[RangeIndex].VertexType;
+		const TArray<FStreetMapVertex>& Vertices = GetVerticesOfType(VertexType);
+
+		FStreetMapColorUpdate Update;
+		Update.VertexType = VertexType;
+
+		const int32 NumColors = CoalesceVertexRanges(DirtyColorRanges, RangeIndex, Vertices.Num(), Update.Ranges);
+		if (NumColors == 0) continue;
+
+		Update.Colors.Reserve(NumColors);
+		for (const FStreetMapVertexRange& Range : Update.Ranges)
+		{
+			for (int32 VertexIndex = Range.FirstVertex; VertexIndex < Range.FirstVertex + Range.NumVertices; ++VertexIndex)
+			{
+				Update.Colors.Add(Vertices[VertexIndex].Color);
+			}
+		}
+
+		UploadBytes += NumColors * sizeof(FColor);
+
+		ENQUEUE_RENDER_COMMAND(StreetMapColorUpdate)(
+			[StreetMapSceneProxy, Update = MoveTemp(Update)](FRHICommandListImmediate& RHICmdList)
+			{
+				StreetMapSceneProxy->UpdateColors_RenderThread(Update);
+			});
+	}
+
+	DirtyColorRanges.Reset();
+
+	RenderCounters.NumColorUpdates++;
+	RenderCounters.LastColorUploadBytes = UploadBytes;
+	RenderCounters.TotalColorUploadBytes += UploadBytes;
+}
+
+int64 UStreetMapComponent::FlushTexCoordUpdates()
+{
+	if (DirtyTexCoordRoads.Num() == 0) return 0;
+
+	// Keeps the texture coordinate streams the next proxy is created from up to date
+	UpdateRenderTexCoords();
+
+	FStreetMapSceneProxy* StreetMapSceneProxy = static_cast<FStreetMapSceneProxy*>(SceneProxy);
+	if (StreetMapSceneProxy == nullptr || IsRenderStateDirty() || !RenderData.IsValid())
+	{
+		DirtyTexCoordRoads.Reset();
+		return 0;
+	}
+
+	TArray<FStreetMapVertexRange> DirtyTexCoordRanges;
+	DirtyTexCoordRanges.Reserve(DirtyTexCoordRoads.Num());
+	for (const int32 RoadIndex : DirtyTexCoordRoads)
+	{
+		if (RoadVertexRanges.IsValidIndex(RoadIndex))
+		{
+			DirtyTexCoordRanges.Add(RoadVertexRanges[RoadIndex]);
+		}
+	}
+	DirtyTexCoordRoads.Reset();
+
+	SortVertexRanges(DirtyTexCoordRanges);
+
+	const int32 VertexStride = RenderData->GetTexCoordStride();
+	int64 UploadBytes = 0;
+	int32 RangeIndex = 0;
+	while (RangeIndex < DirtyTexCoordRanges.Num())
+	{
+		const EVertexType VertexType = DirtyTexCoordRanges[RangeIndex].VertexType;
+		const FStreetMapTexCoordStreamPtr& TexCoords = RenderTexCoords[VertexType];
+
+		FStreetMapTexCoordUpdate Update;
+		Update.VertexType = VertexType;
+
+		const int32 NumStreamVertices = TexCoords.IsValid() ? TexCoords->Num() / VertexStride : 0;
+		const int32 NumVertices = CoalesceVertexRanges(DirtyTexCoordRanges, RangeIndex, NumStreamVertices, Update.Ranges);
+		if (NumVertices == 0) continue;
+
+		Update.TexCoords.Reserve(NumVertices * VertexStride);
+		for (const FStreetMapVertexRange& Range : Update.Ranges)
+		{
+			Update.TexCoords.Append(TexCoords->GetData() + Range.FirstVertex * VertexStride, Range.NumVertices * VertexStride);
+		}
+
+		UploadBytes += NumVertices * VertexStride;
+
+		ENQUEUE_RENDER_COMMAND(StreetMapTexCoordUpdate)(
+			[StreetMapSceneProxy, Update = MoveTemp(Update)](FRHICommandListImmediate& RHICmdList)
+			{
+				StreetMapSceneProxy->UpdateTexCoords_RenderThread(Update);
+			});
+	}
+
+	return UploadBytes;
+}
+
+void UStreetMapComponent::EnsureColorSlots()
+{
+	if (StreetMap == nullptr) return;
+
+	const auto& Roads = StreetMap->GetRoads();
+	if (!bColorSlotsStale && ColorSlots.Num() == Roads.Num()) return;
+
+	ColorSlots.Init(Roads.Num());
+	for (int32 RoadIndex = 0; RoadIndex < Roads.Num(); ++RoadIndex)
+	{
+		UpdateRoadColorSlots(RoadIndex);
+	}
+
+	bColorSlotsStale = false;
+}
+
+void UStreetMapComponent::UpdateColorSlots(FName TMC)
+{
+	if (bColorSlotsStale || StreetMap == nullptr || ColorSlots.Num() != StreetMap->GetRoads().Num() || mTMC2Links.Num() == 0) {
+		// Roads aren't indexed yet, recompute everything on next use
+		bColorSlotsStale = true;
+		return;
+	}
+
+	if (!mTMC2Links.Contains(TMC)) return;
+
+	for (auto& Link : mTMC2Links[TMC]) {
+		if (mLink2RoadIndex.Contains(Link)) {
+			UpdateRoadColorSlots(mLink2RoadIndex[Link]);
+		}
+	}
+}
+
+void UStreetMapComponent::UpdateRoadColorSlots(int32 RoadIndex)
+{
+	const auto& Road = StreetMap->GetRoads()[RoadIndex];
+
+	auto GetSpeedRatio = [&Road](float Speed) {
+		return Road.SpeedLimit > 0.0f ? FGenericPlatformMath::Min(Speed / Road.SpeedLimit, 1.0f) : 1.0f;
+	};
+
+	const float* FlowSpeed = mFlowData.Find(Road.TMC);
+	const float FlowSpeedRatio = FlowSpeed ? GetSpeedRatio(*FlowSpeed) : 1.0f;
+	ColorSlots.SetSpeedRatio(RoadIndex, FStreetMapColorSlots::GetSlot(EColorMode::Flow), FlowSpeedRatio);
+
+	const FPredictiveData* Predictive = mPredictiveData.Find(Road.TMC);
+	ColorSlots.SetSpeedRatio(RoadIndex, FStreetMapColorSlots::GetSlot(EColorMode::Predictive0), Predictive ? GetSpeedRatio(Predictive->S0) : 1.0f);
+	ColorSlots.SetSpeedRatio(RoadIndex, FStreetMapColorSlots::GetSlot(EColorMode::Predictive15), Predictive ? GetSpeedRatio(Predictive->S15) : 1.0f);
+	ColorSlots.SetSpeedRatio(RoadIndex, FStreetMapColorSlots::GetSlot(EColorMode::Predictive30), Predictive ? GetSpeedRatio(Predictive->S30) : 1.0f);
+	ColorSlots.SetSpeedRatio(RoadIndex, FStreetMapColorSlots::GetSlot(EColorMode::Predictive45), Predictive ? GetSpeedRatio(Predictive->S45) : 1.0f);
+
+	if (MeshBuildSettings.bUseRoadAttributes && RoadAttributes.Num() == ColorSlots.Num()) {
+		uint8 RoadSlots[FStreetMapColorSlots::NumSlots];
+		ColorSlots.GetRoadSlots(RoadIndex, RoadSlots);
+		RoadAttributes.SetSpeedRatios(RoadIndex, RoadSlots);
+	}
+
+	bPredictiveTimeStale = true;
+}
+
+void UStreetMapComponent::ApplyColorSlot()
+{
+	if (StreetMap == nullptr) return;
+
+	const auto& Roads = StreetMap->GetRoads();
+
+	if (MeshBuildSettings.bDrawRoadsAsSegments)
+	{
+		EnsureColorSlots();
+		UpdateRoadSegmentColors(MeshBuildSettings.LowFlowColor.ToFColor(false), MeshBuildSettings.MedFlowColor.ToFColor(false), MeshBuildSettings.HighFlowColor.ToFColor(false));
+		return;
+	}
+
+	// Meshes cached without vertex ranges need RefreshStreetColors() instead
+	if (RoadVertexRanges.Num() != Roads.Num()) return;
+
+	EnsureColorSlots();
+
+	const int32 Slot = FStreetMapColorSlots::GetSlot(MeshBuildSettings.ColorMode);
+	const FColor LowFlowColor = MeshBuildSettings.LowFlowColor.ToFColor(false);
+	const FColor MedFlowColor = MeshBuildSettings.MedFlowColor.ToFColor(false);
+	const FColor HighFlowColor = MeshBuildSettings.HighFlowColor.ToFColor(false);
+
+	for (int32 RoadIndex = 0; RoadIndex < Roads.Num(); ++RoadIndex)
+	{
+		RecolorRoadFromSlot(RoadIndex, Slot, LowFlowColor, MedFlowColor, HighFlowColor);
+	}
+
+	FlushColorUpdates();
+}
+
+FColor UStreetMapComponent::GetSlotFlowColor(float SpeedRatio, FColor LowFlowColor, FColor MedFlowColor, FColor HighFlowColor) const
+{
+	// Same band edges as the road attribute material
+	if (SpeedRatio > FStreetMapColorSlots::GetQuantizedBandEdge(HighSpeedRatio)) {
+		return HighFlowColor;
+	}
+	else if (SpeedRatio > FStreetMapColorSlots::GetQuantizedBandEdge(MedSpeedRatio)) {
+		return MedFlowColor;
+	}
+	return LowFlowColor;
+}
+
+void UStreetMapComponent::RecolorRoadFromSlot(int32 RoadIndex, int32 Slot, FColor LowFlowColor, FColor MedFlowColor, FColor HighFlowColor)
+{
+	const float SpeedRatio = ColorSlots.GetSpeedRatio(RoadIndex, Slot);
+	const FColor RoadColor = GetSlotFlowColor(SpeedRatio, LowFlowColor, MedFlowColor, HighFlowColor);
+
+	if (MeshBuildSettings.bDrawRoadsAsSegments) {
+		if (RoadSegmentColors.IsValidIndex(RoadIndex) && !RoadSegmentTraces[RoadIndex]) {
+			SetRoadSegmentColor(RoadIndex, RoadColor, false);
+		}
+		return;
+	}
+
+	const FStreetMapVertexRange& Range = RoadVertexRanges[RoadIndex];
+	if (Range.NumVertices == 0) return;
+
+	TArray<FStreetMapVertex>& Vertices = GetVerticesOfType(Range.VertexType);
+	const int32 LastVertex = FMath::Min(Range.FirstVertex + Range.NumVertices, Vertices.Num());
+
+	// Materials reading the speed ratio from TexCoord4 see the same slot as the vertex colors
+	UpdateRoadSpeedRatio(RoadIndex, SpeedRatio);
+
+	if (RoadIndex == HoveredRoadIndex && HoveredRoadColors.Num() == LastVertex - Range.FirstVertex) {
+		// The hovered road keeps its highlight, the new color shows once it is no longer hovered
+		for (int32 VertexIndex = Range.FirstVertex; VertexIndex < LastVertex; ++VertexIndex)
+		{
+			if (!Vertices[VertexIndex].IsTrace) {
+				HoveredRoadColors[VertexIndex - Range.FirstVertex] = RoadColor;
+			}
+		}
+		return;
+	}
+
+	for (int32 VertexIndex = Range.FirstVertex; VertexIndex < LastVertex; ++VertexIndex)
+	{
+		if (!Vertices[VertexIndex].IsTrace) {
+			Vertices[VertexIndex].Color = RoadColor;
+		}
+	}
+
+	MarkColorRangeDirty(Range.VertexType, Range.FirstVertex, Range.NumVertices);
+}
+
+void UStreetMapComponent::UpdateRoadSpeedRatio(int32 RoadIndex, float SpeedRatio)
+{
+	if (!RoadSpeedRatios.IsValidIndex(RoadIndex) || RoadSpeedRatios[RoadIndex] == SpeedRatio || !RoadVertexRanges.IsValidIndex(RoadIndex)) return;
+
+	// Roads on a trace keep theirs
+	const FStreetMapVertexRange& Range = RoadVertexRanges[RoadIndex];
+	const TArray<FStreetMapVertex>& Vertices = GetVerticesOfType(Range.VertexType);
+	if (Range.NumVertices == 0 || !Vertices.IsValidIndex(Range.FirstVertex) || Vertices[Range.FirstVertex].IsTrace) return;
+
+	RoadSpeedRatios[RoadIndex] = SpeedRatio;
+	MarkRoadTexCoordsDirty(RoadIndex);
+}
+
+void UStreetMapComponent::SetPredictiveTime(float Minutes)
+{
+	if (StreetMap == nullptr) return;
+
+	Minutes = FMath::Clamp(Minutes, 0.0f, 45.0f);
+
+	// Colors on screen only match the previous interpolation if nothing else changed them since
+	const bool bRecolorAll = bPredictiveTimeStale || bColorSlotsStale || MeshBuildSettings.ColorMode != EColorMode::PredictiveTime;
+
+	MeshBuildSettings.ColorMode = EColorMode::PredictiveTime;
+
+	EnsureColorSlots();
+	ColorSlots.InterpolatePredictiveTime(Minutes);
+	bPredictiveTimeStale = false;
+
+	if (MeshBuildSettings.bUseRoadAttributes) {
+		// The material interpolates the predictive slots itself
+		ApplyRoadAttributeMaterialParameters();
+		return;
+	}
+
+	const int32 NumColoredRoads = MeshBuildSettings.bDrawRoadsAsSegments ? RoadSegmentColors.Num() : RoadVertexRanges.Num();
+	if (bRecolorAll || NumColoredRoads != ColorSlots.Num()) {
+		ApplyColorSlot();
+		return;
+	}
+
+	const FColor LowFlowColor = MeshBuildSettings.LowFlowColor.ToFColor(false);
+	const FColor MedFlowColor = MeshBuildSettings.MedFlowColor.ToFColor(false);
+	const FColor HighFlowColor = MeshBuildSettings.HighFlowColor.ToFColor(false);
+	const uint8 HighThreshold = FStreetMapColorSlots::GetQuantizedThreshold(HighSpeedRatio);
+	const uint8 MedThreshold = FStreetMapColorSlots::GetQuantizedThreshold(MedSpeedRatio);
+
+	auto GetColorBand = [HighThreshold, MedThreshold](uint8 Ratio) {
+		return Ratio > HighThreshold ? 2 : (Ratio > MedThreshold ? 1 : 0);
+	};
+
+	// Only roads that moved to another color band need new vertex colors, every changed ratio goes to TexCoord4
+	const TArray<uint8>& Ratios = ColorSlots.GetPredictiveTimeRatios();
+	const TArray<uint8>& PreviousRatios = ColorSlots.GetPreviousPredictiveTimeRatios();
+	for (int32 RoadIndex = 0; RoadIndex < Ratios.Num(); ++RoadIndex)
+	{
+		if (Ratios[RoadIndex] == PreviousRatios[RoadIndex]) continue;
+
+		if (GetColorBand(Ratios[RoadIndex]) != GetColorBand(PreviousRatios[RoadIndex])) {
+			RecolorRoadFromSlot(RoadIndex, FStreetMapColorSlots::PredictiveTimeSlot, LowFlowColor, MedFlowColor, HighFlowColor);
+		}
+		else {
+			UpdateRoadSpeedRatio(RoadIndex, ColorSlots.GetSpeedRatio(RoadIndex, FStreetMapColorSlots::PredictiveTimeSlot));
+		}
+	}
+
+	FlushColorUpdates();
+}
+
+bool UStreetMapComponent::StartFlowFeed(FStreetMapFlowFeedSettings Settings)
+{
+	StopFlowFeed();
+
+	FlowFeed = MakeUnique<FStreetMapFlowFeed>(Settings);
+	if (!FlowFeed->Start()) {
+		FlowFeed.Reset();
+		return false;
+	}
+
+	SetComponentTickEnabled(true);
+	return true;
+}
+
+void UStreetMapComponent::StopFlowFeed()
+{
+	if (FlowFeed.IsValid()) {
+		FlowFeed->Shutdown();
+
+		// Records decoded before the worker stopped still count
+		if (FlowFeed->ConsumeBatch(FlowFeedUpdates)) {
+			ApplyFlowUpdates(FlowFeedUpdates);
+		}
+		FlowFeed.Reset();
+	}
+
+	FlowFeedUpdates.Empty();
+	SetComponentTickEnabled(Heatmap.IsInitialized() || PendingMeshBuild.IsValid());
+}
+
+bool UStreetMapComponent::IsFlowFeedRunning() const
+{
+	return FlowFeed.IsValid() && FlowFeed->IsRunning();
+}
+
+bool UStreetMapComponent::StartLocalFeedServer(FStreetMapFlowFeedSettings Settings, float UpdatesPerSecond)
+{
+	StopLocalFeedServer();
+
+	if (StreetMap == nullptr) return false;
+
+	TSet<FName> UniqueTMCs;
+	for (const auto& Road : StreetMap->GetRoads())
+	{
+		if (!Road.TMC.IsNone()) {
+			UniqueTMCs.Add(Road.TMC);
+		}
+	}
+
+	FeedServer = MakeUnique<FStreetMapFeedServer>(Settings, UniqueTMCs.Array(), UpdatesPerSecond);
+	if (!FeedServer->Start()) {
+		FeedServer.Reset();
+		return false;
+	}
+	return true;
+}
+
+void UStreetMapComponent::StopLocalFeedServer()
+{
+	FeedServer.Reset();
+}
+
+void UStreetMapComponent::EnableFlowHistory(float IntervalSeconds, float DurationHours)
+{
+	if (StreetMap == nullptr) return;
+
+	FlowHistory.Init(StreetMap->GetRoads(), FTimespan::FromSeconds(IntervalSeconds), FTimespan::FromHours(DurationHours));
+	FlowHistory.RecordSnapshot(FDateTime::UtcNow(), mFlowData);
+}
+
+void UStreetMapComponent::DisableFlowHistory()
+{
+	FlowHistory.Reset();
+}
+
+bool UStreetMapComponent::RestoreFlowHistory(FDateTime Time)
+{
+	if (!FlowHistory.GetStateAt(Time, FlowHistorySpeeds)) return false;
+
+	// The restored state is shown, replicated and recolored like a feed update, but it isn't recorded again
+	TGuardValue<bool> NotRecording(bRecordFlowHistory, false);
+
+	FlowFeedTMCs.Reset();
+	for (int32 Ordinal = 0; Ordinal < FlowHistorySpeeds.Num(); ++Ordinal)
+	{
+		const FName TMC = FlowHistory.GetTMC(Ordinal);
+		const float Speed = FlowHistorySpeeds[Ordinal];
+		const float* CurrentSpeed = mFlowData.Find(TMC);
+		if (Speed < 0.0f) {
+			if (CurrentSpeed == nullptr) continue;
+			DeleteFlowData(TMC);
+		}
+		else if (CurrentSpeed == nullptr || *CurrentSpeed != Speed) {
+			AddOrUpdateFlowData(TMC, Speed);
+		}
+		else {
+			continue;
+		}
+		FlowFeedTMCs.Add(TMC);
+	}
+
+	RecolorTMCs(FlowFeedTMCs, true, false);
+	return true;
+}
+
+bool UStreetMapComponent::GetFlowHistoryRange(FDateTime& OutOldest, FDateTime& OutNewest) const
+{
+	OutOldest = FlowHistory.GetOldestTime();
+	OutNewest = FlowHistory.GetNewestTime();
+	return FlowHistory.Contains(OutNewest);
+}
+
+bool UStreetMapComponent::SaveFlowHistory(const FString& Path) const
+{
+	return FlowHistory.SaveToFile(Path);
+}
+
+bool UStreetMapComponent::LoadFlowHistory(const FString& Path)
+{
+	return FlowHistory.LoadFromFile(Path);
+}
+
+bool UStreetMapComponent::SaveStateSnapshot(const FString& Path) const
+{
+	if (StreetMap == nullptr) return false;
+
+	const auto& Roads = StreetMap->GetRoads();
+
+	FStreetMapStateSnapshot Snapshot;
+	Snapshot.Init(Roads);
+	Snapshot.CaptureData(mFlowData, mPredictiveData);
+
+	for (const auto& Elem : mTraces)
+	{
+		Snapshot.AddTrace(Elem.Value, !mHiddenTraces.Contains(Elem.Key));
+	}
+
+	// Highlights only exist in road attribute mode
+	if (RoadAttributes.Num() == Roads.Num()) {
+		for (int32 RoadIndex = 0; RoadIndex < Roads.Num(); ++RoadIndex)
+		{
+			const bool bHighlighted = RoadIndex == HoveredRoadIndex ? bHoveredRoadWasHighlighted : RoadAttributes.IsHighlighted(RoadIndex);
+			if (bHighlighted) {
+				Snapshot.AddHighlightedRoad(RoadIndex);
+			}
+		}
+	}
+
+	return Snapshot.SaveToFile(Path);
+}
+
+bool UStreetMapComponent::LoadStateSnapshot(const FString& Path)
+{
+	if (StreetMap == nullptr) return false;
+
+	FStreetMapStateSnapshot Snapshot;
+	Snapshot.Init(StreetMap->GetRoads());
+	if (!Snapshot.LoadFromFile(Path)) return false;
+
+	Snapshot.RestoreData(mFlowData, mPredictiveData);
+	Snapshot.RestoreTraces(mTraces, mHiddenTraces);
+	RebuildTraceStacks();
+
+	if (FlowHistory.IsInitialized()) {
+		FlowHistory.RecordSnapshot(FDateTime::UtcNow(), mFlowData);
+	}
+
+	if (IsReplicatingFlow()) {
+		EnsureReplicatedFlow();
+		ReplicatedFlow.ClearFlow();
+		ReplicatedFlow.ClearPredictive();
+		for (const auto& Elem : mFlowData)
+		{
+			ReplicatedFlow.SetFlow(Elem.Key, Elem.Value);
+		}
+		for (const auto& Elem : mPredictiveData)
+		{
+			ReplicatedFlow.SetPredictive(Elem.Key, &Elem.Value);
+		}
+	}
+
+	// Every slot is recomputed in one pass on the next use, the congestion statistics right away
+	bColorSlotsStale = true;
+	bPredictiveTimeStale = true;
+	RebuildCongestionStats();
+	TraceAnalytics.Reset();
+
+	RecolorAllRoads(Snapshot.GetHighlightedRoads());
+	return true;
+}
+
+void UStreetMapComponent::RecolorAllRoads(const TArray<int32>& HighlightedRoads)
+{
+	if (StreetMap == nullptr) return;
+
+	const auto& Roads = StreetMap->GetRoads();
+
+	if (MeshBuildSettings.bUseRoadAttributes) {
+		// Slots, traces and highlights go into a fresh texture
+		InitRoadAttributes(HighlightedRoads);
+		return;
+	}
+
+	// Meshes cached without vertex ranges are rebuilt instead
+	if (RoadVertexRanges.Num() != Roads.Num()) {
+		RefreshStreetColors();
+		return;
+	}
+
+	EnsureColorSlots();
+
+	const int32 Slot = FStreetMapColorSlots::GetSlot(MeshBuildSettings.ColorMode);
+	if (Slot == FStreetMapColorSlots::PredictiveTimeSlot) {
+		ColorSlots.InterpolatePredictiveTime(ColorSlots.GetPredictiveTime());
+		bPredictiveTimeStale = false;
+	}
+
+	const FColor LowFlowColor = MeshBuildSettings.LowFlowColor.ToFColor(false);
+	const FColor MedFlowColor = MeshBuildSettings.MedFlowColor.ToFColor(false);
+	const FColor HighFlowColor = MeshBuildSettings.HighFlowColor.ToFColor(false);
+
+	// Trace vertices are raised like ShowTrace() does, which needs a new proxy instead of a color upload
+	bool bRaisedTraces = false;
+	for (int32 RoadIndex = 0; RoadIndex < Roads.Num(); ++RoadIndex)
+	{
+		const FStreetMapVertexRange& Range = RoadVertexRanges[RoadIndex];
+		if (Range.NumVertices == 0) continue;
+
+		const FStreetMapTraceStacks::FEntry* Top = TraceStacks.GetTop(RoadIndex);
+		const bool bOnTrace = Top != nullptr;
+		const float SpeedRatio = ColorSlots.GetSpeedRatio(RoadIndex, Slot);
+		const FColor RoadColor = bOnTrace ? Top->Color :
+			GetSlotFlowColor(SpeedRatio, LowFlowColor, MedFlowColor, HighFlowColor);
+
+		TArray<FStreetMapVertex>& Vertices = GetVerticesOfType(Range.VertexType);
+		const int32 LastVertex = FMath::Min(Range.FirstVertex + Range.NumVertices, Vertices.Num());
+		for (int32 VertexIndex = Range.FirstVertex; VertexIndex < LastVertex; ++VertexIndex)
+		{
+			FStreetMapVertex& Vertex = Vertices[VertexIndex];
+			Vertex.Color = RoadColor;
+			Vertex.IsTrace = bOnTrace;
+			if (bOnTrace && Vertex.Position.Z != 1.0f) {
+				Vertex.Position.Z = 1.0f;
+				bRaisedTraces = true;
+			}
+		}
+
+		MarkColorRangeDirty(Range.VertexType, Range.FirstVertex, Range.NumVertices);
+	}
+
+	if (bRaisedTraces) {
+		InvalidateRenderData();
+	}
+	else {
+		FlushColorUpdates();
+	}
+}
+
+void UStreetMapComponent::RebuildCongestionStats()
+{
+	if (StreetMap == nullptr) {
+		CongestionStats.Reset();
+		return;
+	}
+
+	CongestionStats.Init(StreetMap->GetRoads(), MedSpeedRatio);
+	for (const auto& Elem : mFlowData)
+	{
+		CongestionStats.SetTMCSpeed(Elem.Key, true, Elem.Value);
+	}
+}
+
+void UStreetMapComponent::EnsureCongestionStats()
+{
+	if (StreetMap != nullptr && CongestionStats.Num() != StreetMap->GetRoads().Num()) {
+		RebuildCongestionStats();
+	}
+}
+
+void UStreetMapComponent::EnsureTraceAnalytics()
+{
+	if (StreetMap == nullptr || TraceAnalytics.Num() == StreetMap->GetRoads().Num()) return;
+
+	TraceAnalytics.Init(StreetMap->GetRoads());
+	for (const auto& Elem : mFlowData)
+	{
+		TraceAnalytics.SetTMCSpeed(Elem.Key, FStreetMapTraceAnalyticsPass::Flow, Elem.Value);
+	}
+	for (const auto& Elem : mPredictiveData)
+	{
+		TraceAnalytics.SetTMCSpeed(Elem.Key, FStreetMapTraceAnalyticsPass::S0, Elem.Value.S0);
+		TraceAnalytics.SetTMCSpeed(Elem.Key, FStreetMapTraceAnalyticsPass::S15, Elem.Value.S15);
+		TraceAnalytics.SetTMCSpeed(Elem.Key, FStreetMapTraceAnalyticsPass::S30, Elem.Value.S30);
+		TraceAnalytics.SetTMCSpeed(Elem.Key, FStreetMapTraceAnalyticsPass::S45, Elem.Value.S45);
+	}
+}
+
+FStreetMapRoadTypeCongestion UStreetMapComponent::GetRoadTypeCongestion(EStreetMapRoadType RoadType)
+{
+	EnsureCongestionStats();
+
+	return CongestionStats.GetRoadTypeCongestion(RoadType);
+}
+
+TArray<FStreetMapTMCCongestion> UStreetMapComponent::GetWorstTMCs(int32 Count)
+{
+	EnsureCongestionStats();
+
+	TArray<FStreetMapTMCCongestion> Worst;
+	CongestionStats.GetWorstTMCs(Count, Worst);
+	return Worst;
+}
+
+void UStreetMapComponent::EnableHeatmap(int32 Resolution, float HalfLifeSeconds, bool bAccumulateFlow)
+{
+	if (StreetMap == nullptr) return;
+
+	Heatmap.Init(StreetMap->GetBoundsMin(), StreetMap->GetBoundsMax(), Resolution, HalfLifeSeconds);
+	HeatmapTexture = Heatmap.CreateTexture();
+	bHeatmapFromFlow = bAccumulateFlow;
+	TimeSinceHeatmapUpdate = 0.0f;
+
+	// Link values land at the center of their road, found once here so adding them stays O(1)
+	const auto& Roads = StreetMap->GetRoads();
+	RoadHeatmapCells.SetNumUninitialized(Roads.Num());
+	for (int32 RoadIndex = 0; RoadIndex < Roads.Num(); ++RoadIndex)
+	{
+		RoadHeatmapCells[RoadIndex] = Heatmap.GetCellIndex((Roads[RoadIndex].BoundsMin + Roads[RoadIndex].BoundsMax) * 0.5f);
+	}
+
+	SetComponentTickEnabled(true);
+}
+
+void UStreetMapComponent::DisableHeatmap()
+{
+	Heatmap.Reset();
+	HeatmapTexture = nullptr;
+	RoadHeatmapCells.Empty();
+	bHeatmapFromFlow = false;
+
+	SetComponentTickEnabled(FlowFeed.IsValid() || PendingMeshBuild.IsValid());
+}
+
+void UStreetMapComponent::AddHeatmapProbes(const TArray<FVector2D>& Locations, float Weight)
+{
+	TArray<FVector2D> Probes = Locations;
+	TArray<float> Weights;
+	if (Weight != 1.0f) {
+		Weights.Init(Weight, Probes.Num());
+	}
+	Heatmap.AddProbesAsync(MoveTemp(Probes), MoveTemp(Weights));
+}
+
+void UStreetMapComponent::AddHeatmapLinkValues(const TArray<FStreetMapLink>& Links, const TArray<float>& Values)
+{
+	if (!Heatmap.IsInitialized() || Links.Num() != Values.Num()) return;
+
+	TArray<int32> Cells;
+	TArray<float> Weights;
+	Cells.Reserve(Links.Num());
+	Weights.Reserve(Links.Num());
+	for (int32 Index = 0; Index < Links.Num(); ++Index)
+	{
+		const int* RoadIndex = mLink2RoadIndex.Find(Links[Index]);
+		if (RoadIndex != nullptr && RoadHeatmapCells.IsValidIndex(*RoadIndex)) {
+			Cells.Add(RoadHeatmapCells[*RoadIndex]);
+			Weights.Add(Values[Index]);
+		}
+	}
+	Heatmap.AddCellsAsync(MoveTemp(Cells), MoveTemp(Weights));
+}
+
+void UStreetMapComponent::ApplyFlowUpdates(const TArray<FStreetMapFlowUpdate>& Updates)
+{
+	if (Updates.Num() == 0 || StreetMap == nullptr) return;
+
+	for (const FStreetMapFlowUpdate& Update : Updates)
+	{
+		AddOrUpdateFlowData(Update.TMC, Update.Speed);
+	}
+
+	if (bHeatmapFromFlow && Heatmap.IsInitialized()) {
+		// Congested roads add to the density of their cell
+		const auto& Roads = StreetMap->GetRoads();
+		TArray<int32> Cells;
+		TArray<float> Weights;
+		for (const FStreetMapFlowUpdate& Update : Updates)
+		{
+			const TArray<FStreetMapLink>* Links = mTMC2Links.Find(Update.TMC);
+			if (Links == nullptr) continue;
+
+			for (auto& Link : *Links) {
+				const int* RoadIndex = mLink2RoadIndex.Find(Link);
+				if (RoadIndex == nullptr || !RoadHeatmapCells.IsValidIndex(*RoadIndex)) continue;
+
+				const float SpeedLimit = Roads[*RoadIndex].SpeedLimit;
+				const float SpeedRatio = SpeedLimit > 0.0f ? FMath::Min(Update.Speed / SpeedLimit, 1.0f) : 1.0f;
+				if (SpeedRatio < 1.0f) {
+					Cells.Add(RoadHeatmapCells[*RoadIndex]);
+					Weights.Add(1.0f - SpeedRatio);
+				}
+			}
+		}
+		Heatmap.AddCellsAsync(MoveTemp(Cells), MoveTemp(Weights));
+	}
+
+	FlowFeedTMCs.Reset(Updates.Num());
+	for (const FStreetMapFlowUpdate& Update : Updates)
+	{
+		FlowFeedTMCs.Add(Update.TMC);
+	}
+
+	const double RecolorStart = FPlatformTime::Seconds();
+	RecolorTMCs(FlowFeedTMCs, true, false);
+	RenderCounters.LastFlowRecolorMilliseconds = (float)((FPlatformTime::Seconds() - RecolorStart) * 1000.0);
+}
+
+void UStreetMapComponent::RecolorTMCs(const TArray<FName>& TMCs, bool bFlowChanged, bool bPredictiveChanged)
+{
+	if (TMCs.Num() == 0 || StreetMap == nullptr) return;
+
+	if (MeshBuildSettings.bUseRoadAttributes) {
+		if (bColorSlotsStale) {
+			UpdateRoadAttributes();
+		}
+		else {
+			FlushRoadAttributes();
+		}
+		return;
+	}
+
+	// Data is only visible in the color modes that show it
+	const int32 Slot = FStreetMapColorSlots::GetSlot(MeshBuildSettings.ColorMode);
+	if (Slot == INDEX_NONE) return;
+	if (Slot == FStreetMapColorSlots::GetSlot(EColorMode::Flow) ? !bFlowChanged : !bPredictiveChanged) return;
+
+	if (Slot == FStreetMapColorSlots::PredictiveTimeSlot) {
+		SetPredictiveTime(ColorSlots.GetPredictiveTime());
+		return;
+	}
+
+	// Slots go stale when data arrives before the roads are indexed
+	const int32 NumColoredRoads = MeshBuildSettings.bDrawRoadsAsSegments ? RoadSegmentColors.Num() : RoadVertexRanges.Num();
+	if (bColorSlotsStale || NumColoredRoads != StreetMap->GetRoads().Num()) {
+		ApplyColorSlot();
+		return;
+	}
+
+	const FColor LowFlowColor = MeshBuildSettings.LowFlowColor.ToFColor(false);
+	const FColor MedFlowColor = MeshBuildSettings.MedFlowColor.ToFColor(false);
+	const FColor HighFlowColor = MeshBuildSettings.HighFlowColor.ToFColor(false);
+
+	for (const FName& TMC : TMCs)
+	{
+		const TArray<FStreetMapLink>* Links = mTMC2Links.Find(TMC);
+		if (Links == nullptr) continue;
+
+		for (auto& Link : *Links) {
+			if (const int* RoadIndex = mLink2RoadIndex.Find(Link)) {
+				RecolorRoadFromSlot(*RoadIndex, Slot, LowFlowColor, MedFlowColor, HighFlowColor);
+			}
+		}
+	}
+
+	FlushColorUpdates();
+}
+
+bool UStreetMapComponent::IsReplicatingFlow() const
+{
+	const AActor* Owner = GetOwner();
+	return GetIsReplicated() && Owner != nullptr && Owner->HasAuthority() && GetNetMode() != NM_Standalone && StreetMap != nullptr;
+}
+
+void UStreetMapComponent::EnsureReplicatedFlow()
+{
+	if (!ReplicatedFlow.IsInitialized() && StreetMap != nullptr) {
+		ReplicatedFlow.Init(StreetMap->GetRoads());
+	}
+}
+
+void UStreetMapComponent::ReceiveReplicatedFlow(const FStreetMapReplicatedFlowItem& Item)
+{
+	EnsureReplicatedFlow();
+
+	const FName TMC = ReplicatedFlow.GetTMC(Item.Ordinal);
+	if (TMC.IsNone()) return;
+
+	ReplicatedFlow.Counters.NumTMCsReceived++;
+
+	// Unchanged values dequantize to the same speed, so neither history nor colors see them twice
+	const float Speed = ReplicatedFlow.Dequantize(Item.Ordinal, Item.Flow);
+	const float* CurrentSpeed = mFlowData.Find(TMC);
+	if (Speed < 0.0f) {
+		if (CurrentSpeed) {
+			DeleteFlowData(TMC);
+		}
+	}
+	else if (CurrentSpeed == nullptr || *CurrentSpeed != Speed) {
+		AddOrUpdateFlowData(TMC, Speed);
+	}
+
+	float Predictive[4];
+	for (int32 Horizon = 0; Horizon < 4; ++Horizon)
+	{
+		Predictive[Horizon] = ReplicatedFlow.Dequantize(Item.Ordinal, Item.Predictive[Horizon]);
+	}
+
+	const FPredictiveData* CurrentPredictive = mPredictiveData.Find(TMC);
+	if (Predictive[0] < 0.0f) {
+		if (CurrentPredictive) {
+			DeletePredictiveData(TMC);
+		}
+	}
+	else if (CurrentPredictive == nullptr || CurrentPredictive->S0 != Predictive[0] || CurrentPredictive->S15 != Predictive[1] ||
+		CurrentPredictive->S30 != Predictive[2] || CurrentPredictive->S45 != Predictive[3]) {
+		AddOrUpdatePredictiveData(TMC, Predictive[0], Predictive[1], Predictive[2], Predictive[3]);
+	}
+
+	ReplicatedTMCs.Add(TMC);
+}
+
+void UStreetMapComponent::ApplyReplicatedFlow()
+{
+	RecolorTMCs(ReplicatedTMCs, true, true);
+	ReplicatedTMCs.Reset();
+}
+
+void UStreetMapComponent::InitRoadAttributes(const TArray<int32>& HighlightedRoads)
+{
+	if (StreetMap == nullptr) return;
+
+	const auto& Roads = StreetMap->GetRoads();
+
+	RoadAttributes.Init(Roads.Num());
+
+	for (int32 RoadIndex : HighlightedRoads)
+	{
+		if (Roads.IsValidIndex(RoadIndex)) {
+			RoadAttributes.SetHighlight(RoadIndex, true);
+		}
+	}
+
+	if (Roads.IsValidIndex(HoveredRoadIndex)) {
+		bHoveredRoadWasHighlighted = RoadAttributes.IsHighlighted(HoveredRoadIndex);
+		RoadAttributes.SetHighlight(HoveredRoadIndex, true);
+	}
+
+	EnsureColorSlots();
+	for (int32 RoadIndex = 0; RoadIndex < Roads.Num(); ++RoadIndex)
+	{
+		uint8 RoadSlots[FStreetMapColorSlots::NumSlots];
+		ColorSlots.GetRoadSlots(RoadIndex, RoadSlots);
+		RoadAttributes.SetSpeedRatios(RoadIndex, RoadSlots);
+	}
+
+	for (int32 RoadIndex = 0; RoadIndex < Roads.Num(); ++RoadIndex)
+	{
+		if (const FStreetMapTraceStacks::FEntry* Top = TraceStacks.GetTop(RoadIndex)) {
+			RoadAttributes.SetTrace(RoadIndex, true, Top->Color);
+		}
+	}
+
+	RoadAttributeTexture = RoadAttributes.CreateTexture();
+
+	const int64 UploadBytes = RoadAttributes.GetTextureHeight() * FStreetMapRoadAttributes::TextureWidth * sizeof(FColor);
+	RenderCounters.LastAttributeUploadBytes = UploadBytes;
+	RenderCounters.TotalAttributeUploadBytes += UploadBytes;
+
+	ApplyRoadAttributeMaterialParameters();
+}
+
+void UStreetMapComponent::UpdateRoadAttributes()
+{
+	if (StreetMap == nullptr) return;
+
+	const auto& Roads = StreetMap->GetRoads();
+
+	if (RoadAttributeTexture == nullptr || RoadAttributes.Num() != Roads.Num())
+	{
+		InitRoadAttributes();
+		return;
+	}
+
+	EnsureColorSlots();
+	for (int32 RoadIndex = 0; RoadIndex < Roads.Num(); ++RoadIndex)
+	{
+		uint8 RoadSlots[FStreetMapColorSlots::NumSlots];
+		ColorSlots.GetRoadSlots(RoadIndex, RoadSlots);
+		RoadAttributes.SetSpeedRatios(RoadIndex, RoadSlots);
+	}
+
+	FlushRoadAttributes();
+}
+
+void UStreetMapComponent::FlushRoadAttributes()
+{
+	if (!RoadAttributes.IsDirty()) return;
+
+	if (RoadAttributeTexture == nullptr)
+	{
+		InitRoadAttributes();
+		return;
+	}
+
+	const int64 UploadBytes = RoadAttributes.Flush(RoadAttributeTexture);
+	RenderCounters.LastAttributeUploadBytes = UploadBytes;
+	RenderCounters.TotalAttributeUploadBytes += UploadBytes;
+}
+
+void UStreetMapComponent::ApplyRoadAttributeMaterialParameters()
+{
+	if (RoadAttributeTexture == nullptr || GetNumMaterials() == 0) return;
+
+	UMaterialInstanceDynamic* MaterialInstance = CreateAndSetMaterialInstanceDynamic(0);
+	if (MaterialInstance == nullptr) return;
+
+	MaterialInstance->SetTextureParameterValue(TEXT("RoadAttributes"), RoadAttributeTexture);
+	MaterialInstance->SetScalarParameterValue(TEXT("RoadAttributesWidth"), FStreetMapRoadAttributes::TextureWidth);
+	MaterialInstance->SetScalarParameterValue(TEXT("RoadAttributesHeight"), RoadAttributes.GetTextureHeight());
+	MaterialInstance->SetScalarParameterValue(TEXT("RoadAttributesTexelsPerRoad"), FStreetMapRoadAttributes::TexelsPerRoad);
+	MaterialInstance->SetScalarParameterValue(TEXT("HighSpeedRatio"), FStreetMapColorSlots::GetQuantizedBandEdge(HighSpeedRatio));
+	MaterialInstance->SetScalarParameterValue(TEXT("MedSpeedRatio"), FStreetMapColorSlots::GetQuantizedBandEdge(MedSpeedRatio));
+	MaterialInstance->SetScalarParameterValue(TEXT("ColorModeSlot"), FStreetMapColorSlots::GetSlot(MeshBuildSettings.ColorMode));
+	MaterialInstance->SetScalarParameterValue(TEXT("PredictiveTime"), ColorSlots.GetPredictiveTime());
+	MaterialInstance->SetVectorParameterValue(TEXT("LowFlowColor"), MeshBuildSettings.LowFlowColor);
+	MaterialInstance->SetVectorParameterValue(TEXT("MedFlowColor"), MeshBuildSettings.MedFlowColor);
+	MaterialInstance->SetVectorParameterValue(TEXT("HighFlowColor"), MeshBuildSettings.HighFlowColor);
+	MaterialInstance->SetVectorParameterValue(TEXT("HighlightColor"), MeshBuildSettings.HighlightColor);
+}
+
+void UStreetMapComponent::SetRoadAttributeTrace(const TArray<FStreetMapLink>& Links, bool bOnTrace, FColor TraceColor)
+{
+	for (auto& Link : Links) {
+		if (mLink2RoadIndex.Contains(Link)) {
+			RoadAttributes.SetTrace(mLink2RoadIndex[Link], bOnTrace, TraceColor);
+		}
+	}
+
+	FlushRoadAttributes();
+}
+
+FColor UStreetMapComponent::ResolveRoadAttributeColor(int32 RoadIndex) const
+{
+	if (RoadAttributes.IsHighlighted(RoadIndex)) {
+		return MeshBuildSettings.HighlightColor.ToFColor(false);
+	}
+
+	if (RoadAttributes.IsOnTrace(RoadIndex)) {
+		return RoadAttributes.GetTraceColor(RoadIndex);
+	}
+
+	const int32 Slot = FStreetMapColorSlots::GetSlot(MeshBuildSettings.ColorMode);
+	float SpeedRatio = RoadAttributes.GetSpeedRatio(RoadIndex, Slot);
+	if (Slot == FStreetMapColorSlots::PredictiveTimeSlot) {
+		uint8 RoadSlots[FStreetMapColorSlots::NumSlots];
+		RoadAttributes.GetSpeedRatios(RoadIndex, RoadSlots);
+
+		int32 FirstSlot;
+		uint32 Weight;
+		FStreetMapColorSlots::GetPredictiveTimeWeights(ColorSlots.GetPredictiveTime(), FirstSlot, Weight);
+		SpeedRatio = FStreetMapColorSlots::Interpolate(RoadSlots[FirstSlot], RoadSlots[FirstSlot + 1], Weight) / 255.0f;
+	}
+
+	return GetSlotFlowColor(SpeedRatio, MeshBuildSettings.LowFlowColor.ToFColor(false), MeshBuildSettings.MedFlowColor.ToFColor(false), MeshBuildSettings.HighFlowColor.ToFColor(false));
+}
+
+void UStreetMapComponent::SetRoadHighlighted(FStreetMapLink Link, bool bHighlighted)
+{
+	if (!mLink2RoadIndex.Contains(Link)) return;
+
+	const int32 RoadIndex = mLink2RoadIndex[Link];
+	if (RoadIndex == HoveredRoadIndex) {
+		// Shows once the road is no longer hovered
+		bHoveredRoadWasHighlighted = bHighlighted;
+		return;
+	}
+
+	RoadAttributes.SetHighlight(RoadIndex, bHighlighted);
+	FlushRoadAttributes();
+}
+
+void UStreetMapComponent::ClearRoadHighlights()
+{
+	for (int32 RoadIndex = 0; RoadIndex < RoadAttributes.Num(); ++RoadIndex)
+	{
+		RoadAttributes.SetHighlight(RoadIndex, RoadIndex == HoveredRoadIndex);
+	}
+	bHoveredRoadWasHighlighted = false;
+
+	FlushRoadAttributes();
+}
+
+int32 UStreetMapComponent::FindRoadAt(FVector2D Location, float MaxDistance, EStreetMapRoadType MaxRoadType)
+{
+	if (StreetMap == nullptr) return INDEX_NONE;
+
+	const auto& Roads = StreetMap->GetRoads();
+	if (HoverGrid.Num() != Roads.Num()) {
+		HoverGrid.Init(Roads, StreetMap->GetBoundsMin(), StreetMap->GetBoundsMax(), 256);
+	}
+
+	// Same road classes as GetClosestRoad(): highways only, highways and major roads, or everything
+	uint32 RoadTypeMask = (1u << EStreetMapRoadType::Highway);
+	if (MaxRoadType != EStreetMapRoadType::Highway) {
+		RoadTypeMask |= (1u << EStreetMapRoadType::MajorRoad);
+	}
+	if (MaxRoadType == EStreetMapRoadType::Street) {
+		RoadTypeMask = ~0u;
+	}
+
+	float Distance;
+	return HoverGrid.FindNearest(Roads, Location, MaxDistance, RoadTypeMask, Distance);
+}
+
+bool UStreetMapComponent::HoverRoadAt(FVector Location, FStreetMapLink& OutLink, float MaxDistance, EStreetMapRoadType MaxRoadType)
+{
+	const uint64 StartCycles = FPlatformTime::Cycles64();
+
+	const FVector LocalLocation = GetComponentTransform().InverseTransformPosition(Location);
+	const int32 RoadIndex = FindRoadAt(FVector2D(LocalLocation.X, LocalLocation.Y), MaxDistance, MaxRoadType);
+	SetHoveredRoadIndex(RoadIndex);
+
+	if (RoadIndex != INDEX_NONE) {
+		OutLink = StreetMap->GetRoads()[RoadIndex].Link;
+	}
+
+	RenderCounters.LastHoverMilliseconds = (float)FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles);
+
+	return RoadIndex != INDEX_NONE;
+}
+
+void UStreetMapComponent::SetHoveredRoad(FStreetMapLink Link)
+{
+	const int* RoadIndex = mLink2RoadIndex.Find(Link);
+	SetHoveredRoadIndex(RoadIndex ? *RoadIndex : INDEX_NONE);
+}
+
+void UStreetMapComponent::ClearHoveredRoad()
+{
+	SetHoveredRoadIndex(INDEX_NONE);
+}
+
+void UStreetMapComponent::SetHoveredRoadIndex(int32 RoadIndex)
+{
+	if (RoadIndex == HoveredRoadIndex || StreetMap == nullptr) return;
+
+	const auto& Roads = StreetMap->GetRoads();
+	if (!Roads.IsValidIndex(RoadIndex)) {
+		RoadIndex = INDEX_NONE;
+	}
+
+	if (MeshBuildSettings.bUseRoadAttributes) {
+		if (RoadAttributes.Num() != Roads.Num()) return;
+
+		// Each road is flushed on its own, so two roads far apart don't upload every row between them
+		if (HoveredRoadIndex != INDEX_NONE) {
+			RoadAttributes.SetHighlight(HoveredRoadIndex, bHoveredRoadWasHighlighted);
+			FlushRoadAttributes();
+		}
+
+		HoveredRoadIndex = RoadIndex;
+		if (RoadIndex != INDEX_NONE) {
+			bHoveredRoadWasHighlighted = RoadAttributes.IsHighlighted(RoadIndex);
+			RoadAttributes.SetHighlight(RoadIndex, true);
+			FlushRoadAttributes();
+		}
+		return;
+	}
+
+	const FColor HighlightColor = MeshBuildSettings.HighlightColor.ToFColor(false);
+
+	if (MeshBuildSettings.bDrawRoadsAsSegments) {
+		if (RoadSegmentColors.Num() != Roads.Num()) return;
+
+		// A road's segments share one color, which is all there is to restore
+		if (HoveredRoadIndex != INDEX_NONE && HoveredRoadColors.Num() == 1) {
+			WriteRoadSegmentColor(HoveredRoadIndex, HoveredRoadColors[0]);
+		}
+
+		HoveredRoadIndex = RoadIndex;
+		HoveredRoadColors.Reset();
+
+		if (RoadIndex != INDEX_NONE) {
+			HoveredRoadColors.Add(RoadSegmentColors[RoadIndex]);
+			WriteRoadSegmentColor(RoadIndex, HighlightColor);
+		}
+
+		FlushRoadSegmentColors();
+		return;
+	}
+
+	// Meshes cached without vertex ranges have no per-road vertices to recolor
+	if (RoadVertexRanges.Num() != Roads.Num()) return;
+
+	if (HoveredRoadIndex != INDEX_NONE) {
+		const FStreetMapVertexRange& Range = RoadVertexRanges[HoveredRoadIndex];
+		TArray<FStreetMapVertex>& Vertices = GetVerticesOfType(Range.VertexType);
+
+		// Vertices recolored by something else while hovered keep their new color
+		for (int32 ColorIndex = 0; ColorIndex < HoveredRoadColors.Num(); ++ColorIndex)
+		{
+			FStreetMapVertex& Vertex = Vertices[Range.FirstVertex + ColorIndex];
+			if (Vertex.Color == HighlightColor) {
+				Vertex.Color = HoveredRoadColors[ColorIndex];
+			}
+		}
+
+		MarkColorRangeDirty(Range.VertexType, Range.FirstVertex, HoveredRoadColors.Num());
+	}
+
+	HoveredRoadIndex = RoadIndex;
+	HoveredRoadColors.Reset();
+
+	if (RoadIndex != INDEX_NONE) {
+		const FStreetMapVertexRange& Range = RoadVertexRanges[RoadIndex];
+		TArray<FStreetMapVertex>& Vertices = GetVerticesOfType(Range.VertexType);
+		const int32 LastVertex = FMath::Min(Range.FirstVertex + Range.NumVertices, Vertices.Num());
+
+		HoveredRoadColors.Reserve(LastVertex - Range.FirstVertex);
+		for (int32 VertexIndex = Range.FirstVertex; VertexIndex < LastVertex; ++VertexIndex)
+		{
+			HoveredRoadColors.Add(Vertices[VertexIndex].Color);
+			Vertices[VertexIndex].Color = HighlightColor;
+		}
+
+		MarkColorRangeDirty(Range.VertexType, Range.FirstVertex, HoveredRoadColors.Num());
+	}
+
+	FlushColorUpdates();
+}
+
+void UStreetMapComponent::ForgetHoveredRoad()
+{
+	HoveredRoadIndex = INDEX_NONE;
+	HoveredRoadColors.Reset();
+}
+
+FLinearColor UStreetMapComponent::GetRoadAttributeColor(FStreetMapLink Link) const
+{
+	if (!mLink2RoadIndex.Contains(Link)) return FLinearColor::Transparent;
+
+	return ResolveRoadAttributeColor(mLink2RoadIndex[Link]).ReinterpretAsLinear();
+}
+
+void UStreetMapComponent::ColorRoadMesh(FLinearColor val, TArray<FStreetMapVertex>& Vertices, bool IsTrace, float ZOffset)
+{
+	int NumVertices = Vertices.Num();
+
+	for (int i = 0; i < NumVertices; i++) {
+		Vertices[i].Color = val.ToFColor(false);
+		Vertices[i].IsTrace = IsTrace;
+		if (ZOffset != 0.0f) {
+			Vertices[i].Position.Z = ZOffset;
+		}
+	}
+
+	EVertexType VertexType;
+	if (ZOffset == 0.0f && FindVertexType(Vertices, VertexType))
+	{
+		// Only the colors changed, upload them into the existing proxy
+		MarkColorRangeDirty(VertexType, 0, NumVertices);
+		FlushColorUpdates();
+	}
+	else
+	{
+		// The vertex arrays were edited in place, CreateSceneProxy lays them out again
+		InvalidateRenderData();
+	}
+
+	Modify();
+}
+
+void UStreetMapComponent::ColorRoadMesh(FLinearColor val, FStreetMapLink Link, bool IsTrace, float ZOffset)
+{
+	auto& Roads = StreetMap->GetRoads();
+
+	if (!mLink2RoadIndex.Contains(Link)) return;
+
+	int RoadIndex = mLink2RoadIndex[Link];
+
+	// Segments have no vertices to move, only their color changes
+	if (MeshBuildSettings.bDrawRoadsAsSegments) {
+		SetRoadSegmentColor(RoadIndex, val.ToFColor(false), IsTrace);
+		FlushRoadSegmentColors();
+		return;
+	}
+
+	auto Road = Roads[RoadIndex];
+	TMap<FStreetMapLink, TArray<int>>* LinkMap;
+	TArray<FStreetMapVertex>* Vertices;
+
+	switch (Road.RoadType) {
+	case EStreetMapRoadType::Highway:
+		LinkMap = &mHighwayLink2Vertices;
+		Vertices = &HighwayVertices;
+		break;
+	case EStreetMapRoadType::MajorRoad:
+		LinkMap = &mMajorLink2Vertices;
+		Vertices = &MajorRoadVertices;
+		break;
+	default:
+		LinkMap = &mStreetLink2Vertices;
+		Vertices = &StreetVertices;
+		break;
+	}
+
+	for (int VertexIndex : (*LinkMap)[Link]) {
+		(*Vertices)[VertexIndex].Color = val.ToFColor(false);
+		(*Vertices)[VertexIndex].IsTrace = IsTrace;
+		if (ZOffset != 0.0f) {
+			(*Vertices)[VertexIndex].Position.Z = ZOffset;
+		}
+	}
+
+	MarkRoadColorDirty(RoadIndex);
+
+	if (ZOffset == 0.0f)
+	{
+		// Only the colors changed, upload them into the existing proxy
+		FlushColorUpdates();
+	}
+	else
+	{
+		// The vertex arrays were edited in place, CreateSceneProxy lays them out again
+		InvalidateRenderData();
+	}
+
+	//Modify();
+}
+
+void UStreetMapComponent::ColorRoadMesh(FLinearColor val, TArray<FStreetMapLink> Links, bool IsTrace, float ZOffset)
+{
+	auto& Roads = StreetMap->GetRoads();
+
+	// Segments have no vertices to move, only their color changes
+	if (MeshBuildSettings.bDrawRoadsAsSegments) {
+		for (auto& Link : Links) {
+			if (const int* RoadIndex = mLink2RoadIndex.Find(Link)) {
+				SetRoadSegmentColor(*RoadIndex, val.ToFColor(false), IsTrace);
+			}
+		}
+		FlushRoadSegmentColors();
+		return;
+	}
+
+	for (auto& Link : Links) {
 		if (mLink2RoadIndex.Contains(Link)) {
 			int RoadIndex = mLink2RoadIndex[Link];
 			auto Road = Roads[RoadIndex];
@@ -1660,11 +4296,20 @@ void UStreetMapComponent::ColorRoadMesh(FLinearColor val, TArray<FStreetMapLink>
 					(*Vertices)[VertexIndex].Position.Z = ZOffset;
 				}
 			}
+			MarkRoadColorDirty(RoadIndex);
 		}
 	}
 
-	// Mark our render state dirty so that CreateSceneProxy can refresh it on demand
-	MarkRenderStateDirty();
+	if (ZOffset == 0.0f)
+	{
+		// Only the colors changed, upload them into the existing proxy
+		FlushColorUpdates();
+	}
+	else
+	{
+		// The vertex arrays were edited in place, CreateSceneProxy lays them out again
+		InvalidateRenderData();
+	}
 
 	//Modify();
 }
@@ -1673,6 +4318,13 @@ void UStreetMapComponent::ColorRoadMesh(FLinearColor val, FName TMC, bool IsTrac
 {
 	auto& Roads = StreetMap->GetRoads();
 
+	// Segments have no vertices to move, only the color of the roads with the TMC changes
+	if (MeshBuildSettings.bDrawRoadsAsSegments) {
+		ColorRoadSegmentsOfTMC(TMC, val.ToFColor(false), IsTrace);
+		FlushRoadSegmentColors();
+		return;
+	}
+
 	if (!mTMC2RoadIndex.Contains(TMC)) return;
 
 	int RoadIndex = mTMC2RoadIndex[TMC];
@@ -1703,8 +4355,18 @@ void UStreetMapComponent::ColorRoadMesh(FLinearColor val, FName TMC, bool IsTrac
 		}
 	}
 
-	// Mark our render state dirty so that CreateSceneProxy can refresh it on demand
-	MarkRenderStateDirty();
+	MarkTMCColorDirty(TMC);
+
+	if (ZOffset == 0.0f)
+	{
+		// Only the colors changed, upload them into the existing proxy
+		FlushColorUpdates();
+	}
+	else
+	{
+		// The vertex arrays were edited in place, CreateSceneProxy lays them out again
+		InvalidateRenderData();
+	}
 
 	//Modify();
 }
@@ -1713,6 +4375,15 @@ void UStreetMapComponent::ColorRoadMesh(FLinearColor val, TArray<FName> TMCs, bo
 {
 	auto& Roads = StreetMap->GetRoads();
 
+	// Segments have no vertices to move, only the color of the roads with the TMCs changes
+	if (MeshBuildSettings.bDrawRoadsAsSegments) {
+		for (auto& TMC : TMCs) {
+			ColorRoadSegmentsOfTMC(TMC, val.ToFColor(false), IsTrace);
+		}
+		FlushRoadSegmentColors();
+		return;
+	}
+
 	for (auto& TMC : TMCs) {
 		if (mTMC2RoadIndex.Contains(TMC)) {
 			int RoadIndex = mTMC2RoadIndex[TMC];
@@ -1742,33 +4413,53 @@ void UStreetMapComponent::ColorRoadMesh(FLinearColor val, TArray<FName> TMCs, bo
 					(*Vertices)[VertexIndex].Position.Z = ZOffset;
 				}
 			}
+			MarkTMCColorDirty(TMC);
 		}
 	}
 
-	// Mark our render state dirty so that CreateSceneProxy can refresh it on demand
-	MarkRenderStateDirty();
-
+	if (ZOffset == 0.0f)
+	{
+		// Only the colors changed, upload them into the existing proxy
+		FlushColorUpdates();
+	}
+	else
+	{
+		// The vertex arrays were edited in place, CreateSceneProxy lays them out again
+		InvalidateRenderData();
+	}
+
 	//Modify();
 }
 
 void UStreetMapComponent::ColorRoadMeshFromData(TArray<FStreetMapVertex> & Vertices, FColor DefaultColor, FColor LowFlowColor, FColor MedFlowColor, FColor HighFlowColor, bool OverwriteTrace, float ZOffset) {
-	int NumVertices = Vertices.Num();
-	for (int i = 0; i < NumVertices; i++) {
-		auto* Vertex = &Vertices[i];
-		if (!Vertex->IsTrace || OverwriteTrace) {
-			const FName TMC = Vertex->TMC;
+	EVertexType VertexType;
+	if (StreetMap == nullptr || !FindVertexType(Vertices, VertexType)) return;
 
-			FColor RoadColor;
-			float Speed, SpeedRatio;
-			bool bUseDefaultColor = !GetSpeedAndColorFromData(TMC, Vertex->SpeedLimit, Speed, SpeedRatio, RoadColor, HighFlowColor, MedFlowColor, LowFlowColor);
-			if (bUseDefaultColor) {
-				RoadColor = DefaultColor;
-			}
+	// The TMC and speed limit of the vertices are those of the road whose range they are in
+	const auto& Roads = StreetMap->GetRoads();
+	if (RoadVertexRanges.Num() != Roads.Num()) return;
 
-			Vertex->Color = RoadColor;
+	for (int32 RoadIndex = 0; RoadIndex < Roads.Num(); ++RoadIndex) {
+		const FStreetMapVertexRange& Range = RoadVertexRanges[RoadIndex];
+		if (Range.VertexType != VertexType || Range.NumVertices == 0) continue;
+
+		FColor RoadColor;
+		float Speed, SpeedLimit, SpeedRatio;
+		bool bUseDefaultColor = !GetSpeedAndColorFromData(&Roads[RoadIndex], Speed, SpeedLimit, SpeedRatio, RoadColor, HighFlowColor, MedFlowColor, LowFlowColor);
+		if (bUseDefaultColor) {
+			RoadColor = DefaultColor;
+		}
 
-			auto Direction = Vertex->TextureCoordinate4.Y;
-			Vertex->TextureCoordinate4 = FVector2D(SpeedRatio * 100, Direction);
+		const int32 LastVertex = FMath::Min(Range.FirstVertex + Range.NumVertices, Vertices.Num());
+		if (RoadSpeedRatios.IsValidIndex(RoadIndex) && Range.FirstVertex < LastVertex && (OverwriteTrace || !Vertices[Range.FirstVertex].IsTrace)) {
+			RoadSpeedRatios[RoadIndex] = SpeedRatio;
+		}
+
+		for (int32 VertexIndex = Range.FirstVertex; VertexIndex < LastVertex; ++VertexIndex) {
+			auto* Vertex = &Vertices[VertexIndex];
+			if (Vertex->IsTrace && !OverwriteTrace) continue;
+
+			Vertex->Color = RoadColor;
 
 			if (ZOffset != 0.0f) {
 				Vertex->Position.Z = ZOffset;
@@ -1841,21 +4532,28 @@ void UStreetMapComponent::ColorRoadMeshFromData(TArray<FStreetMapLink> Links, FC
 			break;
 		}
 
-		for (int VertexIndex : (*LinkMap)[Link]) {
-			const FName TMC = (*Vertices)[VertexIndex].TMC;
-			FColor RoadColor;
-			float Speed, SpeedRatio;
-			bool bUseDefaultColor = !GetSpeedAndColorFromData(TMC, (*Vertices)[VertexIndex].SpeedLimit, Speed, SpeedRatio, RoadColor);
-			if (bUseDefaultColor) {
-				RoadColor = DefaultColor;
+		FColor RoadColor;
+		float Speed, SpeedLimit, SpeedRatio;
+		bool bUseDefaultColor = !GetSpeedAndColorFromData(&Roads[RoadIndex], Speed, SpeedLimit, SpeedRatio, RoadColor);
+		if (bUseDefaultColor) {
+			RoadColor = DefaultColor;
+		}
+
+		if (RoadSpeedRatios.IsValidIndex(RoadIndex)) {
+			RoadSpeedRatios[RoadIndex] = SpeedRatio;
+		}
+
+		// Segments have no vertices to raise, only their color changes
+		if (MeshBuildSettings.bDrawRoadsAsSegments) {
+			if (RoadSegmentColors.IsValidIndex(RoadIndex) && (OverwriteTrace || !RoadSegmentTraces[RoadIndex])) {
+				SetRoadSegmentColor(RoadIndex, RoadColor, false);
 			}
+			continue;
+		}
 
+		for (int VertexIndex : (*LinkMap)[Link]) {
 			(*Vertices)[VertexIndex].Color = RoadColor;
 
-			auto Direction = (*Vertices)[VertexIndex].TextureCoordinate4.Y;
-			(*Vertices)[VertexIndex].TextureCoordinate4 = FVector2D(SpeedRatio * 100, Direction);
-
-			(*Vertices)[VertexIndex].TextureCoordinate4 = FVector2D(SpeedRatio * 100, 0.0f);
 			if (ZOffset != 0.0f) {
 				(*Vertices)[VertexIndex].Position.Z = ZOffset;
 			}
@@ -1872,8 +4570,13 @@ void UStreetMapComponent::ColorRoadMeshFromData(TArray<FStreetMapLink> Links, FC
 		}
 	}
 
-	// Mark our render state dirty so that CreateSceneProxy can refresh it on demand
-	MarkRenderStateDirty();
+	if (MeshBuildSettings.bDrawRoadsAsSegments) {
+		FlushRoadSegmentColors();
+		return;
+	}
+
+	// The vertex arrays were edited in place, CreateSceneProxy lays them out again
+	InvalidateRenderData();
 
 	//Modify();
 }
@@ -1949,6 +4652,13 @@ void UStreetMapComponent::RefreshStreetColors()
 
 	//Modify();
 
+	if (MeshBuildSettings.bUseRoadAttributes)
+	{
+		// Vertices only hold road indices, new colors are a per-road upload
+		UpdateRoadAttributes();
+		return;
+	}
+
 	const FColor LowFlowColor = MeshBuildSettings.LowFlowColor.ToFColor(false);
 	const FColor MedFlowColor = MeshBuildSettings.MedFlowColor.ToFColor(false);
 	const FColor HighFlowColor = MeshBuildSettings.HighFlowColor.ToFColor(false);
@@ -1984,6 +4694,16 @@ void UStreetMapComponent::OverrideFlowColors(FLinearColor LowFlowColor, FLinearC
 
 	//Modify();
 
+	if (MeshBuildSettings.bUseRoadAttributes)
+	{
+		// There is no mesh to bake the colors into, the material reads them from the settings
+		MeshBuildSettings.LowFlowColor = LowFlowColor;
+		MeshBuildSettings.MedFlowColor = MedFlowColor;
+		MeshBuildSettings.HighFlowColor = HighFlowColor;
+		ApplyRoadAttributeMaterialParameters();
+		return;
+	}
+
 	BuildRoadMesh(HighFlowColor.ToFColor(false), MedFlowColor.ToFColor(false), LowFlowColor.ToFColor(false));
 }
 
@@ -2452,6 +5172,17 @@ void UStreetMapComponent::ChangeStreetThickness(float val, EStreetMapRoadType ty
 		break;
 	}
 
+	// Segments are stretched to the new thickness, they aren't part of any mesh build
+	if (MeshBuildSettings.bDrawRoadsAsSegments) {
+		UpdateRoadSegmentTransforms(GetVertexTypeForRoad(type));
+		return;
+	}
+
+	// A pending build was captured with the old thickness
+	if (RestartMeshBuild()) {
+		return;
+	}
+
 	BuildRoadMesh(type, HighFlowColor, MedFlowColor, LowFlowColor);
 }
 
@@ -2522,6 +5253,16 @@ void UStreetMapComponent::PostEditChangeProperty(FPropertyChangedEvent& Property
 		if (PropertyName == GET_MEMBER_NAME_CHECKED(UStreetMapComponent, StreetMap))
 		{
 			bNeedRefreshCustomizationModule = true;
+			RebuildCongestionStats();
+			TraceAnalytics.Reset();
+
+			// A pending build was started on the previous street map
+			RestartMeshBuild();
+		}
+		else if (PropertyChangedEvent.MemberProperty != nullptr && PropertyChangedEvent.MemberProperty->GetFName() == GET_MEMBER_NAME_CHECKED(UStreetMapComponent, MeshBuildSettings))
+		{
+			// A pending build was captured with the previous settings
+			RestartMeshBuild();
 		}
 		else if (IsCollisionProperty(PropertyName)) // For some unknown reason , GET_MEMBER_NAME_CHECKED(UStreetMapComponent, CollisionSettings) is not working ??? "TO CHECK LATER"
 		{
@@ -2555,6 +5296,16 @@ void UStreetMapComponent::BuildMesh()
 
 	GenerateMesh();
 
+	FinishBuildMesh();
+}
+
+void UStreetMapComponent::FinishBuildMesh()
+{
+	if (MeshBuildSettings.bUseRoadAttributes)
+	{
+		InitRoadAttributes();
+	}
+
 	if (HasValidMesh())
 	{
 		// We have a new bounding box
@@ -2567,6 +5318,8 @@ void UStreetMapComponent::BuildMesh()
 
 	GenerateCollision();
 
+	UpdateRoadSegmentInstances();
+
 	// Mark our render state dirty so that CreateSceneProxy can refresh it on demand
 	MarkRenderStateDirty();
 
@@ -2575,6 +5328,68 @@ void UStreetMapComponent::BuildMesh()
 	Modify();
 }
 
+void UStreetMapComponent::BuildMeshAsync()
+{
+	CancelMeshBuild();
+
+	PendingMeshBuild = MakeUnique<FStreetMapMeshBuild>();
+	CaptureMeshBuild(*PendingMeshBuild);
+
+	FStreetMapMeshBuild* Build = PendingMeshBuild.Get();
+	MeshBuildTask = Async(EAsyncExecution::ThreadPool, [this, Build]()
+	{
+		GenerateMesh(*Build);
+		Build->bDone = true;
+	});
+
+	// Swapped in by the first tick after the worker is done
+	SetComponentTickEnabled(true);
+}
+
+bool UStreetMapComponent::CancelMeshBuild()
+{
+	if (!PendingMeshBuild.IsValid()) return false;
+
+	// The worker reads the street map and helpers of this component, so it has to be gone before they change
+	PendingMeshBuild->bCancelled = true;
+	MeshBuildTask.Wait();
+	MeshBuildTask = TFuture<void>();
+	PendingMeshBuild.Reset();
+
+	SetComponentTickEnabled(FlowFeed.IsValid() || Heatmap.IsInitialized());
+	return true;
+}
+
+bool UStreetMapComponent::RestartMeshBuild()
+{
+	if (!CancelMeshBuild()) return false;
+
+	BuildMeshAsync();
+	return true;
+}
+
+void UStreetMapComponent::FlushMeshBuild()
+{
+	if (!PendingMeshBuild.IsValid()) return;
+
+	MeshBuildTask.Wait();
+	MeshBuildTask = TFuture<void>();
+	TUniquePtr<FStreetMapMeshBuild> Build = MoveTemp(PendingMeshBuild);
+
+	SetComponentTickEnabled(FlowFeed.IsValid() || Heatmap.IsInitialized());
+
+	InvalidateMesh();
+	ApplyMeshBuild(*Build);
+
+	// Road colors were captured when the build started, flow data and colors may have changed since
+	if (!MeshBuildSettings.bUseRoadAttributes)
+	{
+		ApplyColorSlot();
+	}
+
+	FinishBuildMesh();
+}
+
 void UStreetMapComponent::AssignDefaultMaterialIfNeeded()
 {
 	if (this->GetNumMaterials() == 0 || this->GetMaterial(0) == nullptr)
@@ -2596,6 +5411,8 @@ void UStreetMapComponent::UpdateNavigationIfNeeded()
 
 void UStreetMapComponent::InvalidateMesh()
 {
+	CancelMeshBuild();
+
 	BuildingVertices.Reset();
 	BuildingIndices.Reset();
 	StreetVertices.Reset();
@@ -2604,6 +5421,21 @@ void UStreetMapComponent::InvalidateMesh()
 	MajorRoadIndices.Reset();
 	HighwayVertices.Reset();
 	HighwayIndices.Reset();
+	RoadVertexRanges.Reset();
+	RoadSpeedRatios.Reset();
+	MeshChunks.Reset();
+	RenderData.Reset();
+	for (FStreetMapColorStreamPtr& Colors : RenderColors)
+	{
+		Colors.Reset();
+	}
+	for (FStreetMapTexCoordStreamPtr& TexCoords : RenderTexCoords)
+	{
+		TexCoords.Reset();
+	}
+	DirtyTexCoordRoads.Reset();
+	ForgetHoveredRoad();
+	bColorSlotsStale = true;
 
 	CachedLocalBounds = FBoxSphereBounds(FBox(ForceInitToZero));
 	ClearCollision();
@@ -2639,12 +5471,7 @@ void UStreetMapComponent::AddThick2DLine(
 	TArray<FStreetMapVertex>* Vertices,
 	TArray<uint32>* Indices,
 	EVertexType VertexType,
-	int64 LinkId,
-	FString LinkDir,
-	FName TMC,
-	int SpeedLimit,
-	float SpeedRatio,
-	float RoadTypeFloat
+	const FString& LinkDir
 )
 {
 	const float HalfThickness = Thickness * 0.5f;
@@ -2657,10 +5484,6 @@ void UStreetMapComponent::AddThick2DLine(
 
 	const int32 BottomLeftVertexIndex = Vertices->Num();
 	FStreetMapVertex& BottomLeftVertex = *new(*Vertices)FStreetMapVertex();
-	BottomLeftVertex.LinkId = LinkId;
-	BottomLeftVertex.LinkDir = LinkDir;
-	BottomLeftVertex.TMC = TMC;
-	BottomLeftVertex.SpeedLimit = SpeedLimit;
 	switch (VertexType)
 	{
 	case EVertexType::VStreet:
@@ -2684,19 +5507,13 @@ void UStreetMapComponent::AddThick2DLine(
 	}
 	BottomLeftVertex.TextureCoordinate2 = FVector2D(-RightVector.X, -RightVector.Y);
 	BottomLeftVertex.TextureCoordinate3 = FVector2D(HalfThickness, MaxThickness);
-	BottomLeftVertex.TextureCoordinate4 = FVector2D(SpeedRatio * 100, 0);
-	BottomLeftVertex.TextureCoordinate5 = FVector2D(RoadTypeFloat, 0);
-	BottomLeftVertex.TangentX = FVector(LineDirection, 0.0f);
-	BottomLeftVertex.TangentZ = FVector::UpVector;
+	BottomLeftVertex.Direction = 0;
+	BottomLeftVertex.SetTangents(FVector(LineDirection, 0.0f), FVector::UpVector);
 	BottomLeftVertex.Color = StartColor;
 	MeshBoundingBox += BottomLeftVertex.Position;
 
 	const int32 BottomRightVertexIndex = Vertices->Num();
 	FStreetMapVertex& BottomRightVertex = *new(*Vertices)FStreetMapVertex();
-	BottomRightVertex.LinkId = LinkId;
-	BottomRightVertex.LinkDir = LinkDir;
-	BottomRightVertex.TMC = TMC;
-	BottomRightVertex.SpeedLimit = SpeedLimit;
 	switch (VertexType)
 	{
 	case EVertexType::VStreet:
@@ -2720,19 +5537,13 @@ void UStreetMapComponent::AddThick2DLine(
 	}
 	BottomRightVertex.TextureCoordinate2 = FVector2D(RightVector.X, RightVector.Y);
 	BottomRightVertex.TextureCoordinate3 = FVector2D(HalfThickness, MaxThickness);
-	BottomRightVertex.TextureCoordinate4 = FVector2D(SpeedRatio * 100, 0);
-	BottomRightVertex.TextureCoordinate5 = FVector2D(RoadTypeFloat, 0);
-	BottomRightVertex.TangentX = FVector(LineDirection, 0.0f);
-	BottomRightVertex.TangentZ = FVector::UpVector;
+	BottomRightVertex.Direction = 0;
+	BottomRightVertex.SetTangents(FVector(LineDirection, 0.0f), FVector::UpVector);
 	BottomRightVertex.Color = StartColor;
 	MeshBoundingBox += BottomRightVertex.Position;
 
 	const int32 TopRightVertexIndex = Vertices->Num();
 	FStreetMapVertex& TopRightVertex = *new(*Vertices)FStreetMapVertex();
-	TopRightVertex.LinkId = LinkId;
-	TopRightVertex.LinkDir = LinkDir;
-	TopRightVertex.TMC = TMC;
-	TopRightVertex.SpeedLimit = SpeedLimit;
 	switch (VertexType)
 	{
 	case EVertexType::VStreet:
@@ -2756,19 +5567,13 @@ void UStreetMapComponent::AddThick2DLine(
 	}
 	TopRightVertex.TextureCoordinate2 = FVector2D(RightVector.X, RightVector.Y);
 	TopRightVertex.TextureCoordinate3 = FVector2D(HalfThickness, MaxThickness);
-	TopRightVertex.TextureCoordinate4 = FVector2D(SpeedRatio * 100, 0);
-	TopRightVertex.TextureCoordinate5 = FVector2D(RoadTypeFloat, 0);
-	TopRightVertex.TangentX = FVector(LineDirection, 0.0f);
-	TopRightVertex.TangentZ = FVector::UpVector;
+	TopRightVertex.Direction = 0;
+	TopRightVertex.SetTangents(FVector(LineDirection, 0.0f), FVector::UpVector);
 	TopRightVertex.Color = EndColor;
 	MeshBoundingBox += TopRightVertex.Position;
 
 	const int32 TopLeftVertexIndex = Vertices->Num();
 	FStreetMapVertex& TopLeftVertex = *new(*Vertices)FStreetMapVertex();
-	TopLeftVertex.LinkId = LinkId;
-	TopLeftVertex.LinkDir = LinkDir;
-	TopLeftVertex.TMC = TMC;
-	TopLeftVertex.SpeedLimit = SpeedLimit;
 	switch (VertexType)
 	{
 	case EVertexType::VStreet:
@@ -2792,10 +5597,8 @@ void UStreetMapComponent::AddThick2DLine(
 	}
 	TopLeftVertex.TextureCoordinate2 = FVector2D(-RightVector.X, -RightVector.Y);
 	TopLeftVertex.TextureCoordinate3 = FVector2D(HalfThickness, MaxThickness);
-	TopLeftVertex.TextureCoordinate4 = FVector2D(SpeedRatio * 100, 0);
-	TopLeftVertex.TextureCoordinate5 = FVector2D(RoadTypeFloat, 0);
-	TopLeftVertex.TangentX = FVector(LineDirection, 0.0f);
-	TopLeftVertex.TangentZ = FVector::UpVector;
+	TopLeftVertex.Direction = 0;
+	TopLeftVertex.SetTangents(FVector(LineDirection, 0.0f), FVector::UpVector);
 	TopLeftVertex.Color = EndColor;
 	MeshBoundingBox += TopLeftVertex.Position;
 
@@ -2820,10 +5623,8 @@ void UStreetMapComponent::AddTriangles(const TArray<FVector>& Points, const TArr
 		NewVertex.TextureCoordinate = FVector2D(0.0f, 0.0f);	// NOTE: We're not using texture coordinates for anything yet
 		NewVertex.TextureCoordinate2 = FVector2D(0.0f, 0.0f);
 		NewVertex.TextureCoordinate3 = FVector2D(0.0f, 1.0f); // Thicknesses
-		NewVertex.TextureCoordinate4 = FVector2D(0.0f, 0.0f);
-		NewVertex.TextureCoordinate5 = FVector2D(0.0f, 0.0f);
-		NewVertex.TangentX = ForwardVector;
-		NewVertex.TangentZ = UpVector;
+		NewVertex.Direction = 0;
+		NewVertex.SetTangents(ForwardVector, UpVector);
 		NewVertex.Color = Color;
 
 		MeshBoundingBox += NewVertex.Position;
@@ -2839,7 +5640,8 @@ void UStreetMapComponent::findConnectedRoad(
 	const FStreetMapRoad& Road
 	, int32 RoadCheckIndex
 	, const bool Start
-	, FString LinkDir
+	, const FString& LinkDir
+	, const float ThresholdConnectStreets
 	, int32& ChosenRoadIndex
 	, bool& fromBack)
 {
@@ -2867,7 +5669,7 @@ void UStreetMapComponent::findConnectedRoad(
 	if (RefCount > 1)
 	{
 		auto RoadInNodeIndex = Node.RoadRefs.IndexOfByKey(RoadIndex);
-		float CosAlpha = MeshBuildSettings.fThresholdConnectStreets;
+		float CosAlpha = ThresholdConnectStreets;
 
 		for (auto& OtherRoadNode : Node.RoadRefs)
 		{
@@ -2950,12 +5752,8 @@ void UStreetMapComponent::CheckRoadSmoothQuadList(
 	, TArray<FStreetMapVertex>* Vertices
 	, TArray<uint32>* Indices
 	, EVertexType VertexType
-	, int64 LinkId
-	, FString LinkDir
-	, FName TMC
-	, int SpeedLimit
-	, float SpeedRatio
-	, float RoadTypeFloat
+	, const float ThresholdConnectStreets
+	, const FString& LinkDir
 )
 {
 	if (!StreetMap)
@@ -2985,6 +5783,7 @@ void UStreetMapComponent::CheckRoadSmoothQuadList(
 			, RoadCheckIndex
 			, Start
 			, LinkDir
+			, ThresholdConnectStreets
 			, ChosenRoadIndex
 			, fromBack
 		);
@@ -3022,12 +5821,7 @@ void UStreetMapComponent::CheckRoadSmoothQuadList(
 				Vertices,
 				Indices,
 				VertexType,
-				LinkId,
-				LinkDir,
-				TMC,
-				SpeedLimit,
-				SpeedRatio,
-				RoadTypeFloat
+				LinkDir
 			);
 		}
 		else
@@ -3045,12 +5839,7 @@ void UStreetMapComponent::CheckRoadSmoothQuadList(
 				Vertices,
 				Indices,
 				VertexType,
-				LinkId,
-				LinkDir,
-				TMC,
-				SpeedLimit,
-				SpeedRatio,
-				RoadTypeFloat
+				LinkDir
 			);
 		}
 		return;
@@ -3077,12 +5866,7 @@ void UStreetMapComponent::CheckRoadSmoothQuadList(
 			Vertices,
 			Indices,
 			VertexType,
-			LinkId,
-			LinkDir,
-			TMC,
-			SpeedLimit,
-			SpeedRatio,
-			RoadTypeFloat
+			LinkDir
 		);
 	}
 	else
@@ -3099,12 +5883,7 @@ void UStreetMapComponent::CheckRoadSmoothQuadList(
 			Vertices,
 			Indices,
 			VertexType,
-			LinkId,
-			LinkDir,
-			TMC,
-			SpeedLimit,
-			SpeedRatio,
-			RoadTypeFloat
+			LinkDir
 		);
 	}
 }
@@ -3118,17 +5897,11 @@ void startSmoothVertices(const FVector2D Start
 	, const float XRatio
 	, const FColor& StartColor
 	, const FColor& EndColor
-	, FStreetMapMeshBuildSettings MeshBuildSettings
 	, FBox& MeshBoundingBox
 	, TArray<FStreetMapVertex>* Vertices
 	, TArray<uint32>* Indices
 	, EVertexType VertexType
-	, int64 LinkId
-	, FString LinkDir
-	, FName TMC
-	, int SpeedLimit
-	, float SpeedRatio
-	, float RoadTypeFloat
+	, const FString& LinkDir
 )
 {
 	const float QuarterThickness = HalfThickness * .5f;
@@ -3137,10 +5910,6 @@ void startSmoothVertices(const FVector2D Start
 
 	const int32 BottomLeftVertexIndex = Vertices->Num();
 	FStreetMapVertex& BottomLeftVertex = *new(*Vertices)FStreetMapVertex();
-	BottomLeftVertex.LinkId = LinkId;
-	BottomLeftVertex.LinkDir = LinkDir;
-	BottomLeftVertex.TMC = TMC;
-	BottomLeftVertex.SpeedLimit = SpeedLimit;
 	switch (VertexType)
 	{
 	case EVertexType::VStreet:
@@ -3149,13 +5918,13 @@ void startSmoothVertices(const FVector2D Start
 		if (IsForward)
 		{
 			BottomLeftVertex.TextureCoordinate = FVector2D(0.0f, XRatio);
-			BottomLeftVertex.TextureCoordinate4 = FVector2D(SpeedRatio * 100, -1.f);
+			BottomLeftVertex.Direction = -1;
 			break;
 		}
 		else if (IsBackward)
 		{
 			BottomLeftVertex.TextureCoordinate = FVector2D(0.0f, -XRatio);
-			BottomLeftVertex.TextureCoordinate4 = FVector2D(SpeedRatio * 100, 1.f);
+			BottomLeftVertex.Direction = 1;
 			break;
 		}
 		else
@@ -3164,26 +5933,20 @@ void startSmoothVertices(const FVector2D Start
 		}
 	default:
 		BottomLeftVertex.TextureCoordinate = FVector2D(0.0f, XRatio);
-		BottomLeftVertex.TextureCoordinate4 = FVector2D(SpeedRatio * 100, 0);
+		BottomLeftVertex.Direction = 0;
 		break;
 	}
 
 	BottomLeftVertex.Position = FVector(Start, Z);
 	BottomLeftVertex.TextureCoordinate2 = FVector2D(-RightVector.X, -RightVector.Y);
 	BottomLeftVertex.TextureCoordinate3 = FVector2D(HalfThickness, MaxThickness);
-	BottomLeftVertex.TextureCoordinate5 = FVector2D(RoadTypeFloat, 0.f);
-	BottomLeftVertex.TangentX = FVector(Tangent, 0.0f);
-	BottomLeftVertex.TangentZ = FVector::UpVector;
+	BottomLeftVertex.SetTangents(FVector(Tangent, 0.0f), FVector::UpVector);
 	BottomLeftVertex.Color = StartColor;
 	// BottomLeftVertex.Color = FColor(0, 0, 255);
 	MeshBoundingBox += BottomLeftVertex.Position;
 
 	const int32 BottomRightVertexIndex = Vertices->Num();
 	FStreetMapVertex& BottomRightVertex = *new(*Vertices)FStreetMapVertex();
-	BottomRightVertex.LinkId = LinkId;
-	BottomRightVertex.LinkDir = LinkDir;
-	BottomRightVertex.TMC = TMC;
-	BottomRightVertex.SpeedLimit = SpeedLimit;
 	switch (VertexType)
 	{
 	case EVertexType::VStreet:
@@ -3192,13 +5955,13 @@ void startSmoothVertices(const FVector2D Start
 		if (IsForward)
 		{
 			BottomRightVertex.TextureCoordinate = FVector2D(1.0f, XRatio);
-			BottomRightVertex.TextureCoordinate4 = FVector2D(SpeedRatio * 100, 1.f);
+			BottomRightVertex.Direction = 1;
 			break;
 		}
 		else if (IsBackward)
 		{
 			BottomRightVertex.TextureCoordinate = FVector2D(1.0f, -XRatio);
-			BottomRightVertex.TextureCoordinate4 = FVector2D(SpeedRatio * 100, -1.f);
+			BottomRightVertex.Direction = -1;
 			break;
 		}
 		else
@@ -3207,15 +5970,13 @@ void startSmoothVertices(const FVector2D Start
 		}
 	default:
 		BottomRightVertex.TextureCoordinate = FVector2D(1.0f, XRatio);
-		BottomRightVertex.TextureCoordinate4 = FVector2D(SpeedRatio * 100, 0.f);
+		BottomRightVertex.Direction = 0;
 		break;
 	}
 	BottomRightVertex.Position = FVector(Start, Z);
 	BottomRightVertex.TextureCoordinate2 = FVector2D(RightVector.X, RightVector.Y);
 	BottomRightVertex.TextureCoordinate3 = FVector2D(HalfThickness, MaxThickness);
-	BottomRightVertex.TextureCoordinate5 = FVector2D(RoadTypeFloat, 0.f);
-	BottomRightVertex.TangentX = FVector(Tangent, 0.0f);
-	BottomRightVertex.TangentZ = FVector::UpVector;
+	BottomRightVertex.SetTangents(FVector(Tangent, 0.0f), FVector::UpVector);
 	BottomRightVertex.Color = StartColor;
 	// BottomRightVertex.Color = FColor(0, 0, 255);
 	MeshBoundingBox += BottomRightVertex.Position;
@@ -3237,12 +5998,7 @@ void UStreetMapComponent::StartSmoothQuadList(const FVector2D& Prev
 	, TArray<FStreetMapVertex>* Vertices
 	, TArray<uint32>* Indices
 	, EVertexType VertexType
-	, int64 LinkId
-	, FString LinkDir
-	, FName TMC
-	, int SpeedLimit
-	, float SpeedRatio
-	, float RoadTypeFloat
+	, const FString& LinkDir
 )
 {
 	const float HalfThickness = Thickness * 0.5f;
@@ -3267,17 +6023,11 @@ void UStreetMapComponent::StartSmoothQuadList(const FVector2D& Prev
 		, XRatio
 		, StartColor
 		, EndColor
-		, MeshBuildSettings
 		, MeshBoundingBox
 		, Vertices
 		, Indices
 		, VertexType
-		, LinkId
 		, LinkDir
-		, TMC
-		, SpeedLimit
-		, SpeedRatio
-		, RoadTypeFloat
 	);
 }
 
@@ -3293,12 +6043,7 @@ void UStreetMapComponent::StartSmoothQuadList(const FVector2D& Start
 	, TArray<FStreetMapVertex>* Vertices
 	, TArray<uint32>* Indices
 	, EVertexType VertexType
-	, int64 LinkId
-	, FString LinkDir
-	, FName TMC
-	, int SpeedLimit
-	, float SpeedRatio
-	, float RoadTypeFloat
+	, const FString& LinkDir
 )
 {
 	const float HalfThickness = Thickness * 0.5f;
@@ -3317,17 +6062,11 @@ void UStreetMapComponent::StartSmoothQuadList(const FVector2D& Start
 		, XRatio
 		, StartColor
 		, EndColor
-		, MeshBuildSettings
 		, MeshBoundingBox
 		, Vertices
 		, Indices
 		, VertexType
-		, LinkId
 		, LinkDir
-		, TMC
-		, SpeedLimit
-		, SpeedRatio
-		, RoadTypeFloat
 	);
 }
 
@@ -3346,12 +6085,7 @@ void UStreetMapComponent::AddSmoothQuad(const FVector2D& Start
 	, TArray<FStreetMapVertex>* Vertices
 	, TArray<uint32>* Indices
 	, EVertexType VertexType
-	, int64 LinkId
-	, FString LinkDir
-	, FName TMC
-	, int SpeedLimit
-	, float SpeedRatio
-	, float RoadTypeFloat
+	, const FString& LinkDir
 )
 {
 	const float HalfThickness = Thickness * 0.5f;
@@ -3370,10 +6104,6 @@ void UStreetMapComponent::AddSmoothQuad(const FVector2D& Start
 
 	const int32 MidLeftVertexIndex = Vertices->Num();
 	FStreetMapVertex& MidLeftVertex = *new(*Vertices)FStreetMapVertex();
-	MidLeftVertex.LinkId = LinkId;
-	MidLeftVertex.LinkDir = LinkDir;
-	MidLeftVertex.TMC = TMC;
-	MidLeftVertex.SpeedLimit = SpeedLimit;
 	switch (VertexType)
 	{
 	case EVertexType::VStreet:
@@ -3382,13 +6112,13 @@ void UStreetMapComponent::AddSmoothQuad(const FVector2D& Start
 		if (IsForward)
 		{
 			MidLeftVertex.TextureCoordinate = FVector2D(0.0f, VAccumulation + XRatio);
-			MidLeftVertex.TextureCoordinate4 = FVector2D(SpeedRatio * 100, -1.f);
+			MidLeftVertex.Direction = -1;
 			break;
 		}
 		else if (IsBackward)
 		{
 			MidLeftVertex.TextureCoordinate = FVector2D(0.0f, -VAccumulation - XRatio);
-			MidLeftVertex.TextureCoordinate4 = FVector2D(SpeedRatio * 100, 1.f);
+			MidLeftVertex.Direction = 1;
 			break;
 		}
 		else
@@ -3397,24 +6127,18 @@ void UStreetMapComponent::AddSmoothQuad(const FVector2D& Start
 		}
 	default:
 		MidLeftVertex.TextureCoordinate = FVector2D(0.0f, VAccumulation + XRatio);
-		MidLeftVertex.TextureCoordinate4 = FVector2D(SpeedRatio * 100, 0.f);
+		MidLeftVertex.Direction = 0;
 		break;
 	}
 	MidLeftVertex.Position = FVector(Mid, Z);
 	MidLeftVertex.TextureCoordinate2 = FVector2D(-RightVector.X, -RightVector.Y);
 	MidLeftVertex.TextureCoordinate3 = FVector2D(HalfThickness, MaxThickness);
-	MidLeftVertex.TextureCoordinate5 = FVector2D(RoadTypeFloat, 0.f);
-	MidLeftVertex.TangentX = FVector(alteredLineDirection, 0.0f);
-	MidLeftVertex.TangentZ = FVector::UpVector;
+	MidLeftVertex.SetTangents(FVector(alteredLineDirection, 0.0f), FVector::UpVector);
 	MidLeftVertex.Color = StartColor;
 	MeshBoundingBox += MidLeftVertex.Position;
 
 	const int32 MidRightVertexIndex = Vertices->Num();
 	FStreetMapVertex& MidRightVertex = *new(*Vertices)FStreetMapVertex();
-	MidRightVertex.LinkId = LinkId;
-	MidRightVertex.LinkDir = LinkDir;
-	MidRightVertex.TMC = TMC;
-	MidRightVertex.SpeedLimit = SpeedLimit;
 	switch (VertexType)
 	{
 	case EVertexType::VStreet:
@@ -3423,13 +6147,13 @@ void UStreetMapComponent::AddSmoothQuad(const FVector2D& Start
 		if (IsForward)
 		{
 			MidRightVertex.TextureCoordinate = FVector2D(1.0f, VAccumulation + XRatio);
-			MidRightVertex.TextureCoordinate4 = FVector2D(SpeedRatio * 100, 1.f);
+			MidRightVertex.Direction = 1;
 			break;
 		}
 		else if (IsBackward)
 		{
 			MidRightVertex.TextureCoordinate = FVector2D(1.0f, -VAccumulation - XRatio);
-			MidRightVertex.TextureCoordinate4 = FVector2D(SpeedRatio * 100, -1.f);
+			MidRightVertex.Direction = -1;
 			break;
 		}
 		else
@@ -3438,15 +6162,13 @@ void UStreetMapComponent::AddSmoothQuad(const FVector2D& Start
 		}
 	default:
 		MidRightVertex.TextureCoordinate = FVector2D(1.0f, VAccumulation + XRatio);
-		MidRightVertex.TextureCoordinate4 = FVector2D(SpeedRatio * 100, 0.f);
+		MidRightVertex.Direction = 0;
 		break;
 	}
 	MidRightVertex.Position = FVector(Mid, Z);
 	MidRightVertex.TextureCoordinate2 = FVector2D(RightVector.X, RightVector.Y);
 	MidRightVertex.TextureCoordinate3 = FVector2D(HalfThickness, MaxThickness);
-	MidRightVertex.TextureCoordinate5 = FVector2D(RoadTypeFloat, 0.f);
-	MidRightVertex.TangentX = FVector(alteredLineDirection, 0.0f);
-	MidRightVertex.TangentZ = FVector::UpVector;
+	MidRightVertex.SetTangents(FVector(alteredLineDirection, 0.0f), FVector::UpVector);
 	MidRightVertex.Color = StartColor;
 	MeshBoundingBox += MidRightVertex.Position;
 
@@ -3477,17 +6199,11 @@ void endSmoothVertices(const FVector2D End
 	, const float XRatio
 	, const FColor& StartColor
 	, const FColor& EndColor
-	, FStreetMapMeshBuildSettings MeshBuildSettings
 	, FBox& MeshBoundingBox
 	, TArray<FStreetMapVertex>* Vertices
 	, TArray<uint32>* Indices
 	, EVertexType VertexType
-	, int64 LinkId
-	, FString LinkDir
-	, FName TMC
-	, int SpeedLimit
-	, float SpeedRatio
-	, float RoadTypeFloat
+	, const FString& LinkDir
 )
 {
 	const float QuarterThickness = HalfThickness * .5f;
@@ -3497,10 +6213,6 @@ void endSmoothVertices(const FVector2D End
 	const bool IsBackward = LinkDir.Compare(TEXT("F"), ESearchCase::IgnoreCase) == 0;
 	const int32 TopLeftVertexIndex = Vertices->Num();
 	FStreetMapVertex& TopLeftVertex = *new(*Vertices)FStreetMapVertex();
-	TopLeftVertex.LinkId = LinkId;
-	TopLeftVertex.LinkDir = LinkDir;
-	TopLeftVertex.TMC = TMC;
-	TopLeftVertex.SpeedLimit = SpeedLimit;
 	switch (VertexType)
 	{
 	case EVertexType::VStreet:
@@ -3509,13 +6221,13 @@ void endSmoothVertices(const FVector2D End
 		if (IsForward)
 		{
 			TopLeftVertex.TextureCoordinate = FVector2D(0.0f, XRatio);
-			TopLeftVertex.TextureCoordinate4 = FVector2D(SpeedRatio * 100, -1.f);
+			TopLeftVertex.Direction = -1;
 			break;
 		}
 		else if (IsBackward)
 		{
 			TopLeftVertex.TextureCoordinate = FVector2D(0.0f, -XRatio);
-			TopLeftVertex.TextureCoordinate4 = FVector2D(SpeedRatio * 100, 1.f);
+			TopLeftVertex.Direction = 1;
 			break;
 		}
 		else
@@ -3524,25 +6236,19 @@ void endSmoothVertices(const FVector2D End
 		}
 	default:
 		TopLeftVertex.TextureCoordinate = FVector2D(0.0f, XRatio);
-		TopLeftVertex.TextureCoordinate4 = FVector2D(SpeedRatio * 100, 0.f);
+		TopLeftVertex.Direction = 0;
 		break;
 	}
 	TopLeftVertex.Position = FVector(End, Z);
 	TopLeftVertex.TextureCoordinate2 = FVector2D(-RightVector.X, -RightVector.Y);
 	TopLeftVertex.TextureCoordinate3 = FVector2D(HalfThickness, MaxThickness);
-	TopLeftVertex.TextureCoordinate5 = FVector2D(RoadTypeFloat, 0.f);
-	TopLeftVertex.TangentX = FVector(Tangent, 0.0f);
-	TopLeftVertex.TangentZ = FVector::UpVector;
+	TopLeftVertex.SetTangents(FVector(Tangent, 0.0f), FVector::UpVector);
 	TopLeftVertex.Color = EndColor;
 	// TopLeftVertex.Color = FColor(255, 0, 0);
 	MeshBoundingBox += TopLeftVertex.Position;
 
 	const int32 TopRightVertexIndex = Vertices->Num();
 	FStreetMapVertex& TopRightVertex = *new(*Vertices)FStreetMapVertex();
-	TopRightVertex.LinkId = LinkId;
-	TopRightVertex.LinkDir = LinkDir;
-	TopRightVertex.TMC = TMC;
-	TopRightVertex.SpeedLimit = SpeedLimit;
 	switch (VertexType)
 	{
 	case EVertexType::VStreet:
@@ -3551,13 +6257,13 @@ void endSmoothVertices(const FVector2D End
 		if (IsForward)
 		{
 			TopRightVertex.TextureCoordinate = FVector2D(1.0f, XRatio);
-			TopRightVertex.TextureCoordinate4 = FVector2D(SpeedRatio * 100, 1.f);
+			TopRightVertex.Direction = 1;
 			break;
 		}
 		else if (IsBackward)
 		{
 			TopRightVertex.TextureCoordinate = FVector2D(1.0f, -XRatio);
-			TopRightVertex.TextureCoordinate4 = FVector2D(SpeedRatio * 100, -1.f);
+			TopRightVertex.Direction = -1;
 			break;
 		}
 		else
@@ -3566,15 +6272,13 @@ void endSmoothVertices(const FVector2D End
 		}
 	default:
 		TopRightVertex.TextureCoordinate = FVector2D(1.0f, XRatio);
-		TopRightVertex.TextureCoordinate4 = FVector2D(SpeedRatio * 100, 0.f);
+		TopRightVertex.Direction = 0;
 		break;
 	}
 	TopRightVertex.Position = FVector(End, Z);
 	TopRightVertex.TextureCoordinate2 = FVector2D(RightVector.X, RightVector.Y);
 	TopRightVertex.TextureCoordinate3 = FVector2D(HalfThickness, MaxThickness);
-	TopRightVertex.TextureCoordinate5 = FVector2D(RoadTypeFloat, 0.f);
-	TopRightVertex.TangentX = FVector(Tangent, 0.0f);
-	TopRightVertex.TangentZ = FVector::UpVector;
+	TopRightVertex.SetTangents(FVector(Tangent, 0.0f), FVector::UpVector);
 	TopRightVertex.Color = EndColor;
 	// TopRightVertex.Color = FColor(255, 0, 0);
 	MeshBoundingBox += TopRightVertex.Position;
@@ -3603,12 +6307,7 @@ void UStreetMapComponent::EndSmoothQuadList(const FVector2D& Mid
 	, TArray<FStreetMapVertex>* Vertices
 	, TArray<uint32>* Indices
 	, EVertexType VertexType
-	, int64 LinkId
-	, FString LinkDir
-	, FName TMC
-	, int SpeedLimit
-	, float SpeedRatio
-	, float RoadTypeFloat
+	, const FString& LinkDir
 )
 {
 	const float HalfThickness = Thickness * 0.5f;
@@ -3628,17 +6327,11 @@ void UStreetMapComponent::EndSmoothQuadList(const FVector2D& Mid
 		, XRatio
 		, StartColor
 		, EndColor
-		, MeshBuildSettings
 		, MeshBoundingBox
 		, Vertices
 		, Indices
 		, VertexType
-		, LinkId
 		, LinkDir
-		, TMC
-		, SpeedLimit
-		, SpeedRatio
-		, RoadTypeFloat
 	);
 }
 
@@ -3655,12 +6348,7 @@ void UStreetMapComponent::EndSmoothQuadList(const FVector2D& Start
 	, TArray<FStreetMapVertex>* Vertices
 	, TArray<uint32>* Indices
 	, EVertexType VertexType
-	, int64 LinkId
-	, FString LinkDir
-	, FName TMC
-	, int SpeedLimit
-	, float SpeedRatio
-	, float RoadTypeFloat
+	, const FString& LinkDir
 )
 {
 	const float HalfThickness = Thickness * 0.5f;
@@ -3684,17 +6372,11 @@ void UStreetMapComponent::EndSmoothQuadList(const FVector2D& Start
 		, XRatio
 		, StartColor
 		, EndColor
-		, MeshBuildSettings
 		, MeshBoundingBox
 		, Vertices
 		, Indices
 		, VertexType
-		, LinkId
 		, LinkDir
-		, TMC
-		, SpeedLimit
-		, SpeedRatio
-		, RoadTypeFloat
 	);
 }
 
@@ -3711,16 +6393,65 @@ void UStreetMapComponent::AddOrUpdateFlowData(FName TMC, float Speed)
 	else {
 		mFlowData[TMC] = Speed;
 	}
+
+	if (bRecordFlowHistory && FlowHistory.IsInitialized()) {
+		FlowHistory.Record(FDateTime::UtcNow(), TMC, Speed);
+	}
+
+	EnsureCongestionStats();
+	CongestionStats.SetTMCSpeed(TMC, true, Speed);
+
+	// Only once built, EnsureTraceAnalytics() copies the speeds on first use
+	if (TraceAnalytics.Num() > 0) {
+		TraceAnalytics.SetTMCSpeed(TMC, FStreetMapTraceAnalyticsPass::Flow, Speed);
+	}
+
+	if (IsReplicatingFlow()) {
+		EnsureReplicatedFlow();
+		ReplicatedFlow.SetFlow(TMC, Speed);
+	}
+
+	UpdateColorSlots(TMC);
 }
 
 void UStreetMapComponent::DeleteFlowData(FName TMC)
 {
 	mFlowData.Remove(TMC);
+
+	if (bRecordFlowHistory && FlowHistory.IsInitialized()) {
+		FlowHistory.RecordNoData(FDateTime::UtcNow(), TMC);
+	}
+
+	EnsureCongestionStats();
+	CongestionStats.SetTMCSpeed(TMC, false, 0.0f);
+
+	if (TraceAnalytics.Num() > 0) {
+		TraceAnalytics.SetTMCSpeed(TMC, FStreetMapTraceAnalyticsPass::Flow, -1.0f);
+	}
+
+	if (IsReplicatingFlow()) {
+		EnsureReplicatedFlow();
+		ReplicatedFlow.SetFlow(TMC, -1.0f);
+	}
+
+	UpdateColorSlots(TMC);
 }
 
 void UStreetMapComponent::ClearFlowData()
 {
 	mFlowData.Empty();
+	CongestionStats.ClearData();
+	TraceAnalytics.ClearHorizon(FStreetMapTraceAnalyticsPass::Flow);
+
+	if (FlowHistory.IsInitialized()) {
+		FlowHistory.RecordSnapshot(FDateTime::UtcNow(), mFlowData);
+	}
+
+	if (IsReplicatingFlow()) {
+		ReplicatedFlow.ClearFlow();
+	}
+
+	bColorSlotsStale = true;
 }
 
 void UStreetMapComponent::AddOrUpdatePredictiveData(FName TMC, float S0, float S15, float S30, float S45)
@@ -3737,16 +6468,54 @@ void UStreetMapComponent::AddOrUpdatePredictiveData(FName TMC, float S0, float S
 	else {
 		mPredictiveData[TMC] = Data;
 	}
+
+	if (TraceAnalytics.Num() > 0) {
+		TraceAnalytics.SetTMCSpeed(TMC, FStreetMapTraceAnalyticsPass::S0, S0);
+		TraceAnalytics.SetTMCSpeed(TMC, FStreetMapTraceAnalyticsPass::S15, S15);
+		TraceAnalytics.SetTMCSpeed(TMC, FStreetMapTraceAnalyticsPass::S30, S30);
+		TraceAnalytics.SetTMCSpeed(TMC, FStreetMapTraceAnalyticsPass::S45, S45);
+	}
+
+	if (IsReplicatingFlow()) {
+		EnsureReplicatedFlow();
+		ReplicatedFlow.SetPredictive(TMC, &Data);
+	}
+
+	UpdateColorSlots(TMC);
 }
 
 void UStreetMapComponent::DeletePredictiveData(FName TMC)
 {
 	mPredictiveData.Remove(TMC);
+
+	if (TraceAnalytics.Num() > 0) {
+		TraceAnalytics.SetTMCSpeed(TMC, FStreetMapTraceAnalyticsPass::S0, -1.0f);
+		TraceAnalytics.SetTMCSpeed(TMC, FStreetMapTraceAnalyticsPass::S15, -1.0f);
+		TraceAnalytics.SetTMCSpeed(TMC, FStreetMapTraceAnalyticsPass::S30, -1.0f);
+		TraceAnalytics.SetTMCSpeed(TMC, FStreetMapTraceAnalyticsPass::S45, -1.0f);
+	}
+
+	if (IsReplicatingFlow()) {
+		EnsureReplicatedFlow();
+		ReplicatedFlow.SetPredictive(TMC, nullptr);
+	}
+
+	UpdateColorSlots(TMC);
 }
 
 void UStreetMapComponent::ClearPredictiveData()
 {
 	mPredictiveData.Empty();
+	TraceAnalytics.ClearHorizon(FStreetMapTraceAnalyticsPass::S0);
+	TraceAnalytics.ClearHorizon(FStreetMapTraceAnalyticsPass::S15);
+	TraceAnalytics.ClearHorizon(FStreetMapTraceAnalyticsPass::S30);
+	TraceAnalytics.ClearHorizon(FStreetMapTraceAnalyticsPass::S45);
+
+	if (IsReplicatingFlow()) {
+		ReplicatedFlow.ClearPredictive();
+	}
+
+	bColorSlotsStale = true;
 }
 
 FGuid UStreetMapComponent::AddTrace(FStreetMapTrace Trace)
@@ -3755,35 +6524,102 @@ FGuid UStreetMapComponent::AddTrace(FStreetMapTrace Trace)
 
 	Trace.GUID = NewGuid;
 	mTraces.Add(NewGuid, Trace);
+	mHiddenTraces.Remove(NewGuid);
 
-	this->ColorRoadMesh(Trace.Color, Trace.Links, true, 1.0f);
+	StackTrace(Trace, true);
+	RecolorTraceRoads(Trace.Links, FColor::Transparent, FColor::Transparent, FColor::Transparent);
 
 	return NewGuid;
 }
 
 bool UStreetMapComponent::ShowTrace(FGuid GUID)
 {
-	if (mTraces.Contains(GUID)) {
-		auto Trace = mTraces[GUID];
+	const FStreetMapTrace* Trace = mTraces.Find(GUID);
+	if (Trace == nullptr) return false;
 
-		this->ColorRoadMesh(Trace.Color, Trace.Links, true, 1.0f);
+	mHiddenTraces.Remove(GUID);
 
-		return true;
+	// Showing a trace again puts it on top of the traces of the same priority
+	StackTrace(*Trace, true);
+	RecolorTraceRoads(Trace->Links, FColor::Transparent, FColor::Transparent, FColor::Transparent);
+
+	return true;
+}
+
+bool UStreetMapComponent::HideTrace(FGuid GUID, FColor LowFlowColor = FColor::Transparent, FColor MedFlowColor = FColor::Transparent, FColor HighFlowColor = FColor::Transparent)
+{
+	const FStreetMapTrace* Trace = mTraces.Find(GUID);
+	if (Trace == nullptr) return false;
+
+	mHiddenTraces.Add(GUID);
+
+	// Roads go back to the next trace on their stack, or to their own color
+	StackTrace(*Trace, false);
+	RecolorTraceRoads(Trace->Links, LowFlowColor, MedFlowColor, HighFlowColor);
+
+	return true;
+}
+
+bool UStreetMapComponent::SetTracePriority(FGuid GUID, int32 Priority)
+{
+	FStreetMapTrace* Trace = mTraces.Find(GUID);
+	if (Trace == nullptr) return false;
+
+	Trace->Priority = Priority;
+
+	if (!mHiddenTraces.Contains(GUID)) {
+		StackTrace(*Trace, true);
+		RecolorTraceRoads(Trace->Links, FColor::Transparent, FColor::Transparent, FColor::Transparent);
 	}
-	else {
-		return false;
+
+	return true;
+}
+
+void UStreetMapComponent::StackTrace(const FStreetMapTrace& Trace, bool bVisible)
+{
+	const uint32 Order = bVisible ? TraceStacks.NextOrder() : 0;
+	const FColor TraceColor = Trace.Color.ToFColor(false);
+
+	for (auto& Link : Trace.Links) {
+		if (const int* RoadIndex = mLink2RoadIndex.Find(Link)) {
+			if (bVisible) {
+				TraceStacks.Push(*RoadIndex, Trace.GUID, TraceColor, Trace.Priority, Order);
+			}
+			else {
+				TraceStacks.Remove(*RoadIndex, Trace.GUID);
+			}
+		}
 	}
 }
 
-bool UStreetMapComponent::HideTrace(FGuid GUID, FColor LowFlowColor = FColor::Transparent, FColor MedFlowColor = FColor::Transparent, FColor HighFlowColor = FColor::Transparent)
+void UStreetMapComponent::RebuildTraceStacks()
 {
-	const FColor StreetColor = MeshBuildSettings.StreetColor.ToFColor(false);
-	const FColor MajorRoadColor = MeshBuildSettings.MajorRoadColor.ToFColor(false);
-	const FColor HighwayColor = MeshBuildSettings.HighwayColor.ToFColor(false);
-	const float StreetOffsetZ = MeshBuildSettings.StreetOffsetZ;
-	const float MajorRoadOffsetZ = MeshBuildSettings.MajorRoadOffsetZ;
-	const float HighwayOffsetZ = MeshBuildSettings.HighwayOffsetZ;
-	const EColorMode ColorMode = MeshBuildSettings.ColorMode;
+	TraceStacks.Reset();
+
+	// Show order isn't kept, traces of equal priority stack in map order
+	for (const auto& Elem : mTraces)
+	{
+		if (!mHiddenTraces.Contains(Elem.Key)) {
+			StackTrace(Elem.Value, true);
+		}
+	}
+}
+
+void UStreetMapComponent::RecolorTraceRoads(const TArray<FStreetMapLink>& Links, FColor LowFlowColor, FColor MedFlowColor, FColor HighFlowColor)
+{
+	if (StreetMap == nullptr) return;
+
+	if (MeshBuildSettings.bUseRoadAttributes) {
+		for (auto& Link : Links) {
+			if (const int* RoadIndex = mLink2RoadIndex.Find(Link)) {
+				const FStreetMapTraceStacks::FEntry* Top = TraceStacks.GetTop(*RoadIndex);
+				RoadAttributes.SetTrace(*RoadIndex, Top != nullptr, Top ? Top->Color : FColor::Transparent);
+			}
+		}
+
+		FlushRoadAttributes();
+		return;
+	}
 
 	if (LowFlowColor == FColor::Transparent) {
 		LowFlowColor = MeshBuildSettings.LowFlowColor.ToFColor(false);
@@ -3795,24 +6631,98 @@ bool UStreetMapComponent::HideTrace(FGuid GUID, FColor LowFlowColor = FColor::Tr
 		HighFlowColor = MeshBuildSettings.HighFlowColor.ToFColor(false);
 	}
 
-	if (!mTraces.Contains(GUID)) return false;
+	const auto& Roads = StreetMap->GetRoads();
+	const int32 Slot = FStreetMapColorSlots::GetSlot(MeshBuildSettings.ColorMode);
+	if (Slot != INDEX_NONE) {
+		EnsureColorSlots();
+	}
 
-	auto Trace = mTraces[GUID];
+	// Trace vertices are raised above the roads, which needs a new proxy instead of a color upload
+	bool bRaisedTraces = false;
 
-	switch (ColorMode) {
-	case EColorMode::Flow:
-	case EColorMode::Predictive0:
-	case EColorMode::Predictive15:
-	case EColorMode::Predictive30:
-	case EColorMode::Predictive45:
-		this->ColorRoadMeshFromData(Trace.Links, HighwayColor, LowFlowColor, MedFlowColor, HighFlowColor, true);
-		break;
-	default:
-		this->ColorRoadMesh(HighwayColor, Trace.Links);
-		break;
+	for (auto& Link : Links) {
+		const int* RoadIndex = mLink2RoadIndex.Find(Link);
+		if (RoadIndex == nullptr) continue;
+
+		const FStreetMapRoad& Road = Roads[*RoadIndex];
+		const FStreetMapTraceStacks::FEntry* Top = TraceStacks.GetTop(*RoadIndex);
+
+		FColor RoadColor;
+		TMap<FStreetMapLink, TArray<int>>* LinkMap;
+		TArray<FStreetMapVertex>* Vertices;
+
+		switch (Road.RoadType) {
+		case EStreetMapRoadType::Highway:
+			LinkMap = &mHighwayLink2Vertices;
+			Vertices = &HighwayVertices;
+			RoadColor = MeshBuildSettings.HighwayColor.ToFColor(false);
+			break;
+		case EStreetMapRoadType::MajorRoad:
+			LinkMap = &mMajorLink2Vertices;
+			Vertices = &MajorRoadVertices;
+			RoadColor = MeshBuildSettings.MajorRoadColor.ToFColor(false);
+			break;
+		default:
+			LinkMap = &mStreetLink2Vertices;
+			Vertices = &StreetVertices;
+			RoadColor = MeshBuildSettings.StreetColor.ToFColor(false);
+			break;
+		}
+
+		if (Top != nullptr) {
+			RoadColor = Top->Color;
+		}
+		else if (Slot != INDEX_NONE) {
+			const float SpeedRatio = ColorSlots.GetSpeedRatio(*RoadIndex, Slot);
+			RoadColor = GetSlotFlowColor(SpeedRatio, LowFlowColor, MedFlowColor, HighFlowColor);
+		}
+
+		// Segments aren't raised, the trace only shows in their color
+		if (MeshBuildSettings.bDrawRoadsAsSegments) {
+			SetRoadSegmentColor(*RoadIndex, RoadColor, Top != nullptr);
+			continue;
+		}
+
+		const TArray<int>* LinkVertices = LinkMap->Find(Link);
+		if (LinkVertices == nullptr) continue;
+
+		for (int VertexIndex : *LinkVertices) {
+			FStreetMapVertex& Vertex = (*Vertices)[VertexIndex];
+			Vertex.Color = RoadColor;
+			Vertex.IsTrace = Top != nullptr;
+			if (Top != nullptr && Vertex.Position.Z != 1.0f) {
+				Vertex.Position.Z = 1.0f;
+				bRaisedTraces = true;
+			}
+		}
+
+		MarkRoadColorDirty(*RoadIndex);
 	}
 
-	return true;
+	if (bRaisedTraces) {
+		InvalidateRenderData();
+	}
+	else {
+		FlushColorUpdates();
+	}
+}
+
+TArray<FStreetMapTraceAnalytics> UStreetMapComponent::ComputeTraceAnalytics()
+{
+	TArray<FStreetMapTraceAnalytics> Rows;
+	if (StreetMap == nullptr) return Rows;
+
+	EnsureTraceAnalytics();
+
+	TArray<const FStreetMapTrace*> Traces;
+	Traces.Reserve(mTraces.Num());
+	for (const auto& Elem : mTraces)
+	{
+		Traces.Add(&Elem.Value);
+	}
+
+	TraceAnalytics.Run(Traces, mLink2RoadIndex, Rows);
+	return Rows;
 }
 
 bool UStreetMapComponent::GetTraceDetails(TArray<FStreetMapLink> Links, float& OutAvgSpeed, float& OutDistance, float& OutTravelTime, float& OutIdealTravelTime)
@@ -3860,42 +6770,13 @@ bool UStreetMapComponent::GetTraceDetails(TArray<FStreetMapLink> Links, float& O
 
 bool UStreetMapComponent::DeleteTrace(FGuid GUID, FColor LowFlowColor = FColor::Transparent, FColor MedFlowColor = FColor::Transparent, FColor HighFlowColor = FColor::Transparent)
 {
-	const FColor StreetColor = MeshBuildSettings.StreetColor.ToFColor(false);
-	const FColor MajorRoadColor = MeshBuildSettings.MajorRoadColor.ToFColor(false);
-	const FColor HighwayColor = MeshBuildSettings.HighwayColor.ToFColor(false);
-	const float StreetOffsetZ = MeshBuildSettings.StreetOffsetZ;
-	const float MajorRoadOffsetZ = MeshBuildSettings.MajorRoadOffsetZ;
-	const float HighwayOffsetZ = MeshBuildSettings.HighwayOffsetZ;
-	const EColorMode ColorMode = MeshBuildSettings.ColorMode;
-
-	if (LowFlowColor == FColor::Transparent) {
-		LowFlowColor = MeshBuildSettings.LowFlowColor.ToFColor(false);
-	}
-	if (MedFlowColor == FColor::Transparent) {
-		MedFlowColor = MeshBuildSettings.MedFlowColor.ToFColor(false);
-	}
-	if (HighFlowColor == FColor::Transparent) {
-		HighFlowColor = MeshBuildSettings.HighFlowColor.ToFColor(false);
-	}
-
-	if (!mTraces.Contains(GUID)) return false;
+	FStreetMapTrace Trace;
+	if (!mTraces.RemoveAndCopyValue(GUID, Trace)) return false;
 
-	auto Trace = mTraces[GUID];
-
-	switch (ColorMode) {
-	case EColorMode::Flow:
-	case EColorMode::Predictive0:
-	case EColorMode::Predictive15:
-	case EColorMode::Predictive30:
-	case EColorMode::Predictive45:
-		this->ColorRoadMeshFromData(Trace.Links, HighwayColor, LowFlowColor, MedFlowColor, HighFlowColor, true);
-		break;
-	default:
-		this->ColorRoadMesh(HighwayColor, Trace.Links);
-		break;
-	}
+	mHiddenTraces.Remove(GUID);
 
-	mTraces.Remove(GUID);
+	StackTrace(Trace, false);
+	RecolorTraceRoads(Trace.Links, LowFlowColor, MedFlowColor, HighFlowColor);
 
 	return true;
 }
@@ -3919,6 +6800,7 @@ bool UStreetMapComponent::GetSpeed(FStreetMapLink Link, float& OutSpeed, float&
 		case EColorMode::Predictive15:
 		case EColorMode::Predictive30:
 		case EColorMode::Predictive45:
+		case EColorMode::PredictiveTime:
 			bFound = GetSpeedAndColorFromData(&Road, OutSpeed, OutSpeedLimit, OutSpeedRatio, Color);
 			break;
 		}
@@ -3950,6 +6832,14 @@ EColorMode UStreetMapComponent::GetColorMode() {
 
 void UStreetMapComponent::SetColorMode(EColorMode colorMode) {
 	MeshBuildSettings.ColorMode = colorMode;
+
+	if (MeshBuildSettings.bUseRoadAttributes) {
+		// Every slot is in the attribute texture already, the material only needs to know which one to use
+		ApplyRoadAttributeMaterialParameters();
+	}
+	else {
+		ApplyColorSlot();
+	}
 }
 
 TArray<FStreetMapRoad> UStreetMapComponent::GetRoads(const TArray<FStreetMapLink>& Links)
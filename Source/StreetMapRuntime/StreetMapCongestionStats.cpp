@@ -0,0 +1,303 @@
+// Copyright 2017 Mike Fricker. All Rights Reserved.
+
+#include "StreetMapCongestionStats.h"
+#include "StreetMapRuntime.h"
+
+
+FStreetMapCongestionStats::FStreetMapCongestionStats()
+	: CongestedSpeedRatio(0.5f)
+{
+}
+
+void FStreetMapCongestionStats::Init(const TArray<FStreetMapRoad>& Roads, float InCongestedSpeedRatio)
+{
+	CongestedSpeedRatio = InCongestedSpeedRatio;
+
+	for (FRoadTypeSums& TypeSums : Sums)
+	{
+		TypeSums = FRoadTypeSums();
+	}
+
+	RoadLengths.Reset(Roads.Num());
+	RoadSpeedLimits.Reset(Roads.Num());
+	RoadTypes.Reset(Roads.Num());
+	RoadTMCOrdinals.Reset(Roads.Num());
+	RoadSpeedRatios.Init(1.0f, Roads.Num());
+	RoadHasData.Init(false, Roads.Num());
+
+	TMCs.Reset();
+	TMCFirstRoads.Reset();
+	TMCSpeedRatios.Reset();
+	TMCHeapIndices.Reset();
+	Heap.Reset();
+
+	Ordinals.Reset();
+	for (int32 RoadIndex = 0; RoadIndex < Roads.Num(); ++RoadIndex)
+	{
+		const FStreetMapRoad& Road = Roads[RoadIndex];
+
+		// Road points are in world units, centimeters
+		float Length = 0.0f;
+		for (int32 PointIndex = 1; PointIndex < Road.RoadPoints.Num(); ++PointIndex)
+		{
+			Length += FVector2D::Distance(Road.RoadPoints[PointIndex - 1], Road.RoadPoints[PointIndex]);
+		}
+		Length /= 100000.0f;
+
+		const uint8 RoadType = (uint8)FMath::Clamp((int32)Road.RoadType, 0, NumRoadTypes - 1);
+		RoadLengths.Add(Length);
+		RoadSpeedLimits.Add((float)Road.SpeedLimit);
+		RoadTypes.Add(RoadType);
+		Sums[RoadType].TotalLength += Length;
+
+		int32 Ordinal = INDEX_NONE;
+		if (!Road.TMC.IsNone())
+		{
+			if (const int32* Existing = Ordinals.Find(Road.TMC))
+			{
+				Ordinal = *Existing;
+			}
+			else
+			{
+				Ordinal = TMCs.Add(Road.TMC);
+				Ordinals.Add(Road.TMC, Ordinal);
+				TMCFirstRoads.Add(RoadIndex);
+				TMCSpeedRatios.Add(1.0f);
+				TMCHeapIndices.Add(INDEX_NONE);
+			}
+		}
+		RoadTMCOrdinals.Add(Ordinal);
+	}
+
+	// Roads grouped by TMC, counted first then placed
+	TMCFirstRoadEntries.Init(0, TMCs.Num() + 1);
+	for (int32 Ordinal : RoadTMCOrdinals)
+	{
+		if (Ordinal != INDEX_NONE) TMCFirstRoadEntries[Ordinal + 1]++;
+	}
+	for (int32 Ordinal = 0; Ordinal < TMCs.Num(); ++Ordinal)
+	{
+		TMCFirstRoadEntries[Ordinal + 1] += TMCFirstRoadEntries[Ordinal];
+	}
+
+	TArray<int32> NextEntries(TMCFirstRoadEntries.GetData(), TMCs.Num());
+	TMCRoads.SetNumUninitialized(TMCFirstRoadEntries.Last());
+	for (int32 RoadIndex = 0; RoadIndex < RoadTMCOrdinals.Num(); ++RoadIndex)
+	{
+		const int32 Ordinal = RoadTMCOrdinals[RoadIndex];
+		if (Ordinal != INDEX_NONE) TMCRoads[NextEntries[Ordinal]++] = RoadIndex;
+	}
+}
+
+void FStreetMapCongestionStats::Reset()
+{
+	for (FRoadTypeSums& TypeSums : Sums)
+	{
+		TypeSums = FRoadTypeSums();
+	}
+
+	RoadLengths.Empty();
+	RoadSpeedLimits.Empty();
+	RoadTypes.Empty();
+	RoadTMCOrdinals.Empty();
+	RoadSpeedRatios.Empty();
+	RoadHasData.Empty();
+	Ordinals.Empty();
+	TMCs.Empty();
+	TMCFirstRoads.Empty();
+	TMCSpeedRatios.Empty();
+	TMCHeapIndices.Empty();
+	TMCFirstRoadEntries.Empty();
+	TMCRoads.Empty();
+	Heap.Empty();
+}
+
+void FStreetMapCongestionStats::SetTMCSpeed(FName TMC, bool bHasData, float Speed)
+{
+	const int32* Ordinal = Ordinals.Find(TMC);
+	if (Ordinal == nullptr) return;
+
+	for (int32 Entry = TMCFirstRoadEntries[*Ordinal]; Entry < TMCFirstRoadEntries[*Ordinal + 1]; ++Entry)
+	{
+		const int32 RoadIndex = TMCRoads[Entry];
+		const float SpeedLimit = RoadSpeedLimits[RoadIndex];
+		SetRoadSpeedRatio(RoadIndex, bHasData, SpeedLimit > 0.0f ? FMath::Min(Speed / SpeedLimit, 1.0f) : 1.0f);
+	}
+}
+
+void FStreetMapCongestionStats::ClearData()
+{
+	for (int32 RoadIndex = 0; RoadIndex < RoadLengths.Num(); ++RoadIndex)
+	{
+		if (RoadHasData[RoadIndex])
+		{
+			SetRoadSpeedRatio(RoadIndex, false, 1.0f);
+		}
+	}
+}
+
+void FStreetMapCongestionStats::SetRoadSpeedRatio(int32 RoadIndex, bool bHasData, float SpeedRatio)
+{
+	if (RoadIndex < 0 || RoadIndex >= RoadLengths.Num()) return;
+
+	FRoadTypeSums& TypeSums = Sums[RoadTypes[RoadIndex]];
+	const float Length = RoadLengths[RoadIndex];
+
+	// Take out the previous contribution
+	if (RoadHasData[RoadIndex])
+	{
+		const float OldSpeedRatio = RoadSpeedRatios[RoadIndex];
+		TypeSums.SpeedRatioLength -= OldSpeedRatio * Length;
+		TypeSums.LengthWithData -= Length;
+		TypeSums.NumRoadsWithData--;
+		if (OldSpeedRatio <= CongestedSpeedRatio)
+		{
+			TypeSums.CongestedLength -= Length;
+		}
+	}
+
+	RoadHasData[RoadIndex] = bHasData;
+	RoadSpeedRatios[RoadIndex] = bHasData ? SpeedRatio : 1.0f;
+
+	if (bHasData)
+	{
+		TypeSums.SpeedRatioLength += SpeedRatio * Length;
+		TypeSums.LengthWithData += Length;
+		TypeSums.NumRoadsWithData++;
+		if (SpeedRatio <= CongestedSpeedRatio)
+		{
+			TypeSums.CongestedLength += Length;
+		}
+	}
+
+	const int32 Ordinal = RoadTMCOrdinals[RoadIndex];
+	if (Ordinal != INDEX_NONE && TMCFirstRoads[Ordinal] == RoadIndex)
+	{
+		SetTMCSpeedRatio(Ordinal, bHasData, SpeedRatio);
+	}
+}
+
+FStreetMapRoadTypeCongestion FStreetMapCongestionStats::GetRoadTypeCongestion(EStreetMapRoadType RoadType) const
+{
+	FStreetMapRoadTypeCongestion Result;
+
+	const int32 TypeIndex = (int32)RoadType;
+	if (TypeIndex < 0 || TypeIndex >= NumRoadTypes) return Result;
+
+	// Running sums drift by rounding errors, clamp them to sensible values
+	const FRoadTypeSums& TypeSums = Sums[TypeIndex];
+	Result.NumRoadsWithData = TypeSums.NumRoadsWithData;
+	Result.TotalKm = (float)TypeSums.TotalLength;
+	Result.KmWithData = (float)FMath::Max(0.0, TypeSums.LengthWithData);
+	Result.CongestedKm = (float)FMath::Max(0.0, TypeSums.CongestedLength);
+	Result.AverageSpeedRatio = TypeSums.NumRoadsWithData > 0 && TypeSums.LengthWithData > KINDA_SMALL_NUMBER ?
+		FMath::Clamp((float)(TypeSums.SpeedRatioLength / TypeSums.LengthWithData), 0.0f, 1.0f) : 1.0f;
+
+	return Result;
+}
+
+void FStreetMapCongestionStats::GetWorstTMCs(int32 Count, TArray<FStreetMapTMCCongestion>& OutWorst) const
+{
+	OutWorst.Reset();
+
+	Count = FMath::Min(Count, Heap.Num());
+	if (Count <= 0) return;
+
+	// Best-first walk of the heap: the next worst TMC is always the root or a child of one already taken
+	auto IsWorseEntry = [this](int32 HeapIndexA, int32 HeapIndexB) {
+		return IsWorse(Heap[HeapIndexA], Heap[HeapIndexB]);
+	};
+
+	TArray<int32, TInlineAllocator<64>> Frontier;
+	Frontier.HeapPush(0, IsWorseEntry);
+
+	while (OutWorst.Num() < Count && Frontier.Num() > 0)
+	{
+		int32 HeapIndex;
+		Frontier.HeapPop(HeapIndex, IsWorseEntry, false);
+
+		const int32 Ordinal = Heap[HeapIndex];
+		FStreetMapTMCCongestion& Worst = OutWorst.AddDefaulted_GetRef();
+		Worst.TMC = TMCs[Ordinal];
+		Worst.SpeedRatio = TMCSpeedRatios[Ordinal];
+
+		const int32 FirstChild = HeapIndex * 2 + 1;
+		if (FirstChild < Heap.Num()) Frontier.HeapPush(FirstChild, IsWorseEntry);
+		if (FirstChild + 1 < Heap.Num()) Frontier.HeapPush(FirstChild + 1, IsWorseEntry);
+	}
+}
+
+void FStreetMapCongestionStats::SetTMCSpeedRatio(int32 Ordinal, bool bHasData, float SpeedRatio)
+{
+	int32 HeapIndex = TMCHeapIndices[Ordinal];
+
+	if (!bHasData)
+	{
+		if (HeapIndex == INDEX_NONE) return;
+
+		// Replace with the last entry and restore the heap order around it
+		const int32 LastIndex = Heap.Num() - 1;
+		SwapHeapEntries(HeapIndex, LastIndex);
+		Heap.Pop(false);
+		TMCHeapIndices[Ordinal] = INDEX_NONE;
+		TMCSpeedRatios[Ordinal] = 1.0f;
+
+		if (HeapIndex < Heap.Num())
+		{
+			const int32 MovedOrdinal = Heap[HeapIndex];
+			SiftUp(HeapIndex);
+			SiftDown(TMCHeapIndices[MovedOrdinal]);
+		}
+		return;
+	}
+
+	TMCSpeedRatios[Ordinal] = SpeedRatio;
+
+	if (HeapIndex == INDEX_NONE)
+	{
+		HeapIndex = Heap.Add(Ordinal);
+		TMCHeapIndices[Ordinal] = HeapIndex;
+	}
+
+	SiftUp(HeapIndex);
+	SiftDown(TMCHeapIndices[Ordinal]);
+}
+
+void FStreetMapCongestionStats::SiftUp(int32 HeapIndex)
+{
+	while (HeapIndex > 0)
+	{
+		const int32 ParentIndex = (HeapIndex - 1) / 2;
+		if (!IsWorse(Heap[HeapIndex], Heap[ParentIndex])) break;
+
+		SwapHeapEntries(HeapIndex, ParentIndex);
+		HeapIndex = ParentIndex;
+	}
+}
+
+void FStreetMapCongestionStats::SiftDown(int32 HeapIndex)
+{
+	for (;;)
+	{
+		const int32 FirstChild = HeapIndex * 2 + 1;
+		if (FirstChild >= Heap.Num()) break;
+
+		int32 WorstChild = FirstChild;
+		if (FirstChild + 1 < Heap.Num() && IsWorse(Heap[FirstChild + 1], Heap[FirstChild]))
+		{
+			WorstChild = FirstChild + 1;
+		}
+
+		if (!IsWorse(Heap[WorstChild], Heap[HeapIndex])) break;
+
+		SwapHeapEntries(HeapIndex, WorstChild);
+		HeapIndex = WorstChild;
+	}
+}
+
+void FStreetMapCongestionStats::SwapHeapEntries(int32 HeapIndexA, int32 HeapIndexB)
+{
+	Heap.Swap(HeapIndexA, HeapIndexB);
+	TMCHeapIndices[Heap[HeapIndexA]] = HeapIndexA;
+	TMCHeapIndices[Heap[HeapIndexB]] = HeapIndexB;
+}
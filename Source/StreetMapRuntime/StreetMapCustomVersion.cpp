@@ -0,0 +1,11 @@
+// Copyright 2017 Mike Fricker. All Rights Reserved.
+
+#include "StreetMapCustomVersion.h"
+#include "StreetMapRuntime.h"
+#include "Serialization/CustomVersion.h"
+
+
+const FGuid FStreetMapCustomVersion::GUID(0x6A1E2F0B, 0x3C5D4B27, 0x9E81A4D2, 0x57C3B906);
+
+// Register the custom version with core
+FCustomVersionRegistration GRegisterStreetMapCustomVersion(FStreetMapCustomVersion::GUID, FStreetMapCustomVersion::LatestVersion, TEXT("StreetMapVer"));
@@ -0,0 +1,36 @@
+// Copyright 2017 Mike Fricker. All Rights Reserved.
+#pragma once
+
+#include "CoreMinimal.h"
+
+/** Versions of the street map data saved with levels */
+struct FStreetMapCustomVersion
+{
+	enum Type
+	{
+		// Cached mesh saved as tagged vertex and index array properties
+		BeforeCustomVersionWasAdded = 0,
+
+		// Cached mesh saved as one optionally compressed block after the tagged properties
+		BulkCachedMesh,
+
+		// Spatial chunks of the cached mesh saved after the road vertex ranges
+		SpatialMeshChunks,
+
+		// Level of detail saved with every mesh chunk
+		RoadLODs,
+
+		// Tangents packed and per-road texture coordinates saved once per road instead of with every vertex
+		PackedVertices,
+
+		// -----<new versions can be added above this line>-------------------------------------------------
+		VersionPlusOne,
+		LatestVersion = VersionPlusOne - 1
+	};
+
+	// The GUID for this custom version number
+	const static FGuid GUID;
+
+private:
+	FStreetMapCustomVersion() {}
+};
@@ -0,0 +1,701 @@
+// Copyright 2017 Mike Fricker. All Rights Reserved.
+
+#include "StreetMapFlowFeed.h"
+#include "StreetMapRuntime.h"
+#include "HAL/RunnableThread.h"
+#include "HAL/PlatformFilemanager.h"
+#include "GenericPlatform/GenericPlatformFile.h"
+#include "Sockets.h"
+#include "SocketSubsystem.h"
+#include "IPAddress.h"
+#include "Dom/JsonObject.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonSerializer.h"
+
+#if PLATFORM_WINDOWS
+#include "Windows/AllowWindowsPlatformTypes.h"
+#include "Windows/WindowsHWrapper.h"
+#include "Windows/HideWindowsPlatformTypes.h"
+#elif PLATFORM_UNIX || PLATFORM_MAC
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#endif
+
+
+namespace StreetMapFlowFeed
+{
+	/** Longest TMC accepted, anything longer is treated as a corrupt record */
+	static const int32 MaxTMCLength = 32;
+
+	/** Longest NDJSON line accepted */
+	static const int32 MaxLineLength = 4096;
+
+	/** Bytes read from the source at once */
+	static const int32 ChunkSize = 64 * 1024;
+
+	static bool IsValidTMC(const uint8* Chars, int32 Length)
+	{
+		if (Length <= 0 || Length > MaxTMCLength) return false;
+
+		for (int32 Index = 0; Index < Length; ++Index)
+		{
+			// Printable ASCII without spaces
+			if (Chars[Index] <= 0x20 || Chars[Index] >= 0x7F) return false;
+		}
+		return true;
+	}
+
+	static bool IsValidTMC(const FString& TMC)
+	{
+		if (TMC.Len() == 0 || TMC.Len() > MaxTMCLength) return false;
+
+		for (const TCHAR Char : TMC)
+		{
+			if (Char <= 0x20 || Char >= 0x7F) return false;
+		}
+		return true;
+	}
+
+	static bool IsValidSpeed(float Speed, float MaxSpeed)
+	{
+		return FMath::IsFinite(Speed) && Speed >= 0.0f && Speed <= MaxSpeed;
+	}
+}
+
+
+/** Reads what gets appended to a file */
+class FStreetMapFileTailSource : public IStreetMapFeedSource
+{
+public:
+	FStreetMapFileTailSource(const FString& InPath, bool bInTailFromEnd)
+		: Path(InPath),
+		bTailFromEnd(bInTailFromEnd),
+		Handle(nullptr),
+		Position(0)
+	{
+	}
+
+	virtual ~FStreetMapFileTailSource()
+	{
+		Close();
+	}
+
+	virtual bool Open() override
+	{
+		Handle = FPlatformFileManager::Get().GetPlatformFile().OpenRead(*Path, true);
+		if (Handle == nullptr) return false;
+
+		Position = bTailFromEnd ? Handle->Size() : 0;
+		return true;
+	}
+
+	virtual int32 Read(uint8* Buffer, int32 BufferSize) override
+	{
+		const int64 Size = Handle->Size();
+		if (Size < 0) return INDEX_NONE;
+
+		// Truncated or rotated, start over
+		if (Size < Position)
+		{
+			Position = 0;
+		}
+
+		const int32 NumBytes = (int32)FMath::Min<int64>(Size - Position, BufferSize);
+		if (NumBytes <= 0) return 0;
+
+		if (!Handle->Seek(Position) || !Handle->Read(Buffer, NumBytes)) return INDEX_NONE;
+
+		Position += NumBytes;
+		return NumBytes;
+	}
+
+	virtual void Close() override
+	{
+		delete Handle;
+		Handle = nullptr;
+	}
+
+private:
+	FString Path;
+	bool bTailFromEnd;
+	IFileHandle* Handle;
+	int64 Position;
+};
+
+
+/** Reads a named pipe on Windows or a FIFO elsewhere, without ever blocking so the worker can always be stopped */
+class FStreetMapNamedPipeSource : public IStreetMapFeedSource
+{
+public:
+	FStreetMapNamedPipeSource(const FString& InPath)
+		: Path(InPath)
+#if PLATFORM_WINDOWS
+		, Handle(INVALID_HANDLE_VALUE)
+#elif PLATFORM_UNIX || PLATFORM_MAC
+		, FileDescriptor(-1)
+#endif
+	{
+	}
+
+	virtual ~FStreetMapNamedPipeSource()
+	{
+		Close();
+	}
+
+	virtual bool Open() override
+	{
+#if PLATFORM_WINDOWS
+		Handle = CreateFileW(*Path, GENERIC_READ, 0, nullptr, OPEN_EXISTING, 0, nullptr);
+		return Handle != INVALID_HANDLE_VALUE;
+#elif PLATFORM_UNIX || PLATFORM_MAC
+		FileDescriptor = open(TCHAR_TO_UTF8(*Path), O_RDONLY | O_NONBLOCK);
+		return FileDescriptor >= 0;
+#else
+		UE_LOG(LogStreetMap, Warning, TEXT("Named pipe flow feeds are not supported on this platform"));
+		return false;
+#endif
+	}
+
+	virtual int32 Read(uint8* Buffer, int32 BufferSize) override
+	{
+#if PLATFORM_WINDOWS
+		DWORD NumAvailable = 0;
+		if (!PeekNamedPipe(Handle, nullptr, 0, nullptr, &NumAvailable, nullptr)) return INDEX_NONE;
+		if (NumAvailable == 0) return 0;
+
+		DWORD NumRead = 0;
+		if (!ReadFile(Handle, Buffer, FMath::Min<DWORD>(NumAvailable, BufferSize), &NumRead, nullptr)) return INDEX_NONE;
+		return (int32)NumRead;
+#elif PLATFORM_UNIX || PLATFORM_MAC
+		const ssize_t NumRead = read(FileDescriptor, Buffer, BufferSize);
+		if (NumRead < 0)
+		{
+			return (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) ? 0 : INDEX_NONE;
+		}
+		// 0 means no writer right now, one can still connect later
+		return (int32)NumRead;
+#else
+		return INDEX_NONE;
+#endif
+	}
+
+	virtual void Close() override
+	{
+#if PLATFORM_WINDOWS
+		if (Handle != INVALID_HANDLE_VALUE)
+		{
+			CloseHandle(Handle);
+			Handle = INVALID_HANDLE_VALUE;
+		}
+#elif PLATFORM_UNIX || PLATFORM_MAC
+		if (FileDescriptor >= 0)
+		{
+			close(FileDescriptor);
+			FileDescriptor = -1;
+		}
+#endif
+	}
+
+private:
+	FString Path;
+#if PLATFORM_WINDOWS
+	HANDLE Handle;
+#elif PLATFORM_UNIX || PLATFORM_MAC
+	int FileDescriptor;
+#endif
+};
+
+
+/** Reads a TCP connection to a feed server on localhost */
+class FStreetMapSocketSource : public IStreetMapFeedSource
+{
+public:
+	FStreetMapSocketSource(int32 InPort)
+		: Port(InPort),
+		Socket(nullptr)
+	{
+	}
+
+	virtual ~FStreetMapSocketSource()
+	{
+		Close();
+	}
+
+	virtual bool Open() override
+	{
+		ISocketSubsystem* SocketSubsystem = ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM);
+		if (SocketSubsystem == nullptr) return false;
+
+		TSharedRef<FInternetAddr> Address = SocketSubsystem->CreateInternetAddr();
+		Address->SetLoopbackAddress();
+		Address->SetPort(Port);
+
+		Socket = SocketSubsystem->CreateSocket(NAME_Stream, TEXT("StreetMap flow feed"), false);
+		if (Socket == nullptr) return false;
+
+		if (!Socket->Connect(*Address))
+		{
+			Close();
+			return false;
+		}
+		return true;
+	}
+
+	virtual int32 Read(uint8* Buffer, int32 BufferSize) override
+	{
+		// Waiting here also paces the worker while the feed is idle
+		if (!Socket->Wait(ESocketWaitConditions::WaitForRead, FTimespan::FromMilliseconds(10))) return 0;
+
+		int32 NumRead = 0;
+		if (!Socket->Recv(Buffer, BufferSize, NumRead)) return INDEX_NONE;
+
+		// Readable with nothing to read means the server closed the connection
+		return NumRead > 0 ? NumRead : INDEX_NONE;
+	}
+
+	virtual void Close() override
+	{
+		if (Socket != nullptr)
+		{
+			Socket->Close();
+			ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->DestroySocket(Socket);
+			Socket = nullptr;
+		}
+	}
+
+private:
+	int32 Port;
+	FSocket* Socket;
+};
+
+
+FStreetMapFlowFeed::FStreetMapFlowFeed(const FStreetMapFlowFeedSettings& InSettings)
+	: Settings(InSettings),
+	Thread(nullptr),
+	PublishedBatch(nullptr)
+{
+	switch (Settings.Source) {
+	case EStreetMapFeedSource::FileTail:
+		Source = MakeUnique<FStreetMapFileTailSource>(Settings.Path, Settings.bTailFromEnd);
+		break;
+	case EStreetMapFeedSource::NamedPipe:
+		Source = MakeUnique<FStreetMapNamedPipeSource>(Settings.Path);
+		break;
+	default:
+		Source = MakeUnique<FStreetMapSocketSource>(Settings.Port);
+		break;
+	}
+
+	FreeBatches.Push(&Batches[0]);
+	FreeBatches.Push(&Batches[1]);
+}
+
+FStreetMapFlowFeed::~FStreetMapFlowFeed()
+{
+	Shutdown();
+}
+
+bool FStreetMapFlowFeed::Start()
+{
+	if (Thread != nullptr) return true;
+
+	bStopping = false;
+	Thread = FRunnableThread::Create(this, TEXT("StreetMapFlowFeed"), 0, TPri_BelowNormal);
+	return Thread != nullptr;
+}
+
+void FStreetMapFlowFeed::Shutdown()
+{
+	if (Thread != nullptr)
+	{
+		Thread->Kill(true);
+		delete Thread;
+		Thread = nullptr;
+	}
+}
+
+void FStreetMapFlowFeed::Stop()
+{
+	bStopping = true;
+}
+
+uint32 FStreetMapFlowFeed::Run()
+{
+	TArray<uint8> Chunk;
+	Chunk.SetNumUninitialized(StreetMapFlowFeed::ChunkSize);
+
+	bool bOpen = false;
+	while (!bStopping)
+	{
+		if (!bOpen)
+		{
+			// The feed may not be up yet, or it went away: keep trying until stopped
+			bOpen = Source->Open();
+			if (!bOpen)
+			{
+				Source->Close();
+				FPlatformProcess::Sleep(0.5f);
+				continue;
+			}
+			ReadBuffer.Reset();
+		}
+
+		const int32 NumRead = Source->Read(Chunk.GetData(), Chunk.Num());
+		if (NumRead == INDEX_NONE)
+		{
+			Source->Close();
+			bOpen = false;
+			continue;
+		}
+
+		if (NumRead > 0)
+		{
+			NumBytesRead.Add(NumRead);
+			ReadBuffer.Append(Chunk.GetData(), NumRead);
+
+			int64 BatchRejected = 0;
+			const int32 NumRecordsBefore = Pending.Num();
+			const int32 NumConsumed = Decode(Settings, ReadBuffer.GetData(), ReadBuffer.Num(), Pending, BatchRejected);
+			ReadBuffer.RemoveAt(0, NumConsumed, false);
+
+			NumRecords.Add(Pending.Num() - NumRecordsBefore);
+			NumRejected.Add(BatchRejected);
+		}
+
+		if (Pending.Num() > 0)
+		{
+			Publish();
+		}
+
+		if (NumRead == 0 && Settings.Source != EStreetMapFeedSource::LocalSocket)
+		{
+			FPlatformProcess::Sleep(0.005f);
+		}
+	}
+
+	Source->Close();
+	return 0;
+}
+
+void FStreetMapFlowFeed::Publish()
+{
+	// Take back the batch the game thread hasn't consumed yet and add to it, otherwise fill a free one
+	FBatch* Batch = PublishedBatch.Exchange(nullptr);
+	if (Batch == nullptr)
+	{
+		Batch = FreeBatches.Pop();
+		if (Batch == nullptr)
+		{
+			// The game thread still holds both buffers, keep the records for the next attempt
+			return;
+		}
+	}
+
+	Batch->Updates.Append(Pending);
+	Pending.Reset();
+
+	PublishedBatch.Store(Batch);
+	NumBatches.Increment();
+}
+
+bool FStreetMapFlowFeed::ConsumeBatch(TArray<FStreetMapFlowUpdate>& OutUpdates)
+{
+	OutUpdates.Reset();
+
+	FBatch* Batch = PublishedBatch.Exchange(nullptr);
+	if (Batch == nullptr) return false;
+
+	// Swapping keeps both arrays allocated, so steady state ingestion doesn't allocate
+	Swap(OutUpdates, Batch->Updates);
+	FreeBatches.Push(Batch);
+	return true;
+}
+
+int32 FStreetMapFlowFeed::Decode(const FStreetMapFlowFeedSettings& Settings, const uint8* Data, int32 NumBytes, TArray<FStreetMapFlowUpdate>& OutUpdates, int64& OutNumRejected)
+{
+	using namespace StreetMapFlowFeed;
+
+	const double DecodeTime = FPlatformTime::Seconds();
+	int32 Offset = 0;
+
+	if (Settings.Format == EStreetMapFeedFormat::Binary)
+	{
+		while (Offset < NumBytes)
+		{
+			const int32 Length = Data[Offset];
+			if (Length == 0 || Length > MaxTMCLength)
+			{
+				// Not the start of a record, skip a byte to resynchronize
+				++OutNumRejected;
+				++Offset;
+				continue;
+			}
+
+			const int32 RecordSize = 1 + Length + sizeof(float);
+			if (Offset + RecordSize > NumBytes) break;
+
+			const uint8* Chars = Data + Offset + 1;
+			float Speed;
+			FMemory::Memcpy(&Speed, Chars + Length, sizeof(float));
+
+			if (IsValidTMC(Chars, Length) && IsValidSpeed(Speed, Settings.MaxSpeed))
+			{
+				const FString TMC(Length, (const ANSICHAR*)Chars);
+				OutUpdates.Add({ FName(*TMC), Speed, DecodeTime });
+				Offset += RecordSize;
+			}
+			else
+			{
+				++OutNumRejected;
+				++Offset;
+			}
+		}
+		return Offset;
+	}
+
+	while (Offset < NumBytes)
+	{
+		int32 LineEnd = Offset;
+		while (LineEnd < NumBytes && Data[LineEnd] != '\n')
+		{
+			++LineEnd;
+		}
+
+		if (LineEnd == NumBytes)
+		{
+			// Incomplete line, unless it is too long to ever be valid
+			if (NumBytes - Offset > MaxLineLength)
+			{
+				++OutNumRejected;
+				return NumBytes;
+			}
+			break;
+		}
+
+		const int32 LineLength = LineEnd - Offset;
+		if (LineLength > 0 && LineLength <= MaxLineLength)
+		{
+			const FUTF8ToTCHAR Converted((const ANSICHAR*)Data + Offset, LineLength);
+			const FString Line = FString(Converted.Length(), Converted.Get()).TrimStartAndEnd();
+
+			TSharedPtr<FJsonObject> Record;
+			FString TMC;
+			double Speed = 0.0;
+			if (!Line.IsEmpty())
+			{
+				if (FJsonSerializer::Deserialize(TJsonReaderFactory<>::Create(Line), Record) && Record.IsValid() &&
+					Record->TryGetStringField(TEXT("tmc"), TMC) && Record->TryGetNumberField(TEXT("speed"), Speed) &&
+					IsValidTMC(TMC) && IsValidSpeed((float)Speed, Settings.MaxSpeed))
+				{
+					OutUpdates.Add({ FName(*TMC), (float)Speed, DecodeTime });
+				}
+				else
+				{
+					++OutNumRejected;
+				}
+			}
+		}
+		else if (LineLength > MaxLineLength)
+		{
+			++OutNumRejected;
+		}
+
+		Offset = LineEnd + 1;
+	}
+	return Offset;
+}
+
+void FStreetMapFlowFeed::Encode(EStreetMapFeedFormat Format, FName TMC, float Speed, TArray<uint8>& OutBytes)
+{
+	const FString TMCString = TMC.ToString();
+
+	if (Format == EStreetMapFeedFormat::Binary)
+	{
+		const int32 Length = FMath::Min(TMCString.Len(), StreetMapFlowFeed::MaxTMCLength);
+		OutBytes.Add((uint8)Length);
+		for (int32 Index = 0; Index < Length; ++Index)
+		{
+			OutBytes.Add((uint8)TMCString[Index]);
+		}
+		OutBytes.Append((const uint8*)&Speed, sizeof(float));
+		return;
+	}
+
+	const FString Line = FString::Printf(TEXT("{\"tmc\":\"%s\",\"speed\":%.2f}\n"), *TMCString, Speed);
+	FTCHARToUTF8 Converted(*Line);
+	OutBytes.Append((const uint8*)Converted.Get(), Converted.Length());
+}
+
+
+FStreetMapFeedServer::FStreetMapFeedServer(const FStreetMapFlowFeedSettings& InSettings, const TArray<FName>& InTMCs, float InUpdatesPerSecond)
+	: Settings(InSettings),
+	TMCs(InTMCs),
+	UpdatesPerSecond(InUpdatesPerSecond),
+	Thread(nullptr),
+	ListenSocket(nullptr),
+	ClientSocket(nullptr),
+	FileHandle(nullptr)
+{
+	Speeds.Init(Settings.MaxSpeed * 0.5f, TMCs.Num());
+}
+
+FStreetMapFeedServer::~FStreetMapFeedServer()
+{
+	Shutdown();
+}
+
+bool FStreetMapFeedServer::Start()
+{
+	if (Thread != nullptr) return true;
+	if (TMCs.Num() == 0) return false;
+
+	if (Settings.Source == EStreetMapFeedSource::LocalSocket)
+	{
+		ISocketSubsystem* SocketSubsystem = ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM);
+		TSharedRef<FInternetAddr> Address = SocketSubsystem->CreateInternetAddr();
+		Address->SetLoopbackAddress();
+		Address->SetPort(Settings.Port);
+
+		ListenSocket = SocketSubsystem->CreateSocket(NAME_Stream, TEXT("StreetMap feed server"), false);
+		if (ListenSocket == nullptr) return false;
+
+		ListenSocket->SetReuseAddr(true);
+		if (!ListenSocket->Bind(*Address) || !ListenSocket->Listen(1))
+		{
+			SocketSubsystem->DestroySocket(ListenSocket);
+			ListenSocket = nullptr;
+			return false;
+		}
+	}
+	else
+	{
+		// Pipes are opened like files, the writer end of a FIFO or a Windows pipe client
+		FileHandle = FPlatformFileManager::Get().GetPlatformFile().OpenWrite(*Settings.Path, true, true);
+		if (FileHandle == nullptr) return false;
+	}
+
+	bStopping = false;
+	Thread = FRunnableThread::Create(this, TEXT("StreetMapFeedServer"), 0, TPri_BelowNormal);
+	return Thread != nullptr;
+}
+
+void FStreetMapFeedServer::Shutdown()
+{
+	if (Thread != nullptr)
+	{
+		Thread->Kill(true);
+		delete Thread;
+		Thread = nullptr;
+	}
+
+	ISocketSubsystem* SocketSubsystem = ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM);
+	if (ClientSocket != nullptr)
+	{
+		ClientSocket->Close();
+		SocketSubsystem->DestroySocket(ClientSocket);
+		ClientSocket = nullptr;
+	}
+	if (ListenSocket != nullptr)
+	{
+		ListenSocket->Close();
+		SocketSubsystem->DestroySocket(ListenSocket);
+		ListenSocket = nullptr;
+	}
+
+	delete FileHandle;
+	FileHandle = nullptr;
+}
+
+void FStreetMapFeedServer::SetUpdatesPerSecond(float InUpdatesPerSecond)
+{
+	UpdatesPerSecond = InUpdatesPerSecond;
+}
+
+void FStreetMapFeedServer::Stop()
+{
+	bStopping = true;
+}
+
+bool FStreetMapFeedServer::Write(const TArray<uint8>& Bytes)
+{
+	if (FileHandle != nullptr)
+	{
+		const bool bWritten = FileHandle->Write(Bytes.GetData(), Bytes.Num());
+		FileHandle->Flush();
+		return bWritten;
+	}
+
+	int32 Offset = 0;
+	while (Offset < Bytes.Num() && !bStopping)
+	{
+		int32 NumSent = 0;
+		if (!ClientSocket->Send(Bytes.GetData() + Offset, Bytes.Num() - Offset, NumSent)) return false;
+		Offset += NumSent;
+	}
+	return true;
+}
+
+uint32 FStreetMapFeedServer::Run()
+{
+	// Sends at a fixed tick so the feed rate doesn't depend on how fast the reader keeps up
+	const float TickSeconds = 0.01f;
+
+	FRandomStream Random(0x57EE7);
+	TArray<uint8> Bytes;
+	double PendingRecords = 0.0;
+	int32 NextTMC = 0;
+
+	while (!bStopping)
+	{
+		if (ListenSocket != nullptr && ClientSocket == nullptr)
+		{
+			bool bHasConnection = false;
+			if (ListenSocket->WaitForPendingConnection(bHasConnection, FTimespan::FromMilliseconds(100)) && bHasConnection)
+			{
+				ClientSocket = ListenSocket->Accept(TEXT("StreetMap feed client"));
+				PendingRecords = 0.0;
+			}
+			continue;
+		}
+
+		const double TickStart = FPlatformTime::Seconds();
+
+		PendingRecords += UpdatesPerSecond.Load() * TickSeconds;
+		const int32 NumRecords = (int32)PendingRecords;
+		PendingRecords -= NumRecords;
+
+		Bytes.Reset();
+		for (int32 Index = 0; Index < NumRecords; ++Index)
+		{
+			// Random walk, so consecutive updates of a road look like real traffic
+			float& Speed = Speeds[NextTMC];
+			Speed = FMath::Clamp(Speed + Random.FRandRange(-10.0f, 10.0f), 0.0f, Settings.MaxSpeed);
+
+			FStreetMapFlowFeed::Encode(Settings.Format, TMCs[NextTMC], Speed, Bytes);
+			NextTMC = (NextTMC + 1) % TMCs.Num();
+		}
+
+		if (Bytes.Num() > 0)
+		{
+			if (Write(Bytes))
+			{
+				NumRecordsSent.Add(NumRecords);
+			}
+			else if (ClientSocket != nullptr)
+			{
+				// Client went away, wait for the next one
+				ClientSocket->Close();
+				ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->DestroySocket(ClientSocket);
+				ClientSocket = nullptr;
+			}
+		}
+
+		const float Remaining = TickSeconds - (float)(FPlatformTime::Seconds() - TickStart);
+		if (Remaining > 0.0f)
+		{
+			FPlatformProcess::Sleep(Remaining);
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,332 @@
+// Copyright 2017 Mike Fricker. All Rights Reserved.
+
+#include "StreetMapFlowHistory.h"
+#include "StreetMapRuntime.h"
+#include "StreetMap.h"
+#include "Misc/Compression.h"
+#include "Misc/FileHelper.h"
+#include "Serialization/MemoryWriter.h"
+#include "Serialization/MemoryReader.h"
+
+
+namespace StreetMapFlowHistory
+{
+	static const uint32 FileMagic = 0x48464D53;	// "SMFH"
+	static const int32 FileVersion = 2;
+
+	/** Version 1 files have no recorded bits, every sample of them counts as recorded */
+	static const int32 FirstVersionWithRecordedBits = 2;
+
+	static bool Compress(const TArray<uint8>& Uncompressed, TArray<uint8>& OutCompressed)
+	{
+		int32 CompressedSize = FCompression::CompressMemoryBound(NAME_Zlib, Uncompressed.Num());
+		OutCompressed.SetNumUninitialized(CompressedSize);
+		if (!FCompression::CompressMemory(NAME_Zlib, OutCompressed.GetData(), CompressedSize, Uncompressed.GetData(), Uncompressed.Num())) return false;
+		OutCompressed.SetNum(CompressedSize, false);
+		return true;
+	}
+
+	static bool Uncompress(const TArray<uint8>& Compressed, int32 UncompressedSize, TArray<uint8>& OutUncompressed)
+	{
+		OutUncompressed.SetNumUninitialized(UncompressedSize);
+		return FCompression::UncompressMemory(NAME_Zlib, OutUncompressed.GetData(), UncompressedSize, Compressed.GetData(), Compressed.Num());
+	}
+}
+
+
+FStreetMapFlowHistory::FStreetMapFlowHistory()
+	: IntervalTicks(ETimespan::TicksPerMinute),
+	Capacity(0),
+	FirstSample(INDEX_NONE),
+	NewestSample(INDEX_NONE)
+{
+}
+
+void FStreetMapFlowHistory::Init(const TArray<FStreetMapRoad>& Roads, FTimespan Interval, FTimespan Duration)
+{
+	Reset();
+
+	IntervalTicks = FMath::Max<int64>(Interval.GetTicks(), ETimespan::TicksPerSecond);
+	Capacity = (int32)FMath::Max<int64>(1, Duration.GetTicks() / IntervalTicks);
+
+	for (const FStreetMapRoad& Road : Roads)
+	{
+		if (Road.TMC.IsNone() || Ordinals.Contains(Road.TMC)) continue;
+
+		Ordinals.Add(Road.TMC, TMCs.Num());
+		TMCs.Add(Road.TMC);
+		SpeedLimits.Add((float)Road.SpeedLimit);
+	}
+
+	Samples.Init(NoData, TMCs.Num() * Capacity);
+	RecordedBits.Init(0, FMath::DivideAndRoundUp(Samples.Num(), 8));
+}
+
+void FStreetMapFlowHistory::Reset()
+{
+	Ordinals.Empty();
+	TMCs.Empty();
+	SpeedLimits.Empty();
+	Samples.Empty();
+	RecordedBits.Empty();
+	Capacity = 0;
+	FirstSample = INDEX_NONE;
+	NewestSample = INDEX_NONE;
+}
+
+uint8 FStreetMapFlowHistory::Quantize(int32 Ordinal, float Speed) const
+{
+	// Same clamping as the color slots: roads at or above their limit, or without one, are at full speed
+	const float SpeedLimit = SpeedLimits[Ordinal];
+	const float SpeedRatio = SpeedLimit > 0.0f ? FMath::Clamp(Speed / SpeedLimit, 0.0f, 1.0f) : 1.0f;
+	return (uint8)FMath::RoundToInt(SpeedRatio * FullSpeed);
+}
+
+int32 FStreetMapFlowHistory::GetSlot(int64 Sample) const
+{
+	if (NewestSample == INDEX_NONE || Sample > NewestSample) return INDEX_NONE;
+
+	const int64 OldestSample = FMath::Max(FirstSample, NewestSample - Capacity + 1);
+	if (Sample < OldestSample) return INDEX_NONE;
+
+	return (int32)(Sample % Capacity);
+}
+
+int32 FStreetMapFlowHistory::Advance(int64 Sample)
+{
+	if (!IsInitialized()) return INDEX_NONE;
+
+	if (NewestSample == INDEX_NONE)
+	{
+		FirstSample = Sample;
+		NewestSample = Sample;
+		return (int32)(Sample % Capacity);
+	}
+
+	if (Sample <= NewestSample)
+	{
+		// Late records only change their own sample
+		return GetSlot(Sample);
+	}
+
+	const int32 PreviousSlot = (int32)(NewestSample % Capacity);
+	const int32 NumSkipped = (int32)FMath::Min<int64>(Sample - NewestSample, Capacity);
+	const int32 FirstSlot = (int32)((Sample - NumSkipped + 1) % Capacity);
+
+	for (int32 Ordinal = 0; Ordinal < TMCs.Num(); ++Ordinal)
+	{
+		uint8* Ring = Samples.GetData() + Ordinal * Capacity;
+		const uint8 State = Ring[PreviousSlot];
+
+		for (int32 Step = 0, Slot = FirstSlot; Step < NumSkipped; ++Step)
+		{
+			Ring[Slot] = State;
+			SetRecorded(Ordinal * Capacity + Slot, false);
+			if (++Slot == Capacity) Slot = 0;
+		}
+	}
+
+	NewestSample = Sample;
+	return (int32)(Sample % Capacity);
+}
+
+void FStreetMapFlowHistory::RecordState(int64 Sample, int32 Ordinal, uint8 State)
+{
+	const int32 Slot = Advance(Sample);
+	if (Slot == INDEX_NONE) return;
+
+	const int32 RingStart = Ordinal * Capacity;
+	Samples[RingStart + Slot] = State;
+	SetRecorded(RingStart + Slot, true);
+
+	// A late record also corrects the samples that carried the previous state forward from it
+	for (int64 NextSample = Sample + 1; NextSample <= NewestSample; ++NextSample)
+	{
+		const int32 Index = RingStart + (int32)(NextSample % Capacity);
+		if (IsRecorded(Index)) break;
+
+		Samples[Index] = State;
+	}
+}
+
+void FStreetMapFlowHistory::Record(FDateTime Time, FName TMC, float Speed)
+{
+	const int32 Ordinal = GetOrdinal(TMC);
+	if (Ordinal == INDEX_NONE) return;
+
+	RecordState(GetSample(Time), Ordinal, Quantize(Ordinal, Speed));
+}
+
+void FStreetMapFlowHistory::RecordNoData(FDateTime Time, FName TMC)
+{
+	const int32 Ordinal = GetOrdinal(TMC);
+	if (Ordinal == INDEX_NONE) return;
+
+	RecordState(GetSample(Time), Ordinal, NoData);
+}
+
+void FStreetMapFlowHistory::RecordSnapshot(FDateTime Time, const TMap<FName, float>& FlowData)
+{
+	const int64 Sample = GetSample(Time);
+	if (Advance(Sample) == INDEX_NONE) return;
+
+	for (int32 Ordinal = 0; Ordinal < TMCs.Num(); ++Ordinal)
+	{
+		const float* Speed = FlowData.Find(TMCs[Ordinal]);
+		RecordState(Sample, Ordinal, Speed ? Quantize(Ordinal, *Speed) : NoData);
+	}
+}
+
+bool FStreetMapFlowHistory::Contains(FDateTime Time) const
+{
+	return GetSlot(GetSample(Time)) != INDEX_NONE;
+}
+
+bool FStreetMapFlowHistory::GetSpeedAt(FDateTime Time, FName TMC, float& OutSpeed) const
+{
+	const int32 Ordinal = GetOrdinal(TMC);
+	const int32 Slot = GetSlot(GetSample(Time));
+	if (Ordinal == INDEX_NONE || Slot == INDEX_NONE) return false;
+
+	const uint8 Ratio = Samples[Ordinal * Capacity + Slot];
+	if (Ratio == NoData) return false;
+
+	OutSpeed = Dequantize(Ordinal, Ratio);
+	return true;
+}
+
+bool FStreetMapFlowHistory::GetStateAt(FDateTime Time, TArray<float>& OutSpeeds) const
+{
+	const int32 Slot = GetSlot(GetSample(Time));
+	if (Slot == INDEX_NONE) return false;
+
+	OutSpeeds.SetNumUninitialized(TMCs.Num());
+	for (int32 Ordinal = 0; Ordinal < TMCs.Num(); ++Ordinal)
+	{
+		const uint8 Ratio = Samples[Ordinal * Capacity + Slot];
+		OutSpeeds[Ordinal] = Ratio != NoData ? Dequantize(Ordinal, Ratio) : -1.0f;
+	}
+	return true;
+}
+
+FDateTime FStreetMapFlowHistory::GetOldestTime() const
+{
+	if (NewestSample == INDEX_NONE) return FDateTime(0);
+
+	return FDateTime(FMath::Max(FirstSample, NewestSample - Capacity + 1) * IntervalTicks);
+}
+
+FDateTime FStreetMapFlowHistory::GetNewestTime() const
+{
+	if (NewestSample == INDEX_NONE) return FDateTime(0);
+
+	return FDateTime(NewestSample * IntervalTicks);
+}
+
+bool FStreetMapFlowHistory::SaveToFile(const FString& Path) const
+{
+	if (!IsInitialized()) return false;
+
+	TArray<uint8> Bytes;
+	FMemoryWriter Writer(Bytes);
+
+	uint32 Magic = StreetMapFlowHistory::FileMagic;
+	int32 Version = StreetMapFlowHistory::FileVersion;
+	int64 SavedIntervalTicks = IntervalTicks;
+	int32 SavedCapacity = Capacity;
+	int64 SavedFirstSample = FirstSample;
+	int64 SavedNewestSample = NewestSample;
+	Writer << Magic << Version << SavedIntervalTicks << SavedCapacity << SavedFirstSample << SavedNewestSample;
+
+	TArray<FName> SavedTMCs = TMCs;
+	TArray<float> SavedSpeedLimits = SpeedLimits;
+	Writer << SavedTMCs << SavedSpeedLimits;
+
+	// Rings are mostly runs of the same ratio, and carried samples runs of clear bits, they compress very well
+	int32 UncompressedSize = Samples.Num();
+	TArray<uint8> Compressed;
+	if (!StreetMapFlowHistory::Compress(Samples, Compressed)) return false;
+
+	int32 RecordedSize = RecordedBits.Num();
+	TArray<uint8> CompressedRecorded;
+	if (!StreetMapFlowHistory::Compress(RecordedBits, CompressedRecorded)) return false;
+
+	Writer << UncompressedSize;
+	Writer << Compressed;
+	Writer << RecordedSize;
+	Writer << CompressedRecorded;
+
+	return FFileHelper::SaveArrayToFile(Bytes, *Path);
+}
+
+bool FStreetMapFlowHistory::LoadFromFile(const FString& Path)
+{
+	TArray<uint8> Bytes;
+	if (!FFileHelper::LoadFileToArray(Bytes, *Path, FILEREAD_Silent)) return false;
+
+	FMemoryReader Reader(Bytes);
+
+	uint32 Magic = 0;
+	int32 Version = 0;
+	int64 LoadedIntervalTicks = 0;
+	int32 LoadedCapacity = 0;
+	int64 LoadedFirstSample = INDEX_NONE;
+	int64 LoadedNewestSample = INDEX_NONE;
+	Reader << Magic << Version;
+	if (Magic != StreetMapFlowHistory::FileMagic || Version < 1 || Version > StreetMapFlowHistory::FileVersion) return false;
+
+	Reader << LoadedIntervalTicks << LoadedCapacity << LoadedFirstSample << LoadedNewestSample;
+
+	TArray<FName> LoadedTMCs;
+	TArray<float> LoadedSpeedLimits;
+	Reader << LoadedTMCs << LoadedSpeedLimits;
+
+	int32 UncompressedSize = 0;
+	TArray<uint8> Compressed;
+	Reader << UncompressedSize;
+	Reader << Compressed;
+
+	const bool bHasRecordedBits = Version >= StreetMapFlowHistory::FirstVersionWithRecordedBits;
+	int32 RecordedSize = FMath::DivideAndRoundUp(UncompressedSize, 8);
+	TArray<uint8> CompressedRecorded;
+	if (bHasRecordedBits)
+	{
+		Reader << RecordedSize;
+		Reader << CompressedRecorded;
+	}
+
+	if (Reader.IsError() || LoadedIntervalTicks <= 0 || LoadedCapacity <= 0 || LoadedTMCs.Num() != LoadedSpeedLimits.Num() ||
+		(int64)UncompressedSize != (int64)LoadedTMCs.Num() * LoadedCapacity || RecordedSize != FMath::DivideAndRoundUp(UncompressedSize, 8)) return false;
+
+	TArray<uint8> LoadedSamples;
+	if (!StreetMapFlowHistory::Uncompress(Compressed, UncompressedSize, LoadedSamples)) return false;
+
+	TArray<uint8> LoadedRecordedBits;
+	if (!bHasRecordedBits)
+	{
+		LoadedRecordedBits.Init(0xFF, RecordedSize);
+	}
+	else if (!StreetMapFlowHistory::Uncompress(CompressedRecorded, RecordedSize, LoadedRecordedBits)) return false;
+
+	Reset();
+
+	IntervalTicks = LoadedIntervalTicks;
+	Capacity = LoadedCapacity;
+	FirstSample = LoadedFirstSample;
+	NewestSample = LoadedNewestSample;
+	TMCs = MoveTemp(LoadedTMCs);
+	SpeedLimits = MoveTemp(LoadedSpeedLimits);
+	Samples = MoveTemp(LoadedSamples);
+	RecordedBits = MoveTemp(LoadedRecordedBits);
+
+	for (int32 Ordinal = 0; Ordinal < TMCs.Num(); ++Ordinal)
+	{
+		Ordinals.Add(TMCs[Ordinal], Ordinal);
+	}
+	return true;
+}
+
+SIZE_T FStreetMapFlowHistory::GetAllocatedSize() const
+{
+	return Samples.GetAllocatedSize() + RecordedBits.GetAllocatedSize() + TMCs.GetAllocatedSize() + SpeedLimits.GetAllocatedSize() + Ordinals.GetAllocatedSize();
+}
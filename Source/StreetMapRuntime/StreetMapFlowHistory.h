@@ -0,0 +1,160 @@
+// Copyright 2017 Mike Fricker. All Rights Reserved.
+#pragma once
+
+#include "CoreMinimal.h"
+
+struct FStreetMapRoad;
+
+/**
+ * Flow history of every TMC over a sliding window, e.g. the last 24 hours at one sample per minute.
+ * TMCs are addressed by a dense ordinal and each one owns a ring buffer of 8-bit quantized speed ratios, so a day
+ * of history for 20k TMCs takes about 28 MB, plus one bit per sample.  Samples are taken at a fixed interval: a sample
+ * holds the last state recorded during its interval, and carries the previous state forward when nothing changed.  The
+ * bit tells recorded samples from carried ones, so a late record also replaces the copies of the state it corrects.
+ * Locating the state at a time is O(1), restoring it is a single pass over the TMCs.
+ */
+class FStreetMapFlowHistory
+{
+
+public:
+
+	/** Quantized value of a TMC without flow data at that time */
+	static const uint8 NoData = 255;
+
+	/** Largest quantized speed ratio, for a TMC at or above its speed limit */
+	static const uint8 FullSpeed = 254;
+
+	FStreetMapFlowHistory();
+
+	/**
+	* Assigns an ordinal to every TMC of the roads and allocates empty ring buffers.
+	* @param Interval Time between two samples
+	* @param Duration Length of the window kept
+	*/
+	void Init(const TArray<FStreetMapRoad>& Roads, FTimespan Interval, FTimespan Duration);
+
+	/** Releases all samples */
+	void Reset();
+
+	bool IsInitialized() const
+	{
+		return Capacity > 0;
+	}
+
+	/** @return Ordinal of a TMC, INDEX_NONE for TMCs not on the roads */
+	int32 GetOrdinal(FName TMC) const
+	{
+		const int32* Ordinal = Ordinals.Find(TMC);
+		return Ordinal ? *Ordinal : INDEX_NONE;
+	}
+
+	int32 NumTMCs() const
+	{
+		return TMCs.Num();
+	}
+
+	FName GetTMC(int32 Ordinal) const
+	{
+		return TMCs[Ordinal];
+	}
+
+	/**
+	* Records the speed of a TMC at a time, earlier than the window is ignored.  A time before the newest sample also
+	* replaces the state the following samples carried forward from it, up to the next recorded one.
+	*/
+	void Record(FDateTime Time, FName TMC, float Speed);
+
+	/** Records that a TMC has no flow data anymore */
+	void RecordNoData(FDateTime Time, FName TMC);
+
+	/** Records the state of every TMC at once, TMCs missing from FlowData have no data */
+	void RecordSnapshot(FDateTime Time, const TMap<FName, float>& FlowData);
+
+	/** @return True if the time is inside the recorded window */
+	bool Contains(FDateTime Time) const;
+
+	/** @return Speed of a TMC at a time, false if it had no data or the time is outside the window */
+	bool GetSpeedAt(FDateTime Time, FName TMC, float& OutSpeed) const;
+
+	/**
+	* Speed of every TMC at a time, indexed by ordinal, negative for TMCs without data
+	* @return False if the time is outside the window
+	*/
+	bool GetStateAt(FDateTime Time, TArray<float>& OutSpeeds) const;
+
+	/** First and last recorded sample times */
+	FDateTime GetOldestTime() const;
+	FDateTime GetNewestTime() const;
+
+	FTimespan GetInterval() const
+	{
+		return FTimespan(IntervalTicks);
+	}
+
+	/** Compact binary format: header, TMC table and zlib compressed rings */
+	bool SaveToFile(const FString& Path) const;
+	bool LoadFromFile(const FString& Path);
+
+	/** @return Bytes used by the samples and the TMC table */
+	SIZE_T GetAllocatedSize() const;
+
+private:
+
+	/** @return Absolute sample number of a time */
+	int64 GetSample(FDateTime Time) const
+	{
+		return Time.GetTicks() / IntervalTicks;
+	}
+
+	/** @return Index of a sample in the rings, INDEX_NONE if it left the window or wasn't recorded yet */
+	int32 GetSlot(int64 Sample) const;
+
+	/** Moves the window forward to a sample, carrying the newest state into the skipped samples */
+	int32 Advance(int64 Sample);
+
+	uint8 Quantize(int32 Ordinal, float Speed) const;
+
+	/** Writes a quantized state recorded at a sample, see Record() */
+	void RecordState(int64 Sample, int32 Ordinal, uint8 State);
+
+	bool IsRecorded(int32 Index) const
+	{
+		return (RecordedBits[Index >> 3] & (1 << (Index & 7))) != 0;
+	}
+
+	void SetRecorded(int32 Index, bool bRecorded)
+	{
+		if (bRecorded)
+		{
+			RecordedBits[Index >> 3] |= 1 << (Index & 7);
+		}
+		else
+		{
+			RecordedBits[Index >> 3] &= ~(1 << (Index & 7));
+		}
+	}
+
+	float Dequantize(int32 Ordinal, uint8 Ratio) const
+	{
+		return Ratio * SpeedLimits[Ordinal] / FullSpeed;
+	}
+
+	TMap<FName, int32> Ordinals;
+	TArray<FName> TMCs;
+
+	/** Speed limit of the first road of each TMC, ratios are relative to it */
+	TArray<float> SpeedLimits;
+
+	/** NumTMCs rings of Capacity samples, one ring after the other */
+	TArray<uint8> Samples;
+
+	/** One bit per sample, set if its state was recorded rather than carried forward */
+	TArray<uint8> RecordedBits;
+
+	int64 IntervalTicks;
+	int32 Capacity;
+
+	/** Absolute numbers of the first and newest recorded samples, INDEX_NONE before the first record */
+	int64 FirstSample;
+	int64 NewestSample;
+};
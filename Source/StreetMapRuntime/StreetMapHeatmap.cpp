@@ -0,0 +1,231 @@
+// Copyright 2017 Mike Fricker. All Rights Reserved.
+
+#include "StreetMapHeatmap.h"
+#include "StreetMapRuntime.h"
+#include "Async/Async.h"
+#include "Engine/Texture2D.h"
+
+
+namespace StreetMapHeatmap
+{
+	/** Fixed point unit of a cell */
+	static const double FixedPointOne = 1024.0;
+
+	/** Cells are rescaled before new probes get this much larger than old ones */
+	static const double MinScale = 1.0 / 65536.0;
+
+	/** Probes binned per read lock, so decay never waits for a whole batch */
+	static const int32 ProbesPerLock = 4096;
+}
+
+
+FStreetMapHeatmap::FStreetMapHeatmap()
+	: Scale(1.0),
+	Origin(FVector2D::ZeroVector),
+	CellSize(1.0f),
+	Width(0),
+	Height(0),
+	HalfLife(300.0f)
+{
+}
+
+FStreetMapHeatmap::~FStreetMapHeatmap()
+{
+	WaitForPendingBatches();
+}
+
+void FStreetMapHeatmap::Init(FVector2D BoundsMin, FVector2D BoundsMax, int32 Resolution, float InHalfLife)
+{
+	Reset();
+
+	const FVector2D Size = BoundsMax - BoundsMin;
+	Resolution = FMath::Clamp(Resolution, 1, 4096);
+
+	Origin = BoundsMin;
+	CellSize = FMath::Max(FMath::Max(Size.X, Size.Y) / Resolution, 1.0f);
+	Width = FMath::Clamp(FMath::CeilToInt(Size.X / CellSize), 1, Resolution);
+	Height = FMath::Clamp(FMath::CeilToInt(Size.Y / CellSize), 1, Resolution);
+	HalfLife = FMath::Max(InHalfLife, 0.001f);
+	Scale = 1.0;
+
+	Cells.SetNumZeroed(Width * Height);
+}
+
+void FStreetMapHeatmap::Reset()
+{
+	WaitForPendingBatches();
+
+	FRWScopeLock WriteLock(Lock, SLT_Write);
+	Cells.Empty();
+	Width = 0;
+	Height = 0;
+	Scale = 1.0;
+}
+
+void FStreetMapHeatmap::WaitForPendingBatches() const
+{
+	while (NumPendingBatches.GetValue() > 0)
+	{
+		FPlatformProcess::Sleep(0.0f);
+	}
+}
+
+int32 FStreetMapHeatmap::GetCellIndex(FVector2D Location) const
+{
+	const int32 X = FMath::FloorToInt((Location.X - Origin.X) / CellSize);
+	const int32 Y = FMath::FloorToInt((Location.Y - Origin.Y) / CellSize);
+	if (X < 0 || X >= Width || Y < 0 || Y >= Height) return INDEX_NONE;
+
+	return Y * Width + X;
+}
+
+void FStreetMapHeatmap::AddToCell(int32 CellIndex, float Weight)
+{
+	if (CellIndex < 0 || CellIndex >= Cells.Num()) return;
+
+	FRWScopeLock ReadLock(Lock, SLT_ReadOnly);
+	FPlatformAtomics::InterlockedAdd(&Cells[CellIndex], (int64)(Weight / Scale * StreetMapHeatmap::FixedPointOne));
+}
+
+void FStreetMapHeatmap::AddProbesAsync(TArray<FVector2D>&& Locations, TArray<float>&& Weights)
+{
+	if (!IsInitialized() || Locations.Num() == 0) return;
+
+	NumPendingBatches.Increment();
+	Async(EAsyncExecution::ThreadPool, [this, Locations = MoveTemp(Locations), Weights = MoveTemp(Weights)]()
+	{
+		const bool bWeighted = Weights.Num() == Locations.Num();
+		for (int32 First = 0; First < Locations.Num(); First += StreetMapHeatmap::ProbesPerLock)
+		{
+			FRWScopeLock ReadLock(Lock, SLT_ReadOnly);
+			const double Units = StreetMapHeatmap::FixedPointOne / Scale;
+			const int32 Last = FMath::Min(First + StreetMapHeatmap::ProbesPerLock, Locations.Num());
+			for (int32 Index = First; Index < Last; ++Index)
+			{
+				const int32 CellIndex = GetCellIndex(Locations[Index]);
+				if (CellIndex != INDEX_NONE)
+				{
+					FPlatformAtomics::InterlockedAdd(&Cells[CellIndex], (int64)((bWeighted ? Weights[Index] : 1.0f) * Units));
+				}
+			}
+		}
+		NumPendingBatches.Decrement();
+	});
+}
+
+void FStreetMapHeatmap::AddCellsAsync(TArray<int32>&& CellIndices, TArray<float>&& Weights)
+{
+	if (!IsInitialized() || CellIndices.Num() == 0) return;
+
+	NumPendingBatches.Increment();
+	Async(EAsyncExecution::ThreadPool, [this, CellIndices = MoveTemp(CellIndices), Weights = MoveTemp(Weights)]()
+	{
+		const bool bWeighted = Weights.Num() == CellIndices.Num();
+		for (int32 First = 0; First < CellIndices.Num(); First += StreetMapHeatmap::ProbesPerLock)
+		{
+			FRWScopeLock ReadLock(Lock, SLT_ReadOnly);
+			const double Units = StreetMapHeatmap::FixedPointOne / Scale;
+			const int32 Last = FMath::Min(First + StreetMapHeatmap::ProbesPerLock, CellIndices.Num());
+			for (int32 Index = First; Index < Last; ++Index)
+			{
+				const int32 CellIndex = CellIndices[Index];
+				if (CellIndex >= 0 && CellIndex < Cells.Num())
+				{
+					FPlatformAtomics::InterlockedAdd(&Cells[CellIndex], (int64)((bWeighted ? Weights[Index] : 1.0f) * Units));
+				}
+			}
+		}
+		NumPendingBatches.Decrement();
+	});
+}
+
+void FStreetMapHeatmap::Decay(float DeltaSeconds)
+{
+	if (!IsInitialized() || DeltaSeconds <= 0.0f) return;
+
+	FRWScopeLock WriteLock(Lock, SLT_Write);
+	Scale *= FMath::Pow(2.0f, -DeltaSeconds / HalfLife);
+
+	if (Scale < StreetMapHeatmap::MinScale)
+	{
+		Rescale();
+	}
+}
+
+void FStreetMapHeatmap::Rescale()
+{
+	for (int64& Cell : Cells)
+	{
+		Cell = (int64)(Cell * Scale);
+	}
+	Scale = 1.0;
+}
+
+float FStreetMapHeatmap::GetDensity(int32 CellIndex) const
+{
+	if (CellIndex < 0 || CellIndex >= Cells.Num()) return 0.0f;
+
+	FRWScopeLock ReadLock(Lock, SLT_ReadOnly);
+	return (float)(FPlatformAtomics::AtomicRead(&Cells[CellIndex]) * Scale / StreetMapHeatmap::FixedPointOne);
+}
+
+UTexture2D* FStreetMapHeatmap::CreateTexture() const
+{
+	if (!IsInitialized()) return nullptr;
+
+	UTexture2D* Texture = UTexture2D::CreateTransient(Width, Height, PF_B8G8R8A8);
+	if (Texture == nullptr) return nullptr;
+
+	// Draped over the map, so filtered unlike the road attributes
+	Texture->Filter = TF_Bilinear;
+	Texture->SRGB = false;
+	Texture->CompressionSettings = TC_VectorDisplacementmap;
+	Texture->NeverStream = true;
+	Texture->AddressX = TA_Clamp;
+	Texture->AddressY = TA_Clamp;
+
+	FTexture2DMipMap& Mip = Texture->PlatformData->Mips[0];
+	void* MipData = Mip.BulkData.Lock(LOCK_READ_WRITE);
+	FMemory::Memzero(MipData, Width * Height * sizeof(FColor));
+	Mip.BulkData.Unlock();
+
+	Texture->UpdateResource();
+	return Texture;
+}
+
+int32 FStreetMapHeatmap::Flush(UTexture2D* Texture)
+{
+	if (!IsInitialized() || Texture == nullptr) return 0;
+	if (Texture->GetSizeX() != Width || Texture->GetSizeY() != Height) return 0;
+
+	const int32 NumBytes = Width * Height * sizeof(FColor);
+
+	// The render thread reads the data after this returns, so it gets its own copy
+	FColor* Texels = (FColor*)FMemory::Malloc(NumBytes);
+	{
+		FRWScopeLock ReadLock(Lock, SLT_ReadOnly);
+
+		int64 MaxCell = 1;
+		for (int32 CellIndex = 0; CellIndex < Cells.Num(); ++CellIndex)
+		{
+			MaxCell = FMath::Max(MaxCell, FPlatformAtomics::AtomicRead(&Cells[CellIndex]));
+		}
+
+		const double Normalize = 255.0 / MaxCell;
+		for (int32 CellIndex = 0; CellIndex < Cells.Num(); ++CellIndex)
+		{
+			const uint8 Density = (uint8)FMath::Clamp((int32)(FPlatformAtomics::AtomicRead(&Cells[CellIndex]) * Normalize + 0.5), 0, 255);
+			Texels[CellIndex] = FColor(Density, Density, Density, Density);
+		}
+	}
+
+	FUpdateTextureRegion2D* Region = new FUpdateTextureRegion2D(0, 0, 0, 0, Width, Height);
+	Texture->UpdateTextureRegions(0, 1, Region, Width * sizeof(FColor), sizeof(FColor), (uint8*)Texels,
+		[](uint8* SrcData, const FUpdateTextureRegion2D* Regions)
+		{
+			FMemory::Free(SrcData);
+			delete Regions;
+		});
+
+	return NumBytes;
+}
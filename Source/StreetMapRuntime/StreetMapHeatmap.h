@@ -0,0 +1,106 @@
+// Copyright 2017 Mike Fricker. All Rights Reserved.
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/ThreadSafeCounter.h"
+#include "Misc/ScopeRWLock.h"
+
+class UTexture2D;
+
+/**
+ * Traffic density grid covering the street map, with exponential decay over time.
+ * Probes are binned on worker threads with an atomic add into their cell, O(1) per probe.  Cells hold fixed point
+ * values relative to a global scale: decaying the whole grid only shrinks the scale, and new probes are added
+ * divided by it, so decay is O(1) as well.  Cells are rescaled in one pass when the scale gets too small.
+ */
+class FStreetMapHeatmap
+{
+
+public:
+
+	FStreetMapHeatmap();
+	~FStreetMapHeatmap();
+
+	/**
+	* Allocates an empty grid
+	* @param Resolution Cells along the longest side of the bounds, the other side keeps square cells
+	* @param InHalfLife Seconds after which a probe only weighs half
+	*/
+	void Init(FVector2D BoundsMin, FVector2D BoundsMax, int32 Resolution, float InHalfLife);
+
+	/** Waits for pending work and releases the grid */
+	void Reset();
+
+	bool IsInitialized() const
+	{
+		return Cells.Num() > 0;
+	}
+
+	int32 GetWidth() const
+	{
+		return Width;
+	}
+
+	int32 GetHeight() const
+	{
+		return Height;
+	}
+
+	/** @return Cell containing a location, INDEX_NONE outside the bounds */
+	int32 GetCellIndex(FVector2D Location) const;
+
+	/** Adds weight to a cell, thread safe */
+	void AddToCell(int32 CellIndex, float Weight);
+
+	/** Bins probes on a worker thread.  Weights may be empty for a weight of 1 per probe. */
+	void AddProbesAsync(TArray<FVector2D>&& Locations, TArray<float>&& Weights);
+
+	/** Same as above with precomputed cells, e.g. the cells of roads */
+	void AddCellsAsync(TArray<int32>&& CellIndices, TArray<float>&& Weights);
+
+	/** Decays every cell by the elapsed time */
+	void Decay(float DeltaSeconds);
+
+	/** @return Current density of a cell */
+	float GetDensity(int32 CellIndex) const;
+
+	/** @return Number of batches still being binned */
+	int32 GetNumPendingBatches() const
+	{
+		return NumPendingBatches.GetValue();
+	}
+
+	/** Creates a transient texture the size of the grid, density in all channels */
+	UTexture2D* CreateTexture() const;
+
+	/**
+	* Writes the current densities into the texture, normalized by the densest cell
+	* @return Number of bytes uploaded
+	*/
+	int32 Flush(UTexture2D* Texture);
+
+private:
+
+	/** Spins until no worker is binning anymore */
+	void WaitForPendingBatches() const;
+
+	/** Folds the scale into the cells, needs exclusive access */
+	void Rescale();
+
+	/** Fixed point cells, FixedPointOne is a weight of 1 at a scale of 1 */
+	TArray<int64> Cells;
+
+	/** Density of a cell is its value times Scale */
+	double Scale;
+
+	/** Adders share the lock, rescaling takes it exclusively */
+	mutable FRWLock Lock;
+
+	FThreadSafeCounter NumPendingBatches;
+
+	FVector2D Origin;
+	float CellSize;
+	int32 Width;
+	int32 Height;
+	float HalfLife;
+};
@@ -0,0 +1,48 @@
+// Copyright 2017 Mike Fricker. All Rights Reserved.
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/ThreadSafeBool.h"
+#include "StreetMap.h"
+#include "StreetMapSceneProxy.h"
+#include "StreetMapRoadSegments.h"
+
+/**
+ * Inputs and outputs of one street map mesh generation.  Everything the generation reads from the game thread is
+ * captured up front, so the mesh can be generated on a worker while the component keeps drawing, recoloring and
+ * editing its current mesh.  The outputs are moved into the component in one go once the build is done.
+ */
+struct FStreetMapMeshBuild
+{
+	/** Mesh build settings at the time of the capture */
+	FStreetMapMeshBuildSettings Settings;
+
+	/** Flow color and speed ratio of every road, colors are only set for roads with data */
+	TArray<FColor> RoadColors;
+	TArray<float> RoadSpeedRatios;
+	TArray<uint8> RoadHasData;
+
+	/** Generated mesh, sections indexed by EVertexType */
+	TArray<FStreetMapVertex> Vertices[FStreetMapSceneProxy::NumSections];
+	TArray<uint32> Indices[FStreetMapSceneProxy::NumSections];
+	TArray<FStreetMapVertexRange> RoadVertexRanges;
+	TArray<FStreetMapMeshChunk> MeshChunks;
+	FBox MeshBoundingBox = FBox(ForceInit);
+
+	/** Segments of every road, only collected when roads are drawn as instanced segments */
+	FStreetMapRoadSegments RoadSegments;
+
+	/** Generated mesh laid out for the GPU, and the texture coordinate and color streams of each section */
+	TSharedPtr<FStreetMapRenderData, ESPMode::ThreadSafe> RenderData;
+	FStreetMapTexCoordStreamPtr RenderTexCoords[FStreetMapSceneProxy::NumSections];
+	FStreetMapColorStreamPtr RenderColors[FStreetMapSceneProxy::NumSections];
+
+	/** If true, the mesh is generated on the calling thread only, the same mesh the parallel generation outputs */
+	bool bSingleThreaded = false;
+
+	/** Set by the game thread to stop the generation early, the outputs are then incomplete */
+	FThreadSafeBool bCancelled;
+
+	/** Set once the outputs are written */
+	FThreadSafeBool bDone;
+};
@@ -0,0 +1,207 @@
+// Copyright 2017 Mike Fricker. All Rights Reserved.
+
+#include "StreetMapReplication.h"
+#include "StreetMapRuntime.h"
+#include "StreetMap.h"
+#include "StreetMapComponent.h"
+#include "PredictiveData.h"
+
+
+namespace StreetMapReplication
+{
+	/** Item flags, data that is missing isn't sent */
+	static const uint8 HasFlow = 1 << 0;
+	static const uint8 HasPredictive = 1 << 1;
+}
+
+
+bool FStreetMapReplicatedFlowItem::NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess)
+{
+	uint8 Flags = 0;
+	if (Ar.IsSaving())
+	{
+		Flags |= Flow != NoData ? StreetMapReplication::HasFlow : 0;
+		Flags |= (Predictive[0] & Predictive[1] & Predictive[2] & Predictive[3]) != NoData ? StreetMapReplication::HasPredictive : 0;
+	}
+	Ar << Flags;
+
+	uint32 PackedOrdinal = (uint32)FMath::Max(Ordinal, 0);
+	Ar.SerializeIntPacked(PackedOrdinal);
+
+	if (Ar.IsLoading())
+	{
+		Ordinal = (int32)PackedOrdinal;
+		Flow = NoData;
+		FMemory::Memset(Predictive, NoData, sizeof(Predictive));
+	}
+
+	if (Flags & StreetMapReplication::HasFlow)
+	{
+		Ar << Flow;
+	}
+	if (Flags & StreetMapReplication::HasPredictive)
+	{
+		Ar.Serialize(Predictive, sizeof(Predictive));
+	}
+
+	bOutSuccess = !Ar.IsError();
+	return true;
+}
+
+void FStreetMapReplicatedFlowItem::PostReplicatedAdd(const FStreetMapReplicatedFlow& InArraySerializer)
+{
+	if (InArraySerializer.Owner != nullptr)
+	{
+		InArraySerializer.Owner->ReceiveReplicatedFlow(*this);
+	}
+}
+
+void FStreetMapReplicatedFlowItem::PostReplicatedChange(const FStreetMapReplicatedFlow& InArraySerializer)
+{
+	if (InArraySerializer.Owner != nullptr)
+	{
+		InArraySerializer.Owner->ReceiveReplicatedFlow(*this);
+	}
+}
+
+
+void FStreetMapReplicatedFlow::Init(const TArray<FStreetMapRoad>& Roads)
+{
+	Items.Reset();
+	Ordinals.Reset();
+	TMCs.Reset();
+	SpeedLimits.Reset();
+
+	// Same ordering as the flow history: first road of each TMC, in road order
+	for (const FStreetMapRoad& Road : Roads)
+	{
+		if (Road.TMC.IsNone() || Ordinals.Contains(Road.TMC)) continue;
+
+		Ordinals.Add(Road.TMC, TMCs.Num());
+		TMCs.Add(Road.TMC);
+		SpeedLimits.Add((float)Road.SpeedLimit);
+	}
+
+	ItemIndices.Init(INDEX_NONE, TMCs.Num());
+	MarkArrayDirty();
+}
+
+uint8 FStreetMapReplicatedFlow::Quantize(int32 Ordinal, float Speed) const
+{
+	if (Speed < 0.0f) return FStreetMapReplicatedFlowItem::NoData;
+
+	// Same clamping as the color slots: roads at or above their limit, or without one, are at full speed
+	const float SpeedLimit = SpeedLimits[Ordinal];
+	const float SpeedRatio = SpeedLimit > 0.0f ? FMath::Clamp(Speed / SpeedLimit, 0.0f, 1.0f) : 1.0f;
+	return (uint8)FMath::RoundToInt(SpeedRatio * FStreetMapReplicatedFlowItem::FullSpeed);
+}
+
+float FStreetMapReplicatedFlow::Dequantize(int32 Ordinal, uint8 Ratio) const
+{
+	if (Ratio == FStreetMapReplicatedFlowItem::NoData || !SpeedLimits.IsValidIndex(Ordinal)) return -1.0f;
+
+	return Ratio * SpeedLimits[Ordinal] / FStreetMapReplicatedFlowItem::FullSpeed;
+}
+
+FStreetMapReplicatedFlowItem& FStreetMapReplicatedFlow::FindOrAddItem(int32 Ordinal)
+{
+	int32& ItemIndex = ItemIndices[Ordinal];
+	if (ItemIndex == INDEX_NONE)
+	{
+		ItemIndex = Items.AddDefaulted();
+		Items[ItemIndex].Ordinal = Ordinal;
+	}
+	return Items[ItemIndex];
+}
+
+void FStreetMapReplicatedFlow::SetFlow(FName TMC, float Speed)
+{
+	const int32 Ordinal = GetOrdinal(TMC);
+	if (Ordinal == INDEX_NONE) return;
+
+	const uint8 Flow = Quantize(Ordinal, Speed);
+	if (ItemIndices[Ordinal] == INDEX_NONE && Flow == FStreetMapReplicatedFlowItem::NoData) return;
+
+	// Speed changes within the quantization step aren't worth any bandwidth
+	FStreetMapReplicatedFlowItem& Item = FindOrAddItem(Ordinal);
+	if (Item.Flow != Flow || Item.ReplicationID == INDEX_NONE)
+	{
+		Item.Flow = Flow;
+		MarkItemDirty(Item);
+	}
+}
+
+void FStreetMapReplicatedFlow::SetPredictive(FName TMC, const FPredictiveData* Data)
+{
+	const int32 Ordinal = GetOrdinal(TMC);
+	if (Ordinal == INDEX_NONE) return;
+	if (ItemIndices[Ordinal] == INDEX_NONE && Data == nullptr) return;
+
+	uint8 Predictive[4];
+	Predictive[0] = Data ? Quantize(Ordinal, Data->S0) : FStreetMapReplicatedFlowItem::NoData;
+	Predictive[1] = Data ? Quantize(Ordinal, Data->S15) : FStreetMapReplicatedFlowItem::NoData;
+	Predictive[2] = Data ? Quantize(Ordinal, Data->S30) : FStreetMapReplicatedFlowItem::NoData;
+	Predictive[3] = Data ? Quantize(Ordinal, Data->S45) : FStreetMapReplicatedFlowItem::NoData;
+
+	FStreetMapReplicatedFlowItem& Item = FindOrAddItem(Ordinal);
+	if (FMemory::Memcmp(Item.Predictive, Predictive, sizeof(Predictive)) != 0 || Item.ReplicationID == INDEX_NONE)
+	{
+		FMemory::Memcpy(Item.Predictive, Predictive, sizeof(Predictive));
+		MarkItemDirty(Item);
+	}
+}
+
+void FStreetMapReplicatedFlow::ClearFlow()
+{
+	for (FStreetMapReplicatedFlowItem& Item : Items)
+	{
+		if (Item.Flow != FStreetMapReplicatedFlowItem::NoData)
+		{
+			Item.Flow = FStreetMapReplicatedFlowItem::NoData;
+			MarkItemDirty(Item);
+		}
+	}
+}
+
+void FStreetMapReplicatedFlow::ClearPredictive()
+{
+	for (FStreetMapReplicatedFlowItem& Item : Items)
+	{
+		if (Item.Predictive[0] != FStreetMapReplicatedFlowItem::NoData)
+		{
+			FMemory::Memset(Item.Predictive, FStreetMapReplicatedFlowItem::NoData, sizeof(Item.Predictive));
+			MarkItemDirty(Item);
+		}
+	}
+}
+
+bool FStreetMapReplicatedFlow::NetDeltaSerialize(FNetDeltaSerializeInfo& DeltaParms)
+{
+	// A connection without a base state, e.g. a client that just joined, gets every item: that is the resync
+	const int64 WriterBitsBefore = DeltaParms.Writer ? DeltaParms.Writer->GetNumBits() : 0;
+	const int64 ReaderBitsBefore = DeltaParms.Reader ? DeltaParms.Reader->GetPosBits() : 0;
+
+	const bool bResult = FFastArraySerializer::FastArrayDeltaSerialize<FStreetMapReplicatedFlowItem, FStreetMapReplicatedFlow>(Items, DeltaParms, *this);
+
+	if (DeltaParms.Writer)
+	{
+		Counters.BytesSent += (DeltaParms.Writer->GetNumBits() - WriterBitsBefore + 7) / 8;
+	}
+	if (DeltaParms.Reader)
+	{
+		Counters.BytesReceived += (DeltaParms.Reader->GetPosBits() - ReaderBitsBefore + 7) / 8;
+	}
+
+	return bResult;
+}
+
+void FStreetMapReplicatedFlow::PostReplicatedReceive(const FFastArraySerializer::FPostReplicatedReceiveParameters& Parameters)
+{
+	Counters.NumUpdatesReceived++;
+
+	// Items only update the data, roads are recolored once per update
+	if (Owner != nullptr)
+	{
+		Owner->ApplyReplicatedFlow();
+	}
+}
@@ -0,0 +1,236 @@
+// Copyright 2017 Mike Fricker. All Rights Reserved.
+
+#include "StreetMapRoadAttributes.h"
+#include "StreetMapRuntime.h"
+#include "StreetMapColorSlots.h"
+#include "Engine/Texture2D.h"
+
+
+FStreetMapRoadAttributes::FStreetMapRoadAttributes()
+	: NumRoads(0)
+{
+}
+
+void FStreetMapRoadAttributes::Init(int32 InNumRoads)
+{
+	NumRoads = InNumRoads;
+
+	Texels.Reset();
+	Texels.SetNumZeroed(TextureWidth * GetTextureHeight());
+
+	for (int32 RoadIndex = 0; RoadIndex < NumRoads; ++RoadIndex)
+	{
+		Texels[RoadIndex * TexelsPerRoad] = FColor(255, 255, 255, 255);
+		Texels[RoadIndex * TexelsPerRoad + 1] = FColor(255, 0, 0, 255);
+	}
+
+	// Everything is uploaded by CreateTexture() or the next Flush()
+	RowDirtyMinX.Init(0, GetTextureHeight());
+	RowDirtyMaxX.Init(TextureWidth - 1, GetTextureHeight());
+	DirtyRows.Reset(GetTextureHeight());
+	for (int32 Row = 0; Row < GetTextureHeight(); ++Row)
+	{
+		DirtyRows.Add(Row);
+	}
+}
+
+int32 FStreetMapRoadAttributes::GetTextureHeight() const
+{
+	return FMath::Max(1, FMath::DivideAndRoundUp(NumRoads * TexelsPerRoad, TextureWidth));
+}
+
+void FStreetMapRoadAttributes::MarkDirty(int32 RoadIndex)
+{
+	// The texels of a road may wrap onto the next row
+	const int32 FirstTexel = RoadIndex * TexelsPerRoad;
+	const int32 LastTexel = FirstTexel + TexelsPerRoad - 1;
+	for (int32 Row = FirstTexel / TextureWidth; Row <= LastTexel / TextureWidth; ++Row)
+	{
+		const int32 MinX = FMath::Max(FirstTexel - Row * TextureWidth, 0);
+		const int32 MaxX = FMath::Min(LastTexel - Row * TextureWidth, TextureWidth - 1);
+		if (RowDirtyMaxX[Row] < 0)
+		{
+			DirtyRows.Add(Row);
+		}
+		RowDirtyMinX[Row] = FMath::Min(RowDirtyMinX[Row], MinX);
+		RowDirtyMaxX[Row] = FMath::Max(RowDirtyMaxX[Row], MaxX);
+	}
+}
+
+void FStreetMapRoadAttributes::ClearDirty()
+{
+	for (int32 Row : DirtyRows)
+	{
+		RowDirtyMinX[Row] = TextureWidth;
+		RowDirtyMaxX[Row] = -1;
+	}
+	DirtyRows.Reset();
+}
+
+void FStreetMapRoadAttributes::SetSpeedRatios(int32 RoadIndex, const uint8* QuantizedSlots)
+{
+	if (RoadIndex < 0 || RoadIndex >= NumRoads) return;
+
+	static_assert(FStreetMapColorSlots::NumSlots == 5, "Texel layout holds exactly five color slots");
+
+	const FColor SlotTexel(QuantizedSlots[0], QuantizedSlots[1], QuantizedSlots[2], QuantizedSlots[3]);
+	FColor& Texel = Texels[RoadIndex * TexelsPerRoad];
+	FColor& StateTexel = Texels[RoadIndex * TexelsPerRoad + 1];
+	if (Texel != SlotTexel || StateTexel.R != QuantizedSlots[4])
+	{
+		Texel = SlotTexel;
+		StateTexel.R = QuantizedSlots[4];
+		MarkDirty(RoadIndex);
+	}
+}
+
+void FStreetMapRoadAttributes::SetTrace(int32 RoadIndex, bool bOnTrace, FColor TraceColor)
+{
+	if (RoadIndex < 0 || RoadIndex >= NumRoads) return;
+
+	FColor& Texel = Texels[RoadIndex * TexelsPerRoad + 1];
+	FColor& ColorTexel = Texels[RoadIndex * TexelsPerRoad + 2];
+	const uint8 State = bOnTrace ? 255 : 0;
+	if (!bOnTrace)
+	{
+		TraceColor = FColor(0, 0, 0, 0);
+	}
+
+	if (Texel.G != State || ColorTexel != TraceColor)
+	{
+		Texel.G = State;
+		ColorTexel = TraceColor;
+		MarkDirty(RoadIndex);
+	}
+}
+
+void FStreetMapRoadAttributes::SetHighlight(int32 RoadIndex, bool bHighlighted)
+{
+	if (RoadIndex < 0 || RoadIndex >= NumRoads) return;
+
+	const uint8 State = bHighlighted ? 255 : 0;
+	FColor& Texel = Texels[RoadIndex * TexelsPerRoad + 1];
+	if (Texel.B != State)
+	{
+		Texel.B = State;
+		MarkDirty(RoadIndex);
+	}
+}
+
+float FStreetMapRoadAttributes::GetSpeedRatio(int32 RoadIndex, int32 Slot) const
+{
+	if (RoadIndex < 0 || RoadIndex >= NumRoads || Slot < 0 || Slot >= FStreetMapColorSlots::NumSlots) return 1.0f;
+
+	const FColor& Texel = Texels[RoadIndex * TexelsPerRoad];
+	switch (Slot) {
+	case 0:
+		return Texel.R / 255.0f;
+	case 1:
+		return Texel.G / 255.0f;
+	case 2:
+		return Texel.B / 255.0f;
+	case 3:
+		return Texel.A / 255.0f;
+	default:
+		return Texels[RoadIndex * TexelsPerRoad + 1].R / 255.0f;
+	}
+}
+
+void FStreetMapRoadAttributes::GetSpeedRatios(int32 RoadIndex, uint8* OutQuantizedSlots) const
+{
+	if (RoadIndex < 0 || RoadIndex >= NumRoads)
+	{
+		FMemory::Memset(OutQuantizedSlots, 255, FStreetMapColorSlots::NumSlots);
+		return;
+	}
+
+	const FColor& Texel = Texels[RoadIndex * TexelsPerRoad];
+	OutQuantizedSlots[0] = Texel.R;
+	OutQuantizedSlots[1] = Texel.G;
+	OutQuantizedSlots[2] = Texel.B;
+	OutQuantizedSlots[3] = Texel.A;
+	OutQuantizedSlots[4] = Texels[RoadIndex * TexelsPerRoad + 1].R;
+}
+
+bool FStreetMapRoadAttributes::IsOnTrace(int32 RoadIndex) const
+{
+	if (RoadIndex < 0 || RoadIndex >= NumRoads) return false;
+
+	return Texels[RoadIndex * TexelsPerRoad + 1].G != 0;
+}
+
+FColor FStreetMapRoadAttributes::GetTraceColor(int32 RoadIndex) const
+{
+	if (RoadIndex < 0 || RoadIndex >= NumRoads) return FColor(0, 0, 0, 0);
+
+	return Texels[RoadIndex * TexelsPerRoad + 2];
+}
+
+bool FStreetMapRoadAttributes::IsHighlighted(int32 RoadIndex) const
+{
+	if (RoadIndex < 0 || RoadIndex >= NumRoads) return false;
+
+	return Texels[RoadIndex * TexelsPerRoad + 1].B != 0;
+}
+
+UTexture2D* FStreetMapRoadAttributes::CreateTexture()
+{
+	UTexture2D* Texture = UTexture2D::CreateTransient(TextureWidth, GetTextureHeight(), PF_B8G8R8A8);
+	if (Texture == nullptr) return nullptr;
+
+	// Attributes are looked up per texel, never filtered or converted
+	Texture->Filter = TF_Nearest;
+	Texture->SRGB = false;
+	Texture->CompressionSettings = TC_VectorDisplacementmap;
+	Texture->NeverStream = true;
+	Texture->AddressX = TA_Clamp;
+	Texture->AddressY = TA_Clamp;
+
+	FTexture2DMipMap& Mip = Texture->PlatformData->Mips[0];
+	void* MipData = Mip.BulkData.Lock(LOCK_READ_WRITE);
+	FMemory::Memcpy(MipData, Texels.GetData(), Texels.Num() * sizeof(FColor));
+	Mip.BulkData.Unlock();
+
+	Texture->UpdateResource();
+
+	ClearDirty();
+
+	return Texture;
+}
+
+int32 FStreetMapRoadAttributes::Flush(UTexture2D* Texture)
+{
+	if (!IsDirty() || Texture == nullptr) return 0;
+
+	if (Texture->GetSizeX() != TextureWidth || Texture->GetSizeY() != GetTextureHeight()) return 0;
+
+	// The render thread reads the data after this returns, so it gets its own copy of the dirty rows, stacked in
+	// the order of the regions
+	const int32 NumRegions = DirtyRows.Num();
+	const int32 RowBytes = TextureWidth * sizeof(FColor);
+	uint8* Data = (uint8*)FMemory::Malloc(NumRegions * RowBytes);
+	FUpdateTextureRegion2D* Regions = new FUpdateTextureRegion2D[NumRegions];
+
+	int32 NumBytes = 0;
+	for (int32 RegionIndex = 0; RegionIndex < NumRegions; ++RegionIndex)
+	{
+		const int32 Row = DirtyRows[RegionIndex];
+		const int32 MinX = RowDirtyMinX[Row];
+		const int32 Width = RowDirtyMaxX[Row] - MinX + 1;
+
+		FMemory::Memcpy(Data + RegionIndex * RowBytes + MinX * sizeof(FColor), Texels.GetData() + Row * TextureWidth + MinX, Width * sizeof(FColor));
+		Regions[RegionIndex] = FUpdateTextureRegion2D(MinX, Row, MinX, RegionIndex, Width, 1);
+		NumBytes += Width * sizeof(FColor);
+	}
+
+	Texture->UpdateTextureRegions(0, NumRegions, Regions, RowBytes, sizeof(FColor), Data,
+		[](uint8* SrcData, const FUpdateTextureRegion2D* InRegions)
+		{
+			FMemory::Free(SrcData);
+			delete[] InRegions;
+		});
+
+	ClearDirty();
+
+	return NumBytes;
+}
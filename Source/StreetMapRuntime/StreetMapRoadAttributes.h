@@ -0,0 +1,83 @@
+// Copyright 2017 Mike Fricker. All Rights Reserved.
+#pragma once
+
+#include "CoreMinimal.h"
+
+class UTexture2D;
+
+/**
+ * Per-road render state used when the street map is colored from road attributes instead of vertex colors.
+ * Every road owns three texels of a small texture: the first one holds the speed ratio of the Flow, Predictive0,
+ * Predictive15 and Predictive30 color slots, the second one the Predictive45 slot (R), trace state (G) and
+ * highlight state (B), the third one the color of the trace the road belongs to.  The material picks the slot of
+ * the current color mode, so switching modes needs no upload at all.  Road vertices only carry their road index
+ * in TexCoord5.Y, so a recolor uploads a few bytes per road and never touches vertex data.
+ */
+class FStreetMapRoadAttributes
+{
+
+public:
+
+	/** Number of texels used by each road */
+	static const int32 TexelsPerRoad = 3;
+
+	/** Width of the attribute texture, roads wrap onto the next row */
+	static const int32 TextureWidth = 1024;
+
+	FStreetMapRoadAttributes();
+
+	/** Resets all roads to full speed in every slot, no trace and no highlight, and flags everything for upload */
+	void Init(int32 InNumRoads);
+
+	/** @return Number of roads */
+	int32 Num() const
+	{
+		return NumRoads;
+	}
+
+	/** @return Height of the attribute texture in texels */
+	int32 GetTextureHeight() const;
+
+	/** Setters, each one flags the road for the next Flush() when its texels actually change */
+	void SetSpeedRatios(int32 RoadIndex, const uint8* QuantizedSlots);
+	void SetTrace(int32 RoadIndex, bool bOnTrace, FColor TraceColor);
+	void SetHighlight(int32 RoadIndex, bool bHighlighted);
+
+	/** Getters, return the quantized values the material sees */
+	float GetSpeedRatio(int32 RoadIndex, int32 Slot) const;
+	void GetSpeedRatios(int32 RoadIndex, uint8* OutQuantizedSlots) const;
+	bool IsOnTrace(int32 RoadIndex) const;
+	FColor GetTraceColor(int32 RoadIndex) const;
+	bool IsHighlighted(int32 RoadIndex) const;
+
+	/** @return True if some roads changed since the last upload */
+	bool IsDirty() const
+	{
+		return DirtyRows.Num() > 0;
+	}
+
+	/** Creates a transient texture holding the current attributes of all roads */
+	UTexture2D* CreateTexture();
+
+	/**
+	* Copies the dirty texels into the texture, one region per texture row spanning the dirty texels of that row
+	* @return Number of bytes uploaded
+	*/
+	int32 Flush(UTexture2D* Texture);
+
+private:
+
+	void MarkDirty(int32 RoadIndex);
+
+	void ClearDirty();
+
+	/** Texels of the whole texture, B8G8R8A8 */
+	TArray<FColor> Texels;
+
+	int32 NumRoads;
+
+	/** Rows with texels changed since the last upload, and the inclusive texel span changed in each row */
+	TArray<int32> DirtyRows;
+	TArray<int32> RowDirtyMinX;
+	TArray<int32> RowDirtyMaxX;
+};
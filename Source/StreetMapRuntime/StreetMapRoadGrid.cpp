@@ -0,0 +1,148 @@
+// Copyright 2017 Mike Fricker. All Rights Reserved.
+
+#include "StreetMapRoadGrid.h"
+#include "StreetMapRuntime.h"
+#include "StreetMap.h"
+
+
+FStreetMapRoadGrid::FStreetMapRoadGrid()
+	: Origin(FVector2D::ZeroVector),
+	  CellSize(1.0f),
+	  Width(0),
+	  Height(0),
+	  QueryStamp(0)
+{
+}
+
+void FStreetMapRoadGrid::Reset()
+{
+	CellStarts.Empty();
+	CellRoads.Empty();
+	RoadStamps.Empty();
+	Width = 0;
+	Height = 0;
+}
+
+void FStreetMapRoadGrid::GetCellCoords(FVector2D Location, int32& OutX, int32& OutY) const
+{
+	OutX = FMath::Clamp(FMath::FloorToInt((Location.X - Origin.X) / CellSize), 0, Width - 1);
+	OutY = FMath::Clamp(FMath::FloorToInt((Location.Y - Origin.Y) / CellSize), 0, Height - 1);
+}
+
+void FStreetMapRoadGrid::Init(const TArray<FStreetMapRoad>& Roads, FVector2D BoundsMin, FVector2D BoundsMax, int32 Resolution)
+{
+	const FVector2D Size = BoundsMax - BoundsMin;
+	Origin = BoundsMin;
+	CellSize = FMath::Max(FMath::Max(Size.X, Size.Y) / FMath::Max(Resolution, 1), 1.0f);
+	Width = FMath::Max(FMath::CeilToInt(Size.X / CellSize), 1);
+	Height = FMath::Max(FMath::CeilToInt(Size.Y / CellSize), 1);
+
+	RoadStamps.Init(0, Roads.Num());
+	QueryStamp = 0;
+
+	// Visits every cell a road overlaps once, segment by segment
+	auto ForEachRoadCell = [this](const FStreetMapRoad& Road, uint32 Stamp, TArray<uint32>& CellStamps, TFunctionRef<void(int32)> Visit)
+	{
+		for (int32 PointIndex = 0; PointIndex < Road.RoadPoints.Num(); ++PointIndex)
+		{
+			const FVector2D& Start = Road.RoadPoints[PointIndex];
+			const FVector2D& End = Road.RoadPoints[FMath::Min(PointIndex + 1, Road.RoadPoints.Num() - 1)];
+
+			int32 MinX, MinY, MaxX, MaxY;
+			GetCellCoords(FVector2D(FMath::Min(Start.X, End.X), FMath::Min(Start.Y, End.Y)), MinX, MinY);
+			GetCellCoords(FVector2D(FMath::Max(Start.X, End.X), FMath::Max(Start.Y, End.Y)), MaxX, MaxY);
+
+			for (int32 Y = MinY; Y <= MaxY; ++Y)
+			{
+				for (int32 X = MinX; X <= MaxX; ++X)
+				{
+					const int32 CellIndex = Y * Width + X;
+					if (CellStamps[CellIndex] != Stamp)
+					{
+						CellStamps[CellIndex] = Stamp;
+						Visit(CellIndex);
+					}
+				}
+			}
+		}
+	};
+
+	const int32 NumCells = Width * Height;
+	TArray<uint32> CellStamps;
+	CellStamps.Init(0, NumCells);
+
+	// Count the roads of every cell, then turn the counts into offsets
+	CellStarts.Init(0, NumCells + 1);
+	for (int32 RoadIndex = 0; RoadIndex < Roads.Num(); ++RoadIndex)
+	{
+		ForEachRoadCell(Roads[RoadIndex], RoadIndex + 1, CellStamps, [this](int32 CellIndex) { ++CellStarts[CellIndex + 1]; });
+	}
+	for (int32 CellIndex = 0; CellIndex < NumCells; ++CellIndex)
+	{
+		CellStarts[CellIndex + 1] += CellStarts[CellIndex];
+	}
+
+	TArray<int32> CellEnds(CellStarts.GetData(), NumCells);
+	CellRoads.SetNumUninitialized(CellStarts[NumCells]);
+	FMemory::Memzero(CellStamps.GetData(), NumCells * sizeof(uint32));
+	for (int32 RoadIndex = 0; RoadIndex < Roads.Num(); ++RoadIndex)
+	{
+		ForEachRoadCell(Roads[RoadIndex], RoadIndex + 1, CellStamps, [this, &CellEnds, RoadIndex](int32 CellIndex) { CellRoads[CellEnds[CellIndex]++] = RoadIndex; });
+	}
+}
+
+int32 FStreetMapRoadGrid::FindNearest(const TArray<FStreetMapRoad>& Roads, FVector2D Location, float MaxDistance, uint32 RoadTypeMask, float& OutDistance)
+{
+	OutDistance = MaxDistance;
+	if (CellStarts.Num() == 0 || Roads.Num() != RoadStamps.Num()) return INDEX_NONE;
+
+	if (++QueryStamp == 0)
+	{
+		// Stamps wrapped around, forget every previous query
+		FMemory::Memzero(RoadStamps.GetData(), RoadStamps.Num() * sizeof(uint32));
+		QueryStamp = 1;
+	}
+
+	int32 MinX, MinY, MaxX, MaxY;
+	GetCellCoords(Location - FVector2D(MaxDistance, MaxDistance), MinX, MinY);
+	GetCellCoords(Location + FVector2D(MaxDistance, MaxDistance), MaxX, MaxY);
+
+	int32 NearestRoad = INDEX_NONE;
+	float NearestDistanceSq = MaxDistance * MaxDistance;
+
+	for (int32 Y = MinY; Y <= MaxY; ++Y)
+	{
+		for (int32 X = MinX; X <= MaxX; ++X)
+		{
+			const int32 CellIndex = Y * Width + X;
+			for (int32 Entry = CellStarts[CellIndex]; Entry < CellStarts[CellIndex + 1]; ++Entry)
+			{
+				const int32 RoadIndex = CellRoads[Entry];
+				if (RoadStamps[RoadIndex] == QueryStamp) continue;
+				RoadStamps[RoadIndex] = QueryStamp;
+
+				const FStreetMapRoad& Road = Roads[RoadIndex];
+				if ((RoadTypeMask & (1u << Road.RoadType)) == 0) continue;
+
+				for (int32 PointIndex = 0; PointIndex < Road.RoadPoints.Num(); ++PointIndex)
+				{
+					const FVector2D& Start = Road.RoadPoints[PointIndex];
+					const FVector2D& End = Road.RoadPoints[FMath::Min(PointIndex + 1, Road.RoadPoints.Num() - 1)];
+					const float DistanceSq = (FMath::ClosestPointOnSegment2D(Location, Start, End) - Location).SizeSquared();
+					if (DistanceSq < NearestDistanceSq)
+					{
+						NearestDistanceSq = DistanceSq;
+						NearestRoad = RoadIndex;
+					}
+				}
+			}
+		}
+	}
+
+	if (NearestRoad != INDEX_NONE)
+	{
+		OutDistance = FMath::Sqrt(NearestDistanceSq);
+	}
+
+	return NearestRoad;
+}
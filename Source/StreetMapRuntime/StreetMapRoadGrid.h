@@ -0,0 +1,61 @@
+// Copyright 2017 Mike Fricker. All Rights Reserved.
+#pragma once
+
+#include "CoreMinimal.h"
+
+struct FStreetMapRoad;
+
+/**
+ * Uniform grid of road indices for picking the road under the cursor.  Every segment of a road is binned into the
+ * cells its bounds overlap, and cells are stored as one flat index list with an offset per cell, so a query reads
+ * the few cells around a location and measures the distance to the segments of the roads found there, without
+ * touching or copying any other road.
+ */
+class FStreetMapRoadGrid
+{
+
+public:
+
+	FStreetMapRoadGrid();
+
+	/**
+	* Bins the roads
+	* @param Resolution Cells along the longest side of the bounds, the other side keeps square cells
+	*/
+	void Init(const TArray<FStreetMapRoad>& Roads, FVector2D BoundsMin, FVector2D BoundsMax, int32 Resolution);
+
+	void Reset();
+
+	/** @return Number of roads binned by Init() */
+	int32 Num() const
+	{
+		return RoadStamps.Num();
+	}
+
+	/**
+	* Finds the road closest to a location
+	* @param Roads The roads passed to Init()
+	* @param MaxDistance Roads further away are ignored
+	* @param RoadTypeMask Bit per EStreetMapRoadType of the roads to consider
+	* @param OutDistance Distance to the closest segment of the road found
+	* @return Index of the road, INDEX_NONE if there is none in range
+	*/
+	int32 FindNearest(const TArray<FStreetMapRoad>& Roads, FVector2D Location, float MaxDistance, uint32 RoadTypeMask, float& OutDistance);
+
+private:
+
+	void GetCellCoords(FVector2D Location, int32& OutX, int32& OutY) const;
+
+	FVector2D Origin;
+	float CellSize;
+	int32 Width;
+	int32 Height;
+
+	/** Roads of cell N are CellRoads[CellStarts[N]] up to CellRoads[CellStarts[N + 1]] */
+	TArray<int32> CellStarts;
+	TArray<int32> CellRoads;
+
+	/** Query a road was last measured by, so roads spanning several cells are measured once */
+	TArray<uint32> RoadStamps;
+	uint32 QueryStamp;
+};
@@ -0,0 +1,115 @@
+// Copyright 2017 Mike Fricker. All Rights Reserved.
+
+#include "StreetMapRoadSegments.h"
+#include "StreetMapRuntime.h"
+#include "StreetMapComponent.h"
+
+
+const float FStreetMapRoadSegments::QuadSize = 100.0f;
+
+void FStreetMapRoadSegments::Init(const TArray<FStreetMapRoad>& Roads)
+{
+	Reset();
+
+	int32 NumSegments = 0;
+	for (const FStreetMapRoad& Road : Roads)
+	{
+		NumSegments += FMath::Max(Road.RoadPoints.Num() - 1, 0);
+	}
+
+	Segments.Reserve(NumSegments);
+	RoadFirstSegments.SetNumUninitialized(Roads.Num() + 1);
+	RoadFirstInstances.SetNumUninitialized(Roads.Num());
+	RoadSections.SetNumUninitialized(Roads.Num());
+	RoadForward.SetNumUninitialized(Roads.Num());
+
+	for (int32 RoadIndex = 0; RoadIndex < Roads.Num(); ++RoadIndex)
+	{
+		const FStreetMapRoad& Road = Roads[RoadIndex];
+		const EVertexType Section = UStreetMapComponent::GetVertexTypeForRoad(Road.RoadType);
+
+		RoadFirstSegments[RoadIndex] = Segments.Num();
+		RoadFirstInstances[RoadIndex] = SectionNumInstances[Section];
+		RoadSections[RoadIndex] = Section;
+		RoadForward[RoadIndex] = Road.Link.LinkDir.Compare(TEXT("T"), ESearchCase::IgnoreCase) == 0 ? 1 : 0;
+
+		for (int32 PointIndex = 0; PointIndex < Road.RoadPoints.Num() - 1; ++PointIndex)
+		{
+			FStreetMapRoadSegment& Segment = Segments.AddDefaulted_GetRef();
+			Segment.Start = Road.RoadPoints[PointIndex];
+			Segment.End = Road.RoadPoints[PointIndex + 1];
+			Segment.RoadIndex = RoadIndex;
+		}
+
+		SectionNumInstances[Section] += Segments.Num() - RoadFirstSegments[RoadIndex];
+	}
+	RoadFirstSegments[Roads.Num()] = Segments.Num();
+}
+
+void FStreetMapRoadSegments::Reset()
+{
+	Segments.Empty();
+	RoadFirstSegments.Empty();
+	RoadFirstInstances.Empty();
+	RoadSections.Empty();
+	RoadForward.Empty();
+	FMemory::Memzero(SectionNumInstances, sizeof(SectionNumInstances));
+}
+
+void FStreetMapRoadSegments::ExpandSegment(const FVector2D& Start, const FVector2D& End, float Z, float Thickness, bool bForward, FVector OutCorners[4])
+{
+	const float HalfThickness = Thickness * 0.5f;
+	const FVector2D LineDirection = (End - Start).GetSafeNormal();
+	const FVector2D RightVector(-LineDirection.Y, LineDirection.X);
+
+	// Roads only cover the side of their centerline their direction drives on
+	if (bForward)
+	{
+		OutCorners[0] = FVector(Start, Z);
+		OutCorners[1] = FVector(Start + RightVector * HalfThickness, Z);
+		OutCorners[2] = FVector(End + RightVector * HalfThickness, Z);
+		OutCorners[3] = FVector(End, Z);
+	}
+	else
+	{
+		OutCorners[0] = FVector(Start - RightVector * HalfThickness, Z);
+		OutCorners[1] = FVector(Start, Z);
+		OutCorners[2] = FVector(End, Z);
+		OutCorners[3] = FVector(End - RightVector * HalfThickness, Z);
+	}
+}
+
+FTransform FStreetMapRoadSegments::GetInstanceTransform(const FVector2D& Start, const FVector2D& End, float Z, float Thickness, bool bForward)
+{
+	const float HalfThickness = Thickness * 0.5f;
+	const float Length = (End - Start).Size();
+	const FVector2D LineDirection = (End - Start).GetSafeNormal();
+	const FVector2D RightVector(-LineDirection.Y, LineDirection.X);
+
+	// Zero length segments collapse to a point like their mesh quad does
+	if (LineDirection.IsZero())
+	{
+		return FTransform(FQuat::Identity, FVector(Start, Z), FVector(0.0f, 0.0f, 1.0f));
+	}
+
+	// The quad's X axis runs along the segment, its Y axis to the right, across the half of the road it covers
+	const FVector2D Center = (Start + End) * 0.5f + RightVector * (bForward ? HalfThickness : -HalfThickness) * 0.5f;
+	const FQuat Rotation(FVector::UpVector, FMath::Atan2(LineDirection.Y, LineDirection.X));
+
+	return FTransform(Rotation, FVector(Center, Z), FVector(Length / QuadSize, HalfThickness / QuadSize, 1.0f));
+}
+
+void FStreetMapRoadSegments::GetQuadCorners(FVector OutCorners[4])
+{
+	const float HalfSize = QuadSize * 0.5f;
+	OutCorners[0] = FVector(-HalfSize, -HalfSize, 0.0f);
+	OutCorners[1] = FVector(-HalfSize, HalfSize, 0.0f);
+	OutCorners[2] = FVector(HalfSize, HalfSize, 0.0f);
+	OutCorners[3] = FVector(HalfSize, -HalfSize, 0.0f);
+}
+
+SIZE_T FStreetMapRoadSegments::GetAllocatedSize() const
+{
+	return Segments.GetAllocatedSize() + RoadFirstSegments.GetAllocatedSize() + RoadFirstInstances.GetAllocatedSize() +
+		RoadSections.GetAllocatedSize() + RoadForward.GetAllocatedSize();
+}
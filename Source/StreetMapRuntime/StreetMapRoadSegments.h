@@ -0,0 +1,140 @@
+// Copyright 2017 Mike Fricker. All Rights Reserved.
+#pragma once
+
+#include "CoreMinimal.h"
+#include "StreetMap.h"
+#include "StreetMapRoadSegments.generated.h"
+
+/** Size and validation of the instanced road segments, see FStreetMapMeshBuildSettings::bDrawRoadsAsSegments */
+USTRUCT(BlueprintType)
+struct FStreetMapRoadSegmentStats
+{
+	GENERATED_USTRUCT_BODY()
+
+	UPROPERTY(BlueprintReadOnly, Category = "StreetMap")
+		int32 NumSegments = 0;
+
+	/** Bytes of the segments and their per-road data on the CPU */
+	UPROPERTY(BlueprintReadOnly, Category = "StreetMap")
+		int64 SegmentBytes = 0;
+
+	/** Bytes of the per-instance transforms and custom data on the GPU */
+	UPROPERTY(BlueprintReadOnly, Category = "StreetMap")
+		int64 InstanceBytes = 0;
+
+	/** Bytes the same roads take on the GPU as mesh quads, four vertices and six 16-bit indices per segment */
+	UPROPERTY(BlueprintReadOnly, Category = "StreetMap")
+		int64 ExpandedBytes = 0;
+
+	/** Segments whose CPU expansion was compared with their instance and, when roads are in the mesh, their quad */
+	UPROPERTY(BlueprintReadOnly, Category = "StreetMap")
+		int32 NumValidatedSegments = 0;
+
+	/** Largest distance between a corner of the CPU expansion and the same corner of the instance or mesh quad */
+	UPROPERTY(BlueprintReadOnly, Category = "StreetMap")
+		float MaxCornerError = 0.0f;
+};
+
+/** One straight piece of a road, between two consecutive road points */
+struct FStreetMapRoadSegment
+{
+	FVector2D Start;
+	FVector2D End;
+
+	/** Index of the road, the material looks the road up in the per-road attribute texture with it */
+	int32 RoadIndex;
+};
+
+/**
+ * Roads as a flat list of segments instead of mesh quads.  A segment is drawn as one instance of a unit quad whose
+ * transform stretches it from the start to the end of the segment and across the width of the road, so its four
+ * vertices only exist in the vertex shader, and a thickness change rewrites transforms rather than the mesh.
+ * Segments are stored in road order, with the section and direction of every road kept once per road.  ExpandSegment()
+ * computes on the CPU the same corners AddThick2DLine() generates, to validate the instances without a GPU.
+ */
+class STREETMAPRUNTIME_API FStreetMapRoadSegments
+{
+
+public:
+
+	/** Side length of the unit quad mesh instances are drawn with, /Engine/BasicShapes/Plane */
+	static const float QuadSize;
+
+	/** Per-instance custom data floats: the road index, then the linear color of the road */
+	static const int32 NumCustomDataFloats = 4;
+
+	/** Collects the segments of every road */
+	void Init(const TArray<FStreetMapRoad>& Roads);
+
+	void Reset();
+
+	int32 Num() const
+	{
+		return Segments.Num();
+	}
+
+	int32 NumRoads() const
+	{
+		return RoadSections.Num();
+	}
+
+	const FStreetMapRoadSegment& GetSegment(int32 SegmentIndex) const
+	{
+		return Segments[SegmentIndex];
+	}
+
+	/** Segments of a road are GetFirstSegment(RoadIndex) up to GetFirstSegment(RoadIndex + 1) */
+	int32 GetFirstSegment(int32 RoadIndex) const
+	{
+		return RoadFirstSegments[RoadIndex];
+	}
+
+	/** Instance of the first segment of a road among the instances of its section */
+	int32 GetFirstInstance(int32 RoadIndex) const
+	{
+		return RoadFirstInstances[RoadIndex];
+	}
+
+	EVertexType GetSection(int32 RoadIndex) const
+	{
+		return (EVertexType)RoadSections[RoadIndex];
+	}
+
+	/** True for roads drawn right of their centerline, see FStreetMapLink::LinkDir */
+	bool IsForward(int32 RoadIndex) const
+	{
+		return RoadForward[RoadIndex] != 0;
+	}
+
+	/** Number of instances of a section */
+	int32 GetNumInstances(EVertexType Section) const
+	{
+		return SectionNumInstances[Section];
+	}
+
+	/**
+	* Expands a road segment into its quad the way AddThick2DLine() does
+	* @param OutCorners Bottom left, bottom right, top right and top left, drawn as triangles 0 1 2 and 0 2 3
+	*/
+	static void ExpandSegment(const FVector2D& Start, const FVector2D& End, float Z, float Thickness, bool bForward, FVector OutCorners[4]);
+
+	/** Transform of the unit quad instance covering the quad ExpandSegment() returns */
+	static FTransform GetInstanceTransform(const FVector2D& Start, const FVector2D& End, float Z, float Thickness, bool bForward);
+
+	/** Corners of the unit quad in instance space, in the order of ExpandSegment() */
+	static void GetQuadCorners(FVector OutCorners[4]);
+
+	SIZE_T GetAllocatedSize() const;
+
+private:
+
+	TArray<FStreetMapRoadSegment> Segments;
+
+	/** One more entry than there are roads, the last one is the number of segments */
+	TArray<int32> RoadFirstSegments;
+	TArray<int32> RoadFirstInstances;
+	TArray<uint8> RoadSections;
+	TArray<uint8> RoadForward;
+
+	int32 SectionNumInstances[EVertexType::VBuilding] = { 0 };
+};
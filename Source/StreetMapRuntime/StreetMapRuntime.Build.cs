@@ -15,7 +15,10 @@ namespace UnrealBuildTool.Rules
                     "RHI",
                     "RenderCore",
                     "Renderer",
-                    "Landscape"
+                    "Landscape",
+                    "Sockets",
+                    "NetCore",
+                    "Json"
                 }
             );
 
@@ -1,7 +1,7 @@
-// Copyright 2017 Mike Fricker. All Rights Reserved.
-#pragma once
-
-#include "EngineMinimal.h"
-#include "Engine/Engine.h"	// For UEngine
-#include "EngineGlobals.h"	// For GEngine
-
+// Copyright 2017 Mike Fricker. All Rights Reserved.
+#pragma once
+
+#include "EngineMinimal.h"
+#include "Engine/Engine.h"	// For UEngine
+#include "EngineGlobals.h"	// For GEngine
+
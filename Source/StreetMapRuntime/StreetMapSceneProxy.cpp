@@ -1,286 +1,919 @@
-// Copyright 2017 Mike Fricker. All Rights Reserved.
-
-#include "StreetMapSceneProxy.h"
-#include "StreetMapRuntime.h"
-#include "StreetMapComponent.h"
-#include "Runtime/Engine/Public/SceneManagement.h"
-#include "Runtime/Renderer/Public/MeshPassProcessor.h"
-#include "Runtime/Renderer/Public/PrimitiveSceneInfo.h"
-
-FStreetMapSceneProxy::FStreetMapSceneProxy(const UStreetMapComponent* InComponent)
-	: FPrimitiveSceneProxy(InComponent),
-	BuildingVertexFactory(GetScene().GetFeatureLevel(), "FStreetMapSceneProxy"),
-	StreetVertexFactory(GetScene().GetFeatureLevel(), "FStreetMapSceneProxy"),
-	MajorRoadVertexFactory(GetScene().GetFeatureLevel(), "FStreetMapSceneProxy"),
-	HighwayVertexFactory(GetScene().GetFeatureLevel(), "FStreetMapSceneProxy"),
-	StreetMapComp(InComponent),
-	CollisionResponse(InComponent->GetCollisionResponseToChannels())
-{
-
-}
-
-void FStreetMapSceneProxy::Init(const UStreetMapComponent* InComponent, EVertexType Type, const TArray< FStreetMapVertex >& Vertices, const TArray< uint32 >& Indices)
-{
-	// Copy index buffer
-	switch (Type) {
-	case EVertexType::VBuilding:
-		BuildingIndexBuffer32.Indices = Indices;
-		break;
-	case EVertexType::VStreet:
-		StreetIndexBuffer32.Indices = Indices;
-		break;
-	case EVertexType::VMajorRoad:
-		MajorRoadIndexBuffer32.Indices = Indices;
-		break;
-	case EVertexType::VHighway:
-		HighwayIndexBuffer32.Indices = Indices;
-		break;
-	}
-
-	if (Indices.Num() == 0) return;
-	
-	MaterialInterface = nullptr;
-	this->MaterialRelevance = InComponent->GetMaterialRelevance(GetScene().GetFeatureLevel());
-
-	const int32 NumVerts = Vertices.Num();
-
-	TArray<FDynamicMeshVertex> DynamicVertices;
-	DynamicVertices.SetNumUninitialized(NumVerts);
-
-	for (int VertIdx = 0; VertIdx < NumVerts; VertIdx++)
-	{
-		const FStreetMapVertex& StreetMapVert = Vertices[VertIdx];
-		FDynamicMeshVertex& Vert = DynamicVertices[VertIdx];
-		Vert.Position = StreetMapVert.Position;
-		Vert.Color = StreetMapVert.Color;
-		Vert.TextureCoordinate[0] = StreetMapVert.TextureCoordinate;
-		Vert.TextureCoordinate[1] = StreetMapVert.TextureCoordinate2;
-		Vert.TextureCoordinate[2] = StreetMapVert.TextureCoordinate3;
-		Vert.TextureCoordinate[3] = StreetMapVert.TextureCoordinate4;
-		Vert.TextureCoordinate[4] = StreetMapVert.TextureCoordinate5;
-		Vert.TangentX = StreetMapVert.TangentX;
-		Vert.TangentZ = StreetMapVert.TangentZ;
-	}
-
-	switch (Type) {
-	case EVertexType::VBuilding:
-		BuildingVertexBuffer.InitFromDynamicVertex(&BuildingVertexFactory, DynamicVertices, 5);
-		
-		InitResources(BuildingVertexBuffer, BuildingIndexBuffer32, BuildingVertexFactory);
-		break;
-	case EVertexType::VStreet:
-		StreetVertexBuffer.InitFromDynamicVertex(&StreetVertexFactory, DynamicVertices, 5);
-
-		InitResources(StreetVertexBuffer, StreetIndexBuffer32, StreetVertexFactory);
-		break;
-	case EVertexType::VMajorRoad:
-		MajorRoadVertexBuffer.InitFromDynamicVertex(&MajorRoadVertexFactory, DynamicVertices, 5);
-
-		InitResources(MajorRoadVertexBuffer, MajorRoadIndexBuffer32, MajorRoadVertexFactory);
-		break;
-	case EVertexType::VHighway:
-		HighwayVertexBuffer.InitFromDynamicVertex(&HighwayVertexFactory, DynamicVertices, 5);
-		
-		InitResources(HighwayVertexBuffer, HighwayIndexBuffer32, HighwayVertexFactory);
-		break;
-	}
-	
-	// Set a material
-	{
-		if (InComponent->GetNumMaterials() > 0)
-		{
-			MaterialInterface = InComponent->GetMaterial(0);
-		}
-
-		// Use the default material if we don't have one set
-		if (MaterialInterface == nullptr)
-		{
-			MaterialInterface = UMaterial::GetDefaultMaterial(MD_Surface);
-		}
-	}
-}
-
-FStreetMapSceneProxy::~FStreetMapSceneProxy()
-{
-	StreetVertexBuffer.PositionVertexBuffer.ReleaseResource();
-	StreetVertexBuffer.StaticMeshVertexBuffer.ReleaseResource();
-	StreetVertexBuffer.ColorVertexBuffer.ReleaseResource();
-
-	MajorRoadVertexBuffer.PositionVertexBuffer.ReleaseResource();
-	MajorRoadVertexBuffer.StaticMeshVertexBuffer.ReleaseResource();
-	MajorRoadVertexBuffer.ColorVertexBuffer.ReleaseResource();
-
-	HighwayVertexBuffer.PositionVertexBuffer.ReleaseResource();
-	HighwayVertexBuffer.StaticMeshVertexBuffer.ReleaseResource();
-	HighwayVertexBuffer.ColorVertexBuffer.ReleaseResource();
-
-	BuildingVertexBuffer.PositionVertexBuffer.ReleaseResource();
-	BuildingVertexBuffer.StaticMeshVertexBuffer.ReleaseResource();
-	BuildingVertexBuffer.ColorVertexBuffer.ReleaseResource();
-
-	StreetIndexBuffer32.ReleaseResource();
-	MajorRoadIndexBuffer32.ReleaseResource();
-	HighwayIndexBuffer32.ReleaseResource();
-	BuildingIndexBuffer32.ReleaseResource();
-
-	StreetVertexFactory.ReleaseResource();
-	MajorRoadVertexFactory.ReleaseResource();
-	HighwayVertexFactory.ReleaseResource();
-	BuildingVertexFactory.ReleaseResource();
-}
-
-SIZE_T FStreetMapSceneProxy::GetTypeHash() const
-{
-	static size_t UniquePointer;
-	return reinterpret_cast<size_t>(&UniquePointer);
-}
-
-
-void FStreetMapSceneProxy::InitResources(FStaticMeshVertexBuffers& VertexBuffer, FDynamicMeshIndexBuffer32& IndexBuffer32, FLocalVertexFactory& VertexFactory)
-{
-	// Start initializing our vertex buffer, index buffer, and vertex factory.  This will be kicked off on the render thread.
-	BeginInitResource(&VertexBuffer.PositionVertexBuffer);
-	BeginInitResource(&VertexBuffer.StaticMeshVertexBuffer);
-	BeginInitResource(&VertexBuffer.ColorVertexBuffer);
-	BeginInitResource(&IndexBuffer32);
-	BeginInitResource(&VertexFactory);
-}
-
-
-bool FStreetMapSceneProxy::MustDrawMeshDynamically( const FSceneView& View ) const
-{
-	//return ( AllowDebugViewmodes() && View.Family->EngineShowFlags.Wireframe ) || IsSelected();
-	return true;
-}
-
-
-bool FStreetMapSceneProxy::IsInCollisionView(const FEngineShowFlags& EngineShowFlags) const
-{
-	return  EngineShowFlags.CollisionVisibility || EngineShowFlags.CollisionPawn;
-}
-
-FPrimitiveViewRelevance FStreetMapSceneProxy::GetViewRelevance( const FSceneView* View ) const
-{
-	FPrimitiveViewRelevance Result;
-	Result.bDrawRelevance = IsShown(View);
-	Result.bShadowRelevance = IsShadowCast(View);
-	Result.bRenderCustomDepth = ShouldRenderCustomDepth();
-	
-	const bool bAlwaysHasDynamicData = false;
-
-	// Only draw dynamically if we're drawing in wireframe or we're selected in the editor
-	Result.bDynamicRelevance = MustDrawMeshDynamically( *View ) || bAlwaysHasDynamicData;
-	Result.bStaticRelevance = !MustDrawMeshDynamically( *View );
-	
-	MaterialRelevance.SetPrimitiveViewRelevance(Result);
-	return Result;
-}
-
-
-bool FStreetMapSceneProxy::CanBeOccluded() const
-{
-	return !MaterialRelevance.bDisableDepthTest;
-}
-
-
-void FStreetMapSceneProxy::MakeMeshBatch(FMeshBatch& Mesh, class FMeshElementCollector& Collector, FMaterialRenderProxy* WireframeMaterialRenderProxyOrNull, const FStaticMeshVertexBuffers& VertexBuffer, const FDynamicMeshIndexBuffer32& IndexBuffer32, const FLocalVertexFactory& VertexFactory, bool bDrawCollision) const
-{
-	FMaterialRenderProxy* MaterialProxy = NULL;
-	if( WireframeMaterialRenderProxyOrNull != nullptr )
-	{
-		MaterialProxy = WireframeMaterialRenderProxyOrNull;
-	}
-	else
-	{
-		if (bDrawCollision)
-		{
-			MaterialProxy = new FColoredMaterialRenderProxy(GEngine->ShadedLevelColorationUnlitMaterial->GetRenderProxy(), FLinearColor::Blue);
-		}
-		else if (MaterialProxy == nullptr)
-		{
-			MaterialProxy = StreetMapComp->GetMaterial(0)->GetRenderProxy();
-		}
-	}
-	
-	FMeshBatchElement& BatchElement = Mesh.Elements[0];
-	BatchElement.IndexBuffer = &IndexBuffer32;
-	Mesh.bWireframe = WireframeMaterialRenderProxyOrNull != nullptr;
-	Mesh.VertexFactory = &VertexFactory;
-	Mesh.MaterialRenderProxy = MaterialProxy;
-	Mesh.CastShadow = true;
-	//	BatchElement.PrimitiveUniformBufferResource = &GetUniformBuffer();
-	//	BatchElement.PrimitiveUniformBuffer = CreatePrimitiveUniformBufferImmediate(GetLocalToWorld(), GetBounds(), GetLocalBounds(), true, UseEditorDepthTest());
-
-	FDynamicPrimitiveUniformBuffer& DynamicPrimitiveUniformBuffer = Collector.AllocateOneFrameResource<FDynamicPrimitiveUniformBuffer>();
-	DynamicPrimitiveUniformBuffer.Set(GetLocalToWorld(), GetLocalToWorld(), GetBounds(), GetLocalBounds(), true, false, DrawsVelocity(), false);
-	BatchElement.PrimitiveUniformBufferResource = &DynamicPrimitiveUniformBuffer.UniformBuffer;
-	BatchElement.FirstIndex = 0;
-	const int IndexCount = IndexBuffer32.Indices.Num();
-	BatchElement.NumPrimitives = IndexCount / 3;
-	BatchElement.MinVertexIndex = 0;
-	BatchElement.MaxVertexIndex = VertexBuffer.PositionVertexBuffer.GetNumVertices() - 1;
-	Mesh.ReverseCulling = IsLocalToWorldDeterminantNegative();
-	Mesh.Type = PT_TriangleList;
-	Mesh.DepthPriorityGroup = SDPG_World;
-}
-//
-//void FStreetMapSceneProxy::DrawStaticElements( FStaticPrimitiveDrawInterface* PDI )
-//{
-//	const int IndexCount = IndexBuffer32.Indices.Num();
-//	if (VertexBuffer.PositionVertexBuffer.GetNumVertices() > 0 && IndexCount > 0)
-//	{
-//		const float ScreenSize = 1.0f;
-//
-//		FMeshBatch MeshBatch;
-//		MakeMeshBatch( MeshBatch, nullptr);
-//		PDI->DrawMesh( MeshBatch, ScreenSize );
-//	}
-//}
-
-
-void FStreetMapSceneProxy::GetDynamicMeshElements(const TArray<const FSceneView*>& Views, const FSceneViewFamily& ViewFamily, uint32 VisibilityMap, class FMeshElementCollector& Collector) const
-{
-	this->AddDynamicMeshElements(Views, ViewFamily, VisibilityMap, Collector, StreetVertexBuffer, StreetIndexBuffer32, StreetVertexFactory);
-	this->AddDynamicMeshElements(Views, ViewFamily, VisibilityMap, Collector, MajorRoadVertexBuffer, MajorRoadIndexBuffer32, MajorRoadVertexFactory);
-	this->AddDynamicMeshElements(Views, ViewFamily, VisibilityMap, Collector, HighwayVertexBuffer, HighwayIndexBuffer32, HighwayVertexFactory);
-	this->AddDynamicMeshElements(Views, ViewFamily, VisibilityMap, Collector, BuildingVertexBuffer, BuildingIndexBuffer32, BuildingVertexFactory);
-}
-
-void FStreetMapSceneProxy::AddDynamicMeshElements(const TArray<const FSceneView*>& Views, const FSceneViewFamily& ViewFamily, uint32 VisibilityMap, class FMeshElementCollector& Collector, const FStaticMeshVertexBuffers& VertexBuffer, const FDynamicMeshIndexBuffer32& IndexBuffer32, const FLocalVertexFactory& VertexFactory) const
-{
-	const int IndexCount = IndexBuffer32.Indices.Num();
-	if (VertexBuffer.PositionVertexBuffer.GetNumVertices() > 0 && IndexCount > 0)
-	{
-		for (int32 ViewIndex = 0; ViewIndex < Views.Num(); ++ViewIndex)
-		{
-			const FSceneView& View = *Views[ViewIndex];
-
-			const bool bIsWireframe = AllowDebugViewmodes() && View.Family->EngineShowFlags.Wireframe;
-
-			FColoredMaterialRenderProxy* WireframeMaterialRenderProxy = GEngine->WireframeMaterial && bIsWireframe ? new FColoredMaterialRenderProxy(GEngine->WireframeMaterial->GetRenderProxy(), FLinearColor(0, 0.5f, 1.f)) : NULL;
-
-
-			if (MustDrawMeshDynamically(View))
-			{
-				const bool bInCollisionView = IsInCollisionView(ViewFamily.EngineShowFlags);
-				const bool bCanDrawCollision = bInCollisionView && IsCollisionEnabled();
-
-				if (!IsCollisionEnabled() && bInCollisionView)
-				{
-					continue;
-				}
-
-				// Draw the mesh!
-				FMeshBatch& MeshBatch = Collector.AllocateMesh();
-				MakeMeshBatch(MeshBatch, Collector, WireframeMaterialRenderProxy, VertexBuffer, IndexBuffer32, VertexFactory, bCanDrawCollision);
-				Collector.AddMesh(ViewIndex, MeshBatch);
-			}
-		}
-	}
-}
-
-
-uint32 FStreetMapSceneProxy::GetMemoryFootprint( void ) const
-{ 
-	return sizeof( *this ) + GetAllocatedSize();
-}
+// Copyright 2017 Mike Fricker. All Rights Reserved.
+
+#include "StreetMapSceneProxy.h"
+#include "StreetMapRuntime.h"
+#include "StreetMapComponent.h"
+#include "Runtime/Engine/Public/SceneManagement.h"
+#include "Runtime/Renderer/Public/MeshPassProcessor.h"
+#include "Runtime/Renderer/Public/PrimitiveSceneInfo.h"
+#include "Async/ParallelFor.h"
+
+DEFINE_STAT(STAT_StreetMapColorBytesUploaded);
+DEFINE_STAT(STAT_StreetMapColorRangesUploaded);
+DEFINE_STAT(STAT_StreetMapMeshBatches);
+DEFINE_STAT(STAT_StreetMapChunksCulled);
+DEFINE_STAT(STAT_StreetMapTrianglesCulled);
+DEFINE_STAT(STAT_StreetMapTrianglesDrawn);
+
+void FStreetMapColorVertexBuffer::Init(const FStreetMapColorStreamPtr& InColors)
+{
+	Colors = InColors;
+	NumVertices = Colors.IsValid() ? Colors->Num() : 0;
+}
+
+void FStreetMapColorVertexBuffer::InitRHI()
+{
+	const uint32 SizeInBytes = NumVertices * sizeof(FColor);
+	if (SizeInBytes == 0)
+	{
+		return;
+	}
+
+	// Dynamic, so UpdateRange_RenderThread can lock it again later on
+	FRHIResourceCreateInfo CreateInfo;
+	VertexBufferRHI = RHICreateVertexBuffer(SizeInBytes, BUF_Dynamic | BUF_ShaderResource, CreateInfo);
+
+	void* Buffer = RHILockVertexBuffer(VertexBufferRHI, 0, SizeInBytes, RLM_WriteOnly);
+	FMemory::Memcpy(Buffer, Colors->GetData(), SizeInBytes);
+	RHIUnlockVertexBuffer(VertexBufferRHI);
+
+	if (RHISupportsManualVertexFetch(GMaxRHIShaderPlatform))
+	{
+		ColorComponentsSRV = RHICreateShaderResourceView(VertexBufferRHI, sizeof(FColor), PF_R8G8B8A8);
+	}
+}
+
+void FStreetMapColorVertexBuffer::ReleaseRHI()
+{
+	ColorComponentsSRV.SafeRelease();
+	FVertexBuffer::ReleaseRHI();
+}
+
+void FStreetMapColorVertexBuffer::ReleaseResource()
+{
+	FVertexBuffer::ReleaseResource();
+
+	// The colors are kept over ReleaseRHI()/InitRHI() cycles, only a released resource is done with them
+	Colors.Reset();
+	NumVertices = 0;
+}
+
+void FStreetMapColorVertexBuffer::BindColorVertexBuffer(FLocalVertexFactory::FDataType& Data) const
+{
+	Data.ColorComponent = FVertexStreamComponent(this, 0, sizeof(FColor), VET_Color, EVertexStreamUsage::ManualFetch);
+	Data.ColorComponentsSRV = ColorComponentsSRV;
+	Data.ColorIndexMask = ~0u;
+}
+
+uint32 FStreetMapColorVertexBuffer::UpdateRange_RenderThread(int32 FirstVertex, int32 NumColors, const FColor* SourceColors)
+{
+	check(IsInRenderingThread());
+
+	if (!VertexBufferRHI.IsValid() || NumColors <= 0 || FirstVertex < 0 || FirstVertex + NumColors > NumVertices)
+	{
+		return 0;
+	}
+
+	const uint32 SizeInBytes = NumColors * sizeof(FColor);
+	void* Buffer = RHILockVertexBuffer(VertexBufferRHI, FirstVertex * sizeof(FColor), SizeInBytes, RLM_WriteOnly);
+	FMemory::Memcpy(Buffer, SourceColors, SizeInBytes);
+	RHIUnlockVertexBuffer(VertexBufferRHI);
+
+	// The next InitRHI() uploads the new colors too.  The component copies its stream before the first write after
+	// creating a proxy, so the stream is usually ours alone here, otherwise it is copied once like the component does.
+	if (Colors.IsValid())
+	{
+		if (!Colors.IsUnique())
+		{
+			Colors = MakeShared<TArray<FColor>, ESPMode::ThreadSafe>(*Colors);
+		}
+		FMemory::Memcpy(Colors->GetData() + FirstVertex, SourceColors, SizeInBytes);
+	}
+
+	return SizeInBytes;
+}
+
+void FStreetMapTexCoordVertexBuffer::Init(const FStreetMapTexCoordStreamPtr& InTexCoords, uint32 InVertexStride, uint32 InSRVStride, EPixelFormat InSRVFormat)
+{
+	TexCoords = InTexCoords;
+	VertexStride = InVertexStride;
+	SRVStride = InSRVStride;
+	SRVFormat = InSRVFormat;
+	NumVertices = TexCoords.IsValid() && VertexStride > 0 ? TexCoords->Num() / VertexStride : 0;
+}
+
+void FStreetMapTexCoordVertexBuffer::InitRHI()
+{
+	const uint32 SizeInBytes = NumVertices * VertexStride;
+	if (SizeInBytes == 0)
+	{
+		return;
+	}
+
+	// Dynamic, so UpdateRange_RenderThread can lock it again later on
+	FRHIResourceCreateInfo CreateInfo;
+	VertexBufferRHI = RHICreateVertexBuffer(SizeInBytes, BUF_Dynamic | BUF_ShaderResource, CreateInfo);
+
+	void* Buffer = RHILockVertexBuffer(VertexBufferRHI, 0, SizeInBytes, RLM_WriteOnly);
+	FMemory::Memcpy(Buffer, TexCoords->GetData(), SizeInBytes);
+	RHIUnlockVertexBuffer(VertexBufferRHI);
+
+	if (RHISupportsManualVertexFetch(GMaxRHIShaderPlatform))
+	{
+		SRV = RHICreateShaderResourceView(VertexBufferRHI, SRVStride, SRVFormat);
+	}
+}
+
+void FStreetMapTexCoordVertexBuffer::ReleaseRHI()
+{
+	SRV.SafeRelease();
+	FVertexBuffer::ReleaseRHI();
+}
+
+void FStreetMapTexCoordVertexBuffer::ReleaseResource()
+{
+	FVertexBuffer::ReleaseResource();
+
+	TexCoords.Reset();
+	NumVertices = 0;
+}
+
+uint32 FStreetMapTexCoordVertexBuffer::UpdateRange_RenderThread(int32 FirstVertex, int32 NumRangeVertices, const uint8* SourceTexCoords)
+{
+	check(IsInRenderingThread());
+
+	if (!VertexBufferRHI.IsValid() || NumRangeVertices <= 0 || FirstVertex < 0 || FirstVertex + NumRangeVertices > NumVertices)
+	{
+		return 0;
+	}
+
+	const uint32 SizeInBytes = NumRangeVertices * VertexStride;
+	void* Buffer = RHILockVertexBuffer(VertexBufferRHI, FirstVertex * VertexStride, SizeInBytes, RLM_WriteOnly);
+	FMemory::Memcpy(Buffer, SourceTexCoords, SizeInBytes);
+	RHIUnlockVertexBuffer(VertexBufferRHI);
+
+	// The next InitRHI() uploads them too, see FStreetMapColorVertexBuffer::UpdateRange_RenderThread()
+	if (TexCoords.IsValid())
+	{
+		if (!TexCoords.IsUnique())
+		{
+			TexCoords = MakeShared<TArray<uint8>, ESPMode::ThreadSafe>(*TexCoords);
+		}
+		FMemory::Memcpy(TexCoords->GetData() + FirstVertex * VertexStride, SourceTexCoords, SizeInBytes);
+	}
+
+	return SizeInBytes;
+}
+
+void FStreetMapStaticVertexBuffer::Init(const void* InData, uint32 InSizeInBytes, uint32 InSRVStride, EPixelFormat InSRVFormat)
+{
+	Data = InData;
+	SizeInBytes = InSizeInBytes;
+	SRVStride = InSRVStride;
+	SRVFormat = InSRVFormat;
+}
+
+void FStreetMapStaticVertexBuffer::InitRHI()
+{
+	if (SizeInBytes == 0)
+	{
+		return;
+	}
+
+	FRHIResourceCreateInfo CreateInfo;
+	VertexBufferRHI = RHICreateVertexBuffer(SizeInBytes, BUF_Static | BUF_ShaderResource, CreateInfo);
+
+	void* Buffer = RHILockVertexBuffer(VertexBufferRHI, 0, SizeInBytes, RLM_WriteOnly);
+	FMemory::Memcpy(Buffer, Data, SizeInBytes);
+	RHIUnlockVertexBuffer(VertexBufferRHI);
+
+	if (RHISupportsManualVertexFetch(GMaxRHIShaderPlatform))
+	{
+		SRV = RHICreateShaderResourceView(VertexBufferRHI, SRVStride, SRVFormat);
+	}
+}
+
+void FStreetMapStaticVertexBuffer::ReleaseRHI()
+{
+	SRV.SafeRelease();
+	FVertexBuffer::ReleaseRHI();
+}
+
+void FStreetMapStaticIndexBuffer::InitRHI()
+{
+	const uint32 SizeInBytes = NumIndices * Stride;
+	if (SizeInBytes == 0)
+	{
+		return;
+	}
+
+	FRHIResourceCreateInfo CreateInfo;
+	IndexBufferRHI = RHICreateIndexBuffer(Stride, SizeInBytes, BUF_Static, CreateInfo);
+
+	void* Buffer = RHILockIndexBuffer(IndexBufferRHI, 0, SizeInBytes, RLM_WriteOnly);
+	FMemory::Memcpy(Buffer, Data, SizeInBytes);
+	RHIUnlockIndexBuffer(IndexBufferRHI);
+}
+
+bool FStreetMapSectionRenderData::BuildChunks(const TArray<uint32>& SourceIndices, EVertexType Type, const TArray<FStreetMapMeshChunk>& MeshChunks, bool bCompact)
+{
+	Chunks.Reset();
+
+	auto AddChunks = [this, &SourceIndices, bCompact](int32 FirstMeshIndex, int32 NumMeshIndices, const FBox& Bounds, uint8 LOD)
+	{
+		const int32 EndIndex = FirstMeshIndex + NumMeshIndices - NumMeshIndices % 3;
+		int32 FirstIndex = FirstMeshIndex;
+		while (FirstIndex < EndIndex)
+		{
+			uint32 MinVertexIndex = MAX_uint32;
+			uint32 MaxVertexIndex = 0;
+
+			// Whole triangles, until the chunk is full or its vertices no longer fit 16-bit indices
+			int32 LastIndex = FirstIndex;
+			while (LastIndex < EndIndex && LastIndex - FirstIndex < MaxIndicesPerChunk)
+			{
+				const uint32 TriangleMin = FMath::Min3(SourceIndices[LastIndex], SourceIndices[LastIndex + 1], SourceIndices[LastIndex + 2]);
+				const uint32 TriangleMax = FMath::Max3(SourceIndices[LastIndex], SourceIndices[LastIndex + 1], SourceIndices[LastIndex + 2]);
+				if (bCompact && FMath::Max(MaxVertexIndex, TriangleMax) - FMath::Min(MinVertexIndex, TriangleMin) > MAX_uint16)
+				{
+					if (LastIndex == FirstIndex) return false;
+					break;
+				}
+
+				MinVertexIndex = FMath::Min(MinVertexIndex, TriangleMin);
+				MaxVertexIndex = FMath::Max(MaxVertexIndex, TriangleMax);
+				LastIndex += 3;
+			}
+
+			FStreetMapProxyChunk Chunk;
+			Chunk.FirstIndex = FirstIndex;
+			Chunk.NumPrimitives = (LastIndex - FirstIndex) / 3;
+			Chunk.BaseVertexIndex = bCompact ? MinVertexIndex : 0;
+			Chunk.MinVertexIndex = MinVertexIndex - Chunk.BaseVertexIndex;
+			Chunk.MaxVertexIndex = MaxVertexIndex - Chunk.BaseVertexIndex;
+			Chunk.LocalBounds = Bounds;
+			Chunk.WorldBounds = Bounds;
+			Chunk.LOD = LOD;
+			Chunks.Add(Chunk);
+
+			FirstIndex = LastIndex;
+		}
+		return true;
+	};
+
+	for (const FStreetMapMeshChunk& MeshChunk : MeshChunks)
+	{
+		// Chunks that don't fit the indices are from another mesh, fall back to drawing it whole
+		if (MeshChunk.VertexType == Type && (MeshChunk.FirstIndex < 0 || MeshChunk.FirstIndex + MeshChunk.NumIndices > SourceIndices.Num()))
+		{
+			Chunks.Reset();
+			break;
+		}
+
+		if (MeshChunk.VertexType == Type)
+		{
+			const uint8 LOD = FMath::Min<uint8>(MeshChunk.LOD, FStreetMapSceneProxy::MaxLODs - 1);
+			if (!AddChunks(MeshChunk.FirstIndex, MeshChunk.NumIndices, MeshChunk.Bounds, LOD)) return false;
+		}
+	}
+
+	// Without bounds, GetChunkLOD() always picks LOD 0
+	if (Chunks.Num() == 0)
+	{
+		return AddChunks(0, SourceIndices.Num(), FBox(ForceInit), 0);
+	}
+	return true;
+}
+
+void FStreetMapRenderData::SetTexCoord(TArray<uint8>& TexCoords, int32 VertexIndex, int32 UVIndex, const FVector2D& UV) const
+{
+	uint8* Dest = TexCoords.GetData() + VertexIndex * GetTexCoordStride() + UVIndex * GetTexCoordSize();
+	if (bFullPrecisionUVs)
+	{
+		FMemory::Memcpy(Dest, &UV, sizeof(FVector2D));
+	}
+	else
+	{
+		const FVector2DHalf HalfUV(UV);
+		FMemory::Memcpy(Dest, &HalfUV, sizeof(FVector2DHalf));
+	}
+}
+
+void FStreetMapRenderData::SetRoadTexCoords(TArray<uint8>& TexCoords, const TArray<FStreetMapVertex>& Vertices, const FStreetMapVertexRange& Range, float SpeedRatio, float RoadType, int32 RoadIndex) const
+{
+	const int32 NumVertices = FMath::Min(Vertices.Num(), TexCoords.Num() / (int32)GetTexCoordStride());
+	const int32 First = FMath::Clamp(Range.FirstVertex, 0, NumVertices);
+	const int32 Last = FMath::Clamp(Range.FirstVertex + Range.NumVertices, 0, NumVertices);
+	const FVector2D RoadUV(RoadType, bFullPrecisionUVs ? (float)RoadIndex : 0.0f);
+	for (int32 VertexIndex = First; VertexIndex < Last; ++VertexIndex)
+	{
+		SetTexCoord(TexCoords, VertexIndex, 3, FVector2D(SpeedRatio * 100, Vertices[VertexIndex].Direction));
+		SetTexCoord(TexCoords, VertexIndex, 4, RoadUV);
+	}
+}
+
+void FStreetMapRenderData::BuildSection(EVertexType Type, const TArray<FStreetMapVertex>& Vertices, const TArray<uint32>& Indices, const TArray<FStreetMapMeshChunk>& MeshChunks, FStreetMapTexCoordStreamPtr& OutTexCoords, FStreetMapColorStreamPtr& OutColors)
+{
+	FStreetMapSectionRenderData& Section = Sections[Type];
+	const int32 NumVertices = Vertices.Num();
+
+	Section.Positions.SetNumUninitialized(NumVertices);
+	Section.Tangents.SetNumUninitialized(2 * NumVertices);
+
+	OutTexCoords = MakeShared<TArray<uint8>, ESPMode::ThreadSafe>();
+	TArray<uint8>& TexCoords = *OutTexCoords;
+	TexCoords.SetNumUninitialized(NumVertices * GetTexCoordStride());
+
+	OutColors = MakeShared<TArray<FColor>, ESPMode::ThreadSafe>();
+	TArray<FColor>& Colors = *OutColors;
+	Colors.SetNumUninitialized(NumVertices);
+
+	ParallelFor(NumVertices, [&](int32 VertexIndex)
+	{
+		const FStreetMapVertex& Vertex = Vertices[VertexIndex];
+		Section.Positions[VertexIndex] = Vertex.Position;
+
+		// TangentY is TangentZ ^ TangentX, so the basis is always right handed
+		Section.Tangents[2 * VertexIndex] = Vertex.TangentX;
+		Section.Tangents[2 * VertexIndex + 1] = Vertex.TangentZ;
+
+		// The per-road texture coordinates are written by SetRoadTexCoords()
+		const FVector2D UVs[NumTexCoords] = { Vertex.TextureCoordinate, Vertex.TextureCoordinate2, Vertex.TextureCoordinate3, FVector2D(0.0f, Vertex.Direction), FVector2D::ZeroVector };
+		for (int32 UVIndex = 0; UVIndex < NumTexCoords; ++UVIndex)
+		{
+			SetTexCoord(TexCoords, VertexIndex, UVIndex, UVs[UVIndex]);
+		}
+
+		Colors[VertexIndex] = Vertex.Color;
+	});
+
+	Section.Indices.Reset();
+	Section.CompactIndices.Reset();
+	Section.Chunks.Reset();
+	if (NumVertices > 0 && Indices.Num() > 0)
+	{
+		// 16-bit indices relative to the first vertex of their chunk, unless a triangle spans too many vertices
+		if (Section.BuildChunks(Indices, Type, MeshChunks, true))
+		{
+			Section.CompactIndices.SetNumZeroed(Indices.Num());
+			for (const FStreetMapProxyChunk& Chunk : Section.Chunks)
+			{
+				for (int32 Index = Chunk.FirstIndex; Index < Chunk.FirstIndex + 3 * Chunk.NumPrimitives; ++Index)
+				{
+					Section.CompactIndices[Index] = (uint16)(Indices[Index] - Chunk.BaseVertexIndex);
+				}
+			}
+		}
+		else
+		{
+			Section.BuildChunks(Indices, Type, MeshChunks, false);
+			Section.Indices = Indices;
+		}
+
+		for (const FStreetMapMeshChunk& MeshChunk : MeshChunks)
+		{
+			NumLODs = FMath::Clamp(MeshChunk.LOD + 1, NumLODs, (int32)FStreetMapSceneProxy::MaxLODs);
+		}
+	}
+}
+
+int64 FStreetMapRenderData::GetUploadSizeBytes() const
+{
+	int64 SizeBytes = 0;
+	for (const FStreetMapSectionRenderData& Section : Sections)
+	{
+		if (!Section.HasGeometry()) continue;
+
+		SizeBytes += Section.Positions.Num() * (sizeof(FVector) + GetTexCoordStride() + sizeof(FColor))
+			+ Section.Tangents.Num() * sizeof(FPackedNormal)
+			+ Section.Indices.Num() * sizeof(uint32)
+			+ Section.CompactIndices.Num() * sizeof(uint16);
+	}
+	return SizeBytes;
+}
+
+SIZE_T FStreetMapRenderData::GetAllocatedSize() const
+{
+	SIZE_T SizeBytes = 0;
+	for (const FStreetMapSectionRenderData& Section : Sections)
+	{
+		SizeBytes += Section.Positions.GetAllocatedSize() + Section.Tangents.GetAllocatedSize()
+			+ Section.Indices.GetAllocatedSize() + Section.CompactIndices.GetAllocatedSize() + Section.Chunks.GetAllocatedSize();
+	}
+	return SizeBytes;
+}
+
+void FStreetMapRenderData::GetGPUMemoryStats(FStreetMapGPUMemoryStats& OutStats) const
+{
+	OutStats = FStreetMapGPUMemoryStats();
+	for (const FStreetMapSectionRenderData& Section : Sections)
+	{
+		if (!Section.HasGeometry()) continue;
+
+		const int32 NumVertices = Section.Positions.Num();
+		const int32 NumIndices = Section.GetNumIndices();
+		OutStats.NumVertices += NumVertices;
+		OutStats.NumIndices += NumIndices;
+		OutStats.NumSections++;
+		OutStats.NumCompactIndexSections += Section.UsesCompactIndices() ? 1 : 0;
+
+		OutStats.PositionBytes += NumVertices * sizeof(FVector);
+		OutStats.TangentBytes += Section.Tangents.Num() * sizeof(FPackedNormal);
+		OutStats.TexCoordBytes += NumVertices * GetTexCoordStride();
+		OutStats.ColorBytes += NumVertices * sizeof(FColor);
+		OutStats.IndexBytes += Section.Indices.Num() * sizeof(uint32) + Section.CompactIndices.Num() * sizeof(uint16);
+		OutStats.Index32Bytes += NumIndices * sizeof(uint32);
+		OutStats.UnpackedTangentBytes += NumVertices * 2 * sizeof(FVector);
+		OutStats.UncompressedUploadBytes += NumVertices * (sizeof(FVector) + 2 * sizeof(FVector) + NumTexCoords * sizeof(FVector2D) + sizeof(FColor)) + NumIndices * sizeof(uint32);
+
+		// Vertices of a cell are quantized into the bounds of its full detail chunks, which all LODs share
+		OutStats.QuantizedPositionBytes += NumVertices * 3 * sizeof(uint16);
+		for (const FStreetMapProxyChunk& Chunk : Section.Chunks)
+		{
+			if (Chunk.LOD != 0 || !Chunk.LocalBounds.IsValid) continue;
+
+			OutStats.QuantizedPositionBytes += sizeof(FBox);
+			OutStats.QuantizationStep = FMath::Max(OutStats.QuantizationStep, Chunk.LocalBounds.GetSize().GetMax() / MAX_uint16);
+		}
+	}
+
+	OutStats.UploadBytes = OutStats.PositionBytes + OutStats.TangentBytes + OutStats.TexCoordBytes + OutStats.ColorBytes + OutStats.IndexBytes;
+}
+
+void FStreetMapProxySection::Init(const FStreetMapSectionRenderData& InData, bool bInFullPrecisionUVs, const FStreetMapTexCoordStreamPtr& TexCoords, const FStreetMapColorStreamPtr& Colors)
+{
+	Data = &InData;
+	Chunks = InData.Chunks;
+	bFullPrecisionUVs = bInFullPrecisionUVs;
+
+	PositionVertexBuffer.Init(InData.Positions.GetData(), InData.Positions.Num() * sizeof(FVector), sizeof(float), PF_R32_FLOAT);
+	TangentVertexBuffer.Init(InData.Tangents.GetData(), InData.Tangents.Num() * sizeof(FPackedNormal), sizeof(FPackedNormal), PF_R8G8B8A8_SNORM);
+	if (bFullPrecisionUVs)
+	{
+		TexCoordVertexBuffer.Init(TexCoords, FStreetMapRenderData::NumTexCoords * sizeof(FVector2D), sizeof(FVector2D), PF_G32R32F);
+	}
+	else
+	{
+		TexCoordVertexBuffer.Init(TexCoords, FStreetMapRenderData::NumTexCoords * sizeof(FVector2DHalf), sizeof(FVector2DHalf), PF_G16R16F);
+	}
+	ColorVertexBuffer.Init(Colors);
+	if (InData.UsesCompactIndices())
+	{
+		IndexBuffer.Init(InData.CompactIndices);
+	}
+	else
+	{
+		IndexBuffer.Init(InData.Indices);
+	}
+}
+
+void FStreetMapProxySection::UpdateWorldBounds(const FMatrix& LocalToWorld)
+{
+	for (FStreetMapProxyChunk& Chunk : Chunks)
+	{
+		Chunk.WorldBounds = Chunk.LocalBounds.IsValid ? Chunk.LocalBounds.TransformBy(LocalToWorld) : Chunk.LocalBounds;
+	}
+}
+
+void FStreetMapProxySection::InitResources_RenderThread()
+{
+	PositionVertexBuffer.InitResource();
+	TangentVertexBuffer.InitResource();
+	TexCoordVertexBuffer.InitResource();
+	ColorVertexBuffer.InitResource();
+	IndexBuffer.InitResource();
+
+	// Same stream layouts as FStaticMeshVertexBuffers, texture coordinates are fetched two at a time
+	const int32 NumTexCoords = FStreetMapRenderData::NumTexCoords;
+	const uint32 UVSize = bFullPrecisionUVs ? sizeof(FVector2D) : sizeof(FVector2DHalf);
+	const uint32 UVStride = UVSize * NumTexCoords;
+	const EVertexElementType UVType = bFullPrecisionUVs ? VET_Float2 : VET_Half2;
+	const EVertexElementType DoubleUVType = bFullPrecisionUVs ? VET_Float4 : VET_Half4;
+
+	FLocalVertexFactory::FDataType VertexData;
+	VertexData.PositionComponent = FVertexStreamComponent(&PositionVertexBuffer, 0, sizeof(FVector), VET_Float3);
+	VertexData.PositionComponentSRV = PositionVertexBuffer.GetSRV();
+	VertexData.TangentBasisComponents[0] = FVertexStreamComponent(&TangentVertexBuffer, 0, 2 * sizeof(FPackedNormal), VET_PackedNormal, EVertexStreamUsage::ManualFetch);
+	VertexData.TangentBasisComponents[1] = FVertexStreamComponent(&TangentVertexBuffer, sizeof(FPackedNormal), 2 * sizeof(FPackedNormal), VET_PackedNormal, EVertexStreamUsage::ManualFetch);
+	VertexData.TangentsSRV = TangentVertexBuffer.GetSRV();
+	int32 UVIndex = 0;
+	for (; UVIndex + 1 < NumTexCoords; UVIndex += 2)
+	{
+		VertexData.TextureCoordinates.Add(FVertexStreamComponent(&TexCoordVertexBuffer, UVSize * UVIndex, UVStride, DoubleUVType, EVertexStreamUsage::ManualFetch));
+	}
+	if (UVIndex < NumTexCoords)
+	{
+		VertexData.TextureCoordinates.Add(FVertexStreamComponent(&TexCoordVertexBuffer, UVSize * UVIndex, UVStride, UVType, EVertexStreamUsage::ManualFetch));
+	}
+	VertexData.TextureCoordinatesSRV = TexCoordVertexBuffer.GetSRV();
+	VertexData.NumTexCoords = NumTexCoords;
+	VertexData.LightMapCoordinateComponent = FVertexStreamComponent(&TexCoordVertexBuffer, 0, UVStride, UVType, EVertexStreamUsage::ManualFetch);
+	VertexData.LightMapCoordinateIndex = 0;
+	ColorVertexBuffer.BindColorVertexBuffer(VertexData);
+	VertexFactory.SetData(VertexData);
+
+	VertexFactory.InitResource();
+}
+
+void FStreetMapProxySection::ReleaseResources()
+{
+	PositionVertexBuffer.ReleaseResource();
+	TangentVertexBuffer.ReleaseResource();
+	TexCoordVertexBuffer.ReleaseResource();
+	ColorVertexBuffer.ReleaseResource();
+	IndexBuffer.ReleaseResource();
+	VertexFactory.ReleaseResource();
+}
+
+FStreetMapSceneProxy::FStreetMapSceneProxy(const UStreetMapComponent* InComponent)
+	: FPrimitiveSceneProxy(InComponent),
+	UploadSizeBytes(0),
+	VisibleSectionMask(InComponent->GetVisibleSectionMask()),
+	ChunkDrawDistance(InComponent->GetChunkDrawDistance()),
+	LODScreenSize(InComponent->GetLODScreenSize()),
+	NumLODs(1),
+	bDrawChunksDynamically(InComponent->ShouldDrawChunksDynamically()),
+	LastColorUpdateFrame(0),
+	bHasColorUpdates(false),
+	StreetMapComp(InComponent),
+	CollisionResponse(InComponent->GetCollisionResponseToChannels())
+{
+	for (int32 SectionIndex = 0; SectionIndex < NumSections; SectionIndex++)
+	{
+		Sections[SectionIndex] = MakeUnique<FStreetMapProxySection>(GetScene().GetFeatureLevel());
+	}
+}
+
+void FStreetMapSceneProxy::Init(const UStreetMapComponent* InComponent, const TSharedRef<const FStreetMapRenderData, ESPMode::ThreadSafe>& InRenderData, const FStreetMapTexCoordStreamPtr* TexCoords, const FStreetMapColorStreamPtr* Colors)
+{
+	RenderData = InRenderData;
+	NumLODs = InRenderData->NumLODs;
+	UploadSizeBytes = InRenderData->GetUploadSizeBytes();
+
+	for (int32 SectionIndex = 0; SectionIndex < NumSections; SectionIndex++)
+	{
+		const FStreetMapSectionRenderData& SectionData = InRenderData->Sections[SectionIndex];
+		const int32 NumVertices = SectionData.Positions.Num();
+		if (!SectionData.HasGeometry() || !Colors[SectionIndex].IsValid() || Colors[SectionIndex]->Num() != NumVertices
+			|| !TexCoords[SectionIndex].IsValid() || TexCoords[SectionIndex]->Num() != NumVertices * InRenderData->GetTexCoordStride())
+		{
+			continue;
+		}
+
+		FStreetMapProxySection& Section = *Sections[SectionIndex];
+		Section.Init(SectionData, InRenderData->bFullPrecisionUVs, TexCoords[SectionIndex], Colors[SectionIndex]);
+
+		// Start initializing our vertex buffers, index buffer, and vertex factory.  This will be kicked off on the render thread.
+		FStreetMapProxySection* SectionPtr = &Section;
+		ENQUEUE_RENDER_COMMAND(StreetMapSectionInit)(
+			[SectionPtr](FRHICommandListImmediate& RHICmdList)
+			{
+				SectionPtr->InitResources_RenderThread();
+			});
+	}
+
+	this->MaterialRelevance = InComponent->GetMaterialRelevance(GetScene().GetFeatureLevel());
+
+	// Set a material
+	{
+		MaterialInterface = nullptr;
+		if (InComponent->GetNumMaterials() > 0)
+		{
+			MaterialInterface = InComponent->GetMaterial(0);
+		}
+
+		// Use the default material if we don't have one set
+		if (MaterialInterface == nullptr)
+		{
+			MaterialInterface = UMaterial::GetDefaultMaterial(MD_Surface);
+		}
+	}
+}
+
+FStreetMapSceneProxy::~FStreetMapSceneProxy()
+{
+	for (int32 SectionIndex = 0; SectionIndex < NumSections; SectionIndex++)
+	{
+		Sections[SectionIndex]->ReleaseResources();
+	}
+}
+
+SIZE_T FStreetMapSceneProxy::GetTypeHash() const
+{
+	static size_t UniquePointer;
+	return reinterpret_cast<size_t>(&UniquePointer);
+}
+
+
+uint32 FStreetMapSceneProxy::UpdateColors_RenderThread(const FStreetMapColorUpdate& Update)
+{
+	check(IsInRenderingThread());
+
+	FStreetMapColorVertexBuffer& ColorVertexBuffer = Sections[Update.VertexType]->ColorVertexBuffer;
+
+	uint32 UploadedBytes = 0;
+	int32 ColorOffset = 0;
+	for (const FStreetMapVertexRange& Range : Update.Ranges)
+	{
+		UploadedBytes += ColorVertexBuffer.UpdateRange_RenderThread(Range.FirstVertex, Range.NumVertices, Update.Colors.GetData() + ColorOffset);
+		ColorOffset += Range.NumVertices;
+	}
+
+	INC_DWORD_STAT_BY(STAT_StreetMapColorBytesUploaded, UploadedBytes);
+	INC_DWORD_STAT_BY(STAT_StreetMapColorRangesUploaded, Update.Ranges.Num());
+
+	LastColorUpdateFrame = GFrameNumberRenderThread;
+	bHasColorUpdates = true;
+
+	return UploadedBytes;
+}
+
+uint32 FStreetMapSceneProxy::UpdateTexCoords_RenderThread(const FStreetMapTexCoordUpdate& Update)
+{
+	check(IsInRenderingThread());
+
+	FStreetMapTexCoordVertexBuffer& TexCoordVertexBuffer = Sections[Update.VertexType]->TexCoordVertexBuffer;
+	const uint32 VertexStride = RenderData->GetTexCoordStride();
+
+	uint32 UploadedBytes = 0;
+	int32 ByteOffset = 0;
+	for (const FStreetMapVertexRange& Range : Update.Ranges)
+	{
+		UploadedBytes += TexCoordVertexBuffer.UpdateRange_RenderThread(Range.FirstVertex, Range.NumVertices, Update.TexCoords.GetData() + ByteOffset);
+		ByteOffset += Range.NumVertices * VertexStride;
+	}
+
+	// Drawn like a color update until the stream settles
+	LastColorUpdateFrame = GFrameNumberRenderThread;
+	bHasColorUpdates = true;
+
+	return UploadedBytes;
+}
+
+
+void FStreetMapSceneProxy::SetVisibleSections_RenderThread(uint32 InVisibleSectionMask)
+{
+	check(IsInRenderingThread());
+	if (VisibleSectionMask == InVisibleSectionMask) return;
+
+	VisibleSectionMask = InVisibleSectionMask;
+
+	// DrawStaticElements() only submits the visible sections, have the renderer ask for them again
+	if (GetPrimitiveSceneInfo() != nullptr)
+	{
+		GetPrimitiveSceneInfo()->BeginDeferredUpdateStaticMeshes();
+	}
+}
+
+
+bool FStreetMapSceneProxy::MustDrawMeshDynamically( const FSceneView& View ) const
+{
+	return bDrawChunksDynamically
+		|| ( AllowDebugViewmodes() && View.Family->EngineShowFlags.Wireframe )
+		|| IsSelected()
+		|| IsInCollisionView( View.Family->EngineShowFlags )
+		|| IsColorStreamUpdating();
+}
+
+
+bool FStreetMapSceneProxy::IsColorStreamUpdating() const
+{
+	// Live flow rewrites colors every few frames, draw those dynamically until the stream settles
+	return bHasColorUpdates && GFrameNumberRenderThread - LastColorUpdateFrame <= ColorStreamSettleFrames;
+}
+
+
+bool FStreetMapSceneProxy::IsInCollisionView(const FEngineShowFlags& EngineShowFlags) const
+{
+	return  EngineShowFlags.CollisionVisibility || EngineShowFlags.CollisionPawn;
+}
+
+FPrimitiveViewRelevance FStreetMapSceneProxy::GetViewRelevance( const FSceneView* View ) const
+{
+	FPrimitiveViewRelevance Result;
+	Result.bDrawRelevance = IsShown(View);
+	Result.bShadowRelevance = IsShadowCast(View);
+	Result.bRenderCustomDepth = ShouldRenderCustomDepth();
+	
+	const bool bAlwaysHasDynamicData = false;
+
+	// Draw from the cached static batches unless chunks have to be culled per view, see MustDrawMeshDynamically()
+	Result.bDynamicRelevance = MustDrawMeshDynamically( *View ) || bAlwaysHasDynamicData;
+	Result.bStaticRelevance = !MustDrawMeshDynamically( *View );
+	
+	MaterialRelevance.SetPrimitiveViewRelevance(Result);
+	return Result;
+}
+
+
+bool FStreetMapSceneProxy::CanBeOccluded() const
+{
+	return !MaterialRelevance.bDisableDepthTest;
+}
+
+
+void FStreetMapSceneProxy::OnTransformChanged()
+{
+	for (int32 SectionIndex = 0; SectionIndex < NumSections; SectionIndex++)
+	{
+		Sections[SectionIndex]->UpdateWorldBounds(GetLocalToWorld());
+	}
+}
+
+
+bool FStreetMapSceneProxy::IsChunkCulled(const FSceneView& View, const FStreetMapProxyChunk& Chunk) const
+{
+	const FBox& Bounds = Chunk.WorldBounds;
+	if (!Bounds.IsValid)
+	{
+		return false;
+	}
+
+	if (!View.ViewFrustum.IntersectBox(Bounds.GetCenter(), Bounds.GetExtent()))
+	{
+		return true;
+	}
+
+	return ChunkDrawDistance > 0.0f && Bounds.ComputeSquaredDistanceToPoint(View.ViewMatrices.GetViewOrigin()) > FMath::Square(ChunkDrawDistance);
+}
+
+
+int32 FStreetMapSceneProxy::GetChunkLOD(const FSceneView& View, const FStreetMapProxyChunk& Chunk) const
+{
+	const FBox& Bounds = Chunk.WorldBounds;
+	if (NumLODs <= 1 || !Bounds.IsValid || LODScreenSize <= 0.0f)
+	{
+		return 0;
+	}
+
+	const float ScreenSize = ComputeBoundsScreenSize(Bounds.GetCenter(), Bounds.GetExtent().Size(), View);
+
+	int32 LOD = 0;
+	for (float Threshold = LODScreenSize; LOD + 1 < NumLODs && ScreenSize < Threshold; Threshold *= 0.5f)
+	{
+		++LOD;
+	}
+	return LOD;
+}
+
+
+void FStreetMapSceneProxy::InitMeshBatch(FMeshBatch& Mesh, FMaterialRenderProxy* MaterialProxy, const FStreetMapProxySection& Section, const FStreetMapProxyChunk& Chunk) const
+{
+	FMeshBatchElement& BatchElement = Mesh.Elements[0];
+	BatchElement.IndexBuffer = &Section.IndexBuffer;
+	Mesh.VertexFactory = &Section.VertexFactory;
+	Mesh.MaterialRenderProxy = MaterialProxy;
+	Mesh.CastShadow = true;
+	BatchElement.FirstIndex = Chunk.FirstIndex;
+	BatchElement.NumPrimitives = Chunk.NumPrimitives;
+	BatchElement.BaseVertexIndex = Chunk.BaseVertexIndex;
+	BatchElement.MinVertexIndex = Chunk.MinVertexIndex;
+	BatchElement.MaxVertexIndex = Chunk.MaxVertexIndex;
+	Mesh.LODIndex = Chunk.LOD;
+	Mesh.ReverseCulling = IsLocalToWorldDeterminantNegative();
+	Mesh.Type = PT_TriangleList;
+	Mesh.DepthPriorityGroup = SDPG_World;
+}
+
+
+void FStreetMapSceneProxy::MakeMeshBatch(FMeshBatch& Mesh, class FMeshElementCollector& Collector, FMaterialRenderProxy* WireframeMaterialRenderProxyOrNull, const FStreetMapProxySection& Section, const FStreetMapProxyChunk& Chunk, bool bDrawCollision) const
+{
+	FMaterialRenderProxy* MaterialProxy = NULL;
+	if( WireframeMaterialRenderProxyOrNull != nullptr )
+	{
+		MaterialProxy = WireframeMaterialRenderProxyOrNull;
+	}
+	else
+	{
+		if (bDrawCollision)
+		{
+			MaterialProxy = new FColoredMaterialRenderProxy(GEngine->ShadedLevelColorationUnlitMaterial->GetRenderProxy(), FLinearColor::Blue);
+		}
+		else if (MaterialProxy == nullptr)
+		{
+			MaterialProxy = StreetMapComp->GetMaterial(0)->GetRenderProxy();
+		}
+	}
+
+	InitMeshBatch(Mesh, MaterialProxy, Section, Chunk);
+	Mesh.bWireframe = WireframeMaterialRenderProxyOrNull != nullptr;
+
+	FDynamicPrimitiveUniformBuffer& DynamicPrimitiveUniformBuffer = Collector.AllocateOneFrameResource<FDynamicPrimitiveUniformBuffer>();
+	DynamicPrimitiveUniformBuffer.Set(GetLocalToWorld(), GetLocalToWorld(), GetBounds(), GetLocalBounds(), true, false, DrawsVelocity(), false);
+	Mesh.Elements[0].PrimitiveUniformBufferResource = &DynamicPrimitiveUniformBuffer.UniformBuffer;
+}
+
+
+void FStreetMapSceneProxy::DrawStaticElements(FStaticPrimitiveDrawInterface* PDI)
+{
+	if (MaterialInterface == nullptr)
+	{
+		return;
+	}
+
+	// Static batches use the primitive uniform buffer of the scene, so they're built once and their draw commands
+	// cached until the proxy goes away or the visible sections change.  The renderer culls and picks the LOD of
+	// static batches for the whole primitive, so they are submitted coarsest last, as it expects; per-chunk culling
+	// and LODs need bDrawChunksDynamically, the default.
+	FMaterialRenderProxy* MaterialProxy = MaterialInterface->GetRenderProxy();
+	for (int32 LOD = 0; LOD < NumLODs; ++LOD)
+	{
+		const float ScreenSize = LOD == 0 ? 1000.0f : LODScreenSize / (1 << (LOD - 1));
+
+		for (int32 SectionIndex = 0; SectionIndex < NumSections; SectionIndex++)
+		{
+			const FStreetMapProxySection& Section = *Sections[SectionIndex];
+			if (!(VisibleSectionMask & (1u << SectionIndex)) || !Section.HasGeometry())
+			{
+				continue;
+			}
+
+			for (const FStreetMapProxyChunk& Chunk : Section.Chunks)
+			{
+				// Chunks without bounds have no LODs and are drawn at all of them
+				const bool bHasLODs = Chunk.LocalBounds.IsValid;
+				if (bHasLODs && Chunk.LOD != LOD)
+				{
+					continue;
+				}
+
+				FMeshBatch MeshBatch;
+				InitMeshBatch(MeshBatch, MaterialProxy, Section, Chunk);
+				MeshBatch.LODIndex = LOD;
+				PDI->DrawMesh(MeshBatch, ScreenSize);
+			}
+		}
+	}
+}
+
+
+void FStreetMapSceneProxy::GetDynamicMeshElements(const TArray<const FSceneView*>& Views, const FSceneViewFamily& ViewFamily, uint32 VisibilityMap, class FMeshElementCollector& Collector) const
+{
+	for (int32 SectionIndex = 0; SectionIndex < NumSections; SectionIndex++)
+	{
+		if (VisibleSectionMask & (1u << SectionIndex))
+		{
+			this->AddDynamicMeshElements(Views, ViewFamily, VisibilityMap, Collector, *Sections[SectionIndex]);
+		}
+	}
+}
+
+void FStreetMapSceneProxy::AddDynamicMeshElements(const TArray<const FSceneView*>& Views, const FSceneViewFamily& ViewFamily, uint32 VisibilityMap, class FMeshElementCollector& Collector, const FStreetMapProxySection& Section) const
+{
+	if (Section.HasGeometry())
+	{
+		for (int32 ViewIndex = 0; ViewIndex < Views.Num(); ++ViewIndex)
+		{
+			const FSceneView& View = *Views[ViewIndex];
+
+			const bool bIsWireframe = AllowDebugViewmodes() && View.Family->EngineShowFlags.Wireframe;
+
+			FColoredMaterialRenderProxy* WireframeMaterialRenderProxy = GEngine->WireframeMaterial && bIsWireframe ? new FColoredMaterialRenderProxy(GEngine->WireframeMaterial->GetRenderProxy(), FLinearColor(0, 0.5f, 1.f)) : NULL;
+
+
+			if (MustDrawMeshDynamically(View))
+			{
+				const bool bInCollisionView = IsInCollisionView(ViewFamily.EngineShowFlags);
+				const bool bCanDrawCollision = bInCollisionView && IsCollisionEnabled();
+
+				if (!IsCollisionEnabled() && bInCollisionView)
+				{
+					continue;
+				}
+
+				// Draw the chunks in view
+				int32 NumChunksDrawn = 0;
+				for (const FStreetMapProxyChunk& Chunk : Section.Chunks)
+				{
+					// Every LOD of a cell has the same bounds, only the one matching its screen size is drawn
+					if (NumLODs > 1 && GetChunkLOD(View, Chunk) != Chunk.LOD)
+					{
+						continue;
+					}
+
+					if (IsChunkCulled(View, Chunk))
+					{
+						INC_DWORD_STAT(STAT_StreetMapChunksCulled);
+						INC_DWORD_STAT_BY(STAT_StreetMapTrianglesCulled, Chunk.NumPrimitives);
+						continue;
+					}
+
+					FMeshBatch& MeshBatch = Collector.AllocateMesh();
+					MakeMeshBatch(MeshBatch, Collector, WireframeMaterialRenderProxy, Section, Chunk, bCanDrawCollision);
+					Collector.AddMesh(ViewIndex, MeshBatch);
+					++NumChunksDrawn;
+
+					INC_DWORD_STAT_BY(STAT_StreetMapTrianglesDrawn, Chunk.NumPrimitives);
+				}
+
+				INC_DWORD_STAT_BY(STAT_StreetMapMeshBatches, NumChunksDrawn);
+			}
+		}
+	}
+}
+
+
+uint32 FStreetMapSceneProxy::GetMemoryFootprint( void ) const
+{ 
+	return sizeof( *this ) + GetAllocatedSize();
+}
@@ -7,7 +7,11 @@
 #include "Runtime/Engine/Public/DynamicMeshBuilder.h"
 #include "StreetMapSceneProxy.generated.h"
 
-/**	A single vertex on a street map mesh */
+/**
+ * A single vertex on a street map mesh.  Vertices only hold what is drawn; the link, TMC and speed limit of a road
+ * vertex are those of the street map road whose vertex range contains it.  Per-road render data (speed ratio, road
+ * type and road index) is written to TexCoord4/TexCoord5 from the road ranges when the render data is built.
+ */
 USTRUCT()
 struct FStreetMapVertex
 {
@@ -30,45 +34,23 @@ struct FStreetMapVertex
 	UPROPERTY()
 		FVector2D TextureCoordinate3;
 
-	/** Texture coordinate */
-	UPROPERTY()
-		FVector2D TextureCoordinate4;
+	/** Tangent vector X, packed like the render data */
+	FPackedNormal TangentX;
 
-	/** Texture coordinate */
-	UPROPERTY()
-		FVector2D TextureCoordinate5;
-
-	/** Tangent vector X */
-	UPROPERTY()
-		FVector TangentX;
-
-	/** Tangent vector Z (normal) */
-	UPROPERTY()
-		FVector TangentZ;
+	/** Tangent vector Z (normal), packed like the render data */
+	FPackedNormal TangentZ;
 
 	/** Color */
 	UPROPERTY()
 		FColor Color;
 
-	/** Link ID of road */
+	/** Flow direction of the road at this vertex (1, -1 or 0), written to TexCoord4.Y next to the per-road speed ratio */
 	UPROPERTY()
-		int64 LinkId;
-
-	/** Link Direction of road */
-	UPROPERTY()
-		FString LinkDir;
-
-	/** TMC of road */
-	UPROPERTY()
-		FName TMC;
-
-	/** Speed limit of road (mph) */
-	UPROPERTY()
-		int SpeedLimit;
+		int8 Direction;
 
 	/** Is flagged as trace */
 	UPROPERTY()
-		uint32 IsTrace:1;
+		uint8 IsTrace:1;
 
 	/** Default constructor, leaves everything uninitialized */
 	FStreetMapVertex()
@@ -81,16 +63,549 @@ struct FStreetMapVertex
 		TextureCoordinate(InitTextureCoordinate),
 		TextureCoordinate2(FVector2D::ZeroVector),
 		TextureCoordinate3(FVector2D::ZeroVector),
-		TextureCoordinate4(FVector2D::ZeroVector),
-		TextureCoordinate5(FVector2D::ZeroVector),
-		TangentX(InitTangentX),
-		TangentZ(InitTangentZ),
 		Color(InitColor),
+		Direction(0),
 		IsTrace(false)
+	{
+		SetTangents(InitTangentX, InitTangentZ);
+	}
+
+	/** Packs the tangent basis of the vertex */
+	void SetTangents(const FVector& InTangentX, const FVector& InTangentZ)
+	{
+		TangentX = FPackedNormal(InTangentX);
+		TangentZ = FPackedNormal(FVector4(InTangentZ, 1.0f));
+	}
+
+	/** Binary serialization of the cached mesh, see UStreetMapComponent::Serialize() */
+	friend FArchive& operator<<(FArchive& Ar, FStreetMapVertex& Vertex)
+	{
+		Ar << Vertex.Position;
+		Ar << Vertex.TextureCoordinate << Vertex.TextureCoordinate2 << Vertex.TextureCoordinate3;
+		Ar << Vertex.TangentX << Vertex.TangentZ;
+		Ar << Vertex.Color;
+		Ar << Vertex.Direction;
+
+		uint8 bIsTrace = Vertex.IsTrace;
+		Ar << bIsTrace;
+		Vertex.IsTrace = bIsTrace;
+
+		return Ar;
+	}
+};
+
+
+/** A contiguous range of vertices inside one of the street map mesh sections */
+USTRUCT()
+struct FStreetMapVertexRange
+{
+	GENERATED_USTRUCT_BODY()
+
+	/** Mesh section the vertices live in */
+	UPROPERTY()
+		TEnumAsByte<EVertexType> VertexType;
+
+	/** Index of the first vertex of the range */
+	UPROPERTY()
+		int32 FirstVertex;
+
+	/** Number of vertices in the range */
+	UPROPERTY()
+		int32 NumVertices;
+
+	FStreetMapVertexRange()
+		: VertexType(EVertexType::VStreet),
+		FirstVertex(0),
+		NumVertices(0)
+	{
+	}
+
+	FStreetMapVertexRange(EVertexType InVertexType, int32 InFirstVertex, int32 InNumVertices)
+		: VertexType(InVertexType),
+		FirstVertex(InFirstVertex),
+		NumVertices(InNumVertices)
+	{
+	}
+
+	friend FArchive& operator<<(FArchive& Ar, FStreetMapVertexRange& Range)
+	{
+		return Ar << Range.VertexType << Range.FirstVertex << Range.NumVertices;
+	}
+};
+
+/**
+ * Indices of one section that fall into one cell of the spatial grid the mesh is generated in, at one level of
+ * detail.  The geometry of a cell is contiguous in its section, so the scene proxy can skip whole cells that are out
+ * of view and pick the level of detail of every cell on its own.
+ */
+struct FStreetMapMeshChunk
+{
+	/** Mesh section the indices belong to */
+	EVertexType VertexType = EVertexType::VStreet;
+
+	int32 FirstIndex = 0;
+	int32 NumIndices = 0;
+
+	/**
+	* Local space bounds of the cell the triangles are in.  The same for every LOD of a cell, so they all agree on
+	* which one is drawn.
+	*/
+	FBox Bounds = FBox(ForceInit);
+
+	/** Level of detail, 0 is full detail */
+	uint8 LOD = 0;
+
+	friend FArchive& operator<<(FArchive& Ar, FStreetMapMeshChunk& Chunk)
+	{
+		uint8 VertexType = Chunk.VertexType;
+		Ar << VertexType;
+		Chunk.VertexType = (EVertexType)VertexType;
+
+		return Ar << Chunk.FirstIndex << Chunk.NumIndices << Chunk.Bounds;
+	}
+};
+
+/** Counters describing how much data was sent to the GPU, so update paths can be compared (also on NullRHI) */
+USTRUCT(BlueprintType)
+struct FStreetMapRenderCounters
+{
+	GENERATED_USTRUCT_BODY()
+
+	/** Number of times the scene proxy was (re)created */
+	UPROPERTY(BlueprintReadOnly, Category = "StreetMap")
+		int32 NumProxyRebuilds = 0;
+
+	/** Bytes of vertex and index data uploaded by the last proxy creation */
+	UPROPERTY(BlueprintReadOnly, Category = "StreetMap")
+		int64 LastProxyUploadBytes = 0;
+
+	/** Number of partial color stream updates sent to an existing proxy */
+	UPROPERTY(BlueprintReadOnly, Category = "StreetMap")
+		int32 NumColorUpdates = 0;
+
+	/** Bytes uploaded by the last partial color stream update, the speed ratio texture coordinates included */
+	UPROPERTY(BlueprintReadOnly, Category = "StreetMap")
+		int64 LastColorUploadBytes = 0;
+
+	/** Bytes uploaded by all partial color stream updates, the speed ratio texture coordinates included */
+	UPROPERTY(BlueprintReadOnly, Category = "StreetMap")
+		int64 TotalColorUploadBytes = 0;
+
+	/** Bytes uploaded by the last road attribute texture update */
+	UPROPERTY(BlueprintReadOnly, Category = "StreetMap")
+		int64 LastAttributeUploadBytes = 0;
+
+	/** Bytes uploaded by all road attribute texture updates */
+	UPROPERTY(BlueprintReadOnly, Category = "StreetMap")
+		int64 TotalAttributeUploadBytes = 0;
+
+	/** Game thread time of the last HoverRoadAt(), picking and upload included */
+	UPROPERTY(BlueprintReadOnly, Category = "StreetMap")
+		float LastHoverMilliseconds = 0.0f;
+
+	/** Game thread time of the recolor of the last ApplyFlowUpdates(), vertex colors or road attributes and upload included */
+	UPROPERTY(BlueprintReadOnly, Category = "StreetMap")
+		float LastFlowRecolorMilliseconds = 0.0f;
+};
+
+/** Memory held by the cached mesh of a street map component */
+USTRUCT(BlueprintType)
+struct FStreetMapMeshMemoryStats
+{
+	GENERATED_USTRUCT_BODY()
+
+	UPROPERTY(BlueprintReadOnly, Category = "StreetMap")
+		int32 NumVertices = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "StreetMap")
+		int32 NumIndices = 0;
+
+	/** Bytes allocated by the cached vertex and index arrays of all sections */
+	UPROPERTY(BlueprintReadOnly, Category = "StreetMap")
+		int64 VertexBytes = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "StreetMap")
+		int64 IndexBytes = 0;
+
+	/** Bytes allocated by the per-road vertex ranges, which tie vertices to the metadata of their road */
+	UPROPERTY(BlueprintReadOnly, Category = "StreetMap")
+		int64 RoadRangeBytes = 0;
+
+	/** Bytes allocated by the GPU layouts and color streams of the mesh, shared with the scene proxies */
+	UPROPERTY(BlueprintReadOnly, Category = "StreetMap")
+		int64 RenderDataBytes = 0;
+
+	/** Bytes allocated by the per-road speed ratios, written to the texture coordinates of the vertices of each road */
+	UPROPERTY(BlueprintReadOnly, Category = "StreetMap")
+		int64 RoadSpeedRatioBytes = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "StreetMap")
+		int32 BytesPerVertex = 0;
+};
+
+/**
+ * Size of the GPU buffers of a street map mesh, next to the size of the same streams without the compact encodings:
+ * 16-bit chunk-local indices, packed tangents, and positions quantized into the bounds of their chunk.
+ */
+USTRUCT(BlueprintType)
+struct FStreetMapGPUMemoryStats
+{
+	GENERATED_USTRUCT_BODY()
+
+	UPROPERTY(BlueprintReadOnly, Category = "StreetMap")
+		int32 NumVertices = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "StreetMap")
+		int32 NumIndices = 0;
+
+	/** Sections whose chunks all fit 16-bit indices, out of the sections with geometry */
+	UPROPERTY(BlueprintReadOnly, Category = "StreetMap")
+		int32 NumCompactIndexSections = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "StreetMap")
+		int32 NumSections = 0;
+
+	/** Bytes of each stream as uploaded */
+	UPROPERTY(BlueprintReadOnly, Category = "StreetMap")
+		int64 PositionBytes = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "StreetMap")
+		int64 TangentBytes = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "StreetMap")
+		int64 TexCoordBytes = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "StreetMap")
+		int64 ColorBytes = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "StreetMap")
+		int64 IndexBytes = 0;
+
+	/** Bytes of the indices as 32-bit indices */
+	UPROPERTY(BlueprintReadOnly, Category = "StreetMap")
+		int64 Index32Bytes = 0;
+
+	/** Bytes of the tangents as full precision vectors */
+	UPROPERTY(BlueprintReadOnly, Category = "StreetMap")
+		int64 UnpackedTangentBytes = 0;
+
+	/**
+	* Bytes of the positions as three 16-bit offsets into the bounds of their chunk, plus the bounds.  Only reported,
+	* the local vertex factory the mesh is drawn with reads float positions.
+	*/
+	UPROPERTY(BlueprintReadOnly, Category = "StreetMap")
+		int64 QuantizedPositionBytes = 0;
+
+	/** Largest distance between two neighbouring quantized positions, in local space */
+	UPROPERTY(BlueprintReadOnly, Category = "StreetMap")
+		float QuantizationStep = 0.0f;
+
+	/** Bytes of all streams as uploaded */
+	UPROPERTY(BlueprintReadOnly, Category = "StreetMap")
+		int64 UploadBytes = 0;
+
+	/** Bytes of all streams with 32-bit indices, unpacked tangents and full precision texture coordinates */
+	UPROPERTY(BlueprintReadOnly, Category = "StreetMap")
+		int64 UncompressedUploadBytes = 0;
+};
+
+DECLARE_STATS_GROUP(TEXT("StreetMap"), STATGROUP_StreetMap, STATCAT_Advanced);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Color Stream Bytes Uploaded"), STAT_StreetMapColorBytesUploaded, STATGROUP_StreetMap, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Color Stream Ranges Uploaded"), STAT_StreetMapColorRangesUploaded, STATGROUP_StreetMap, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Mesh Batches Drawn"), STAT_StreetMapMeshBatches, STATGROUP_StreetMap, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Chunks Culled"), STAT_StreetMapChunksCulled, STATGROUP_StreetMap, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Triangles Culled"), STAT_StreetMapTrianglesCulled, STATGROUP_StreetMap, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Triangles Drawn"), STAT_StreetMapTrianglesDrawn, STATGROUP_StreetMap, );
+
+/** Colors of one mesh section, shared by the component with its scene proxies until either side writes to them */
+typedef TSharedPtr<TArray<FColor>, ESPMode::ThreadSafe> FStreetMapColorStreamPtr;
+
+/**
+ * Vertex buffer that only holds vertex colors.  Unlike FColorVertexBuffer it is created dynamic, so ranges
+ * of it can be rewritten in place without recreating the scene proxy.
+ */
+class FStreetMapColorVertexBuffer : public FVertexBuffer
+{
+public:
+
+	/**
+	* Colors used to fill the buffer whenever the RHI resource is created, e.g. again after a feature level change.
+	* Kept up to date by UpdateRange_RenderThread() and released with the resource.
+	*/
+	FStreetMapColorStreamPtr Colors;
+
+	/** Sets the colors the buffer is created with, they aren't copied */
+	void Init(const FStreetMapColorStreamPtr& InColors);
+
+	/** Binds this buffer as the color stream of a local vertex factory */
+	void BindColorVertexBuffer(FLocalVertexFactory::FDataType& Data) const;
+
+	/**
+	 * Overwrites a range of colors on the GPU.  Render thread only.
+	 * @return Number of bytes uploaded
+	 */
+	uint32 UpdateRange_RenderThread(int32 FirstVertex, int32 NumColors, const FColor* SourceColors);
+
+	int32 GetNumVertices() const
+	{
+		return NumVertices;
+	}
+
+	// FRenderResource interface
+	virtual void InitRHI() override;
+	virtual void ReleaseRHI() override;
+	virtual void ReleaseResource() override;
+
+private:
+
+	int32 NumVertices = 0;
+
+	FShaderResourceViewRHIRef ColorComponentsSRV;
+};
+
+/** Interleaved texture coordinates of one mesh section as laid out by FStreetMapRenderData, shared like the color streams */
+typedef TSharedPtr<TArray<uint8>, ESPMode::ThreadSafe> FStreetMapTexCoordStreamPtr;
+
+/**
+ * Vertex buffer that holds the interleaved texture coordinates of a section.  Created dynamic like
+ * FStreetMapColorVertexBuffer, so the speed ratio in TexCoord4 follows the vertex colors without a new scene proxy.
+ */
+class FStreetMapTexCoordVertexBuffer : public FVertexBuffer
+{
+public:
+
+	/** Texture coordinates used to fill the buffer whenever the RHI resource is created, kept like the colors of FStreetMapColorVertexBuffer */
+	FStreetMapTexCoordStreamPtr TexCoords;
+
+	/**
+	* Sets the texture coordinates the buffer is created with, they aren't copied
+	* @param InVertexStride	Bytes of all the texture coordinates of one vertex
+	* @param InSRVStride	Size of the elements the shaders fetch from the stream
+	* @param InSRVFormat	Format of those elements
+	*/
+	void Init(const FStreetMapTexCoordStreamPtr& InTexCoords, uint32 InVertexStride, uint32 InSRVStride, EPixelFormat InSRVFormat);
+
+	const FShaderResourceViewRHIRef& GetSRV() const
+	{
+		return SRV;
+	}
+
+	/**
+	* Overwrites the texture coordinates of a range of vertices on the GPU.  Render thread only.
+	* @return Number of bytes uploaded
+	*/
+	uint32 UpdateRange_RenderThread(int32 FirstVertex, int32 NumRangeVertices, const uint8* SourceTexCoords);
+
+	// FRenderResource interface
+	virtual void InitRHI() override;
+	virtual void ReleaseRHI() override;
+	virtual void ReleaseResource() override;
+
+private:
+
+	int32 NumVertices = 0;
+	uint32 VertexStride = 0;
+	uint32 SRVStride = 0;
+	EPixelFormat SRVFormat = PF_Unknown;
+
+	FShaderResourceViewRHIRef SRV;
+};
+
+/**
+ * Vertex buffer created from one of the streams of a FStreetMapRenderData, read in place rather than copied.  The
+ * render data has to outlive the creation of the RHI resource.
+ */
+class FStreetMapStaticVertexBuffer : public FVertexBuffer
+{
+public:
+
+	/**
+	* Sets the stream the buffer is created with
+	* @param InSRVStride	Size of the elements the shaders fetch from the stream
+	* @param InSRVFormat	Format of those elements
+	*/
+	void Init(const void* InData, uint32 InSizeInBytes, uint32 InSRVStride, EPixelFormat InSRVFormat);
+
+	const FShaderResourceViewRHIRef& GetSRV() const
+	{
+		return SRV;
+	}
+
+	// FRenderResource interface
+	virtual void InitRHI() override;
+	virtual void ReleaseRHI() override;
+
+private:
+
+	const void* Data = nullptr;
+	uint32 SizeInBytes = 0;
+	uint32 SRVStride = 0;
+	EPixelFormat SRVFormat = PF_Unknown;
+
+	FShaderResourceViewRHIRef SRV;
+};
+
+/** 16 or 32-bit index buffer created from the indices of a FStreetMapRenderData section, read in place rather than copied */
+class FStreetMapStaticIndexBuffer : public FIndexBuffer
+{
+public:
+
+	void Init(const TArray<uint32>& InIndices)
+	{
+		Data = InIndices.GetData();
+		NumIndices = InIndices.Num();
+		Stride = sizeof(uint32);
+	}
+
+	void Init(const TArray<uint16>& InIndices)
+	{
+		Data = InIndices.GetData();
+		NumIndices = InIndices.Num();
+		Stride = sizeof(uint16);
+	}
+
+	// FRenderResource interface
+	virtual void InitRHI() override;
+
+private:
+
+	const void* Data = nullptr;
+	uint32 NumIndices = 0;
+	uint32 Stride = sizeof(uint32);
+};
+
+/** Contiguous range of the indices of a section, drawn as one mesh batch */
+struct FStreetMapProxyChunk
+{
+	int32 FirstIndex;
+	int32 NumPrimitives;
+
+	/** Added to every index of the chunk, so 16-bit indices reach the vertices past the first 65536 */
+	uint32 BaseVertexIndex;
+
+	/** Range of the vertices referenced by the indices, relative to BaseVertexIndex, so each batch only covers its own vertices */
+	uint32 MinVertexIndex;
+	uint32 MaxVertexIndex;
+
+	/** Local space bounds of the triangles, invalid if unknown so the chunk is never culled */
+	FBox LocalBounds;
+
+	/** LocalBounds in world space, updated whenever the proxy moves */
+	FBox WorldBounds;
+
+	/** Level of detail, chunks of the same cell share their bounds so exactly one LOD of a cell is drawn */
+	uint8 LOD;
+};
+
+/** One mesh section of a FStreetMapRenderData */
+struct FStreetMapSectionRenderData
+{
+	TArray<FVector> Positions;
+
+	/** TangentX and TangentZ of every vertex, back to back */
+	TArray<FPackedNormal> Tangents;
+
+	/** 32-bit indices, only filled if the section can't use CompactIndices */
+	TArray<uint32> Indices;
+
+	/** 16-bit indices relative to the BaseVertexIndex of their chunk */
+	TArray<uint16> CompactIndices;
+
+	/**
+	* Index ranges the section is drawn with, whole triangles of at most MaxIndicesPerChunk indices each.  A spatial
+	* chunk of the mesh larger than that is split, the parts keep its bounds.
+	*/
+	TArray<FStreetMapProxyChunk> Chunks;
+
+	static const int32 MaxIndicesPerChunk = 3 * 65536;
+
+	bool HasGeometry() const
+	{
+		return Positions.Num() > 0 && (Indices.Num() > 0 || CompactIndices.Num() > 0);
+	}
+
+	bool UsesCompactIndices() const
+	{
+		return CompactIndices.Num() > 0;
+	}
+
+	int32 GetNumIndices() const
+	{
+		return UsesCompactIndices() ? CompactIndices.Num() : Indices.Num();
+	}
+
+	/**
+	* Splits the indices into chunks
+	* @param MeshChunks Spatial chunks of the whole mesh, the ones of other sections are skipped.  Without any for
+	*                   this section, the indices are drawn as a whole and never culled.
+	* @param bCompact	If true, chunks are split further so the vertices of each fit 16-bit indices
+	* @return False if a single triangle spans too many vertices for 16-bit indices
+	*/
+	bool BuildChunks(const TArray<uint32>& SourceIndices, EVertexType Type, const TArray<FStreetMapMeshChunk>& MeshChunks, bool bCompact);
+};
+
+/** Render resources of one street map mesh section (streets, major roads, highways or buildings) */
+struct FStreetMapProxySection
+{
+	/** Position and tangent streams */
+	FStreetMapStaticVertexBuffer PositionVertexBuffer;
+	FStreetMapStaticVertexBuffer TangentVertexBuffer;
+	/** Texture coordinate and color streams, kept separate so they can be updated on their own */
+	FStreetMapTexCoordVertexBuffer TexCoordVertexBuffer;
+	FStreetMapColorVertexBuffer ColorVertexBuffer;
+
+	/** All of the vertex indices of this section, 16-bit whenever the chunks allow it */
+	FStreetMapStaticIndexBuffer IndexBuffer;
+
+	FLocalVertexFactory VertexFactory;
+
+	/** Render data the buffers are created from, null if the section has no geometry */
+	const FStreetMapSectionRenderData* Data;
+
+	/** Chunks of the render data, with bounds in world space */
+	TArray<FStreetMapProxyChunk> Chunks;
+
+	bool bFullPrecisionUVs;
+
+	FStreetMapProxySection(ERHIFeatureLevel::Type InFeatureLevel)
+		: VertexFactory(InFeatureLevel, "FStreetMapSceneProxy"),
+		Data(nullptr),
+		bFullPrecisionUVs(false)
 	{
 	}
+
+	bool HasGeometry() const
+	{
+		return Data != nullptr;
+	}
+
+	/** Points the buffers at the render data of the section, which has to outlive them */
+	void Init(const FStreetMapSectionRenderData& InData, bool bInFullPrecisionUVs, const FStreetMapTexCoordStreamPtr& TexCoords, const FStreetMapColorStreamPtr& Colors);
+
+	/** Transforms the bounds of the chunks into world space */
+	void UpdateWorldBounds(const FMatrix& LocalToWorld);
+
+	/** Creates the RHI resources and binds the streams to the vertex factory.  Render thread only. */
+	void InitResources_RenderThread();
+
+	void ReleaseResources();
+};
+
+/** Colors for a set of vertex ranges of one section, packed back to back in the order of the ranges */
+struct FStreetMapColorUpdate
+{
+	EVertexType VertexType;
+	TArray<FStreetMapVertexRange> Ranges;
+	TArray<FColor> Colors;
 };
 
+/** Texture coordinates for a set of vertex ranges of one section, packed back to back in the order of the ranges */
+struct FStreetMapTexCoordUpdate
+{
+	EVertexType VertexType;
+	TArray<FStreetMapVertexRange> Ranges;
+	TArray<uint8> TexCoords;
+};
 
 /** Scene proxy for rendering a section of a street map mesh on the rendering thread */
 class FStreetMapSceneProxy : public FPrimitiveSceneProxy
@@ -98,64 +613,127 @@ class FStreetMapSceneProxy : public FPrimitiveSceneProxy
 
 public:
 
+	/** Number of mesh sections, one per EVertexType */
+	static const int32 NumSections = 4;
+
+	/** Most levels of detail a section can be generated with */
+	static const int32 MaxLODs = 4;
+
 	/** Construct this scene proxy */
 	FStreetMapSceneProxy(const class UStreetMapComponent* InComponent);
 
 	/**
-	* Init this street map mesh scene proxy for the specified component (32-bit indices)
+	* Init this street map mesh scene proxy for the specified component.  Nothing is copied, the buffers are created
+	* straight from the render data and color streams on the render thread.
 	*
 	* @param	InComponent			The street map mesh component to initialize this with
-	* @param	Vertices			The vertices for this street map mesh
-	* @param	Indices				The vertex indices for this street map mesh
+	* @param	InRenderData		The mesh laid out for the GPU, kept alive by the proxy
+	* @param	TexCoords			Texture coordinate stream of every section, indexed by EVertexType
+	* @param	Colors				Color stream of every section, indexed by EVertexType
 	*/
-	void Init(const UStreetMapComponent* InComponent, EVertexType Type, const TArray< FStreetMapVertex >& Vertices, const TArray< uint32 >& Indices);
+	void Init(const UStreetMapComponent* InComponent, const TSharedRef<const struct FStreetMapRenderData, ESPMode::ThreadSafe>& InRenderData, const FStreetMapTexCoordStreamPtr* TexCoords, const FStreetMapColorStreamPtr* Colors);
 
 	/** Destructor that cleans up our rendering data */
 	virtual ~FStreetMapSceneProxy();
 
 	SIZE_T GetTypeHash() const override;
 
+	/**
+	* Uploads new colors for some vertex ranges of a section into the existing color stream.  Render thread only.
+	* @return Number of bytes uploaded
+	*/
+	uint32 UpdateColors_RenderThread(const FStreetMapColorUpdate& Update);
+
+	/**
+	* Uploads new texture coordinates for some vertex ranges of a section.  Render thread only.
+	* @return Number of bytes uploaded
+	*/
+	uint32 UpdateTexCoords_RenderThread(const FStreetMapTexCoordUpdate& Update);
+
+	/**
+	* Chooses which sections are drawn, bit N for EVertexType N.  Hidden sections keep their buffers and only stop
+	* submitting mesh batches, the cached static batches are submitted again.  Render thread only.
+	*/
+	void SetVisibleSections_RenderThread(uint32 InVisibleSectionMask);
+
+	/** Sets the distance beyond which chunks are not drawn, 0 draws them at any distance.  Render thread only. */
+	void SetChunkDrawDistance_RenderThread(float InChunkDrawDistance)
+	{
+		check(IsInRenderingThread());
+		ChunkDrawDistance = InChunkDrawDistance;
+	}
+
+	/** @return Number of bytes of vertex and index data handed to the GPU when this proxy was initialized */
+	int64 GetUploadSizeBytes() const
+	{
+		return UploadSizeBytes;
+	}
+
 protected:
 
-	/** Initializes this scene proxy's vertex buffer, index buffer and vertex factory (on the render thread.) */
-	void InitResources(FStaticMeshVertexBuffers& VertexBuffer, FDynamicMeshIndexBuffer32& IndexBuffer, FLocalVertexFactory& VertexFactory);
+	/** Fills the parts of a MeshBatch drawing a chunk that the static and dynamic paths share */
+	void InitMeshBatch(struct FMeshBatch& Mesh, class FMaterialRenderProxy* MaterialProxy, const FStreetMapProxySection& Section, const FStreetMapProxyChunk& Chunk) const;
 
-	/** Makes a MeshBatch for rendering.  Called every time the mesh is drawn */
-	void MakeMeshBatch(struct FMeshBatch& Mesh, class FMeshElementCollector& Collector, class FMaterialRenderProxy* WireframeMaterialRenderProxyOrNull, const FStaticMeshVertexBuffers& VertexBuffer, const FDynamicMeshIndexBuffer32& IndexBuffer, const FLocalVertexFactory& VertexFactory, bool bDrawCollision = false) const;
+	/** Makes a MeshBatch for dynamic rendering.  Called every time the mesh is drawn dynamically */
+	void MakeMeshBatch(struct FMeshBatch& Mesh, class FMeshElementCollector& Collector, class FMaterialRenderProxy* WireframeMaterialRenderProxyOrNull, const FStreetMapProxySection& Section, const FStreetMapProxyChunk& Chunk, bool bDrawCollision = false) const;
 
 	/** Checks to see if this mesh must be drawn during the dynamic pass.  Note that even when this returns false, we may still
 	have other (debug) geometry to render as dynamic */
 	bool MustDrawMeshDynamically(const class FSceneView& View) const;
 
+	/** @return True if colors were uploaded within the last few frames */
+	bool IsColorStreamUpdating() const;
+
 	/** Returns true , if in a collision view */
 	bool IsInCollisionView(const FEngineShowFlags& EngineShowFlags) const;
 
+	/** @return True if a chunk is outside the view frustum or further than the chunk draw distance */
+	bool IsChunkCulled(const FSceneView& View, const FStreetMapProxyChunk& Chunk) const;
+
+	/** @return Level of detail a chunk's cell is drawn at, from the size of its bounds on screen */
+	int32 GetChunkLOD(const FSceneView& View, const FStreetMapProxyChunk& Chunk) const;
+
 	// FPrimitiveSceneProxy interface
-	//virtual void DrawStaticElements(class FStaticPrimitiveDrawInterface* PDI) override;
+	virtual void DrawStaticElements(class FStaticPrimitiveDrawInterface* PDI) override;
 	virtual void GetDynamicMeshElements(const TArray<const FSceneView*>& Views, const FSceneViewFamily& ViewFamily, uint32 VisibilityMap, class FMeshElementCollector& Collector) const override;
-	void AddDynamicMeshElements(const TArray<const FSceneView*>& Views, const FSceneViewFamily& ViewFamily, uint32 VisibilityMap, class FMeshElementCollector& Collector, const FStaticMeshVertexBuffers& VertexBuffer, const FDynamicMeshIndexBuffer32& IndexBuffer, const FLocalVertexFactory& VertexFactory) const;
+	void AddDynamicMeshElements(const TArray<const FSceneView*>& Views, const FSceneViewFamily& ViewFamily, uint32 VisibilityMap, class FMeshElementCollector& Collector, const FStreetMapProxySection& Section) const;
 	virtual uint32 GetMemoryFootprint(void) const override;
 	virtual FPrimitiveViewRelevance GetViewRelevance(const class FSceneView* View) const override;
 	virtual bool CanBeOccluded() const override;
+	virtual void OnTransformChanged() override;
 	
 protected:
 
-	/** Contains all of the vertices in our street map mesh */
-	FStaticMeshVertexBuffers StreetVertexBuffer;
-	FStaticMeshVertexBuffers MajorRoadVertexBuffer;
-	FStaticMeshVertexBuffers HighwayVertexBuffer;
-	FStaticMeshVertexBuffers BuildingVertexBuffer;
+	/** Render resources of each mesh section, indexed by EVertexType */
+	TUniquePtr<FStreetMapProxySection> Sections[NumSections];
+
+	/** Mesh the sections are created from, shared with the component */
+	TSharedPtr<const struct FStreetMapRenderData, ESPMode::ThreadSafe> RenderData;
+
+	/** Size of the vertex and index data of all sections */
+	int64 UploadSizeBytes;
+
+	/** Sections that are drawn, bit N for EVertexType N */
+	uint32 VisibleSectionMask;
+
+	/** Chunks further from the view than this are not drawn, 0 draws them at any distance */
+	float ChunkDrawDistance;
+
+	/** Screen size below which chunks switch to LOD 1, every halving of it switches to the next LOD */
+	float LODScreenSize;
+
+	/** Levels of detail of the mesh chunks, a section without chunks at a LOD draws nothing there */
+	int32 NumLODs;
 
-	/** All of the vertex indices32 in our street map mesh */
-	FDynamicMeshIndexBuffer32 StreetIndexBuffer32;
-	FDynamicMeshIndexBuffer32 MajorRoadIndexBuffer32;
-	FDynamicMeshIndexBuffer32 HighwayIndexBuffer32;
-	FDynamicMeshIndexBuffer32 BuildingIndexBuffer32;
+	/** If true, every frame draws dynamically so each chunk is culled and picks its LOD on its own */
+	bool bDrawChunksDynamically;
 
-	FLocalVertexFactory StreetVertexFactory;
-	FLocalVertexFactory MajorRoadVertexFactory;
-	FLocalVertexFactory HighwayVertexFactory;
-	FLocalVertexFactory BuildingVertexFactory;
+	/** Render thread frame of the last color upload, see IsColorStreamUpdating() */
+	uint32 LastColorUpdateFrame;
+	bool bHasColorUpdates;
+
+	/** Frames without color uploads after which the cached static batches are drawn again */
+	static const uint32 ColorStreamSettleFrames = 8;
 
 	/** Cached material relevance */
 	FMaterialRelevance MaterialRelevance;
@@ -167,4 +745,65 @@ protected:
 
 	// The Collision Response of the component being proxied
 	FCollisionResponseContainer CollisionResponse;
-};
\ No newline at end of file
+};
+
+/**
+ * Street map mesh laid out the way the scene proxy uploads it.  Built once per generated mesh, on the worker for
+ * asynchronous builds, then shared read-only by the component and every scene proxy created from it, so creating a
+ * proxy takes a reference rather than converting and copying every vertex.  Colors and the speed ratios in the
+ * texture coordinates keep changing after the build, so they live in separate streams.
+ */
+struct FStreetMapRenderData
+{
+	static const int32 NumTexCoords = 5;
+
+	/** Mesh sections, indexed by EVertexType */
+	FStreetMapSectionRenderData Sections[FStreetMapSceneProxy::NumSections];
+
+	/** Road indices in TexCoord5.Y need more precision than half floats.  Set before building any section. */
+	bool bFullPrecisionUVs = false;
+
+	/** Levels of detail of the mesh chunks of all sections */
+	int32 NumLODs = 1;
+
+	/**
+	* Lays out one mesh section
+	* @param MeshChunks	Spatial chunks of the whole mesh
+	* @param OutTexCoords	Set to a new texture coordinate stream holding the interleaved texture coordinates of the section
+	* @param OutColors	Set to a new color stream holding the vertex colors of the section
+	*/
+	void BuildSection(EVertexType Type, const TArray<FStreetMapVertex>& Vertices, const TArray<uint32>& Indices, const TArray<FStreetMapMeshChunk>& MeshChunks, FStreetMapTexCoordStreamPtr& OutTexCoords, FStreetMapColorStreamPtr& OutColors);
+
+	/** @return Bytes of one texture coordinate in the texture coordinate streams */
+	uint32 GetTexCoordSize() const
+	{
+		return bFullPrecisionUVs ? sizeof(FVector2D) : sizeof(FVector2DHalf);
+	}
+
+	/** @return Bytes of all the texture coordinates of one vertex in the texture coordinate streams */
+	uint32 GetTexCoordStride() const
+	{
+		return NumTexCoords * GetTexCoordSize();
+	}
+
+	/** Writes one texture coordinate of a vertex into a texture coordinate stream laid out by this data */
+	void SetTexCoord(TArray<uint8>& TexCoords, int32 VertexIndex, int32 UVIndex, const FVector2D& UV) const;
+
+	/**
+	* Writes the per-road texture coordinates of the vertices of one road, which the vertices don't hold
+	* @param Range	Vertex range of the road in Vertices and TexCoords
+	* @param SpeedRatio	Speed ratio of the road, written to TexCoord4.X next to the direction of each vertex
+	* @param RoadType	Type of the road, written to TexCoord5.X
+	* @param RoadIndex	Index of the road, written to TexCoord5.Y with full precision texture coordinates
+	*/
+	void SetRoadTexCoords(TArray<uint8>& TexCoords, const TArray<FStreetMapVertex>& Vertices, const FStreetMapVertexRange& Range, float SpeedRatio, float RoadType, int32 RoadIndex) const;
+
+	/** @return Bytes a scene proxy created from this data uploads, texture coordinates and colors included */
+	int64 GetUploadSizeBytes() const;
+
+	/** @return Bytes allocated by the layouts, texture coordinates and colors excluded */
+	SIZE_T GetAllocatedSize() const;
+
+	/** Measures the GPU buffers created from this data against the same streams without compact encodings */
+	void GetGPUMemoryStats(FStreetMapGPUMemoryStats& OutStats) const;
+};
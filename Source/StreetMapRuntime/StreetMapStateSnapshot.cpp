@@ -0,0 +1,283 @@
+// Copyright 2017 Mike Fricker. All Rights Reserved.
+
+#include "StreetMapStateSnapshot.h"
+#include "StreetMapRuntime.h"
+#include "StreetMap.h"
+#include "PredictiveData.h"
+#include "Misc/Compression.h"
+#include "Misc/FileHelper.h"
+#include "Serialization/MemoryWriter.h"
+#include "Serialization/MemoryReader.h"
+
+
+namespace StreetMapStateSnapshot
+{
+	static const uint32 FileMagic = 0x53534D53;	// "SMSS"
+	static const int32 FileVersion = 2;
+
+	/** Version 1 had no trace priorities */
+	static const int32 FileVersionNoPriorities = 1;
+}
+
+
+FStreetMapStateSnapshot::FStreetMapStateSnapshot()
+{
+}
+
+void FStreetMapStateSnapshot::Init(const TArray<FStreetMapRoad>& Roads)
+{
+	Ordinals.Reset();
+	TMCs.Reset();
+
+	// Same ordering as the flow history: first road of each TMC, in road order
+	for (const FStreetMapRoad& Road : Roads)
+	{
+		if (Road.TMC.IsNone() || Ordinals.Contains(Road.TMC)) continue;
+
+		Ordinals.Add(Road.TMC, TMCs.Num());
+		TMCs.Add(Road.TMC);
+	}
+
+	FlowSpeeds.Init(-1.0f, TMCs.Num());
+	PredictiveSpeeds.Init(-1.0f, TMCs.Num() * 4);
+
+	TraceGUIDs.Reset();
+	TraceColors.Reset();
+	TraceVisible.Reset();
+	TracePriorities.Reset();
+	TraceNumLinks.Reset();
+	LinkIds.Reset();
+	LinkDirs.Reset();
+	HighlightedRoads.Reset();
+}
+
+uint32 FStreetMapStateSnapshot::ComputeTMCsCrc() const
+{
+	uint32 Crc = 0;
+	for (const FName& TMC : TMCs)
+	{
+		Crc = FCrc::StrCrc32(*TMC.ToString(), Crc);
+	}
+	return Crc;
+}
+
+void FStreetMapStateSnapshot::CaptureData(const TMap<FName, float>& FlowData, const TMap<FName, FPredictiveData>& PredictiveData)
+{
+	for (const auto& Elem : FlowData)
+	{
+		if (const int32* Ordinal = Ordinals.Find(Elem.Key))
+		{
+			FlowSpeeds[*Ordinal] = Elem.Value;
+		}
+	}
+
+	for (const auto& Elem : PredictiveData)
+	{
+		if (const int32* Ordinal = Ordinals.Find(Elem.Key))
+		{
+			float* Speeds = &PredictiveSpeeds[*Ordinal * 4];
+			Speeds[0] = Elem.Value.S0;
+			Speeds[1] = Elem.Value.S15;
+			Speeds[2] = Elem.Value.S30;
+			Speeds[3] = Elem.Value.S45;
+		}
+	}
+}
+
+void FStreetMapStateSnapshot::AddTrace(const FStreetMapTrace& Trace, bool bVisible)
+{
+	TraceGUIDs.Add(Trace.GUID);
+	TraceColors.Add(Trace.Color);
+	TraceVisible.Add(bVisible ? 1 : 0);
+	TracePriorities.Add(Trace.Priority);
+	TraceNumLinks.Add(Trace.Links.Num());
+
+	for (const FStreetMapLink& Link : Trace.Links)
+	{
+		LinkIds.Add(Link.LinkId);
+		LinkDirs.Add(Link.LinkDir.Len() > 0 ? (uint8)Link.LinkDir[0] : (uint8)'T');
+	}
+}
+
+void FStreetMapStateSnapshot::RestoreData(TMap<FName, float>& OutFlowData, TMap<FName, FPredictiveData>& OutPredictiveData) const
+{
+	OutFlowData.Reset();
+	OutPredictiveData.Reset();
+	OutFlowData.Reserve(TMCs.Num());
+	OutPredictiveData.Reserve(TMCs.Num());
+
+	for (int32 Ordinal = 0; Ordinal < TMCs.Num(); ++Ordinal)
+	{
+		if (FlowSpeeds[Ordinal] >= 0.0f)
+		{
+			OutFlowData.Add(TMCs[Ordinal], FlowSpeeds[Ordinal]);
+		}
+
+		const float* Speeds = &PredictiveSpeeds[Ordinal * 4];
+		if (Speeds[0] >= 0.0f)
+		{
+			FPredictiveData& Data = OutPredictiveData.Add(TMCs[Ordinal]);
+			Data.S0 = Speeds[0];
+			Data.S15 = Speeds[1];
+			Data.S30 = Speeds[2];
+			Data.S45 = Speeds[3];
+		}
+	}
+
+	OutFlowData.Shrink();
+	OutPredictiveData.Shrink();
+}
+
+void FStreetMapStateSnapshot::RestoreTraces(TMap<FGuid, FStreetMapTrace>& OutTraces, TSet<FGuid>& OutHiddenTraces) const
+{
+	OutTraces.Reset();
+	OutHiddenTraces.Reset();
+	OutTraces.Reserve(TraceGUIDs.Num());
+
+	int32 FirstLink = 0;
+	for (int32 TraceIndex = 0; TraceIndex < TraceGUIDs.Num(); ++TraceIndex)
+	{
+		FStreetMapTrace& Trace = OutTraces.Add(TraceGUIDs[TraceIndex]);
+		Trace.GUID = TraceGUIDs[TraceIndex];
+		Trace.Color = TraceColors[TraceIndex];
+		Trace.Priority = TracePriorities[TraceIndex];
+
+		const int32 NumLinks = TraceNumLinks[TraceIndex];
+		Trace.Links.Reserve(NumLinks);
+		for (int32 LinkIndex = FirstLink; LinkIndex < FirstLink + NumLinks; ++LinkIndex)
+		{
+			const TCHAR LinkDir[2] = { (TCHAR)LinkDirs[LinkIndex], 0 };
+			Trace.Links.Add(FStreetMapLink(LinkIds[LinkIndex], LinkDir));
+		}
+		FirstLink += NumLinks;
+
+		if (!TraceVisible[TraceIndex])
+		{
+			OutHiddenTraces.Add(Trace.GUID);
+		}
+	}
+}
+
+bool FStreetMapStateSnapshot::SaveToFile(const FString& Path) const
+{
+	TArray<uint8> Body;
+	FMemoryWriter BodyWriter(Body);
+
+	// Dense arrays of plain values, each one is written and read as a single block
+	const_cast<TArray<float>&>(FlowSpeeds).BulkSerialize(BodyWriter);
+	const_cast<TArray<float>&>(PredictiveSpeeds).BulkSerialize(BodyWriter);
+	const_cast<TArray<FGuid>&>(TraceGUIDs).BulkSerialize(BodyWriter);
+	const_cast<TArray<FLinearColor>&>(TraceColors).BulkSerialize(BodyWriter);
+	const_cast<TArray<uint8>&>(TraceVisible).BulkSerialize(BodyWriter);
+	const_cast<TArray<int32>&>(TracePriorities).BulkSerialize(BodyWriter);
+	const_cast<TArray<int32>&>(TraceNumLinks).BulkSerialize(BodyWriter);
+	const_cast<TArray<int64>&>(LinkIds).BulkSerialize(BodyWriter);
+	const_cast<TArray<uint8>&>(LinkDirs).BulkSerialize(BodyWriter);
+	const_cast<TArray<int32>&>(HighlightedRoads).BulkSerialize(BodyWriter);
+
+	int32 UncompressedSize = Body.Num();
+	int32 CompressedSize = FCompression::CompressMemoryBound(NAME_Zlib, UncompressedSize);
+	TArray<uint8> Compressed;
+	Compressed.SetNumUninitialized(CompressedSize);
+	if (!FCompression::CompressMemory(NAME_Zlib, Compressed.GetData(), CompressedSize, Body.GetData(), UncompressedSize)) return false;
+	Compressed.SetNum(CompressedSize, false);
+
+	TArray<uint8> Bytes;
+	FMemoryWriter Writer(Bytes);
+
+	uint32 Magic = StreetMapStateSnapshot::FileMagic;
+	int32 Version = StreetMapStateSnapshot::FileVersion;
+	int32 NumTMCs = TMCs.Num();
+	uint32 TMCsCrc = ComputeTMCsCrc();
+	Writer << Magic << Version << NumTMCs << TMCsCrc;
+	Writer << UncompressedSize;
+	Writer << Compressed;
+
+	return FFileHelper::SaveArrayToFile(Bytes, *Path);
+}
+
+bool FStreetMapStateSnapshot::LoadFromFile(const FString& Path)
+{
+	TArray<uint8> Bytes;
+	if (!FFileHelper::LoadFileToArray(Bytes, *Path, FILEREAD_Silent)) return false;
+
+	FMemoryReader Reader(Bytes);
+
+	uint32 Magic = 0;
+	int32 Version = 0;
+	int32 NumTMCs = 0;
+	uint32 TMCsCrc = 0;
+	Reader << Magic << Version;
+	if (Magic != StreetMapStateSnapshot::FileMagic ||
+		(Version != StreetMapStateSnapshot::FileVersion && Version != StreetMapStateSnapshot::FileVersionNoPriorities)) return false;
+
+	// Ordinals are only meaningful for the same street map
+	Reader << NumTMCs << TMCsCrc;
+	if (NumTMCs != TMCs.Num() || TMCsCrc != ComputeTMCsCrc()) return false;
+
+	int32 UncompressedSize = 0;
+	TArray<uint8> Compressed;
+	Reader << UncompressedSize;
+	Reader << Compressed;
+	if (Reader.IsError() || UncompressedSize < 0) return false;
+
+	TArray<uint8> Body;
+	Body.SetNumUninitialized(UncompressedSize);
+	if (!FCompression::UncompressMemory(NAME_Zlib, Body.GetData(), UncompressedSize, Compressed.GetData(), Compressed.Num())) return false;
+
+	FMemoryReader BodyReader(Body);
+
+	TArray<float> LoadedFlowSpeeds;
+	TArray<float> LoadedPredictiveSpeeds;
+	TArray<FGuid> LoadedTraceGUIDs;
+	TArray<FLinearColor> LoadedTraceColors;
+	TArray<uint8> LoadedTraceVisible;
+	TArray<int32> LoadedTracePriorities;
+	TArray<int32> LoadedTraceNumLinks;
+	TArray<int64> LoadedLinkIds;
+	TArray<uint8> LoadedLinkDirs;
+	TArray<int32> LoadedHighlightedRoads;
+	LoadedFlowSpeeds.BulkSerialize(BodyReader);
+	LoadedPredictiveSpeeds.BulkSerialize(BodyReader);
+	LoadedTraceGUIDs.BulkSerialize(BodyReader);
+	LoadedTraceColors.BulkSerialize(BodyReader);
+	LoadedTraceVisible.BulkSerialize(BodyReader);
+	if (Version != StreetMapStateSnapshot::FileVersionNoPriorities)
+	{
+		LoadedTracePriorities.BulkSerialize(BodyReader);
+	}
+	else
+	{
+		LoadedTracePriorities.SetNumZeroed(LoadedTraceGUIDs.Num());
+	}
+	LoadedTraceNumLinks.BulkSerialize(BodyReader);
+	LoadedLinkIds.BulkSerialize(BodyReader);
+	LoadedLinkDirs.BulkSerialize(BodyReader);
+	LoadedHighlightedRoads.BulkSerialize(BodyReader);
+
+	if (BodyReader.IsError() || LoadedFlowSpeeds.Num() != NumTMCs || LoadedPredictiveSpeeds.Num() != NumTMCs * 4) return false;
+
+	const int32 NumTraces = LoadedTraceGUIDs.Num();
+	if (LoadedTraceColors.Num() != NumTraces || LoadedTraceVisible.Num() != NumTraces || LoadedTraceNumLinks.Num() != NumTraces ||
+		LoadedTracePriorities.Num() != NumTraces || LoadedLinkDirs.Num() != LoadedLinkIds.Num()) return false;
+
+	int64 NumLinks = 0;
+	for (int32 TraceNumLinksValue : LoadedTraceNumLinks)
+	{
+		if (TraceNumLinksValue < 0) return false;
+		NumLinks += TraceNumLinksValue;
+	}
+	if (NumLinks != LoadedLinkIds.Num()) return false;
+
+	FlowSpeeds = MoveTemp(LoadedFlowSpeeds);
+	PredictiveSpeeds = MoveTemp(LoadedPredictiveSpeeds);
+	TraceGUIDs = MoveTemp(LoadedTraceGUIDs);
+	TraceColors = MoveTemp(LoadedTraceColors);
+	TraceVisible = MoveTemp(LoadedTraceVisible);
+	TracePriorities = MoveTemp(LoadedTracePriorities);
+	TraceNumLinks = MoveTemp(LoadedTraceNumLinks);
+	LinkIds = MoveTemp(LoadedLinkIds);
+	LinkDirs = MoveTemp(LoadedLinkDirs);
+	HighlightedRoads = MoveTemp(LoadedHighlightedRoads);
+	return true;
+}
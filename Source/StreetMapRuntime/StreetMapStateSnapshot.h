@@ -0,0 +1,81 @@
+// Copyright 2017 Mike Fricker. All Rights Reserved.
+#pragma once
+
+#include "CoreMinimal.h"
+
+struct FStreetMapRoad;
+struct FStreetMapTrace;
+struct FPredictiveData;
+
+/**
+ * Runtime state of a street map component: flow and predictive data, traces with their visibility and
+ * highlighted roads.  Everything is held in dense arrays, TMCs by their ordinal in the street map, so saving and
+ * loading is one bulk copy per array and the file is a single zlib block.  A snapshot only loads against the street
+ * map it was taken from, which is checked with a checksum of the TMC table.
+ */
+class FStreetMapStateSnapshot
+{
+
+public:
+
+	FStreetMapStateSnapshot();
+
+	/** Assigns an ordinal to every TMC of the roads, must be called before anything else */
+	void Init(const TArray<FStreetMapRoad>& Roads);
+
+	/** Copies the flow and predictive data of every TMC on the roads, other TMCs are dropped */
+	void CaptureData(const TMap<FName, float>& FlowData, const TMap<FName, FPredictiveData>& PredictiveData);
+
+	/** Adds a trace with its visibility */
+	void AddTrace(const FStreetMapTrace& Trace, bool bVisible);
+
+	/** Adds a highlighted road */
+	void AddHighlightedRoad(int32 RoadIndex)
+	{
+		HighlightedRoads.Add(RoadIndex);
+	}
+
+	/** Replaces the contents of the maps with the captured data */
+	void RestoreData(TMap<FName, float>& OutFlowData, TMap<FName, FPredictiveData>& OutPredictiveData) const;
+
+	/** Replaces the traces and the set of hidden traces with the captured ones */
+	void RestoreTraces(TMap<FGuid, FStreetMapTrace>& OutTraces, TSet<FGuid>& OutHiddenTraces) const;
+
+	const TArray<int32>& GetHighlightedRoads() const
+	{
+		return HighlightedRoads;
+	}
+
+	/** Writes the snapshot, about 20 bytes per TMC with data before compression */
+	bool SaveToFile(const FString& Path) const;
+
+	/** Reads a snapshot of the street map passed to Init(), fails on any other */
+	bool LoadFromFile(const FString& Path);
+
+private:
+
+	/** Checksum of the TMC table */
+	uint32 ComputeTMCsCrc() const;
+
+	TMap<FName, int32> Ordinals;
+	TArray<FName> TMCs;
+
+	/** Speed per TMC ordinal, negative without data */
+	TArray<float> FlowSpeeds;
+
+	/** S0, S15, S30 and S45 per TMC ordinal, S0 negative without data */
+	TArray<float> PredictiveSpeeds;
+
+	/** Traces, their links are consecutive in the link arrays */
+	TArray<FGuid> TraceGUIDs;
+	TArray<FLinearColor> TraceColors;
+	TArray<uint8> TraceVisible;
+	TArray<int32> TracePriorities;
+	TArray<int32> TraceNumLinks;
+
+	/** Links of all traces, directions are "T" or "F" and stored as their character */
+	TArray<int64> LinkIds;
+	TArray<uint8> LinkDirs;
+
+	TArray<int32> HighlightedRoads;
+};
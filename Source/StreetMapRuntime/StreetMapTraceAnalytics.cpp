@@ -0,0 +1,142 @@
+// Copyright 2017 Mike Fricker. All Rights Reserved.
+
+#include "StreetMapTraceAnalytics.h"
+#include "StreetMapRuntime.h"
+#include "Async/ParallelFor.h"
+
+
+const float FStreetMapTraceAnalyticsPass::MinSpeed = 0.1f;
+
+void FStreetMapTraceAnalyticsPass::Init(const TArray<FStreetMapRoad>& Roads)
+{
+	RoadDistances.SetNumUninitialized(Roads.Num());
+	RoadSpeedLimits.SetNumUninitialized(Roads.Num());
+
+	TArray<int32> RoadOrdinals;
+	RoadOrdinals.SetNumUninitialized(Roads.Num());
+	Ordinals.Reset();
+
+	for (int32 RoadIndex = 0; RoadIndex < Roads.Num(); ++RoadIndex)
+	{
+		const FStreetMapRoad& Road = Roads[RoadIndex];
+		RoadDistances[RoadIndex] = Road.Distance;
+		RoadSpeedLimits[RoadIndex] = (float)Road.SpeedLimit;
+
+		int32 Ordinal = INDEX_NONE;
+		if (!Road.TMC.IsNone())
+		{
+			if (const int32* Existing = Ordinals.Find(Road.TMC))
+			{
+				Ordinal = *Existing;
+			}
+			else
+			{
+				Ordinal = Ordinals.Num();
+				Ordinals.Add(Road.TMC, Ordinal);
+			}
+		}
+		RoadOrdinals[RoadIndex] = Ordinal;
+	}
+
+	for (TArray<float>& Speeds : RoadSpeeds)
+	{
+		Speeds = RoadSpeedLimits;
+	}
+
+	// Roads grouped by TMC, counted first then placed
+	TMCFirstRoadEntries.Init(0, Ordinals.Num() + 1);
+	for (int32 Ordinal : RoadOrdinals)
+	{
+		if (Ordinal != INDEX_NONE) TMCFirstRoadEntries[Ordinal + 1]++;
+	}
+	for (int32 Ordinal = 0; Ordinal < Ordinals.Num(); ++Ordinal)
+	{
+		TMCFirstRoadEntries[Ordinal + 1] += TMCFirstRoadEntries[Ordinal];
+	}
+
+	TArray<int32> NextEntries(TMCFirstRoadEntries.GetData(), Ordinals.Num());
+	TMCRoads.SetNumUninitialized(TMCFirstRoadEntries.Last());
+	for (int32 RoadIndex = 0; RoadIndex < RoadOrdinals.Num(); ++RoadIndex)
+	{
+		const int32 Ordinal = RoadOrdinals[RoadIndex];
+		if (Ordinal != INDEX_NONE) TMCRoads[NextEntries[Ordinal]++] = RoadIndex;
+	}
+}
+
+void FStreetMapTraceAnalyticsPass::Reset()
+{
+	RoadDistances.Empty();
+	RoadSpeedLimits.Empty();
+	for (TArray<float>& Speeds : RoadSpeeds)
+	{
+		Speeds.Empty();
+	}
+	Ordinals.Empty();
+	TMCFirstRoadEntries.Empty();
+	TMCRoads.Empty();
+}
+
+void FStreetMapTraceAnalyticsPass::SetTMCSpeed(FName TMC, EHorizon Horizon, float Speed)
+{
+	const int32* Ordinal = Ordinals.Find(TMC);
+	if (Ordinal == nullptr) return;
+
+	TArray<float>& Speeds = RoadSpeeds[Horizon];
+	for (int32 Entry = TMCFirstRoadEntries[*Ordinal]; Entry < TMCFirstRoadEntries[*Ordinal + 1]; ++Entry)
+	{
+		const int32 RoadIndex = TMCRoads[Entry];
+		Speeds[RoadIndex] = Speed >= 0.0f ? Speed : RoadSpeedLimits[RoadIndex];
+	}
+}
+
+void FStreetMapTraceAnalyticsPass::ClearHorizon(EHorizon Horizon)
+{
+	RoadSpeeds[Horizon] = RoadSpeedLimits;
+}
+
+void FStreetMapTraceAnalyticsPass::Run(const TArray<const FStreetMapTrace*>& Traces, const TMap<FStreetMapLink, int>& Link2RoadIndex, TArray<FStreetMapTraceAnalytics>& OutRows) const
+{
+	OutRows.SetNum(Traces.Num());
+
+	ParallelFor(Traces.Num(), [&](int32 TraceIndex)
+	{
+		const FStreetMapTrace& Trace = *Traces[TraceIndex];
+
+		// Speeds are per hour, times in minutes
+		float Distance = 0.0f;
+		float FreeFlowTime = 0.0f;
+		float Times[NumHorizons] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+		int32 NumRoads = 0;
+
+		for (const FStreetMapLink& Link : Trace.Links)
+		{
+			const int* RoadIndex = Link2RoadIndex.Find(Link);
+			if (RoadIndex == nullptr) continue;
+
+			const float RoadMinutes = RoadDistances[*RoadIndex] * 60.0f;
+			Distance += RoadDistances[*RoadIndex];
+			FreeFlowTime += RoadMinutes / FMath::Max(RoadSpeedLimits[*RoadIndex], MinSpeed);
+			for (int32 Horizon = 0; Horizon < NumHorizons; ++Horizon)
+			{
+				Times[Horizon] += RoadMinutes / FMath::Max(RoadSpeeds[Horizon][*RoadIndex], MinSpeed);
+			}
+			++NumRoads;
+		}
+
+		FStreetMapTraceAnalytics& Row = OutRows[TraceIndex];
+		Row.TraceGUID = Trace.GUID;
+		Row.Distance = Distance;
+		Row.NumRoads = NumRoads;
+		Row.FreeFlowTime = FreeFlowTime;
+		Row.FlowTime = Times[Flow];
+		Row.S0Time = Times[S0];
+		Row.S15Time = Times[S15];
+		Row.S30Time = Times[S30];
+		Row.S45Time = Times[S45];
+		Row.FlowDelay = Times[Flow] - FreeFlowTime;
+		Row.S0Delay = Times[S0] - FreeFlowTime;
+		Row.S15Delay = Times[S15] - FreeFlowTime;
+		Row.S30Delay = Times[S30] - FreeFlowTime;
+		Row.S45Delay = Times[S45] - FreeFlowTime;
+	});
+}
@@ -0,0 +1,48 @@
+// Copyright 2017 Mike Fricker. All Rights Reserved.
+
+#include "StreetMapTraceStacks.h"
+#include "StreetMapRuntime.h"
+
+
+FStreetMapTraceStacks::FStreetMapTraceStacks()
+	: LastOrder(0)
+{
+}
+
+void FStreetMapTraceStacks::Reset()
+{
+	Stacks.Reset();
+}
+
+void FStreetMapTraceStacks::Push(int32 RoadIndex, const FGuid& TraceGUID, FColor Color, int32 Priority, uint32 Order)
+{
+	FStack& Stack = Stacks.FindOrAdd(RoadIndex);
+
+	Stack.RemoveAll([&TraceGUID](const FEntry& Entry) { return Entry.TraceGUID == TraceGUID; });
+
+	FEntry NewEntry;
+	NewEntry.TraceGUID = TraceGUID;
+	NewEntry.Color = Color;
+	NewEntry.Priority = Priority;
+	NewEntry.Order = Order;
+
+	// Insertion sort, stacks hold a handful of entries at most
+	int32 Position = Stack.Num();
+	while (Position > 0 && Stack[Position - 1].IsAbove(NewEntry))
+	{
+		--Position;
+	}
+	Stack.Insert(NewEntry, Position);
+}
+
+void FStreetMapTraceStacks::Remove(int32 RoadIndex, const FGuid& TraceGUID)
+{
+	FStack* Stack = Stacks.Find(RoadIndex);
+	if (Stack == nullptr) return;
+
+	Stack->RemoveAll([&TraceGUID](const FEntry& Entry) { return Entry.TraceGUID == TraceGUID; });
+	if (Stack->Num() == 0)
+	{
+		Stacks.Remove(RoadIndex);
+	}
+}
@@ -0,0 +1,71 @@
+// Copyright 2017 Mike Fricker. All Rights Reserved.
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Visible traces of every road, ordered by priority.  A road on several traces is drawn with the trace on top of its
+ * stack: the highest priority, then the one shown last.  Most roads are on no trace and have no stack at all, and a
+ * road rarely sits on more than a couple of traces, so stacks are small inline arrays in a sparse map.
+ * Showing or hiding a trace only touches the stacks of its own roads.
+ */
+class FStreetMapTraceStacks
+{
+
+public:
+
+	/** A visible trace on a road */
+	struct FEntry
+	{
+		FGuid TraceGUID;
+		FColor Color;
+		int32 Priority;
+
+		/** Order in which traces were shown, later ones win among equal priorities */
+		uint32 Order;
+
+		bool IsAbove(const FEntry& Other) const
+		{
+			return Priority != Other.Priority ? Priority > Other.Priority : Order > Other.Order;
+		}
+	};
+
+	FStreetMapTraceStacks();
+
+	/** Removes every trace from every road */
+	void Reset();
+
+	/** Puts a trace on a road, or moves it to its new priority and order if it is already there */
+	void Push(int32 RoadIndex, const FGuid& TraceGUID, FColor Color, int32 Priority, uint32 Order);
+
+	/** Takes a trace off a road */
+	void Remove(int32 RoadIndex, const FGuid& TraceGUID);
+
+	/** @return The trace a road is drawn with, null if the road is on no visible trace */
+	const FEntry* GetTop(int32 RoadIndex) const
+	{
+		const FStack* Stack = Stacks.Find(RoadIndex);
+		return Stack ? &Stack->Last() : nullptr;
+	}
+
+	/** @return Number of roads on at least one visible trace */
+	int32 NumRoads() const
+	{
+		return Stacks.Num();
+	}
+
+	/** @return A new show order, above every trace shown so far */
+	uint32 NextOrder()
+	{
+		return ++LastOrder;
+	}
+
+private:
+
+	/** Entries of a road, sorted bottom to top */
+	typedef TArray<FEntry, TInlineAllocator<2>> FStack;
+
+	TMap<int32, FStack> Stacks;
+
+	uint32 LastOrder;
+};